@@ -0,0 +1,371 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "corpus.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+// splitmix64: small, fast and good enough to drive the generator.
+static uint64_t next(uint64_t * s) {
+    uint64_t z = (*s += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static uint64_t range(uint64_t * s, uint64_t lo, uint64_t hi) { return lo + next(s) % (hi - lo + 1); }
+
+static uint64_t hash64(uint64_t x) { return next(&x); }
+
+static const char * const kind_names[CORPUS_KINDS] = { "overwrite", "insert", "delete", "move",
+                                                        "reloc",     "text",   "mixed" };
+
+const char * corpus_kind_name(enum corpus_kind kind) { return kind < CORPUS_KINDS ? kind_names[kind] : "unknown"; }
+
+int corpus_kind_parse(const char * name) {
+    for (int i = 0; i < CORPUS_KINDS; i++)
+        if (!strcmp(name, kind_names[i])) return i;
+    return -1;
+}
+
+size_t corpus_parse_size(const char * str) {
+    char * end;
+    unsigned long long v = strtoull(str, &end, 10);
+    switch (toupper((unsigned char)*end)) {
+        case 'K':
+            v *= 1000;
+            end++;
+            break;
+        case 'M':
+            v *= 1000000;
+            end++;
+            break;
+        case 'G':
+            v *= 1000000000;
+            end++;
+            break;
+    }
+    return *end || end == str ? 0 : (size_t)v;
+}
+
+// Base content generators.
+
+static void fill_random(uint8_t * buf, size_t len, uint64_t * s) {
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t r = next(s);
+        memcpy(buf + i, &r, 8);
+    }
+    for (; i < len; i++) buf[i] = next(s);
+}
+
+// Skewed pick from a fixed vocabulary, so that the result compresses like natural text.
+static void fill_text(uint8_t * buf, size_t len, uint64_t * s) {
+    static const char * const syll[16] = { "ka", "mi", "lo", "re", "tu", "sa", "ne", "po",
+                                           "di", "ga", "va", "xe", "ru", "fo", "bi", "ze" };
+    size_t i = 0;
+    while (i < len) {
+        uint64_t r = next(s);
+        uint64_t w = ((r & 0x3ff) * ((r >> 10) & 0x3ff)) >> 10;
+        int sylls = 1 + (w & 3);
+        for (int k = 0; k < sylls && i < len; k++, w >>= 4)
+            for (const char * p = syll[(w >> 2) & 15]; *p && i < len; p++) buf[i++] = *p;
+        if (i < len) buf[i++] = (r >> 20) % 13 ? ' ' : '\n';
+    }
+}
+
+static void fill_mixed(uint8_t * buf, size_t len, uint64_t * s) {
+    for (size_t i = 0; i < len; i += 65536) {
+        size_t n = len - i < 65536 ? len - i : 65536;
+        if ((i >> 16) & 1)
+            fill_random(buf + i, n, s);
+        else
+            fill_text(buf + i, n, s);
+    }
+}
+
+// Generic edit model: the new file is a sequence of segments, each either a slice of the old
+// file or a literal run produced by the base content generator.
+
+struct segment {
+    uint64_t src, len;
+    int literal;
+};
+
+struct seglist {
+    struct segment * s;
+    size_t n, cap;
+};
+
+static int push(struct seglist * l, uint64_t src, uint64_t len, int literal) {
+    if (!len) return 0;
+    if (l->n == l->cap) {
+        size_t cap = l->cap ? l->cap * 2 : 1024;
+        struct segment * s = realloc(l->s, cap * sizeof(*s));
+        if (!s) return -1;
+        l->s = s;
+        l->cap = cap;
+    }
+    l->s[l->n++] = (struct segment){ src, len, literal };
+    return 0;
+}
+
+static int cmp_u64(const void * a, const void * b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int edit_generic(enum corpus_kind kind, void (*fill)(uint8_t *, size_t, uint64_t *), uint64_t * s,
+                        struct corpus * c) {
+    size_t size = c->old_len;
+    if (!size) {
+        c->new = malloc(1);
+        return c->new ? 0 : -1;
+    }
+
+    size_t n = size >> 15;
+    if (kind == CORPUS_MOVE) n >>= 5;
+    if (n < 4) n = 4;
+
+    uint64_t * cuts = malloc(n * sizeof(uint64_t));
+    struct seglist l = { 0 };
+    if (!cuts) return -1;
+    for (size_t i = 0; i < n; i++) cuts[i] = next(s) % size;
+    qsort(cuts, n, sizeof(uint64_t), cmp_u64);
+
+    uint64_t pos = 0;
+    int err = 0;
+    for (size_t i = 0; i < n && !err; i++) {
+        uint64_t cut = cuts[i] < pos ? pos : cuts[i];
+        uint64_t limit = i + 1 < n ? cuts[i + 1] : size;
+        if (limit < cut) limit = cut;
+        err |= push(&l, pos, cut - pos, 0);
+        pos = cut;
+
+        enum corpus_kind k = kind;
+        if (kind == CORPUS_TEXT || kind == CORPUS_MIXED) k = (enum corpus_kind)range(s, CORPUS_OVERWRITE, CORPUS_DELETE);
+
+        uint64_t len;
+        switch (k) {
+            case CORPUS_OVERWRITE:
+                len = range(s, 1, 64);
+                if (len > limit - cut) len = limit - cut;
+                err |= push(&l, 0, len, 1);
+                pos += len;
+                break;
+            case CORPUS_INSERT:
+                err |= push(&l, 0, range(s, 1, 512), 1);
+                break;
+            case CORPUS_DELETE:
+                len = range(s, 1, 512);
+                pos += len > limit - cut ? limit - cut : len;
+                break;
+            case CORPUS_MOVE:
+                if (next(s) & 1) err |= push(&l, 0, range(s, 1, 256), 1);
+                break;
+            default:
+                break;
+        }
+    }
+    err |= push(&l, pos, size - pos, 0);
+    free(cuts);
+
+    // Shuffle sections around: swap random pairs of old-file segments.
+    if (!err && (kind == CORPUS_MOVE || kind == CORPUS_MIXED)) {
+        size_t swaps = kind == CORPUS_MOVE ? l.n / 2 : l.n / 64;
+        for (size_t i = 0; i < swaps; i++) {
+            size_t a = next(s) % l.n, b = next(s) % l.n;
+            struct segment t = l.s[a];
+            l.s[a] = l.s[b];
+            l.s[b] = t;
+        }
+    }
+
+    size_t new_len = 0;
+    for (size_t i = 0; i < l.n; i++) new_len += l.s[i].len;
+    c->new = err ? NULL : malloc(new_len ? new_len : 1);
+    if (!c->new) {
+        free(l.s);
+        return -1;
+    }
+
+    c->new_len = new_len;
+    for (size_t i = 0, p = 0; i < l.n; p += l.s[i++].len) {
+        if (l.s[i].literal)
+            fill(c->new + p, l.s[i].len, s);
+        else
+            memcpy(c->new + p, c->old + l.s[i].src, l.s[i].len);
+    }
+
+    free(l.s);
+    return 0;
+}
+
+// Code-like corpus. Functions start at pseudo-random but O(1)-computable offsets; bodies are
+// filler from a small opcode alphabet interleaved with E8 rel32 calls to other functions, and
+// the last eighth of the file is a table of absolute 64-bit function pointers. The new file
+// inserts code before a number of functions, which moves every function after them, so every
+// call and pointer that crosses an insertion changes. Both files are generated from the same
+// random stream, once per layout.
+
+#define RELOC_BASE 0x400000ULL
+#define FUNC_STRIDE 160
+
+static uint64_t func_start(uint64_t i) { return i * FUNC_STRIDE + hash64(i) % 128; }
+
+struct insertion {
+    uint64_t func, len, shift;  // shift = total bytes inserted up to and including this one.
+};
+
+static uint64_t shift_of(const struct insertion * ins, size_t n, uint64_t func) {
+    size_t lo = 0, hi = n;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (ins[mid].func <= func)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo ? ins[lo - 1].shift : 0;
+}
+
+static void put32(uint8_t * p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = v >> (8 * i);
+}
+
+static void put64(uint8_t * p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = v >> (8 * i);
+}
+
+static void emit_code(uint8_t * out, uint64_t code_len, uint64_t funcs, uint64_t data_len, uint64_t seed,
+                      const struct insertion * ins, size_t n_ins) {
+    static const uint8_t ops[16] = { 0x48, 0x89, 0x8b, 0x83, 0xc3, 0x0f, 0x85, 0x74,
+                                     0x31, 0xc0, 0x55, 0x5d, 0x41, 0xff, 0x24, 0x90 };
+    uint64_t s = seed, p = 0;
+    size_t next_ins = 0;
+
+    for (uint64_t f = 0; f < funcs; f++) {
+        uint64_t body = (f + 1 < funcs ? func_start(f + 1) : code_len) - func_start(f);
+        if (next_ins < n_ins && ins[next_ins].func == f) {
+            uint64_t bs = hash64(seed ^ (f * 0x51ED27ULL));
+            for (uint64_t i = 0; i < ins[next_ins].len; i++) out[p++] = ops[next(&bs) & 15];
+            next_ins++;
+        }
+        for (uint64_t b = 0; b < body;) {
+            uint64_t r = next(&s);
+            if (r % 5 == 0 && body - b >= 5) {
+                uint64_t target = (r >> 8) % funcs;
+                uint64_t dst = func_start(target) + shift_of(ins, n_ins, target);
+                out[p] = 0xe8;
+                put32(out + p + 1, (uint32_t)(dst - (p + 5)));
+                p += 5;
+                b += 5;
+            } else {
+                out[p++] = ops[(r >> 8) & 15];
+                b++;
+            }
+        }
+    }
+
+    for (uint64_t d = 0; d + 8 <= data_len; d += 8) {
+        uint64_t target = next(&s) % funcs;
+        put64(out + p, RELOC_BASE + func_start(target) + shift_of(ins, n_ins, target));
+        p += 8;
+    }
+    memset(out + p, 0, data_len % 8);
+}
+
+static int gen_reloc(size_t size, uint64_t * s, struct corpus * c) {
+    uint64_t data_len = size / 8, code_len = size - data_len;
+    uint64_t funcs = code_len / FUNC_STRIDE;
+    if (funcs < 2) {
+        // Too small to be code-like; degenerate to plain insertions.
+        fill_random(c->old, size, s);
+        return edit_generic(CORPUS_INSERT, fill_random, s, c);
+    }
+    while (func_start(funcs - 1) >= code_len) funcs--;
+
+    size_t n = size >> 15;
+    if (n < 4) n = 4;
+    struct insertion * ins = malloc(n * sizeof(*ins));
+    if (!ins) return -1;
+    for (size_t i = 0; i < n; i++) ins[i].func = next(s) % funcs;
+    qsort(ins, n, sizeof(*ins), cmp_u64);
+
+    size_t k = 0;
+    uint64_t total = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (k && ins[k - 1].func == ins[i].func) continue;
+        ins[k].func = ins[i].func;
+        ins[k].len = range(s, 1, 256);
+        total += ins[k].len;
+        ins[k++].shift = total;
+    }
+
+    uint64_t seed = next(s);
+    c->new_len = size + total;
+    c->new = malloc(c->new_len);
+    if (!c->new) {
+        free(ins);
+        return -1;
+    }
+
+    emit_code(c->old, code_len, funcs, data_len, seed, NULL, 0);
+    emit_code(c->new, code_len, funcs, data_len, seed, ins, k);
+    free(ins);
+    return 0;
+}
+
+int corpus_generate(enum corpus_kind kind, size_t size, uint64_t seed, struct corpus * c) {
+    uint64_t s = seed * 0x2545F4914F6CDD1DULL + kind;
+    memset(c, 0, sizeof(*c));
+    c->old_len = size;
+    c->old = malloc(size ? size : 1);
+    if (!c->old) return -1;
+
+    int ret;
+    switch (kind) {
+        case CORPUS_RELOC:
+            ret = gen_reloc(size, &s, c);
+            break;
+        case CORPUS_TEXT:
+            fill_text(c->old, size, &s);
+            ret = edit_generic(kind, fill_text, &s, c);
+            break;
+        case CORPUS_MIXED:
+            fill_mixed(c->old, size, &s);
+            ret = edit_generic(kind, fill_mixed, &s, c);
+            break;
+        default:
+            fill_random(c->old, size, &s);
+            ret = edit_generic(kind, fill_random, &s, c);
+            break;
+    }
+
+    if (ret) corpus_free(c);
+    return ret;
+}
+
+void corpus_free(struct corpus * c) {
+    free(c->old);
+    free(c->new);
+    c->old = c->new = NULL;
+    c->old_len = c->new_len = 0;
+}
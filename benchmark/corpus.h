@@ -0,0 +1,54 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Deterministic generator of old/new file pairs that resemble real updates.
+// The same (kind, size, seed) triple always yields byte-identical output.
+
+enum corpus_kind {
+    CORPUS_OVERWRITE,  // Random bytes overwritten in place (what benchmark/modbytes.c does).
+    CORPUS_INSERT,     // Short insertions, shifting everything after them.
+    CORPUS_DELETE,     // Short deletions.
+    CORPUS_MOVE,       // Large sections moved around the file.
+    CORPUS_RELOC,      // Code-like data where inserted code relocates rel32 calls and absolute pointers.
+    CORPUS_TEXT,       // Compressible text with insertions, deletions and rewrites.
+    CORPUS_MIXED,      // All of the above applied to a half-text, half-binary file.
+    CORPUS_KINDS
+};
+
+struct corpus {
+    uint8_t *old, *new;
+    size_t old_len, new_len;
+};
+
+const char * corpus_kind_name(enum corpus_kind kind);
+int corpus_kind_parse(const char * name);
+
+// Parses sizes such as "10K", "4G" or "123". Returns 0 on error.
+size_t corpus_parse_size(const char * str);
+
+// Returns 0 on success and -1 when out of memory.
+int corpus_generate(enum corpus_kind kind, size_t size, uint64_t seed, struct corpus * c);
+void corpus_free(struct corpus * c);
+
+#endif
@@ -0,0 +1,266 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Microbenchmarks for the hot kernels of the library. The library source is included
+// directly, so that its static functions can be timed in isolation on controlled inputs.
+// Every kernel is run a number of times and the fastest run is reported, in timestamp
+// counter ticks (CPU cycles on x86) and nanoseconds per unit of work, as JSON lines.
+
+#define _GNU_SOURCE
+#include <time.h>
+
+#include "../src/libqbdiff.c"
+#include "corpus.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+static inline uint64_t ticks(void) { return __rdtsc(); }
+    #define TICK_UNIT "cycles"
+#elif defined(__aarch64__)
+static inline uint64_t ticks(void) {
+    uint64_t v;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+}
+    #define TICK_UNIT "ticks"
+#else
+static inline uint64_t ticks(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+    #define TICK_UNIT "ns"
+#endif
+
+// Keeps results alive so that the compiler does not elide the work.
+static volatile int64_t sink;
+
+static int runs = 5;
+static const char * filter = NULL;
+
+struct timing {
+    uint64_t ticks;
+    double secs;
+};
+
+#define BENCH(name, param, units, unit_name, body)                                                                \
+    do {                                                                                                          \
+        if (filter && !strstr(name, filter)) break;                                                               \
+        struct timing best = { UINT64_MAX, 1e30 };                                                                \
+        for (int run = 0; run < runs; run++) {                                                                    \
+            double s0 = now();                                                                                    \
+            uint64_t t0 = ticks();                                                                                \
+            body;                                                                                                 \
+            uint64_t t = ticks() - t0;                                                                            \
+            double s = now() - s0;                                                                                \
+            if (t < best.ticks) best.ticks = t;                                                                   \
+            if (s < best.secs) best.secs = s;                                                                     \
+        }                                                                                                         \
+        printf("{\"kernel\":\"%s\",\"param\":\"%s\",\"units\":%.0f,\"unit\":\"%s\",\"" TICK_UNIT                  \
+               "_per_unit\":%.3f,\"ns_per_unit\":%.3f,\"mbps\":%.3f}\n",                                           \
+               name, param, (double)(units), unit_name, best.ticks / (double)(units), best.secs * 1e9 / (units), \
+               !strcmp(unit_name, "byte") ? (units) / best.secs / 1e6 : 0.0);                                    \
+        fflush(stdout);                                                                                           \
+    } while (0)
+
+static uint8_t * xmalloc(size_t n) {
+    uint8_t * p = malloc(n);
+    if (!p) {
+        fprintf(stderr, "Out of memory.\n");
+        exit(1);
+    }
+    return p;
+}
+
+// Copies `src' and flips one byte in every `period' on average.
+static uint8_t * mutate(const uint8_t * src, size_t n, size_t period) {
+    uint8_t * dst = xmalloc(n);
+    memcpy(dst, src, n);
+    uint64_t s = 12345;
+    for (size_t i = 0; i < n;) {
+        s = s * 6364136223846793005ULL + 1442695040888963407ULL;
+        dst[i] ^= 0x5a;
+        i += 1 + (s >> 33) % (2 * period - 1);
+    }
+    return dst;
+}
+
+static void bench_matchlen(void) {
+    static const size_t lens[] = { 64, 4096, 1 << 20 };
+    for (size_t k = 0; k < sizeof(lens) / sizeof(lens[0]); k++) {
+        size_t n = lens[k], iters = (64 << 20) / n;
+        uint8_t *a = xmalloc(n), *b = xmalloc(n);
+        for (size_t i = 0; i < n; i++) a[i] = b[i] = i * 31 + (i >> 8);
+        char param[32];
+        snprintf(param, sizeof(param), "%zu", n);
+        BENCH("matchlen", param, (double)n * iters, "byte", {
+            for (size_t i = 0; i < iters; i++) sink += matchlen(a, n, b, n);
+        });
+        free(a);
+        free(b);
+    }
+}
+
+// Suffix array searches of positions in an edited copy of a mixed text/binary old file.
+static void bench_search(const struct corpus * c) {
+    enum { QUERIES = 4096 };
+    int64_t * pos = malloc(QUERIES * sizeof(int64_t));
+    uint64_t s = 777;
+    for (int i = 0; i < QUERIES; i++) pos[i] = (s = s * 6364136223846793005ULL + 1) % c->new_len;
+
+    int32_t * I32 = malloc((c->old_len + 1) * sizeof(int32_t));
+    int64_t * I64 = malloc((c->old_len + 1) * sizeof(int64_t));
+    if (!pos || !I32 || !I64 || libsais(c->old, I32, c->old_len, 1, NULL) < 0 ||
+        libsais64(c->old, I64, c->old_len, 1, NULL) < 0) {
+        fprintf(stderr, "Failed to build the suffix arrays.\n");
+        exit(1);
+    }
+
+    int64_t old_pos, len;
+    BENCH("search32", "4M", QUERIES, "query", {
+        for (int i = 0; i < QUERIES; i++) {
+            search32(I32, c->old, c->old_len, c->new + pos[i], c->new_len - pos[i], 0, c->old_len - 1, &old_pos, &len);
+            sink += len;
+        }
+    });
+    BENCH("search64", "4M", QUERIES, "query", {
+        for (int i = 0; i < QUERIES; i++) {
+            search64(I64, c->old, c->old_len, c->new + pos[i], c->new_len - pos[i], 0, c->old_len - 1, &old_pos, &len);
+            sink += len;
+        }
+    });
+
+    free(pos);
+    free(I32);
+    free(I64);
+}
+
+// Fuzzy extension scoring over a region where about every 16th byte differs.
+static void bench_fuzzy(const struct corpus * c) {
+    int64_t n = min(c->old_len, 1 << 20);
+    uint8_t * new = mutate(c->old, n, 16);
+    BENCH("fuzzy_forward", "1M", n, "byte", { sink += fuzzy_forward(c->old, n, new, 0, 0, n); });
+    BENCH("fuzzy_backward", "1M", n, "byte", { sink += fuzzy_backward(c->old, new, n, n, 0); });
+    free(new);
+}
+
+// The reconstruction add loop of qbdiff_patch.
+static void bench_add(const struct corpus * c) {
+    int64_t n = min(c->old_len, 1 << 20);
+    uint8_t * dst = xmalloc(n);
+    memset(dst, 1, n);
+    BENCH("add_old", "1M", n * 16.0, "byte", {
+        for (int i = 0; i < 16; i++) add_old(dst, c->old, 0, n, n);
+        sink += dst[n / 2];
+    });
+    free(dst);
+}
+
+// Decoding of the control stream varints, at a mix of lengths like that of real patches.
+static void bench_varint(void) {
+    enum { COUNT = 1 << 20 };
+    uint8_t * buf = xmalloc(COUNT * 9 + 9);
+    size_t len = 0;
+    uint64_t s = 99;
+    for (int i = 0; i < COUNT; i++) {
+        s = s * 6364136223846793005ULL + 1442695040888963407ULL;
+        len += put_varint((s >> 11) >> (s >> 58), buf + len);
+    }
+    uint64_t v, sum;
+    BENCH("get_varint", "1M", COUNT, "value", {
+        const uint8_t * p = buf;
+        sum = 0;
+        for (int i = 0; i < COUNT; i++) {
+            p += get_varint(p, &v);
+            sum += v;
+        }
+        sink += sum;
+    });
+    free(buf);
+}
+
+static void bench_blake2b(const struct corpus * c) {
+    uint8_t cksum[64];
+    BENCH("blake2b_cksum", "4M", c->old_len, "byte", {
+        blake2b_cksum(c->old, c->old_len, cksum);
+        sink += cksum[0];
+    });
+}
+
+// LZMA on a text-like stream and on a diff-like stream (mostly zeroes).
+static void bench_lzma(const struct corpus * c) {
+    size_t n = min(c->old_len, 1 << 20);
+    uint8_t * db = calloc(n, 1);
+    if (!db) exit(1);
+    for (size_t i = 0; i < n; i += 97) db[i] = c->old[i];
+
+    const struct {
+        const char * name;
+        const uint8_t * data;
+    } inputs[] = { { "text", c->old }, { "db", db } };
+
+    for (size_t k = 0; k < sizeof(inputs) / sizeof(inputs[0]); k++) {
+        uint8_t *packed = NULL, *unpacked = NULL;
+        size_t packed_len;
+        BENCH("compress", inputs[k].name, n, "byte", {
+            free(packed);
+            if (compress(inputs[k].data, n, QBDIFF_CODEC_LZMA2, &packed, &packed_len) != QBERR_OK) exit(1);
+        });
+        BENCH("decompress", inputs[k].name, n, "byte", {
+            free(unpacked);
+            if (decompress(packed, packed_len, &unpacked, n) != QBERR_OK) exit(1);
+        });
+        free(packed);
+        free(unpacked);
+    }
+    free(db);
+}
+
+int main(int argc, char * argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-r") && i + 1 < argc)
+            runs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-k") && i + 1 < argc)
+            filter = argv[++i];
+        else {
+            fprintf(stderr,
+                    "Usage: micro [-r runs] [-k kernel]\n\n"
+                    "Times the library kernels in isolation. -k selects kernels whose name\n"
+                    "contains the given string; the fastest of `runs' runs is reported.\n");
+            return 1;
+        }
+    }
+    if (runs < 1) runs = 1;
+
+    struct corpus c;
+    if (corpus_generate(CORPUS_MIXED, 4 << 20, 1, &c)) {
+        fprintf(stderr, "Out of memory.\n");
+        return 1;
+    }
+
+    bench_matchlen();
+    bench_search(&c);
+    bench_fuzzy(&c);
+    bench_add(&c);
+    bench_varint();
+    bench_blake2b(&c);
+    bench_lzma(&c);
+
+    corpus_free(&c);
+    return 0;
+}
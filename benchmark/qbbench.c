@@ -0,0 +1,409 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// End-to-end benchmark driver. For every (kind, size) pair it generates a corpus, writes it
+// out, and then runs qbdiff_compute_ex and qbdiff_patch_ex in forked children, so that peak
+// RSS is measured per operation exactly like for the command-line tools. One record per
+// (kind, size, threads) triple is printed as JSON lines (default) or CSV.
+//
+// With -t, every pair is measured once per thread count. Records then also carry the
+// strong-scaling efficiency T(1) / (p * T(p)) of the whole operation and of its parallel
+// phases (suffix sorting and LZMA), relative to the single-threaded run of the same sweep.
+// Every record compares the peak RSS of diffing with the 5*n+m bytes the README promises.
+//
+// With -m, every pair is also diffed out of core, with that memory limit and the work directory
+// for scratch files, and records carry the time of that diff relative to the in-memory one.
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "corpus.h"
+#include "libqbdiff.h"
+#include "libqbdiff_private.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int write_file(const char * path, const uint8_t * data, size_t len) {
+    FILE * f = fopen(path, "wb");
+    if (!f) return -1;
+    int ok = fwrite(data, 1, len, f) == len;
+    return (fclose(f) || !ok) ? -1 : 0;
+}
+
+static long long file_size(const char * path) {
+    struct stat st;
+    return stat(path, &st) ? -1 : (long long)st.st_size;
+}
+
+struct op_result {
+    double secs;
+    struct qbdiff_stats stats;
+    long rss_kb;
+    int status;
+};
+
+// Work done in the child; returns a QBERR_* code.
+static int do_diff(char * const paths[3], const struct qbdiff_options * opts) {
+    struct file_mapping o = map_file(paths[0]), n = map_file(paths[1]);
+    FILE * out = fopen(paths[2], "wb");
+    if (!out) return QBERR_IOERR;
+    int ret = qbdiff_compute_ex(o.data, n.data, o.length, n.length, out, opts);
+    if (fclose(out)) ret = QBERR_IOERR;
+    return ret;
+}
+
+static int do_patch(char * const paths[3], const struct qbdiff_options * opts) {
+    struct file_mapping o = map_file(paths[0]), p = map_file(paths[2]);
+    FILE * out = fopen(paths[1], "wb");
+    if (!out) return QBERR_IOERR;
+    int ret = qbdiff_patch_ex(o.data, p.data, o.length, p.length, out, opts);
+    if (fclose(out)) ret = QBERR_IOERR;
+    return ret;
+}
+
+// Passed through to qbdiff_options, see -b, -e and -m.
+static int64_t block_size = 0, memory_limit = 0;
+static int engine = QBDIFF_ENGINE_SA;
+static const char * scratch_dir = NULL;
+
+static struct op_result run_child(int (*fn)(char * const[3], const struct qbdiff_options *), char * const paths[3],
+                                  int threads) {
+    struct op_result r = { 0 };
+    r.status = -1;
+    int fds[2];
+    if (pipe(fds)) return r;
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        struct qbdiff_options opts;
+        qbdiff_options_init(&opts);
+        opts.threads = threads;
+        opts.block_size = block_size;
+        opts.engine = engine;
+        opts.scratch_dir = scratch_dir;
+        opts.memory_limit = memory_limit;
+        opts.stats = &r.stats;
+        double t0 = now();
+        int ret = fn(paths, &opts);
+        r.secs = now() - t0;
+        if (write(fds[1], &r, sizeof(r)) != sizeof(r)) _exit(126);
+        _exit(ret);
+    }
+
+    close(fds[1]);
+    if (pid < 0) {
+        close(fds[0]);
+        return r;
+    }
+
+    if (read(fds[0], &r, sizeof(r)) != sizeof(r)) r.secs = -1;
+    close(fds[0]);
+
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) == pid && WIFEXITED(status)) {
+        r.status = WEXITSTATUS(status);
+        r.rss_kb = ru.ru_maxrss;
+    }
+    return r;
+}
+
+static int same_file(const char * a, const char * b) {
+    struct file_mapping x = map_file((char *)a), y = map_file((char *)b);
+    int same = x.length == y.length && (x.length == 0 || !memcmp(x.data, y.data, x.length));
+    if (x.length) unmap_file(x);
+    if (y.length) unmap_file(y);
+    return same;
+}
+
+static void usage(void) {
+    fprintf(stderr,
+            "qbbench %s - qbdiff end-to-end benchmark\n"
+            "Usage: qbbench [-k kinds] [-z sizes] [-t threads] [-s seed] [-r reps] [-f json|csv] [-w workdir]\n"
+            "               [-b block] [-e sa|hash] [-m limit]\n\n"
+            "  -k  comma-separated corpus kinds (default: all)\n"
+            "  -z  comma-separated sizes, e.g. 10K,1M,4G (default: 10K,100K,1M,10M)\n"
+            "  -t  comma-separated thread counts to sweep, e.g. 1,2,4, or `all' for 1..ncpu\n"
+            "      (default: the library default only)\n"
+            "  -s  generator seed (default: 1)\n"
+            "  -r  repetitions; the fastest run is reported (default: 3)\n"
+            "  -f  output format (default: json)\n"
+            "  -w  directory for the generated files (default: $TMPDIR or /tmp)\n"
+            "  -b  block hash pre-pass interval, e.g. 4K, or -1 to disable (default: automatic)\n"
+            "  -e  match finder (default: sa)\n"
+            "  -m  also diff out of core with this memory limit, e.g. 1M, and report the slowdown\n\n"
+            "Kinds: overwrite insert delete move reloc text mixed\n",
+            qbdiff_version());
+    exit(1);
+}
+
+// One measurement: the fastest of the repetitions for every phase, the largest peak RSS. ooc is
+// the out-of-core diff of -m.
+struct record {
+    struct op_result diff, patch, ooc;
+    long long ooc_patch_size;
+    int ok;
+};
+
+static void keep_min(double * best, double v, int first) {
+    if (first || v < *best) *best = v;
+}
+
+// Keeps the fastest of the runs for each time, and the largest peak RSS.
+static void merge(struct op_result * best, const struct op_result * r, int first) {
+    struct qbdiff_stats * b = &best->stats;
+    const struct qbdiff_stats * s = &r->stats;
+    keep_min(&best->secs, r->secs, first);
+    keep_min(&b->checksum_time, s->checksum_time, first);
+    keep_min(&b->index_time, s->index_time, first);
+    keep_min(&b->match_time, s->match_time, first);
+    keep_min(&b->compress_time, s->compress_time, first);
+    keep_min(&b->decompress_time, s->decompress_time, first);
+    keep_min(&b->reconstruct_time, s->reconstruct_time, first);
+    keep_min(&b->write_time, s->write_time, first);
+    keep_min(&b->total_time, s->total_time, first);
+    best->rss_kb = max(best->rss_kb, r->rss_kb);
+}
+
+static double efficiency(double t1, double tp, int threads) { return tp > 0 && t1 > 0 ? t1 / (threads * tp) : 0; }
+
+static void print_record(const char * format, const char * kind, size_t size, uint64_t seed, int threads,
+                         size_t old_len, size_t new_len, long long patch_size, const struct record * r,
+                         const struct record * base) {
+    const struct qbdiff_stats *d = &r->diff.stats, *p = &r->patch.stats;
+    double diff_mbps = new_len / 1e6 / r->diff.secs, patch_mbps = new_len / 1e6 / r->patch.secs;
+    double slowdown = memory_limit && r->diff.secs > 0 ? r->ooc.secs / r->diff.secs : 0;
+    double model = 5.0 * old_len + new_len, ratio = r->diff.rss_kb * 1024.0 / model;
+
+    // Scaling efficiencies are only meaningful relative to a single-threaded run.
+    double eff[4] = { 0, 0, 0, 0 };
+    if (base) {
+        eff[0] = efficiency(base->diff.secs, r->diff.secs, threads);
+        eff[1] = efficiency(base->diff.stats.index_time, d->index_time, threads);
+        eff[2] = efficiency(base->diff.stats.compress_time, d->compress_time, threads);
+        eff[3] = efficiency(base->patch.secs, r->patch.secs, threads);
+    }
+
+    if (!strcmp(format, "csv")) {
+        printf("%s,%zu,%llu,%d,%zu,%zu,%lld,%.6f,%.3f,%ld,%.6f,%.6f,%.6f,%.6f,%.6f,%.6f,%.3f,%ld,%.6f,%.6f,%.6f,%.6f,"
+               "%.0f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%.6f,%.6f,%lld,%.3f\n",
+               kind, size, (unsigned long long)seed, threads, old_len, new_len, patch_size, r->diff.secs, diff_mbps,
+               r->diff.rss_kb, d->checksum_time, d->index_time, d->match_time, d->compress_time, d->write_time,
+               r->patch.secs, patch_mbps, r->patch.rss_kb, p->decompress_time, p->reconstruct_time, p->checksum_time,
+               p->write_time, model, ratio, eff[0], eff[1], eff[2], eff[3], r->ok, r->ooc.secs,
+               r->ooc.stats.match_time, r->ooc_patch_size, slowdown);
+        return;
+    }
+
+    printf("{\"kind\":\"%s\",\"size\":%zu,\"seed\":%llu,\"threads\":%d,\"old_size\":%zu,\"new_size\":%zu,"
+           "\"patch_size\":%lld,\"diff_s\":%.6f,\"diff_mbps\":%.3f,\"diff_rss_kb\":%ld,"
+           "\"diff_phases\":{\"checksum\":%.6f,\"index\":%.6f,\"match\":%.6f,\"compress\":%.6f,\"write\":%.6f},"
+           "\"patch_s\":%.6f,\"patch_mbps\":%.3f,\"patch_rss_kb\":%ld,"
+           "\"patch_phases\":{\"decompress\":%.6f,\"reconstruct\":%.6f,\"checksum\":%.6f,\"write\":%.6f},"
+           "\"mem_model_bytes\":%.0f,\"diff_rss_model_ratio\":%.3f",
+           kind, size, (unsigned long long)seed, threads, old_len, new_len, patch_size, r->diff.secs, diff_mbps,
+           r->diff.rss_kb, d->checksum_time, d->index_time, d->match_time, d->compress_time, d->write_time,
+           r->patch.secs, patch_mbps, r->patch.rss_kb, p->decompress_time, p->reconstruct_time, p->checksum_time,
+           p->write_time, model, ratio);
+    if (base)
+        printf(",\"efficiency\":{\"diff\":%.3f,\"index\":%.3f,\"compress\":%.3f,\"patch\":%.3f}", eff[0], eff[1],
+               eff[2], eff[3]);
+    if (memory_limit)
+        printf(",\"ooc\":{\"diff_s\":%.6f,\"match_s\":%.6f,\"patch_size\":%lld,\"slowdown\":%.3f}", r->ooc.secs,
+               r->ooc.stats.match_time, r->ooc_patch_size, slowdown);
+    printf(",\"ok\":%s}\n", r->ok ? "true" : "false");
+}
+
+int main(int argc, char * argv[]) {
+    const char *kinds = NULL, *sizes = "10K,100K,1M,10M", *format = "json", *workdir = getenv("TMPDIR"), *threads = "0";
+    uint64_t seed = 1;
+    int reps = 3, opt;
+
+    while ((opt = getopt(argc, argv, "k:z:t:s:r:f:w:b:e:m:h")) != -1) {
+        switch (opt) {
+            case 'k':
+                kinds = optarg;
+                break;
+            case 'z':
+                sizes = optarg;
+                break;
+            case 't':
+                threads = optarg;
+                break;
+            case 's':
+                seed = strtoull(optarg, NULL, 10);
+                break;
+            case 'r':
+                reps = atoi(optarg);
+                break;
+            case 'f':
+                format = optarg;
+                break;
+            case 'w':
+                workdir = optarg;
+                break;
+            case 'b':
+                block_size = strcmp(optarg, "-1") ? (int64_t)corpus_parse_size(optarg) : -1;
+                if (!block_size && strcmp(optarg, "0")) usage();
+                break;
+            case 'm':
+                memory_limit = corpus_parse_size(optarg);
+                if (!memory_limit) usage();
+                break;
+            case 'e':
+                if (!strcmp(optarg, "sa"))
+                    engine = QBDIFF_ENGINE_SA;
+                else if (!strcmp(optarg, "hash"))
+                    engine = QBDIFF_ENGINE_HASH;
+                else
+                    usage();
+                break;
+            default:
+                usage();
+        }
+    }
+    if (reps < 1 || (strcmp(format, "json") && strcmp(format, "csv"))) usage();
+
+    int kind_list[CORPUS_KINDS], nkinds = 0;
+    if (kinds) {
+        char * list = strdup(kinds);
+        for (char * t = strtok(list, ", "); t; t = strtok(NULL, ", ")) {
+            int k = corpus_kind_parse(t);
+            if (k < 0 || nkinds == CORPUS_KINDS) usage();
+            kind_list[nkinds++] = k;
+        }
+        free(list);
+    } else {
+        for (; nkinds < CORPUS_KINDS; nkinds++) kind_list[nkinds] = nkinds;
+    }
+
+    int thread_list[256], nthreads = 0;
+    if (!strcmp(threads, "all")) {
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 1; i <= ncpu && nthreads < 256; i++) thread_list[nthreads++] = i;
+    } else {
+        char * list = strdup(threads);
+        for (char * t = strtok(list, ", "); t; t = strtok(NULL, ", ")) {
+            if (nthreads == 256 || atoi(t) < 0) usage();
+            thread_list[nthreads++] = atoi(t);
+        }
+        free(list);
+    }
+    if (!nthreads) usage();
+
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s/qbbench.XXXXXX", workdir ? workdir : "/tmp");
+    if (!mkdtemp(dir)) {
+        fprintf(stderr, "Failed to create a work directory in %s: %s\n", workdir ? workdir : "/tmp", strerror(errno));
+        return 1;
+    }
+
+    char old_path[4200], new_path[4200], patch_path[4200], out_path[4200], ooc_path[4200];
+    snprintf(old_path, sizeof(old_path), "%s/old", dir);
+    snprintf(new_path, sizeof(new_path), "%s/new", dir);
+    snprintf(patch_path, sizeof(patch_path), "%s/patch", dir);
+    snprintf(out_path, sizeof(out_path), "%s/out", dir);
+    snprintf(ooc_path, sizeof(ooc_path), "%s/ooc", dir);
+    char * const diff_paths[3] = { old_path, new_path, patch_path };
+    char * const patch_paths[3] = { old_path, out_path, patch_path };
+    char * const ooc_diff_paths[3] = { old_path, new_path, ooc_path };
+    char * const ooc_patch_paths[3] = { old_path, out_path, ooc_path };
+
+    if (!strcmp(format, "csv"))
+        printf("kind,size,seed,threads,old_size,new_size,patch_size,diff_s,diff_mbps,diff_rss_kb,diff_checksum_s,"
+               "diff_index_s,diff_match_s,diff_compress_s,diff_write_s,patch_s,patch_mbps,patch_rss_kb,"
+               "patch_decompress_s,patch_reconstruct_s,patch_checksum_s,patch_write_s,mem_model_bytes,"
+               "diff_rss_model_ratio,diff_efficiency,index_efficiency,compress_efficiency,patch_efficiency,ok,"
+               "ooc_diff_s,ooc_match_s,ooc_patch_size,ooc_slowdown\n");
+
+    int failed = 0;
+    char * size_list = strdup(sizes);
+    for (char * t = strtok(size_list, ", "); t; t = strtok(NULL, ", ")) {
+        size_t size = corpus_parse_size(t);
+        if (!size) usage();
+
+        for (int ki = 0; ki < nkinds; ki++) {
+            struct corpus c;
+            if (corpus_generate(kind_list[ki], size, seed, &c)) {
+                fprintf(stderr, "Out of memory generating %s/%s.\n", corpus_kind_name(kind_list[ki]), t);
+                return 1;
+            }
+            if (write_file(old_path, c.old, c.old_len) || write_file(new_path, c.new, c.new_len)) {
+                fprintf(stderr, "Failed to write the corpus to %s: %s\n", dir, strerror(errno));
+                return 1;
+            }
+            size_t old_len = c.old_len, new_len = c.new_len;
+            corpus_free(&c);
+
+            struct record base = { 0 };
+            int have_base = 0;
+            for (int ti = 0; ti < nthreads; ti++) {
+                struct record rec = { 0 };
+                rec.ok = 1;
+                for (int r = 0; r < reps && rec.ok; r++) {
+                    struct op_result d = run_child(do_diff, diff_paths, thread_list[ti]);
+                    struct op_result p = d.status ? d : run_child(do_patch, patch_paths, thread_list[ti]);
+                    rec.ok = !d.status && !p.status && same_file(new_path, out_path);
+                    merge(&rec.diff, &d, r == 0);
+                    merge(&rec.patch, &p, r == 0);
+                    if (!memory_limit || !rec.ok) continue;
+                    // The patch of the out-of-core diff has to apply as well.
+                    scratch_dir = dir;
+                    struct op_result o = run_child(do_diff, ooc_diff_paths, thread_list[ti]);
+                    scratch_dir = NULL;
+                    if (!o.status) p = run_child(do_patch, ooc_patch_paths, thread_list[ti]);
+                    rec.ok = !o.status && !p.status && same_file(new_path, out_path);
+                    merge(&rec.ooc, &o, r == 0);
+                    rec.ooc_patch_size = file_size(ooc_path);
+                }
+                failed |= !rec.ok;
+
+                if (thread_list[ti] == 1) {
+                    base = rec;
+                    have_base = 1;
+                }
+                print_record(format, corpus_kind_name(kind_list[ki]), size, seed, thread_list[ti], old_len, new_len,
+                             file_size(patch_path), &rec, have_base && thread_list[ti] > 0 ? &base : NULL);
+                fflush(stdout);
+            }
+        }
+    }
+    free(size_list);
+
+    unlink(old_path);
+    unlink(new_path);
+    unlink(patch_path);
+    unlink(out_path);
+    unlink(ooc_path);
+    rmdir(dir);
+    return failed;
+}
@@ -38,11 +38,146 @@
 #define QBERR_BADCKSUM 5
 #define QBERR_LZMAERR 6
 #define QBERR_SAIS 7
+#define QBERR_BADOLD 8  // The patch was made against another old file.
 
+// Match finders of qbdiff_compute_ex.
+#define QBDIFF_ENGINE_SA 0    // Suffix array of the old file: best patches, O(n log n) time and 5n memory.
+#define QBDIFF_ENGINE_HASH 1  // Sampled hash table: linear time, n to 2n memory, slightly larger patches.
+
+// BCJ filters for executable code, which turn relative branch targets into absolute ones
+// before LZMA2 compression.
+#define QBDIFF_FILTER_AUTO 0   // Picked from the ELF or PE header of the new file.
+#define QBDIFF_FILTER_NONE 1
+#define QBDIFF_FILTER_X86 2    // x86 and x86-64.
+#define QBDIFF_FILTER_ARM64 3  // Needs liblzma 5.4 or later.
+
+// Streams of a patch that the filter may apply to.
+#define QBDIFF_STREAM_DIFF 1   // Differences against the old file.
+#define QBDIFF_STREAM_EXTRA 2  // New bytes not found in the old file.
+#define QBDIFF_STREAM_FULL 4   // The whole new file, when it is stored rather than diffed.
+
+// Wall-clock time spent in each phase, in seconds. Phases that do not apply to an
+// operation are left at zero. The streams of a diff are compressed while matching runs,
+// so compress_time only counts the tail left once matching is done. qbdiff_estimate fills in
+// index_time, match_time and total_time.
+struct qbdiff_stats {
+    double checksum_time, index_time, match_time, compress_time;  // qbdiff_compute_ex
+    double decompress_time, reconstruct_time;                     // qbdiff_patch_ex
+    double write_time, total_time;
+};
+
+// A thread pool of the host, which the parallel stages then use instead of threads of their
+// own. submit(host, task, arg) must run task(arg) once, on any thread and at any later time,
+// and may run it right away. A stage runs outstanding tasks itself while it waits for them,
+// so it never waits on the host, and tasks that the host runs after the stage is done return
+// at once. A stage has about as many tasks outstanding as it would use threads of its own.
+// The suffix sort of a large old file is the exception: its threads wait for each other, so
+// it runs on the host tasks that the host starts within a few milliseconds, which it keeps
+// until the sort is done, and on fewer threads when the host is busy or holds them back.
+struct qbdiff_executor {
+    void (*submit)(void * host, void (*task)(void * arg), void * arg);
+    void * host;
+};
+
+struct qbdiff_options {
+    int threads;                  // Worker threads for the parallel phases, 0 = library default.
+    struct qbdiff_stats * stats;  // Filled in when not NULL.
+    // Average spacing of the anchors sampled by the block hash pre-pass, which matches large
+    // identical regions before the suffix array is built. 0 enables it with a size picked
+    // from the old file for inputs over 256M, -1 disables it. Rounded up to a power of two.
+    int64_t block_size;
+    int engine;  // QBDIFF_ENGINE_SA (the default) or QBDIFF_ENGINE_HASH.
+    // Out-of-core mode, used when set and a diff would need more than memory_limit bytes
+    // (0 = half of physical memory). The suffix array is then built in windows of the old
+    // file that fit the limit, and they are kept with the other large buffers in unlinked
+    // temporary files under scratch_dir.
+    const char * scratch_dir;
+    int64_t memory_limit;
+    int filter;          // QBDIFF_FILTER_*, QBDIFF_FILTER_AUTO by default.
+    int filter_streams;  // QBDIFF_STREAM_* mask, 0 = QBDIFF_STREAM_FULL, where it pays off the most.
+    // Branch normalization: 1 also diffs the new file with its relative branches rewritten
+    // against the old one when both are x86-64 or ARM64 ELF executables, and keeps whichever
+    // patch is smaller, at the cost of a second diff. 0, the default, does not.
+    int normalize;
+    // Primes the compressor of the extra stream with up to 32M of the end of the old file, so
+    // that inserted data found there costs little even when too short or too different for
+    // the matcher. Slows down diffing by the time it takes to index that span.
+    int extra_dict;
+    struct qbdiff_executor executor;  // Host thread pool for the parallel stages, if submit is set.
+    // Block size of a seekable patch, whose blocks of the new file can be rebuilt on their own
+    // with qbdiff_patch_range, or 0 for a regular patch. At least 4K; blocks cost about 200
+    // bytes each, and each is compressed on its own. Normalization and extra_dict are ignored.
+    int64_t seekable;
+    // Fingerprint of the old file recorded in the patch, against which qbdiff_patch checks the
+    // old file before anything else: 0 hashes 256K of samples of it, 1 also all of it, and -1
+    // records none.
+    int fingerprint;
+    // Spill buffer of an in-place patch, which qbdiff_patch_in_place applies over the old file
+    // itself, or 0 for a regular patch. Blocks that read each other's places in the old file are
+    // rebuilt ahead into up to this many bytes, kept in the journal, and the rest of them are
+    // stored as they are. Implies a seekable patch, with blocks of 64K unless seekable is set.
+    int64_t in_place;
+};
+
+// Patch size predicted by qbdiff_estimate, in bytes. Normalization and the extra stream
+// dictionary are not accounted for.
+struct qbdiff_estimate {
+    int64_t size, low, high;  // Expected size of the patch and its 95% confidence interval.
+    int64_t cb, db, eb;       // Expected compressed size of the control, diff and extra streams.
+    int64_t full;             // Expected size of a patch holding a copy of the new file.
+    double sampled;           // Fraction of the new file that was matched.
+};
+
+LIBQDIFF_PUBLIC_API void qbdiff_options_init(struct qbdiff_options * opts);
 LIBQDIFF_PUBLIC_API int qbdiff_compute(const uint8_t * old, const uint8_t * new, size_t old_len, size_t new_len,
                                        FILE * diff_file);
 LIBQDIFF_PUBLIC_API int qbdiff_patch(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len,
                                      FILE * new_file);
+LIBQDIFF_PUBLIC_API int qbdiff_compute_ex(const uint8_t * old, const uint8_t * new, size_t old_len, size_t new_len,
+                                          FILE * diff_file, const struct qbdiff_options * opts);
+LIBQDIFF_PUBLIC_API int qbdiff_patch_ex(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len,
+                                        FILE * new_file, const struct qbdiff_options * opts);
+// qbdiff_patch_ex with the patch read from a stream, such as a pipe. The new file of a
+// seekable patch is written out as the patch arrives, a few blocks at a time and each checked
+// against its BLAKE2b first; other patches are read in full before being applied.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_stream(const uint8_t * old, FILE * patch_file, size_t old_len, FILE * new_file,
+                                            const struct qbdiff_options * opts);
+// Rebuilds bytes [offset, offset + len) of the new file from a seekable patch into out, decoding
+// only the blocks they lie in, each checked against its own BLAKE2b. Other patches, and ranges
+// past the end of the new file, fail with QBERR_BADPATCH. The blocks of seekable patches are
+// rebuilt in parallel, here and in qbdiff_patch_ex.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_range(const uint8_t * old, const uint8_t * patch, size_t old_len,
+                                           size_t patch_len, int64_t offset, int64_t len, uint8_t * out,
+                                           const struct qbdiff_options * opts);
+// Checks that a patch applies to old, as qbdiff_patch_ex would, without writing the new file
+// or holding it in memory: it is rebuilt a window at a time and hashed as it goes. Seekable
+// patches take a block per thread.
+LIBQDIFF_PUBLIC_API int qbdiff_verify(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len,
+                                      const struct qbdiff_options * opts);
+// Applies an in-place patch to the file at path, which holds the old file and ends up holding
+// the new one, with no room needed beyond the larger of the two and the journal. The patch is
+// verified and the plan of its blocks checked before anything is written. Progress is recorded
+// in the journal file, created at the given path and removed once done; if the call is cut
+// short, by an error or a crash, calling it again with the same patch and journal picks up
+// where it left off. An existing file at the journal path that is not a journal is left alone,
+// and the call fails with QBERR_IOERR. Other patches fail with QBERR_BADPATCH. Not available on
+// Windows.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_in_place(const char * path, const uint8_t * patch, size_t patch_len,
+                                              const char * journal, const struct qbdiff_options * opts);
+// Applies a patch to old as qbdiff_patch_ex does, writing the new file to path, and records
+// checkpoints of its progress in the file at checkpoint, which is removed once done. If the
+// call is cut short, calling it again with the same patch and checkpoint keeps the blocks of
+// the new file written by then, after checking them, and rebuilds the rest: seekable patches
+// are checkpointed every 64M of the new file, and fail with QBERR_IOERR, leaving it alone, if
+// some other file is at checkpoint. Other patches are applied from the start. Not available on
+// Windows.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_resume(const uint8_t * old, const uint8_t * patch, size_t old_len,
+                                            size_t patch_len, const char * path, const char * checkpoint,
+                                            const struct qbdiff_options * opts);
+// Predicts the size of the patch qbdiff_compute_ex would produce, without compressing it and
+// from a sample of the new file, typically in a small fraction of the time.
+LIBQDIFF_PUBLIC_API int qbdiff_estimate(const uint8_t * old, const uint8_t * new, size_t old_len, size_t new_len,
+                                        struct qbdiff_estimate * est, const struct qbdiff_options * opts);
 LIBQDIFF_PUBLIC_API const char * qbdiff_version(void);
 LIBQDIFF_PUBLIC_API const char * qbdiff_error(int code);
 
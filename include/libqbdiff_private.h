@@ -23,6 +23,7 @@
 #define LIBQBDIFF_PRIVATE_H
 
 #include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -56,6 +57,63 @@ static inline int64_t ri64(const uint8_t * buf) {
            ((int64_t)buf[4] << 24) | ((int64_t)buf[5] << 16) | ((int64_t)buf[6] << 8) | (int64_t)buf[7];
 }
 
+// Little-endian 64-bit loads of possibly unaligned data.
+static inline uint64_t rl64(const uint8_t * buf) {
+    uint64_t x;
+    memcpy(&x, buf, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+// Prefix varints. The number of trailing zero bits of the first byte, plus one, is the length
+// of the encoding (up to 8 bytes), which holds 7 bits of the value per byte, little-endian.
+// Values over 56 bits are written as a zero byte followed by all 64 bits.
+static inline size_t put_varint(uint64_t v, uint8_t * buf) {
+    int bits = 64 - __builtin_clzll(v | 1);
+    if (bits > 56) {
+        buf[0] = 0;
+        for (int i = 0; i < 8; i++) buf[i + 1] = v >> (8 * i);
+        return 9;
+    }
+    int n = (bits + 6) / 7;
+    uint64_t x = (v << n) | (1ULL << (n - 1));
+    for (int i = 0; i < n; i++) buf[i] = x >> (8 * i);
+    return n;
+}
+
+// Decodes a varint from at least 9 readable bytes, returning its length.
+static inline size_t get_varint(const uint8_t * buf, uint64_t * v) {
+    uint64_t x = rl64(buf);
+    if (!(x & 0xff)) {
+        *v = rl64(buf + 1);
+        return 9;
+    }
+    int n = __builtin_ctzll(x) + 1;
+    *v = (x << (64 - 8 * n)) >> (64 - 7 * n);
+    return n;
+}
+
+// Reads a varint from [*p, end), failing if it does not fit.
+static inline bool read_varint(const uint8_t ** p, const uint8_t * end, uint64_t * v) {
+    size_t n;
+    if (end - *p >= 9) {
+        n = get_varint(*p, v);
+    } else {
+        uint8_t tmp[9] = { 0 };
+        memcpy(tmp, *p, end - *p);
+        n = get_varint(tmp, v);
+        if (n > (size_t)(end - *p)) return false;
+    }
+    *p += n;
+    return true;
+}
+
+// Maps signed values of small magnitude to small unsigned ones.
+static inline uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
 // Open the binary output file.
 #ifdef _WIN32
     #include <windows.h>
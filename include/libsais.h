@@ -51,23 +51,21 @@ int32_t libsais(const uint8_t * T, int32_t * SA, int32_t n, int32_t fs, int32_t
  */
 int32_t libsais_int(int32_t * T, int32_t * SA, int32_t n, int32_t k, int32_t fs);
 
-#if defined(_OPENMP)
 /**
- * Constructs the suffix array of a given string in parallel using OpenMP.
+ * Constructs the suffix array of a given string in parallel, on the threads of pool_parallel().
  * @param T [0..n-1] The input string.
  * @param SA [0..n-1+fs] The output array of suffixes.
  * @param n The length of the given string.
  * @param fs The extra space available at the end of SA array (0 should be
  * enough for most cases).
  * @param freq [0..255] The output symbol frequency table (can be NULL).
- * @param threads The number of OpenMP threads to use (can be 0 for OpenMP
- * default).
+ * @param threads The number of threads to use (can be 0 for the default).
  * @return 0 if no error occurred, -1 or -2 otherwise.
  */
 int32_t libsais_omp(const uint8_t * T, int32_t * SA, int32_t n, int32_t fs, int32_t * freq, int32_t threads);
 
 /**
- * Constructs the suffix array of a given integer array in parallel using OpenMP.
+ * Constructs the suffix array of a given integer array in parallel, on the threads of pool_parallel().
  * Note, during construction input array will be modified, but restored at the end if no errors occurred.
  * @param T [0..n-1] The input integer array.
  * @param SA [0..n-1+fs] The output array of suffixes.
@@ -75,11 +73,9 @@ int32_t libsais_omp(const uint8_t * T, int32_t * SA, int32_t n, int32_t fs, int3
  * @param k The alphabet size of the input integer array.
  * @param fs Extra space available at the end of SA array (can be 0, but 4k or better 6k is recommended for optimal
  * performance).
- * @param threads The number of OpenMP threads to use (can be 0 for OpenMP default).
+ * @param threads The number of threads to use (can be 0 for the default).
  * @return 0 if no error occurred, -1 or -2 otherwise.
  */
 int32_t libsais_int_omp(int32_t * T, int32_t * SA, int32_t n, int32_t k, int32_t fs, int32_t threads);
 
 #endif
-
-#endif
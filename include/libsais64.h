@@ -37,18 +37,16 @@ Please see the file 3rdparty/libsais-LICENSE for full copyright information.
  */
 int64_t libsais64(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, int64_t * freq);
 
-#if defined(_OPENMP)
 /**
- * Constructs the suffix array of a given string in parallel using OpenMP.
+ * Constructs the suffix array of a given string in parallel, on the threads of pool_parallel().
  * @param T [0..n-1] The input string.
  * @param SA [0..n-1+fs] The output array of suffixes.
  * @param n The length of the given string.
  * @param fs The extra space available at the end of SA array (0 should be enough for most cases).
  * @param freq [0..255] The output symbol frequency table (can be NULL).
- * @param threads The number of OpenMP threads to use (can be 0 for OpenMP default).
+ * @param threads The number of threads to use (can be 0 for the default).
  * @return 0 if no error occurred, -1 or -2 otherwise.
  */
 int64_t libsais64_omp(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, int64_t * freq, int64_t threads);
-#endif
 
 #endif
@@ -0,0 +1,71 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _NORMALIZE_H
+#define _NORMALIZE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Branch target normalization of executables (see normalize.c).
+
+#define NORM_NONE 0
+#define NORM_X86_64 1
+#define NORM_ARM64 2
+
+// A region of the new file that corresponds to one of the old file.
+struct norm_region {
+    int64_t new_pos, old_pos, len;
+};
+
+// Everything that denormalization needs, stored in the patch.
+struct norm_info {
+    int arch;
+    int64_t * ranges;  // Code ranges of the new file, as start and end pairs.
+    int64_t nranges;
+    struct norm_region * regions;
+    int64_t nregions;
+    uint8_t * flags;  // One bit per branch that denormalization would change, set if it was normalized.
+    int64_t nflags;
+};
+
+// The architecture to normalize for, if both files are ELF executables of the same machine.
+int norm_arch(const uint8_t * old, size_t old_size, const uint8_t * new, size_t new_size);
+
+// Rewrites the branches in the code of `new', in place, as if their targets had the addresses
+// of the matching code in the old file. Takes over `regions', sorted by new_pos.
+int normalize(int arch, uint8_t * new, size_t new_size, struct norm_region * regions, int64_t nregions,
+              struct norm_info * info);
+
+// Undoes normalize() on the reconstructed new file.
+int denormalize(const struct norm_info * info, uint8_t * new, size_t new_size);
+
+// denormalize() a window of the new file at a time, for files that are never held in full.
+// denorm_window() undoes it on bytes [off, end) of the file, held at d, and sets `done' to
+// where they are final; the bytes from there on have to be passed again with the next window.
+// denorm_end() frees the state, and fails if the patch holds more flags than were used.
+struct denorm;
+int denorm_begin(const struct norm_info * info, size_t new_size, struct denorm ** dn);
+int denorm_window(struct denorm * dn, uint8_t * d, int64_t off, int64_t end, int64_t * done);
+int denorm_end(struct denorm * dn);
+
+int norm_encode(const struct norm_info * info, uint8_t ** buf, size_t * len);
+int norm_decode(const uint8_t * buf, size_t len, struct norm_info * info);
+void norm_free(struct norm_info * info);
+
+#endif
@@ -0,0 +1,88 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _POOL_H
+#define _POOL_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libqbdiff.h"
+
+// Parallel stages of the library (see pool.c). They run on the host executor when one is
+// given, and otherwise on OpenMP when the library is built with it, or on a built-in team of
+// POSIX threads.
+
+// Tasks submitted to the same queue run one at a time, in the order they were submitted.
+// A zeroed queue is ready for use.
+struct pool_queue {
+    struct pool_job *head, *tail;
+    int busy;
+};
+
+// Largest argument of a task, which is copied when it is submitted.
+#define POOL_ARG_SIZE 32
+
+// Runs fn(arg) on the calling thread, with up to `threads' - 1 other threads, or the host
+// executor when `ex' is not NULL and has a submit callback, running the tasks it submits, and
+// returns once they are all done. 0 threads is pool_threads().
+void pool_run(const struct qbdiff_executor * ex, int threads, void (*fn)(void * arg), void * arg);
+
+// Submits a task from within pool_run(), on a queue or, when it is NULL, on its own.
+void pool_submit(struct pool_queue * q, void (*fn)(void * arg), const void * arg, size_t size);
+
+// Waits for all tasks submitted so far, running some of them meanwhile.
+void pool_wait(void);
+
+// Runs fn(arg, i) for every i in [0, n) on up to `threads' threads, as pool_run() does.
+void pool_for(const struct qbdiff_executor * ex, int threads, int64_t n, void (*fn)(void * arg, int64_t i),
+              void * arg);
+
+// The default number of threads.
+int pool_threads(void);
+
+// Code written for a team of threads that run it at once and wait for each other at barriers,
+// as the suffix sorter is, runs in regions of pool_parallel(). The threads come from the gang
+// of pool_gang(), which holds its size for all the regions it runs, or from OpenMP.
+
+// Runs fn(arg, n) with a gang of n threads, up to `threads', for its regions: the calling
+// thread and POSIX threads, or host tasks when `ex' is not NULL and has a submit callback. The
+// host is waited for briefly, and the host tasks that it has not run by then are left out, so
+// that a host that holds them back only leaves fewer threads. With OpenMP, and no host
+// executor, there is no gang and regions run on OpenMP. 0 threads is pool_threads().
+void pool_gang(const struct qbdiff_executor * ex, int threads, void (*fn)(void * arg, int threads), void * arg);
+
+// Runs fn(arg) on the calling thread and up to `threads' - 1 others at once, and returns once
+// they are all done. A region within a region runs on the calling thread alone.
+void pool_parallel(int threads, void (*fn)(void * arg), void * arg);
+
+// Numbers the threads of a region from 0, the thread that started it, to pool_num_threads() - 1.
+int pool_thread_num(void);
+int pool_num_threads(void);
+
+// Waits for all the threads of the region to get here.
+void pool_barrier(void);
+
+// Whether regions may get fewer threads than asked for, as OpenMP may be set up to do.
+int pool_dynamic(void);
+
+// Flags shared between tasks.
+#define pool_load(p) __atomic_load_n(p, __ATOMIC_ACQUIRE)
+#define pool_store(p, v) __atomic_store_n(p, v, __ATOMIC_RELEASE)
+
+#endif
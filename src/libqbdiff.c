@@ -22,33 +22,169 @@
 #include "libqbdiff.h"
 
 #include <lzma.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
-#if defined(_OPENMP)
-    #include <omp.h>
-#else
-    #error "OpenMP not available."
+#ifndef _WIN32
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
 #endif
 
 #include "blake2b.h"
 #include "libqbdiff_private.h"
+#include "pool.h"
 #include "libsais.h"
 #include "libsais64.h"
+#include "normalize.h"
+
+#define QBDIFF_MAGIC_BIG "QBDB2"
+#define QBDIFF_MAGIC_BIG_V1 "QBDB1"  // Fixed-width control entries, still accepted by qbdiff_patch.
+#define QBDIFF_MAGIC_NORM "QBDN2"  // QBDB2 of a normalized executable.
+#define QBDIFF_MAGIC_FULL "QBDF2"
+#define QBDIFF_MAGIC_FULL_V1 "QBDF1"  // No codec byte, still accepted by qbdiff_patch.
+#define QBDIFF_MAGIC_SEEK "QBDS1"
+#define QBDIFF_MAGIC_INPLACE "QBDI1"  // QBDS1 that can be applied over the old file itself.
+#define QBDIFF_MAGIC_OLD "QBDO1"  // Fingerprint of the old file, ahead of any of the others.
+
+// Header of a QBDB2 patch: magic, BLAKE2b of the new file, old and new size, then for the
+// control, diff and extra streams a codec byte, the packed and the raw size. A QBDF2 patch
+// has the magic, the BLAKE2b, a codec byte and the size of the new file. A QBDN2 patch is a
+// QBDB2 patch with a fourth stream, the normalization map. A QBDS1 patch has the magic, the
+// BLAKE2b, the old, new and block size, and an index entry per block of the new file: the
+// offset of its streams in the patch, the old position at its start, a codec byte, the packed
+// and the raw size of its control, diff and extra streams, and its BLAKE2b. A QBDO1 header,
+// which may precede any of them, has the magic, a flags byte, the old size, the BLAKE2b of
+// samples of the old file and, with QBDIFF_OLD_FULL, the BLAKE2b of all of it. A QBDI1 patch
+// is a QBDS1 patch whose index is followed by its plan, the order to apply the blocks in, with
+// QBDIFF_PLAN_SPILL set on those rebuilt before any other. Integers are big-endian.
+#define QBDIFF_HEADER_V1 133
+#define QBDIFF_HEADER 136
+#define QBDIFF_HEADER_NORM 153
+#define QBDIFF_HEADER_FULL_V1 77
+#define QBDIFF_HEADER_FULL 78
+#define QBDIFF_HEADER_SEEK 93
+#define QBDIFF_SEEK_ENTRY 131
+#define QBDIFF_SEEK_MIN 4096  // Smallest block of a QBDS1 patch.
+#define QBDIFF_INPLACE_BLOCK (64 << 10)  // Default block of a QBDI1 patch.
+#define QBDIFF_PLAN_SPILL (1LL << 62)
+#define QBDIFF_HEADER_OLD 78  // Without the full BLAKE2b.
+#define QBDIFF_OLD_FULL 1
+#define QBDIFF_OLD_SAMPLES 64
+#define QBDIFF_OLD_SAMPLE 4096
+
+// Codec bytes hold the compression method in the low nibble and the filter applied before
+// it in the high nibble. QBDIFF_CODEC_LZMA2 is an .xz stream, QBDIFF_CODEC_LZMA2_DICT raw
+// LZMA2 primed with a span of the old file, whose offset and length precede it as varints,
+// and QBDIFF_CODEC_STORE the data as is, with no filter.
+#define QBDIFF_CODEC_LZMA2 0x00
+#define QBDIFF_CODEC_LZMA2_DICT 0x01
+#define QBDIFF_CODEC_STORE 0x02
+
+// The LZMA2 dictionary size of preset 8, which bounds the span of the old file that a
+// stream can be primed with.
+#define QBDIFF_DICT_SIZE (32 << 20)
+#define QBDIFF_CODEC_X86 0x10
+#define QBDIFF_CODEC_ARM64 0x20
+
+// Old files at least this large are indexed with 64-bit suffix arrays. Overridable so that
+// the test suite can exercise the 64-bit path on small inputs.
+#ifndef QBDIFF_SAIS32_LIMIT
+    #define QBDIFF_SAIS32_LIMIT (INT32_MAX - 8)
+#endif
+
+// Suffix arrays of more than this many bytes are sorted on several threads. Overridable so
+// that the test suite can run the parallel sort on small inputs.
+#ifndef QBDIFF_SAIS_PARALLEL
+    #define QBDIFF_SAIS_PARALLEL 32000000
+#endif
 
-#define QBDIFF_MAGIC_BIG "QBDB1"
-#define QBDIFF_MAGIC_FULL "QBDF1"
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+// Resolves the optional arguments of the _ex entry points. Statistics are always collected,
+// into a scratch structure when the caller is not interested.
+static struct qbdiff_stats * init_stats(const struct qbdiff_options * opts, struct qbdiff_stats * scratch) {
+    struct qbdiff_stats * stats = opts && opts->stats ? opts->stats : scratch;
+    memset(stats, 0, sizeof(*stats));
+    return stats;
+}
 
 // LZMA wrappers with a sane API.
 
-static int compress(const uint8_t * src, size_t src_size, uint8_t ** dest, size_t * dest_written) {
+// Fills in the liblzma filter chain of a codec byte.
+static int codec_filters(int codec, lzma_options_lzma * opt, lzma_filter filters[3]) {
+    int n = 0;
+    if ((codec & 15) > QBDIFF_CODEC_LZMA2_DICT) return QBERR_BADPATCH;
+    switch (codec & ~15) {
+        case 0:
+            break;
+        case QBDIFF_CODEC_X86:
+            filters[n++] = (lzma_filter){ LZMA_FILTER_X86, NULL };
+            break;
+#ifdef LZMA_FILTER_ARM64
+        case QBDIFF_CODEC_ARM64:
+            filters[n++] = (lzma_filter){ LZMA_FILTER_ARM64, NULL };
+            break;
+#endif
+        default:
+            return QBERR_BADPATCH;
+    }
+    if (lzma_lzma_preset(opt, 8)) return QBERR_LZMAERR;
+    filters[n++] = (lzma_filter){ LZMA_FILTER_LZMA2, opt };
+    filters[n] = (lzma_filter){ LZMA_VLI_UNKNOWN, NULL };
+    return QBERR_OK;
+}
+
+static bool codec_valid(int codec) {
+    if (codec == QBDIFF_CODEC_STORE) return true;
     lzma_options_lzma opt;
-    if (lzma_lzma_preset(&opt, 8)) return QBERR_LZMAERR;
+    lzma_filter filters[3];
+    return codec_filters(codec, &opt, filters) == QBERR_OK;
+}
+
+// Whether data is not worth running LZMA over: too short to pay for the .xz container, or
+// with a byte distribution too flat for it to gain anything. The test is that the Renyi
+// entropy of order 2 of the bytes exceeds 7.9 bits, and it misses data that is random at the
+// byte level but repetitive at a larger scale, which is rare among the streams of a patch.
+static bool incompressible(const uint64_t hist[256]) {
+    uint64_t total = 0;
+    double sum = 0;
+    for (int i = 0; i < 256; i++) {
+        total += hist[i];
+        sum += (double)hist[i] * hist[i];
+    }
+    if (total < 64) return true;
+    // 2^-7.9 is 1.072 / 256. Allow for the sampling noise of short streams.
+    return 256 * sum <= (1.072 + 256.0 / total) * ((double)total * total);
+}
+
+static void histogram(uint64_t hist[256], const uint8_t * data, size_t len) {
+    for (size_t i = 0; i < len; i++) hist[data[i]]++;
+}
+
+static int compress(const uint8_t * src, size_t src_size, int codec, uint8_t ** dest, size_t * dest_written) {
+    if (codec == QBDIFF_CODEC_STORE) {
+        *dest = malloc(src_size + 1);
+        if (!*dest) return QBERR_NOMEM;
+        memcpy(*dest, src, src_size);
+        *dest_written = src_size;
+        return QBERR_OK;
+    }
 
-    lzma_filter filters[] = { { LZMA_FILTER_LZMA2, &opt }, { LZMA_VLI_UNKNOWN, NULL } };
+    lzma_options_lzma opt;
+    lzma_filter filters[3];
+    int err = codec_filters(codec, &opt, filters);
+    if (err != QBERR_OK) return err;
 
     // It is generally frowned upon to swear about bad library documentation in comments.
     // Because of this, the comment below is written in German in an attempt to avoid
@@ -60,14 +196,15 @@ static int compress(const uint8_t * src, size_t src_size, uint8_t ** dest, size_
     // erwähnt. Das ist verdammt frustrierend.
     *dest_written = 0;
 
-    *dest = malloc(src_size + 64);
+    size_t bound = lzma_stream_buffer_bound(src_size);
+    *dest = malloc(bound);
     if (!*dest) {
         return QBERR_NOMEM;
     }
 
     lzma_ret ret;
 
-    ret = lzma_stream_buffer_encode(filters, LZMA_CHECK_CRC64, NULL, src, src_size, *dest, dest_written, src_size + 64);
+    ret = lzma_stream_buffer_encode(filters, LZMA_CHECK_CRC64, NULL, src, src_size, *dest, dest_written, bound);
     if (ret != LZMA_OK) {
         free(*dest);
         *dest = NULL;
@@ -94,6 +231,40 @@ static int decompress(const uint8_t * src, int64_t src_size, uint8_t ** dest, in
     return QBERR_OK;
 }
 
+// Decompresses a stream of a patch, which may be primed with the old file.
+static int decompress_codec(const uint8_t * src, int64_t src_size, int codec, const uint8_t * old, int64_t old_size,
+                            uint8_t ** dest, int64_t dest_size) {
+    if ((codec & 15) == QBDIFF_CODEC_LZMA2) return decompress(src, src_size, dest, dest_size);
+    if (codec == QBDIFF_CODEC_STORE) {
+        if (src_size != dest_size) return QBERR_BADPATCH;
+        *dest = malloc(dest_size + 1);
+        if (!*dest) return QBERR_NOMEM;
+        memcpy(*dest, src, dest_size);
+        return QBERR_OK;
+    }
+
+    lzma_options_lzma opt;
+    lzma_filter filters[3];
+    uint64_t off, len;
+    const uint8_t * p = src;
+    if (codec_filters(codec, &opt, filters) != QBERR_OK || !read_varint(&p, src + src_size, &off) ||
+        !read_varint(&p, src + src_size, &len) || off > old_size || len > old_size - off || len > opt.dict_size)
+        return QBERR_BADPATCH;
+    opt.preset_dict = old + off;
+    opt.preset_dict_size = len;
+
+    *dest = malloc(dest_size + 1);
+    if (!*dest) return QBERR_NOMEM;
+    size_t in_pos = p - src, out_pos = 0;
+    lzma_ret ret = lzma_raw_buffer_decode(filters, NULL, src, &in_pos, src_size, *dest, &out_pos, dest_size);
+    if (ret != LZMA_OK || in_pos != src_size || out_pos != dest_size) {
+        free(*dest);
+        *dest = NULL;
+        return QBERR_LZMAERR;
+    }
+    return QBERR_OK;
+}
+
 // BLAKE2b checksum wrapper.
 static void blake2b_cksum(const uint8_t * data, int64_t size, uint8_t cksum[64]) {
     blake2b_state state;
@@ -103,23 +274,108 @@ static void blake2b_cksum(const uint8_t * data, int64_t size, uint8_t cksum[64])
     blake2b_final(&state, cksum, 64);
 }
 
+// Hashes the size of the old file and 64 samples of 4K spread evenly over it, or all of it if
+// it is smaller. That tells another file apart at the cost of a few page reads, short of a
+// change that falls between the samples.
+static void old_fingerprint(const uint8_t * old, int64_t old_size, uint8_t hash[64]) {
+    blake2b_state state;
+    uint8_t size[8];
+    wi64(old_size, size);
+    int64_t stride = (old_size - QBDIFF_OLD_SAMPLE) / (QBDIFF_OLD_SAMPLES - 1);
+    blake2b_init(&state, 64);
+    blake2b_update(&state, size, 8);
+    if (old_size <= QBDIFF_OLD_SAMPLES * QBDIFF_OLD_SAMPLE)
+        blake2b_update(&state, old, old_size);
+    else
+        for (int i = 0; i < QBDIFF_OLD_SAMPLES; i++) blake2b_update(&state, old + i * stride, QBDIFF_OLD_SAMPLE);
+    memset(hash, 0, 64);
+    blake2b_final(&state, hash, 64);
+}
+
+static int64_t fingerprint_len(const struct qbdiff_options * opts) {
+    if (opts && opts->fingerprint < 0) return 0;
+    return QBDIFF_HEADER_OLD + (opts && opts->fingerprint > 0 ? 64 : 0);
+}
+
+static int write_fingerprint(const uint8_t * old, int64_t old_size, const struct qbdiff_options * opts, FILE * f) {
+    uint8_t header[QBDIFF_HEADER_OLD + 64];
+    int64_t len = fingerprint_len(opts);
+    if (!len) return QBERR_OK;
+    memcpy(header, QBDIFF_MAGIC_OLD, 5);
+    header[5] = len > QBDIFF_HEADER_OLD ? QBDIFF_OLD_FULL : 0;
+    wi64(old_size, header + 6);
+    old_fingerprint(old, old_size, header + 14);
+    if (header[5] & QBDIFF_OLD_FULL) blake2b_cksum(old, old_size, header + QBDIFF_HEADER_OLD);
+    return fwrite(header, 1, len, f) == len ? QBERR_OK : QBERR_IOERR;
+}
+
+// Checks the fingerprint of the old file that may precede a patch, and sets skip to its length.
+static int check_old(const uint8_t * old, size_t old_len, const uint8_t * patch, size_t patch_len, size_t * skip) {
+    uint8_t hash[64];
+    *skip = 0;
+    if (patch_len < 5 || memcmp(patch, QBDIFF_MAGIC_OLD, 5)) return QBERR_OK;
+    if (patch_len < QBDIFF_HEADER_OLD) return QBERR_TRUNCPATCH;
+    if (patch[5] & ~QBDIFF_OLD_FULL) return QBERR_BADPATCH;
+    size_t len = QBDIFF_HEADER_OLD + (patch[5] & QBDIFF_OLD_FULL ? 64 : 0);
+    if (patch_len < len) return QBERR_TRUNCPATCH;
+    if (ri64(patch + 6) != old_len) return QBERR_BADOLD;
+    old_fingerprint(old, old_len, hash);
+    if (memcmp(patch + 14, hash, 64)) return QBERR_BADOLD;
+    if (patch[5] & QBDIFF_OLD_FULL) {
+        blake2b_cksum(old, old_len, hash);
+        if (memcmp(patch + QBDIFF_HEADER_OLD, hash, 64)) return QBERR_BADOLD;
+    }
+    *skip = len;
+    return QBERR_OK;
+}
+
+// Index of the first (lowest addressed) and last differing byte in the XOR of two words.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    #define first_diff(x) (__builtin_clzll(x) >> 3)
+    #define last_diff(x) (__builtin_ctzll(x) >> 3)
+#else
+    #define first_diff(x) (__builtin_ctzll(x) >> 3)
+    #define last_diff(x) (__builtin_clzll(x) >> 3)
+#endif
+
+// Compares a word at a time; memcpy compiles down to unaligned loads.
 static int64_t matchlen(const uint8_t * RESTRICT old, int64_t old_size, const uint8_t * RESTRICT new,
                         int64_t new_size) {
-    int64_t i, end = min(old_size, new_size);
-    for (i = 0; i < end; i++)
+    int64_t i = 0, end = min(old_size, new_size);
+    for (; i + 8 <= end; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, old + i, 8);
+        memcpy(&b, new + i, 8);
+        if (a != b) return i + first_diff(a ^ b);
+    }
+    for (; i < end; i++)
         if (old[i] != new[i]) break;
     return i;
 }
 
+// Length of the common run of bytes ending right before old_end and new_end, at most len.
+static int64_t matchlen_back(const uint8_t * RESTRICT old_end, const uint8_t * RESTRICT new_end, int64_t len) {
+    int64_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        uint64_t a, b;
+        memcpy(&a, old_end - i - 8, 8);
+        memcpy(&b, new_end - i - 8, 8);
+        if (a != b) return i + last_diff(a ^ b);
+    }
+    for (; i < len; i++)
+        if (old_end[-i - 1] != new_end[-i - 1]) break;
+    return i;
+}
+
 static void search32(const int32_t * RESTRICT I, const uint8_t * RESTRICT old, int64_t old_size,
                      const uint8_t * RESTRICT new, int64_t new_size, int64_t st, int64_t en, int64_t * old_pos,
                      int64_t * max_len) {
     int64_t x, y;
 
     /* Initialize max_len for the binary search */
-    if (st == 0 && en == old_size) {
+    if (st == 0 && en == old_size - 1) {
         *max_len = matchlen(old, old_size, new, new_size);
-        *old_pos = I[st];
+        *old_pos = 0;
     }
 
     /* The binary search terminates here when "en" and "st" are adjacent
@@ -165,9 +421,9 @@ static void search64(const int64_t * RESTRICT I, const uint8_t * RESTRICT old, i
     int64_t x, y;
 
     /* Initialize max_len for the binary search */
-    if (st == 0 && en == old_size) {
+    if (st == 0 && en == old_size - 1) {
         *max_len = matchlen(old, old_size, new, new_size);
-        *old_pos = I[st];
+        *old_pos = 0;
     }
 
     /* The binary search terminates here when "en" and "st" are adjacent
@@ -178,8 +434,6 @@ static void search64(const int64_t * RESTRICT I, const uint8_t * RESTRICT old, i
             *max_len = x;
             *old_pos = I[st];
         }
-        if(en == old_size)
-            printf("%ld\n", I[en]);
         y = matchlen(old + I[en], old_size - I[en], new, new_size);
         if (y > *max_len) {
             *max_len = y;
@@ -209,477 +463,1798 @@ static void search64(const int64_t * RESTRICT I, const uint8_t * RESTRICT old, i
     }
 }
 
-struct match_result {
-    size_t cblen, dblen, eblen;
-    uint8_t *cb, *db, *eb;
-    int16_t error;
-};
-
-static struct match_result match32(const int32_t * RESTRICT I, const uint8_t * RESTRICT old,
-                                   const uint8_t * RESTRICT new, int64_t new_size, int64_t old_size) {
-    int64_t new_pos = 0;
-    int64_t old_pos = 0;
-    int64_t match_len = 0;
-    int64_t last_offset = 0;
-    int64_t last_new_pos = 0;
-    int64_t last_old_pos = 0;
-
-    int64_t cblen = 0, dblen = 0, eblen = 0;
-
-    uint8_t *cb, *db, *eb;
-
-    struct match_result result;
-    result.cb = NULL;
-    result.db = NULL;
-    result.eb = NULL;
-    result.cblen = 0;
-    result.dblen = 0;
-    result.eblen = 0;
-    result.error = QBERR_OK;
+// Out-of-core mode keeps the large buffers in shared mappings of unlinked files in the scratch
+// directory, which the kernel can write back and evict under memory pressure.
+static void * scratch_map(const char * dir, size_t size) {
+#ifdef _WIN32
+    return NULL;
+#else
+    char path[4096];
+    snprintf(path, sizeof(path), "%s/qbdiff.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) return NULL;
+    unlink(path);
+    void * p = MAP_FAILED;
+    if (!ftruncate(fd, size)) p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    return p == MAP_FAILED ? NULL : p;
+#endif
+}
 
-    cb = malloc(new_size + new_size / 50 + 50);
+static void * buf_alloc(const char * scratch, size_t size) {
+    return scratch ? scratch_map(scratch, size) : malloc(size);
+}
 
-    if (cb == NULL) {
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.cb = cb;
+static void buf_free(const char * scratch, const void * p, size_t size) {
+#ifndef _WIN32
+    if (scratch) {
+        if (p) munmap((void *)p, size);
+        return;
     }
+#endif
+    free((void *)p);
+}
 
-    db = malloc(new_size + new_size / 50 + 50);
-
-    if (db == NULL) {
-        free(cb);
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.db = db;
-    }
+static int64_t memory_limit(const struct qbdiff_options * opts) {
+    if (opts && opts->memory_limit > 0) return opts->memory_limit;
+#ifdef _SC_PHYS_PAGES
+    return (int64_t)sysconf(_SC_PHYS_PAGES) * sysconf(_SC_PAGESIZE) / 2;
+#else
+    return INT64_MAX;
+#endif
+}
 
-    eb = malloc(new_size + new_size / 50 + 50);
+// The cb, db and eb streams of a diff are filled in chunks, each handed to the LZMA encoder of
+// its stream as a task, with task dependencies keeping the chunks of a stream in order. Full
+// chunks are held back until the streams reach QBDIFF_STREAM_HOLD bytes, so that small diffs
+// are compressed after the index is freed, as the encoders need hundreds of megabytes each.
+// Past that, the encoders run alongside the matcher, and memory is bounded by the chunks in
+// flight rather than proportional to the new file. Both sizes are overridable so that the test
+// suite can stream small diffs.
+#ifndef QBDIFF_CHUNK
+    #define QBDIFF_CHUNK (1 << 20)
+#endif
+#ifndef QBDIFF_STREAM_HOLD
+    #define QBDIFF_STREAM_HOLD (256 << 20)
+#endif
+#define QBDIFF_CHUNKS_IN_FLIGHT 8
+
+struct stream {
+    lzma_stream lz;
+    uint8_t codec;
+    bool started, chosen;
+    bool borrowed;      // Chunks belong to the caller, rather than to the stream.
+    const int * cancel;  // Chunks are dropped once this is set.
+    int finished;       // Set when the stream has ended.
+    size_t published;   // outlen as of the last chunk, for other threads.
+    const uint8_t * dict;  // Span of the old file for QBDIFF_CODEC_LZMA2_DICT.
+    int64_t dict_off, dict_len;
+    uint8_t * chunk;  // Chunk being filled.
+    size_t fill, raw;
+    uint8_t ** held;  // Full chunks not yet submitted.
+    size_t nheld, heldcap;
+    uint8_t * out;  // Compressed so far.
+    size_t outlen, outcap;
+    int error;
+    struct pool_queue queue;  // Chunks waiting for the encoder.
+};
 
-    if (eb == NULL) {
-        free(cb);
-        free(db);
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.eb = eb;
-    }
+static int stream_init(struct stream * s) {
+    lzma_options_lzma opt;
+    lzma_filter filters[3];
+    int err = codec_filters(s->codec, &opt, filters);
+    if (err != QBERR_OK) return err;
+    if ((s->codec & 15) == QBDIFF_CODEC_LZMA2)
+        return lzma_stream_encoder(&s->lz, filters, LZMA_CHECK_CRC64) == LZMA_OK ? QBERR_OK : QBERR_LZMAERR;
+
+    s->outcap = 65536;
+    if (!(s->out = malloc(s->outcap))) return QBERR_NOMEM;
+    s->outlen = put_varint(s->dict_off, s->out);
+    s->outlen += put_varint(s->dict_len, s->out + s->outlen);
+    opt.preset_dict = s->dict;
+    opt.preset_dict_size = s->dict_len;
+    return lzma_raw_encoder(&s->lz, filters) == LZMA_OK ? QBERR_OK : QBERR_LZMAERR;
+}
 
-    while (new_pos < new_size) {
-        int64_t old_score = 0;
-        int64_t new_peek;
-        for (new_peek = new_pos += match_len; new_pos < new_size; new_pos++) {
-            search32(I, old, old_size, new + new_pos, new_size - new_pos, 0, old_size, &old_pos, &match_len);
+static void stream_free(struct stream * s) {
+    lzma_end(&s->lz);
+    for (size_t i = 0; i < s->nheld; i++) free(s->held[i]);
+    free(s->held);
+    free(s->chunk);
+    free(s->out);
+    s->held = NULL;
+    s->chunk = s->out = NULL;
+    s->nheld = 0;
+}
 
-            for (; new_peek < new_pos + match_len; new_peek++) {
-                if ((new_peek + last_offset < old_size) && (old[new_peek + last_offset] == new[new_peek])) {
-                    old_score++;
-                }
-            }
+// The LZMA side of stream_encode(). The encoder is created on first use, on the thread that
+// runs it.
+static void stream_compress(struct stream * s, uint8_t * chunk, size_t len) {
+    if (!s->started && !s->error) {
+        s->started = true;
+        s->error = stream_init(s);
+    }
 
-            if (((match_len == old_score) && (match_len != 0)) || (match_len > old_score + 8)) {
+    lzma_action action = chunk ? LZMA_RUN : LZMA_FINISH;
+    s->lz.next_in = chunk;
+    s->lz.avail_in = len;
+    while (!s->error) {
+        if (s->outlen == s->outcap) {
+            size_t cap = s->outcap * 2 + 65536;
+            uint8_t * out = realloc(s->out, cap);
+            if (!out) {
+                s->error = QBERR_NOMEM;
                 break;
             }
+            s->out = out;
+            s->outcap = cap;
+        }
+        s->lz.next_out = s->out + s->outlen;
+        s->lz.avail_out = s->outcap - s->outlen;
+        lzma_ret ret = lzma_code(&s->lz, action);
+        s->outlen = s->outcap - s->lz.avail_out;
+        if (ret == LZMA_STREAM_END || (ret == LZMA_OK && action == LZMA_RUN && !s->lz.avail_in)) break;
+        if (ret != LZMA_OK) s->error = QBERR_LZMAERR;
+    }
+    if (!chunk) lzma_end(&s->lz);
+}
 
-            // Before beginning the next loop iteration, decrement
-            // old_score if needed, since new_pos will be
-            // incremented.
-            if ((new_pos + last_offset < old_size) && (old[new_pos + last_offset] == new[new_pos])) {
-                old_score--;
+// Compresses a chunk into the output of the stream and frees it, or finishes the stream when
+// the chunk is NULL.
+static void stream_encode(struct stream * s, uint8_t * chunk, size_t len) {
+    if (s->cancel && pool_load(s->cancel)) {
+        if (!s->borrowed) free(chunk);
+        return;
+    }
+
+    if (s->codec == QBDIFF_CODEC_STORE) {
+        if (!s->error && s->outlen + len > s->outcap) {
+            size_t cap = max(s->outcap * 2, s->outlen + len);
+            uint8_t * out = realloc(s->out, cap + 1);
+            if (out) {
+                s->out = out;
+                s->outcap = cap;
+            } else {
+                s->error = QBERR_NOMEM;
             }
         }
+        if (!s->error && len) memcpy(s->out + s->outlen, chunk, len);
+        if (!s->error) s->outlen += len;
+    } else {
+        stream_compress(s, chunk, len);
+    }
+    if (!s->borrowed) free(chunk);
 
-        if ((match_len != old_score) || (new_pos == new_size)) {
-            int64_t bytes = 0, max = 0;
-            int64_t len_fuzzyforward = 0;
-            for (int64_t i = 0; (last_new_pos + i < new_pos) && (last_old_pos + i < old_size);) {
-                if (old[last_old_pos + i] == new[last_new_pos + i]) {
-                    bytes++;
-                }
-                i++;
-                if (bytes * 2 - i > max * 2 - len_fuzzyforward) {
-                    max = bytes;
-                    len_fuzzyforward = i;
-                }
-            }
+    pool_store(&s->published, s->outlen);
+    if (!chunk) pool_store(&s->finished, 1);
+}
 
-            int64_t len_fuzzybackward = 0;
-            if (new_pos < new_size) {
-                bytes = 0;
-                max = 0;
-                for (int64_t i = 1; (new_pos >= last_new_pos + i) && (old_pos >= i); i++) {
-                    if (old[old_pos - i] == new[new_pos - i]) {
-                        bytes++;
-                    }
-                    if (bytes * 2 - i > max * 2 - len_fuzzybackward) {
-                        max = bytes;
-                        len_fuzzybackward = i;
-                    }
-                }
-            }
+struct encode_args {
+    struct stream * s;
+    uint8_t * chunk;
+    size_t len;
+};
 
-            // If there is an overlap between len_fuzzyforward and
-            // len_fuzzybackward in the new file, that overlap must
-            // be eliminated.
-            if (last_new_pos + len_fuzzyforward > new_pos - len_fuzzybackward) {
-                bytes = 0;
-                max = 0;
-                int64_t overlap = (last_new_pos + len_fuzzyforward) - (new_pos - len_fuzzybackward);
-                int64_t len_fuzzyshift = 0;
-                for (int64_t i = 0; i < overlap; i++) {
-                    if (new[last_new_pos + len_fuzzyforward - overlap + i] ==
-                        old[last_old_pos + len_fuzzyforward - overlap + i]) {
-                        bytes++;
-                    }
-                    if (new[new_pos - len_fuzzybackward + i] == old[old_pos - len_fuzzybackward + i]) {
-                        bytes--;
-                    }
-                    if (bytes > max) {
-                        max = bytes;
-                        len_fuzzyshift = i + 1;
-                    }
-                }
+static void encode_task(void * arg) {
+    struct encode_args * a = arg;
+    stream_encode(a->s, a->chunk, a->len);
+}
 
-                len_fuzzyforward += len_fuzzyshift - overlap;
-                len_fuzzybackward -= len_fuzzyshift;
-            }
+static void stream_submit(struct stream * s, uint8_t * chunk, size_t len) {
+    struct encode_args a = { s, chunk, len };
+    pool_submit(&s->queue, encode_task, &a, sizeof(a));
+}
 
-            for (int64_t i = 0; i < len_fuzzyforward; i++) {
-                db[dblen + i] = new[last_new_pos + i] - old[last_old_pos + i];
-            }
+// Submits the held chunks. The first time around, stores the stream if what is known of it
+// looks incompressible: all of it, unless it outgrew the hold threshold.
+static void stream_release(struct stream * s) {
+    if (!s->chosen) {
+        uint64_t hist[256] = { 0 };
+        s->chosen = true;
+        for (size_t i = 0; i < s->nheld; i++) histogram(hist, s->held[i], QBDIFF_CHUNK);
+        if (s->chunk) histogram(hist, s->chunk, s->fill);
+        if (incompressible(hist)) s->codec = QBDIFF_CODEC_STORE;
+    }
+    for (size_t i = 0; i < s->nheld; i++) stream_submit(s, s->held[i], QBDIFF_CHUNK);
+    s->nheld = 0;
+}
 
-            for (int64_t i = 0; i < (new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward); i++) {
-                eb[eblen + i] = new[last_new_pos + len_fuzzyforward + i];
-            }
+// The control stream is columnar: the varint lengths of the add and extra columns, then the
+// add lengths, the extra lengths and the zigzagged seeks, each as varints. Most entries then
+// take a few bytes instead of 24, and each column compresses better on its own. The columns
+// are gathered in memory and written out once matching is done.
+struct column {
+    uint8_t * buf;
+    size_t len, cap;
+};
 
-            dblen += len_fuzzyforward;
-            eblen += (new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward);
+static int column_put(struct column * c, uint64_t v) {
+    if (c->len + 9 > c->cap) {
+        size_t cap = c->cap * 2 + 4096;
+        uint8_t * buf = realloc(c->buf, cap);
+        if (!buf) return QBERR_NOMEM;
+        c->buf = buf;
+        c->cap = cap;
+    }
+    c->len += put_varint(v, c->buf + c->len);
+    return QBERR_OK;
+}
 
-            wi64(len_fuzzyforward, cb + cblen);
-            cblen += 8;
+// Appends room for len bytes to the column.
+static uint8_t * column_reserve(struct column * c, size_t len) {
+    if (!c->buf || c->len + len > c->cap) {
+        size_t cap = max(c->cap * 2, c->len + len) + 4096;
+        uint8_t * buf = realloc(c->buf, cap);
+        if (!buf) return NULL;
+        c->buf = buf;
+        c->cap = cap;
+    }
+    c->len += len;
+    return c->buf + c->len - len;
+}
 
-            wi64((new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward), cb + cblen);
-            cblen += 8;
+struct match_result {
+    struct stream cb, db, eb;
+    struct column cols[3];
+    int64_t ctrl[3];  // The last control triple, held back so that a seek can be folded into it.
+    bool have_ctrl, streaming;
+    size_t held;
+    int in_flight;
+    int16_t error;
+    // A probe only collects the matching regions, for normalization.
+    bool probe;
+    struct norm_region * regions;
+    int64_t nregions, regcap;
+    // An estimate, or a seekable patch, only collects the bytes of the control, diff and extra
+    // streams, with a control entry per emit().
+    struct column * sample;
+    // A full copy of the new file racing the diff, see race_step().
+    struct stream full;
+    const uint8_t * full_data;
+    int64_t full_size, full_next;
+    bool racing;
+    int full_busy, cancel_full, cancel_delta;
+};
 
-            wi64((old_pos - len_fuzzybackward) - (last_old_pos + len_fuzzyforward), cb + cblen);
-            cblen += 8;
+static void result_free(struct match_result * r) {
+    stream_free(&r->cb);
+    stream_free(&r->db);
+    stream_free(&r->eb);
+    stream_free(&r->full);
+    for (int i = 0; i < 3; i++) {
+        free(r->cols[i].buf);
+        r->cols[i].buf = NULL;
+    }
+    free(r->regions);
+    r->regions = NULL;
+}
 
-            last_new_pos = new_pos - len_fuzzybackward;
-            last_old_pos = old_pos - len_fuzzybackward;
-            last_offset = old_pos - new_pos;
+// Passes on a full chunk. Once streaming, waits for the encoders to catch up with the matcher
+// every few chunks.
+static int stream_full(struct match_result * r, struct stream * s) {
+    uint8_t * chunk = s->chunk;
+    s->chunk = NULL;
+    s->fill = 0;
+    if (r->streaming) {
+        stream_submit(s, chunk, QBDIFF_CHUNK);
+        if (++r->in_flight >= QBDIFF_CHUNKS_IN_FLIGHT) {
+            pool_wait();
+            r->in_flight = 0;
+        }
+        return QBERR_OK;
+    }
+
+    if (s->nheld == s->heldcap) {
+        size_t cap = s->heldcap * 2 + 16;
+        uint8_t ** held = realloc(s->held, cap * sizeof(uint8_t *));
+        if (!held) {
+            free(chunk);
+            return QBERR_NOMEM;
         }
+        s->held = held;
+        s->heldcap = cap;
+    }
+    s->held[s->nheld++] = chunk;
+    if ((r->held += QBDIFF_CHUNK) >= QBDIFF_STREAM_HOLD) {
+        r->streaming = true;
+        stream_release(&r->cb);
+        stream_release(&r->db);
+        stream_release(&r->eb);
     }
+    return QBERR_OK;
+}
 
-    result.cblen = cblen;
-    result.dblen = dblen;
-    result.eblen = eblen;
+// Returns room for up to *len bytes in the chunk of the stream, lowering *len to what fits.
+static uint8_t * stream_reserve(struct stream * s, size_t * len) {
+    if (!s->chunk && !(s->chunk = malloc(QBDIFF_CHUNK))) return NULL;
+    *len = min(*len, QBDIFF_CHUNK - s->fill);
+    return s->chunk + s->fill;
+}
 
-    return result;
+static int stream_commit(struct match_result * r, struct stream * s, size_t len) {
+    s->fill += len;
+    s->raw += len;
+    return s->fill == QBDIFF_CHUNK ? stream_full(r, s) : QBERR_OK;
 }
 
-static struct match_result match64(const int64_t * RESTRICT I, const uint8_t * RESTRICT old,
-                                   const uint8_t * RESTRICT new, int64_t new_size, int64_t old_size) {
-    int64_t new_pos = 0;
-    int64_t old_pos = 0;
-    int64_t match_len = 0;
-    int64_t last_offset = 0;
-    int64_t last_new_pos = 0;
-    int64_t last_old_pos = 0;
+static int stream_write(struct match_result * r, struct stream * s, const uint8_t * data, size_t len) {
+    while (len) {
+        size_t n = len;
+        uint8_t * p = stream_reserve(s, &n);
+        if (!p) return QBERR_NOMEM;
+        memcpy(p, data, n);
+        if (stream_commit(r, s, n)) return QBERR_NOMEM;
+        data += n;
+        len -= n;
+    }
+    return QBERR_OK;
+}
+
+static int flush_ctrl(struct match_result * r) {
+    if (!r->have_ctrl) return QBERR_OK;
+    r->have_ctrl = false;
+    if (column_put(&r->cols[0], r->ctrl[0]) || column_put(&r->cols[1], r->ctrl[1]) ||
+        column_put(&r->cols[2], zigzag(r->ctrl[2])))
+        return QBERR_NOMEM;
+    return QBERR_OK;
+}
 
-    int64_t cblen = 0, dblen = 0, eblen = 0;
+// Writes out the control stream after the last entry.
+static int write_controls(struct match_result * r) {
+    if (flush_ctrl(r)) return QBERR_NOMEM;
+    uint8_t buf[18];
+    size_t n = put_varint(r->cols[0].len, buf);
+    n += put_varint(r->cols[1].len, buf + n);
+    if (stream_write(r, &r->cb, buf, n)) return QBERR_NOMEM;
+    for (int i = 0; i < 3; i++) {
+        if (stream_write(r, &r->cb, r->cols[i].buf, r->cols[i].len)) return QBERR_NOMEM;
+        free(r->cols[i].buf);
+        r->cols[i].buf = NULL;
+    }
+    return QBERR_OK;
+}
 
-    uint8_t *cb, *db, *eb;
+// Once the extra stream holds over half of the new bytes that the matcher has gone through,
+// a full copy of the new file may well beat the diff, and it starts to be compressed on a
+// spare thread, a chunk at a time and only when the previous chunk is done, so that it never
+// holds up the matcher. The race is then run to the end by race_run().
+static void race_task(void * arg) {
+    struct match_result * r = *(struct match_result **)arg;
+    size_t len = min(QBDIFF_CHUNK, r->full_size - r->full_next);
+    stream_encode(&r->full, (uint8_t *)r->full_data + r->full_next, len);
+    r->full_next += len;
+    pool_store(&r->full_busy, 0);
+}
 
-    struct match_result result;
-    result.cb = NULL;
-    result.db = NULL;
-    result.eb = NULL;
-    result.cblen = 0;
-    result.dblen = 0;
-    result.eblen = 0;
-    result.error = QBERR_OK;
+static void race_step(struct match_result * r) {
+    int64_t done = r->db.raw + r->eb.raw;
+    if (!r->full_data || (!r->racing && (done < QBDIFF_CHUNK || 2 * r->eb.raw < done))) return;
+    r->racing = true;
+    if (pool_load(&r->full_busy) || r->full_next == r->full_size) return;
+    r->full_busy = 1;
+    pool_submit(&r->full.queue, race_task, &r, sizeof(r));
+}
 
-    cb = malloc(new_size + new_size / 50 + 5);
+static size_t published(const struct stream * s, int * finished) {
+    size_t len = pool_load(&s->published);
+    *finished &= pool_load(&s->finished);
+    return len;
+}
 
-    if (cb == NULL) {
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.cb = cb;
+// Compresses the rest of the full copy alongside the diff streams. The copy is abandoned once
+// the finished diff is smaller than what it has produced so far, and the diff is abandoned
+// once the finished copy is smaller than what the diff streams have produced so far.
+static void race_run(void * arg) {
+    struct match_result * r = *(struct match_result **)arg;
+    for (;;) {
+        int finished = 1;
+        size_t delta = published(&r->cb, &finished) + published(&r->db, &finished) + published(&r->eb, &finished);
+        if (finished && r->full.outlen >= delta) {
+            pool_store(&r->cancel_full, 1);
+            return;
+        }
+        if (r->full.error) return;
+        if (r->full_next == r->full_size) break;
+        size_t len = min(QBDIFF_CHUNK, r->full_size - r->full_next);
+        stream_encode(&r->full, (uint8_t *)r->full_data + r->full_next, len);
+        r->full_next += len;
     }
 
-    db = malloc(new_size + new_size / 50 + 5);
+    stream_encode(&r->full, NULL, 0);
+    int finished = 1;
+    size_t delta = published(&r->cb, &finished) + published(&r->db, &finished) + published(&r->eb, &finished);
+    if (!r->full.error && r->full.outlen < delta) pool_store(&r->cancel_delta, 1);
+}
 
-    if (db == NULL) {
-        free(cb);
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.db = db;
+// Appends a control triple along with its diff and extra bytes.
+static int emit(struct match_result * r, const uint8_t * RESTRICT old, const uint8_t * RESTRICT new,
+                int64_t old_pos, int64_t new_pos, int64_t add, int64_t extra, int64_t seek) {
+    if (r->probe) {
+        if (!add) return QBERR_OK;
+        if (r->nregions == r->regcap) {
+            int64_t cap = r->regcap * 2 + 1024;
+            struct norm_region * regions = realloc(r->regions, cap * sizeof(struct norm_region));
+            if (!regions) return QBERR_NOMEM;
+            r->regions = regions;
+            r->regcap = cap;
+        }
+        r->regions[r->nregions++] = (struct norm_region){ new_pos, old_pos, add };
+        return QBERR_OK;
     }
+    if (r->sample) {
+        uint8_t *c = column_reserve(&r->sample[0], 27), *d = column_reserve(&r->sample[1], add),
+                *e = column_reserve(&r->sample[2], extra);
+        if (!c || !d || !e) return QBERR_NOMEM;
+        size_t n = put_varint(add, c);
+        n += put_varint(extra, c + n);
+        n += put_varint(zigzag(seek), c + n);
+        r->sample[0].len -= 27 - n;
+        for (int64_t i = 0; i < add; i++) d[i] = new[new_pos + i] - old[old_pos + i];
+        memcpy(e, new + new_pos + add, extra);
+        return QBERR_OK;
+    }
+    if (flush_ctrl(r)) return QBERR_NOMEM;
+
+    for (int64_t done = 0; done < add;) {
+        size_t n = add - done;
+        uint8_t * p = stream_reserve(&r->db, &n);
+        if (!p) return QBERR_NOMEM;
+        for (size_t i = 0; i < n; i++) p[i] = new[new_pos + done + i] - old[old_pos + done + i];
+        if (stream_commit(r, &r->db, n)) return QBERR_NOMEM;
+        done += n;
+    }
+    if (stream_write(r, &r->eb, new + new_pos + add, extra)) return QBERR_NOMEM;
 
-    eb = malloc(new_size + new_size / 50 + 5);
+    r->ctrl[0] = add;
+    r->ctrl[1] = extra;
+    r->ctrl[2] = seek;
+    r->have_ctrl = true;
+    race_step(r);
+    return QBERR_OK;
+}
 
-    if (eb == NULL) {
-        free(cb);
-        free(db);
-        result.error = QBERR_NOMEM;
-        return result;
-    } else {
-        result.eb = eb;
+// Submits the rest of each stream and its end, to be compressed in parallel.
+static void result_finish(void * arg) {
+    struct match_result * r = arg;
+    struct stream * s[3] = { &r->cb, &r->db, &r->eb };
+    for (int i = 0; i < 3; i++) {
+        stream_release(s[i]);
+        if (s[i]->fill) stream_submit(s[i], s[i]->chunk, s[i]->fill);
+        s[i]->chunk = NULL;
+        stream_submit(s[i], NULL, 0);
     }
+    if (r->racing) pool_submit(NULL, race_run, &r, sizeof(r));
+}
 
-    while (new_pos < new_size) {
-        int64_t old_score = 0;
-        int64_t new_peek;
-        for (new_peek = new_pos += match_len; new_pos < new_size; new_pos++) {
-            search64(I, old, old_size, new + new_pos, new_size - new_pos, 0, old_size, &old_pos, &match_len);
+// Scoring loops of the fuzzy match extension. A byte is worth encoding as part of a diff
+// rather than as extra data as long as more than half of the bytes up to it match.
 
-            for (; new_peek < new_pos + match_len; new_peek++) {
-                if ((new_peek + last_offset < old_size) && (old[new_peek + last_offset] == new[new_peek])) {
-                    old_score++;
-                }
-            }
+// Length of the diff extending forwards from the end of the previous match.
+static int64_t fuzzy_forward(const uint8_t * RESTRICT old, int64_t old_size, const uint8_t * RESTRICT new,
+                             int64_t last_old_pos, int64_t last_new_pos, int64_t new_pos) {
+    int64_t bytes = 0, max = 0, len = 0;
+    for (int64_t i = 0; (last_new_pos + i < new_pos) && (last_old_pos + i < old_size);) {
+        if (old[last_old_pos + i] == new[last_new_pos + i]) {
+            bytes++;
+        }
+        i++;
+        if (bytes * 2 - i > max * 2 - len) {
+            max = bytes;
+            len = i;
+        }
+    }
+    return len;
+}
 
-            if (((match_len == old_score) && (match_len != 0)) || (match_len > old_score + 8)) {
-                break;
-            }
+// Length of the diff extending backwards from the start of the current match.
+static int64_t fuzzy_backward(const uint8_t * RESTRICT old, const uint8_t * RESTRICT new, int64_t old_pos,
+                              int64_t new_pos, int64_t last_new_pos) {
+    int64_t bytes = 0, max = 0, len = 0;
+    for (int64_t i = 1; (new_pos >= last_new_pos + i) && (old_pos >= i); i++) {
+        if (old[old_pos - i] == new[new_pos - i]) {
+            bytes++;
+        }
+        if (bytes * 2 - i > max * 2 - len) {
+            max = bytes;
+            len = i;
+        }
+    }
+    return len;
+}
 
-            // Before beginning the next loop iteration, decrement
-            // old_score if needed, since new_pos will be
-            // incremented.
-            if ((new_pos + last_offset < old_size) && (old[new_pos + last_offset] == new[new_pos])) {
-                old_score--;
-            }
+// If there is an overlap between the forward and backward extensions in the new file,
+// that overlap must be eliminated.
+static void fuzzy_overlap(const uint8_t * RESTRICT old, const uint8_t * RESTRICT new, int64_t last_old_pos,
+                          int64_t last_new_pos, int64_t old_pos, int64_t new_pos, int64_t * len_fuzzyforward,
+                          int64_t * len_fuzzybackward) {
+    if (last_new_pos + *len_fuzzyforward <= new_pos - *len_fuzzybackward) return;
+
+    int64_t bytes = 0, max = 0;
+    int64_t overlap = (last_new_pos + *len_fuzzyforward) - (new_pos - *len_fuzzybackward);
+    int64_t len_fuzzyshift = 0;
+    for (int64_t i = 0; i < overlap; i++) {
+        if (new[last_new_pos + *len_fuzzyforward - overlap + i] == old[last_old_pos + *len_fuzzyforward - overlap + i]) {
+            bytes++;
         }
+        if (new[new_pos - *len_fuzzybackward + i] == old[old_pos - *len_fuzzybackward + i]) {
+            bytes--;
+        }
+        if (bytes > max) {
+            max = bytes;
+            len_fuzzyshift = i + 1;
+        }
+    }
 
-        if ((match_len != old_score) || (new_pos == new_size)) {
-            int64_t bytes = 0, max = 0;
-            int64_t len_fuzzyforward = 0;
-            for (int64_t i = 0; (last_new_pos + i < new_pos) && (last_old_pos + i < old_size);) {
-                if (old[last_old_pos + i] == new[last_new_pos + i]) {
-                    bytes++;
-                }
-                i++;
-                if (bytes * 2 - i > max * 2 - len_fuzzyforward) {
-                    max = bytes;
-                    len_fuzzyforward = i;
-                }
-            }
+    *len_fuzzyforward += len_fuzzyshift - overlap;
+    *len_fuzzybackward -= len_fuzzyshift;
+}
 
-            int64_t len_fuzzybackward = 0;
-            if (new_pos < new_size) {
-                bytes = 0;
-                max = 0;
-                for (int64_t i = 1; (new_pos >= last_new_pos + i) && (old_pos >= i); i++) {
-                    if (old[old_pos - i] == new[new_pos - i]) {
-                        bytes++;
-                    }
-                    if (bytes * 2 - i > max * 2 - len_fuzzybackward) {
-                        max = bytes;
-                        len_fuzzybackward = i;
-                    }
-                }
-            }
+// Open addressing table of sampled old file positions, keyed by a hash of the content around
+// them. Only the first position of equal hashes is kept.
+struct sample {
+    uint64_t hash;
+    int64_t pos;
+};
 
-            // If there is an overlap between len_fuzzyforward and
-            // len_fuzzybackward in the new file, that overlap must
-            // be eliminated.
-            if (last_new_pos + len_fuzzyforward > new_pos - len_fuzzybackward) {
-                bytes = 0;
-                max = 0;
-                int64_t overlap = (last_new_pos + len_fuzzyforward) - (new_pos - len_fuzzybackward);
-                int64_t len_fuzzyshift = 0;
-                for (int64_t i = 0; i < overlap; i++) {
-                    if (new[last_new_pos + len_fuzzyforward - overlap + i] ==
-                        old[last_old_pos + len_fuzzyforward - overlap + i]) {
-                        bytes++;
-                    }
-                    if (new[new_pos - len_fuzzybackward + i] == old[old_pos - len_fuzzybackward + i]) {
-                        bytes--;
-                    }
-                    if (bytes > max) {
-                        max = bytes;
-                        len_fuzzyshift = i + 1;
-                    }
-                }
+struct sample_table {
+    struct sample * slots;
+    int64_t n;
+    int bits;
+};
 
-                len_fuzzyforward += len_fuzzyshift - overlap;
-                len_fuzzybackward -= len_fuzzyshift;
-            }
+static int samples_init(struct sample_table * t, int64_t expected) {
+    t->n = 0;
+    t->bits = 4;
+    while ((INT64_C(1) << t->bits) < 2 * expected + 16) t->bits++;
+    t->slots = malloc(sizeof(struct sample) << t->bits);
+    if (!t->slots) return QBERR_NOMEM;
+    for (int64_t i = 0; i < INT64_C(1) << t->bits; i++) t->slots[i].pos = -1;
+    return QBERR_OK;
+}
 
-            for (int64_t i = 0; i < len_fuzzyforward; i++) {
-                db[dblen + i] = new[last_new_pos + i] - old[last_old_pos + i];
-            }
+static struct sample * samples_slot(const struct sample_table * t, uint64_t hash) {
+    int64_t mask = (INT64_C(1) << t->bits) - 1, slot = (hash * 0x9E3779B97F4A7C15ULL) >> (64 - t->bits);
+    while (t->slots[slot].pos >= 0 && t->slots[slot].hash != hash) slot = (slot + 1) & mask;
+    return &t->slots[slot];
+}
 
-            for (int64_t i = 0; i < (new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward); i++) {
-                eb[eblen + i] = new[last_new_pos + len_fuzzyforward + i];
-            }
+// Returns false once the table is half full. The expected number of samples is far below
+// that; degenerate inputs just lose the rest rather than fill the table.
+static bool samples_add(struct sample_table * t, uint64_t hash, int64_t pos) {
+    struct sample * slot = samples_slot(t, hash);
+    if (slot->pos >= 0) return true;
+    if (++t->n > INT64_C(1) << (t->bits - 1)) return false;
+    slot->hash = hash;
+    slot->pos = pos;
+    return true;
+}
 
-            dblen += len_fuzzyforward;
-            eblen += (new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward);
+// Finds long matches of the new file in the old one. The suffix array engine indexes either the
+// whole old file, or only its residual regions laid end to end, with seg_data and seg_old
+// holding the start of each region in the index and in the old file. Out of core, the indexed
+// data is split into windows that each have their own suffix array in the scratch directory.
+// Searches are then answered a chunk of the new file at a time: each window in turn is searched
+// for the long matches of the whole chunk, so that only one of them is in use at a time, and
+// they are kept for every position, in the scratch directory too. The hash engine samples the
+// whole old file.
+struct sa_window {
+    int32_t * I32;
+    int64_t * I64;
+    int64_t start, size;
+};
 
-            wi64(len_fuzzyforward, cb + cblen);
-            cblen += 8;
+struct sa_hit {
+    int64_t pos, len;
+};
 
-            wi64((new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward), cb + cblen);
-            cblen += 8;
+// The matches of new positions [start, start + size), all in a region of the new file that
+// ends at `end', up to `cap' of them, and those of the run of positions that the matcher is
+// stepping through, from run_start on, up to `run_cap' of them.
+struct sa_hits {
+    struct sa_hit * hit;
+    const uint8_t *start, *end;
+    int64_t size, cap;
+    struct sa_hit * run;
+    const uint8_t * run_start;
+    int64_t run_size, run_cap;
+};
 
-            wi64((old_pos - len_fuzzybackward) - (last_old_pos + len_fuzzyforward), cb + cblen);
-            cblen += 8;
+struct match_index {
+    void (*search)(const struct match_index * idx, const uint8_t * new, int64_t new_size, int64_t * old_pos,
+                   int64_t * len);
+    const uint8_t * old;
+    int64_t old_size;
+
+    const uint8_t * data;
+    int64_t size;
+    int32_t * I32;
+    int64_t * I64;
+    int64_t *seg_data, *seg_old, segs;
+
+    const char * scratch;
+    struct sa_window * windows;
+    int64_t nwindows, limit;
+    struct sa_hits * hits;
+
+    // Hash engine.
+    struct sample_table samples;
+    uint64_t mask;
+};
 
-            last_new_pos = new_pos - len_fuzzybackward;
-            last_old_pos = old_pos - len_fuzzybackward;
-            last_offset = old_pos - new_pos;
+// Maps a position in the indexed data back to the old file and measures the match there,
+// since it may well continue past the end of its residual region or window.
+static void sa_locate(const struct match_index * idx, const uint8_t * new, int64_t new_size, int64_t * old_pos,
+                      int64_t * len) {
+    if (idx->segs) {
+        int64_t lo = 0, hi = idx->segs - 1;
+        while (lo < hi) {
+            int64_t mid = (lo + hi + 1) / 2;
+            if (idx->seg_data[mid] <= *old_pos)
+                lo = mid;
+            else
+                hi = mid - 1;
         }
+        *old_pos = idx->seg_old[lo] + *old_pos - idx->seg_data[lo];
     }
-
-    result.cblen = cblen;
-    result.dblen = dblen;
-    result.eblen = eblen;
-
-    return result;
+    *len = matchlen(idx->old + *old_pos, idx->old_size - *old_pos, new, new_size);
 }
 
-static struct match_result diff(const uint8_t * old, const uint8_t * new, const size_t old_size,
-                                const size_t new_size) {
-    int32_t sais_ret = 0;
-    if (old_size < INT32_MAX - 8) {
-        int32_t * I = malloc((old_size + 1) * sizeof(int32_t));
+// Out of core, each window is searched at most WINDOW_STRIDE bytes apart, so that every match at
+// least that long is found, and extended both ways, as by the block hash pre-pass. Positions
+// that are not at least WINDOW_STRIDE bytes from the end of such a match may well have a better
+// match that is shorter, and are searched in all windows a run at a time, as the matcher steps
+// through them one by one. Runs grow up to WINDOW_RUN positions while the matcher steps through
+// them to the end, and shrink when it jumps out of them.
+#define WINDOW_STRIDE 256
+#define WINDOW_RUN 256
+
+static void sa_window_search(const struct match_index * idx, const struct sa_window * w, const uint8_t * new,
+                             int64_t new_size, int64_t * old_pos, int64_t * len) {
+    if (w->I32)
+        search32(w->I32, idx->data + w->start, w->size, new, new_size, 0, w->size - 1, old_pos, len);
+    else
+        search64(w->I64, idx->data + w->start, w->size, new, new_size, 0, w->size - 1, old_pos, len);
+    *old_pos += w->start;
+    sa_locate(idx, new, new_size, old_pos, len);
+}
 
-        if (I == NULL) {
-            struct match_result ml = { 0 };
-            ml.error = QBERR_NOMEM;
-            return ml;
+// Finds the long matches of new positions [new, new + cap) in every window in turn.
+static void sa_chunk(const struct match_index * idx, const uint8_t * new, int64_t new_size) {
+    struct sa_hits * h = idx->hits;
+    h->start = new;
+    h->end = new + new_size;
+    h->size = min(new_size, h->cap);
+    h->run_size = 0;
+    for (int64_t j = 0; j < h->size; j++) h->hit[j].len = -1;
+    for (int64_t i = 0; i < idx->nwindows; i++) {
+        for (int64_t j = 0; j < h->size;) {
+            // What an earlier window matched, the matcher skips.
+            if (h->hit[j].len >= WINDOW_STRIDE) {
+                j += h->hit[j].len;
+                continue;
+            }
+            int64_t pos, l;
+            sa_window_search(idx, &idx->windows[i], new + j, new_size - j, &pos, &l);
+            int64_t back = matchlen_back(idx->old + pos, new + j, min(pos, j));
+            if (back + l < WINDOW_STRIDE) {
+                j += WINDOW_STRIDE;
+                continue;
+            }
+            for (int64_t k = j - back; k < min(j + l, h->size); k++)
+                if (j + l - k > h->hit[k].len) h->hit[k] = (struct sa_hit){ pos + k - j, j + l - k };
+            j += max(l, 1);
         }
+    }
+}
 
-#if defined(_OPENMP)
-        // Paralellization threshold.
-        if (old_size > 32000000) {
-            sais_ret = libsais_omp(old, I, old_size, 1, NULL, 0);
-        } else {
-            sais_ret = libsais(old, I, old_size, 1, NULL);
+// Searches all windows for the positions from new on that have no long match, keeping the first
+// of the longest matches, as a search of the whole index would.
+static void sa_run(const struct match_index * idx, const uint8_t * new, int64_t new_size) {
+    struct sa_hits * h = idx->hits;
+    if (h->run_size)
+        h->run_cap = h->run_start + h->run_size == new ? min(2 * h->run_cap, WINDOW_RUN) : max(h->run_cap / 2, 4);
+    int64_t n = 0;
+    while (n < h->run_cap && new + n < h->start + h->size && h->hit[new + n - h->start].len < WINDOW_STRIDE) n++;
+    h->run_start = new;
+    h->run_size = n;
+    for (int64_t j = 0; j < n; j++) h->run[j].len = -1;
+    for (int64_t i = 0; i < idx->nwindows; i++) {
+        for (int64_t j = 0; j < n; j++) {
+            int64_t pos, l;
+            sa_window_search(idx, &idx->windows[i], new + j, new_size - j, &pos, &l);
+            if (l > h->run[j].len) h->run[j] = (struct sa_hit){ pos, l };
         }
-#else
-        sais_ret = libsais(old, I, old_size, 1, NULL);
-#endif
+    }
+}
 
-        if (sais_ret < 0) {
-            struct match_result ml = { 0 };
-            ml.error = QBERR_SAIS;
-            return ml;
-        }
+static void sa_search(const struct match_index * idx, const uint8_t * new, int64_t new_size, int64_t * old_pos,
+                      int64_t * len) {
+    if (!idx->windows) {
+        if (idx->I32)
+            search32(idx->I32, idx->data, idx->size, new, new_size, 0, idx->size - 1, old_pos, len);
+        else
+            search64(idx->I64, idx->data, idx->size, new, new_size, 0, idx->size - 1, old_pos, len);
+        if (idx->segs) sa_locate(idx, new, new_size, old_pos, len);
+        return;
+    }
+
+    // Searches come in order of new positions, and only leave the chunk for another one.
+    struct sa_hits * h = idx->hits;
+    if (new < h->start || new >= h->start + h->size || new + new_size != h->end) sa_chunk(idx, new, new_size);
+    const struct sa_hit * hit = &h->hit[new - h->start];
+    if (hit->len < WINDOW_STRIDE) {
+        if (new < h->run_start || new >= h->run_start + h->run_size) sa_run(idx, new, new_size);
+        hit = &h->run[new - h->run_start];
+    }
+    *old_pos = hit->pos;
+    *len = hit->len;
+}
 
-        struct match_result ml = match32(I, old, new, new_size, old_size);
+struct sort_args {
+    const uint8_t * data;
+    int64_t size;
+    int32_t * I32;
+    int64_t * I64;
+    int64_t ret;
+};
 
-        free(I);
+static void sort_gang(void * arg, int threads) {
+    struct sort_args * s = arg;
+    if (s->I32)
+        s->ret = libsais_omp(s->data, s->I32, s->size, 1, NULL, threads);
+    else
+        s->ret = libsais64_omp(s->data, s->I64, s->size, 1, NULL, threads);
+}
 
-        return ml;
+// Builds the suffix array of data[0, size) into I32 or I64, allocating it from the scratch
+// directory out of core. libsais is asked for one slot of free space at the end of it. Over
+// QBDIFF_SAIS_PARALLEL bytes, it sorts on a gang of threads, or host tasks with an executor.
+static int sa_sort(const struct qbdiff_executor * ex, const uint8_t * data, int64_t size, bool wide,
+                   const char * scratch, int threads, int32_t ** I32, int64_t ** I64) {
+    if (!wide) {
+        *I32 = buf_alloc(scratch, (size + 1) * sizeof(int32_t));
+        if (*I32 == NULL) return scratch ? QBERR_IOERR : QBERR_NOMEM;
     } else {
-        int64_t * I = malloc((old_size + 1) * sizeof(int64_t));
+        *I64 = buf_alloc(scratch, (size + 1) * sizeof(int64_t));
+        if (*I64 == NULL) return scratch ? QBERR_IOERR : QBERR_NOMEM;
+    }
+    struct sort_args s = { data, size, wide ? NULL : *I32, wide ? *I64 : NULL, 0 };
+    if (size > QBDIFF_SAIS_PARALLEL)
+        pool_gang(ex, threads, sort_gang, &s);
+    else
+        sort_gang(&s, 1);
+    return s.ret < 0 ? QBERR_SAIS : QBERR_OK;
+}
 
-        if (I == NULL) {
-            struct match_result ml = { 0 };
-            ml.error = QBERR_NOMEM;
-            return ml;
-        }
+static int sa_build(struct match_index * idx, const struct qbdiff_executor * ex, int threads) {
+    idx->search = sa_search;
+
+    // Out of core, windows are sized so that one window and its suffix array fit the limit.
+    int64_t window = idx->limit / 5;
+    bool wide = window >= QBDIFF_SAIS32_LIMIT;
+    if (wide) window = idx->limit / 9;
+    window = max(window, 1 << 16);
+    if (!idx->scratch || idx->size <= window)
+        return sa_sort(ex, idx->data, idx->size, idx->size >= QBDIFF_SAIS32_LIMIT, NULL, threads, &idx->I32,
+                       &idx->I64);
+
+    idx->nwindows = (idx->size + window - 1) / window;
+    idx->windows = calloc(idx->nwindows, sizeof(struct sa_window));
+    if (!idx->windows) return QBERR_NOMEM;
+    for (int64_t i = 0; i < idx->nwindows; i++) {
+        struct sa_window * w = &idx->windows[i];
+        w->start = i * window;
+        w->size = min(window, idx->size - w->start);
+        int err = sa_sort(ex, idx->data + w->start, w->size, wide, idx->scratch, threads, &w->I32, &w->I64);
+        if (err != QBERR_OK) return err;
+    }
 
-#if defined(_OPENMP)
-        sais_ret = libsais64_omp(old, I, old_size, 1, NULL, 0);
-#else
-        sais_ret = libsais64(old, I, old_size, 1, NULL);
-#endif
+    // Every window is paged in once per chunk, so chunks are large: their matches take as much
+    // scratch space as the suffix arrays.
+    idx->hits = calloc(1, sizeof(struct sa_hits));
+    if (!idx->hits || !(idx->hits->run = malloc(WINDOW_RUN * sizeof(struct sa_hit)))) return QBERR_NOMEM;
+    idx->hits->run_cap = 8;
+    idx->hits->cap = max(idx->size * (wide ? 8 : 4) / (int64_t)sizeof(struct sa_hit), 4096);
+    idx->hits->hit = buf_alloc(idx->scratch, idx->hits->cap * sizeof(struct sa_hit));
+    return idx->hits->hit ? QBERR_OK : QBERR_IOERR;
+}
+
+static void index_free(struct match_index * idx) {
+    free(idx->I32);
+    free(idx->I64);
+    for (int64_t i = 0; idx->windows && i < idx->nwindows; i++) {
+        buf_free(idx->scratch, idx->windows[i].I32, (idx->windows[i].size + 1) * sizeof(int32_t));
+        buf_free(idx->scratch, idx->windows[i].I64, (idx->windows[i].size + 1) * sizeof(int64_t));
+    }
+    free(idx->windows);
+    if (idx->hits) {
+        buf_free(idx->scratch, idx->hits->hit, idx->hits->cap * sizeof(struct sa_hit));
+        free(idx->hits->run);
+    }
+    free(idx->hits);
+    if (idx->data != idx->old) buf_free(idx->scratch, idx->data, idx->size);
+    free(idx->seg_data);
+    free(idx->seg_old);
+    free(idx->samples.slots);
+}
+
+// Hash engine, in the style of long distance matchers. Every position whose 16 byte window
+// hashes to a value with the low bits clear is sampled, about one in `interval'. A search
+// looks up the first samples ahead of the position and verifies them with matchlen, so it
+// takes constant time, but only finds matches that span a sample and only one candidate
+// per sample.
+
+#define HASH_WINDOW 16
+#define HASH_INTERVAL 32
+
+static inline uint64_t hash_window(const uint8_t * p) {
+    uint64_t a, b;
+    memcpy(&a, p, 8);
+    memcpy(&b, p + 8, 8);
+    uint64_t h = a ^ (b * 0x9E3779B97F4A7C15ULL);
+    h = (h ^ (h >> 29)) * 0xBF58476D1CE4E5B9ULL;
+    return h ^ (h >> 32);
+}
 
-        if (sais_ret < 0) {
-            struct match_result ml = { 0 };
-            ml.error = QBERR_SAIS;
-            return ml;
+static void hash_search(const struct match_index * idx, const uint8_t * new, int64_t new_size, int64_t * old_pos,
+                        int64_t * len) {
+    int64_t limit = min(new_size - HASH_WINDOW, 4 * (int64_t)idx->mask + 4), tries = 2;
+    *old_pos = 0;
+    *len = 0;
+    for (int64_t i = 0; i <= limit && tries; i++) {
+        uint64_t h = hash_window(new + i);
+        if (h & idx->mask) continue;
+        int64_t o = samples_slot(&idx->samples, h)->pos - i;
+        if (o + i < 0) continue;
+        tries--;
+        if (o < 0) continue;
+        int64_t l = matchlen(idx->old + o, idx->old_size - o, new, new_size);
+        if (l > *len) {
+            *len = l;
+            *old_pos = o;
         }
+    }
+}
 
-        struct match_result ml = match64(I, old, new, new_size, old_size);
+static int hash_build(struct match_index * idx, int64_t interval) {
+    idx->search = hash_search;
+    idx->mask = interval - 1;
+    if (samples_init(&idx->samples, idx->old_size / interval) != QBERR_OK) return QBERR_NOMEM;
+    for (int64_t i = 0; i + HASH_WINDOW <= idx->old_size; i++) {
+        uint64_t h = hash_window(idx->old + i);
+        if (!(h & idx->mask) && !samples_add(&idx->samples, h, i)) break;
+    }
+    return QBERR_OK;
+}
 
-        free(I);
+// Matches new[new_start, new_end) against the old file, starting from old_start and leaving
+// the old position at old_end.
+static int match(const struct match_index * idx, const uint8_t * RESTRICT new, int64_t new_start, int64_t new_end,
+                 int64_t old_start, int64_t old_end, struct match_result * r) {
+    const uint8_t * old = idx->old;
+    int64_t old_size = idx->old_size;
+    int64_t new_pos = new_start;
+    int64_t old_pos = old_start;
+    int64_t match_len = 0;
+    int64_t last_offset = old_start - new_start;
+    int64_t last_new_pos = new_start;
+    int64_t last_old_pos = old_start;
 
-        return ml;
+    while (new_pos < new_end) {
+        int64_t old_score = 0;
+        int64_t new_peek;
+        for (new_peek = new_pos += match_len; new_pos < new_end; new_pos++) {
+            idx->search(idx, new + new_pos, new_end - new_pos, &old_pos, &match_len);
+
+            for (; new_peek < new_pos + match_len; new_peek++) {
+                if ((new_peek + last_offset < old_size) && (old[new_peek + last_offset] == new[new_peek])) {
+                    old_score++;
+                }
+            }
+
+            if (((match_len == old_score) && (match_len != 0)) || (match_len > old_score + 8)) {
+                break;
+            }
+
+            // Before beginning the next loop iteration, decrement
+            // old_score if needed, since new_pos will be
+            // incremented.
+            if ((new_pos + last_offset < old_size) && (old[new_pos + last_offset] == new[new_pos])) {
+                old_score--;
+            }
+        }
+
+        if ((match_len != old_score) || (new_pos == new_end)) {
+            int64_t len_fuzzyforward = fuzzy_forward(old, old_size, new, last_old_pos, last_new_pos, new_pos);
+            int64_t len_fuzzybackward = 0;
+            if (new_pos < new_end)
+                len_fuzzybackward = fuzzy_backward(old, new, old_pos, new_pos, last_new_pos);
+            else
+                old_pos = old_end;
+            fuzzy_overlap(old, new, last_old_pos, last_new_pos, old_pos, new_pos, &len_fuzzyforward,
+                          &len_fuzzybackward);
+
+            int64_t extra = (new_pos - len_fuzzybackward) - (last_new_pos + len_fuzzyforward);
+            int64_t seek = (old_pos - len_fuzzybackward) - (last_old_pos + len_fuzzyforward);
+            if (emit(r, old, new, last_old_pos, last_new_pos, len_fuzzyforward, extra, seek)) return QBERR_NOMEM;
+
+            last_new_pos = new_pos - len_fuzzybackward;
+            last_old_pos = old_pos - len_fuzzybackward;
+            last_offset = old_pos - new_pos;
+        }
+    }
+
+    return QBERR_OK;
+}
+
+// Matches the gap between two exactly matching regions.
+static int match_gap(const struct match_index * idx, const uint8_t * RESTRICT new, int64_t new_start,
+                     int64_t new_end, int64_t old_start, int64_t old_end, struct match_result * r) {
+    if (new_start == new_end) {
+        if (old_start == old_end) return QBERR_OK;
+        // Fold the seek into the previous control triple.
+        if (r->have_ctrl) {
+            r->ctrl[2] += old_end - old_start;
+            return QBERR_OK;
+        }
     }
+    if (new_start == new_end || !idx->size)
+        return emit(r, idx->old, new, old_start, new_start, 0, new_end - new_start, old_end - old_start);
+    return match(idx, new, new_start, new_end, old_start, old_end, r);
 }
 
+// Block hash pre-pass. Positions where a gear hash of the preceding 64 bytes has its low bits
+// clear are sampled in both files, so that identical content yields identical samples no
+// matter how it moved. Samples of the new file are looked up among those of the old one and
+// extended into exact matches, which become anchors when at least `interval' bytes long.
+
+struct anchor {
+    int64_t new_pos, old_pos, len;
+};
+
+#define QBDIFF_BLOCK_THRESHOLD (256 << 20)
+
+static int64_t block_interval(int64_t block_size, int64_t old_size) {
+    int64_t interval = 64;
+    if (block_size < 0 || (!block_size && old_size < QBDIFF_BLOCK_THRESHOLD)) return 0;
+    if (!block_size) block_size = max(1024, old_size >> 22);
+    while (interval < block_size) interval <<= 1;
+    return interval;
+}
+
+static int find_anchors(const uint8_t * RESTRICT old, int64_t old_size, const uint8_t * RESTRICT new,
+                        int64_t new_start, int64_t new_end, int64_t interval, struct anchor ** anchors,
+                        int64_t * count) {
+    uint64_t gear[256], seed = 0, h = 0, mask = interval - 1;
+    for (int i = 0; i < 256; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        gear[i] = z ^ (z >> 31);
+    }
+
+    struct sample_table table;
+    if (samples_init(&table, old_size / interval) != QBERR_OK) return QBERR_NOMEM;
+    for (int64_t i = 0; i < old_size; i++) {
+        h = (h << 1) + gear[old[i]];
+        if (!(h & mask) && i >= 63 && !samples_add(&table, h, i)) break;
+    }
+
+    *anchors = NULL;
+    *count = 0;
+    int64_t cur = new_start, p = new_start, n = 0, acap = 0;
+    for (h = 0; p < new_end; p++) {
+        h = (h << 1) + gear[new[p]];
+        if ((h & mask) || p < 63) continue;
+        int64_t o = samples_slot(&table, h)->pos;
+        if (o < 0) continue;
+
+        int64_t fwd = matchlen(old + o, old_size - o, new + p, new_end - p);
+        int64_t back = matchlen_back(old + o, new + p, min(o, p - cur));
+        if (back + fwd < interval) continue;
+
+        if (n == acap) {
+            acap = acap * 2 + 256;
+            struct anchor * a = realloc(*anchors, acap * sizeof(struct anchor));
+            if (!a) {
+                free(table.slots);
+                return QBERR_NOMEM;
+            }
+            *anchors = a;
+        }
+        (*anchors)[n++] = (struct anchor){ p - back, o - back, back + fwd };
+
+        // Resume right after the match, with the hash of the bytes preceding it.
+        cur = p + fwd;
+        for (h = 0, p = max(0, cur - 64); p < cur; p++) h = (h << 1) + gear[new[p]];
+        p = cur - 1;
+    }
+
+    free(table.slots);
+    *count = n;
+    return QBERR_OK;
+}
+
+static int by_old_pos(const void * a, const void * b) {
+    int64_t x = ((const struct anchor *)a)->old_pos, y = ((const struct anchor *)b)->old_pos;
+    return (x > y) - (x < y);
+}
+
+// Lays the parts of the old file not covered by the anchors or by the trimmed prefix and
+// suffix out end to end, for the suffix array to index only those.
+static int residual_index(struct match_index * idx, const struct anchor * anchors, int64_t count, int64_t prefix,
+                          int64_t old_end) {
+    int64_t n = 0, size = 0, pos = prefix;
+    struct anchor * used = malloc((count + 1) * sizeof(struct anchor));
+    idx->seg_data = malloc((count + 1) * sizeof(int64_t));
+    idx->seg_old = malloc((count + 1) * sizeof(int64_t));
+    if (!used || !idx->seg_data || !idx->seg_old) {
+        free(used);
+        return QBERR_NOMEM;
+    }
+
+    memcpy(used, anchors, count * sizeof(struct anchor));
+    used[count] = (struct anchor){ 0, old_end, idx->old_size - old_end };
+    qsort(used, count + 1, sizeof(struct anchor), by_old_pos);
+    for (int64_t i = 0; i <= count; i++) {
+        if (used[i].old_pos > pos) {
+            idx->seg_data[n] = size;
+            idx->seg_old[n++] = pos;
+            size += used[i].old_pos - pos;
+        }
+        pos = max(pos, used[i].old_pos + used[i].len);
+    }
+    free(used);
+
+    idx->segs = n;
+    idx->size = size;
+    if (!size) return QBERR_OK;
+
+    uint8_t * data = buf_alloc(idx->scratch, size);
+    if (!data) return idx->scratch ? QBERR_IOERR : QBERR_NOMEM;
+    for (int64_t i = 0; i < n; i++) {
+        int64_t len = (i + 1 < n ? idx->seg_data[i + 1] : size) - idx->seg_data[i];
+        memcpy(data + idx->seg_data[i], idx->old + idx->seg_old[i], len);
+    }
+    idx->data = data;
+    return QBERR_OK;
+}
+
+// Emits the prefix, the anchors and the gaps between them, and the suffix of the new file.
+static int match_all(const struct match_index * idx, const struct anchor * anchors, int64_t count,
+                     const uint8_t * RESTRICT new, int64_t prefix, int64_t new_end, int64_t old_end,
+                     int64_t suffix, struct match_result * r) {
+    const uint8_t * old = idx->old;
+    int err;
+    if (prefix && (err = emit(r, old, new, 0, 0, prefix, 0, 0))) return err;
+
+    int64_t new_pos = prefix, old_pos = prefix;
+    for (int64_t i = 0; i < count; i++) {
+        if ((err = match_gap(idx, new, new_pos, anchors[i].new_pos, old_pos, anchors[i].old_pos, r))) return err;
+        if ((err = emit(r, old, new, anchors[i].old_pos, anchors[i].new_pos, anchors[i].len, 0, 0))) return err;
+        new_pos = anchors[i].new_pos + anchors[i].len;
+        old_pos = anchors[i].old_pos + anchors[i].len;
+    }
+    if ((err = match_gap(idx, new, new_pos, new_end, old_pos, old_end, r))) return err;
+    if (suffix && (err = emit(r, old, new, old_end, new_end, suffix, 0, 0))) return err;
+    return QBERR_OK;
+}
+
+struct match_args {
+    const struct match_index * idx;
+    const struct anchor * anchors;
+    int64_t count;
+    const uint8_t * new;
+    int64_t prefix, new_end, old_end, suffix;
+    struct match_result * r;
+};
+
+static void match_stage(void * arg) {
+    struct match_args * a = arg;
+    a->r->error = match_all(a->idx, a->anchors, a->count, a->new, a->prefix, a->new_end, a->old_end, a->suffix, a->r);
+    if (a->r->error == QBERR_OK && !a->r->probe && !a->r->sample) a->r->error = write_controls(a->r);
+}
+
+static struct match_result diff(const uint8_t * old, const uint8_t * new, const size_t old_size,
+                                const size_t new_size, const struct qbdiff_options * opts, int db_codec,
+                                int eb_codec, const uint8_t * full, int full_codec, bool probe,
+                                struct column * sample, struct qbdiff_stats * stats) {
+    int threads = opts ? opts->threads : 0, engine = opts ? opts->engine : QBDIFF_ENGINE_SA;
+    const struct qbdiff_executor * ex = opts && opts->executor.submit ? &opts->executor : NULL;
+    struct match_result ml = { 0 };
+    ml.probe = probe;
+    ml.sample = sample;
+    ml.db.codec = db_codec;
+    ml.eb.codec = eb_codec;
+    ml.cb.cancel = ml.db.cancel = ml.eb.cancel = &ml.cancel_delta;
+    // The full copy of the new file, when given, may race the diff on a spare thread.
+    ml.full_data = (threads > 0 ? threads : pool_threads()) > 1 ? full : NULL;
+    ml.full_size = new_size;
+    ml.full.codec = full_codec;
+    ml.full.chosen = ml.full.borrowed = true;
+    ml.full.cancel = &ml.cancel_full;
+    // The extra stream is primed with the end of the old file, all of it when it fits.
+    if (opts && opts->extra_dict) {
+        ml.eb.codec |= QBDIFF_CODEC_LZMA2_DICT;
+        ml.eb.dict_len = min(old_size, QBDIFF_DICT_SIZE);
+        ml.eb.dict_off = old_size - ml.eb.dict_len;
+        ml.eb.dict = old + ml.eb.dict_off;
+    }
+    struct match_index idx = { 0 };
+    struct anchor * anchors = NULL;
+    int64_t count = 0;
+    double t0 = now();
+
+    // Out of core when the in-memory diff would not fit the limit.
+    idx.limit = memory_limit(opts);
+    if (opts && opts->scratch_dir && 5 * old_size + 2 * new_size > idx.limit) idx.scratch = opts->scratch_dir;
+
+    // Identical leading and trailing regions are emitted as single control entries, so only the
+    // middle of the new file goes through the matcher. Nothing needs to be indexed when either
+    // middle is empty, which is the case for identical files and pure appends.
+    int64_t prefix = matchlen(old, old_size, new, new_size);
+    int64_t suffix = matchlen_back(old + old_size, new + new_size, min(old_size, new_size) - prefix);
+    int64_t old_end = old_size - suffix, new_end = new_size - suffix;
+
+    idx.old = idx.data = old;
+    idx.old_size = idx.size = old_size;
+    if (new_end == prefix || old_end == prefix) {
+        idx.size = 0;
+    } else {
+        int64_t interval = block_interval(opts ? opts->block_size : 0, old_end - prefix);
+        if (interval &&
+            (ml.error = find_anchors(old, old_size, new, prefix, new_end, interval, &anchors, &count)) != QBERR_OK)
+            goto err;
+        if (engine == QBDIFF_ENGINE_HASH) {
+            ml.error = hash_build(&idx, HASH_INTERVAL);
+        } else {
+            if (count && (ml.error = residual_index(&idx, anchors, count, prefix, old_end)) != QBERR_OK) goto err;
+            if (idx.size) ml.error = sa_build(&idx, ex, threads);
+        }
+        if (ml.error != QBERR_OK) goto err;
+    }
+
+    double t1 = now(), t2 = t1;
+    stats->index_time = t1 - t0;
+
+    // The matcher runs on one thread, and the encoders pick up its chunks on the others.
+    struct match_args args = { &idx, anchors, count, new, prefix, new_end, old_end, suffix, &ml };
+    pool_run(ex, threads > 0 ? min(threads, 4) : 4, match_stage, &args);
+    if (ml.error != QBERR_OK) goto err;
+    t2 = now();
+    stats->match_time = t2 - t1;
+    index_free(&idx);
+    free(anchors);
+    if (probe || sample) return ml;
+
+    pool_run(ex, threads > 0 ? min(threads, 3 + ml.racing) : 3 + ml.racing, result_finish, &ml);
+    stats->compress_time = now() - t2;
+
+    // ml is returned by value.
+    ml.cb.cancel = ml.db.cancel = ml.eb.cancel = ml.full.cancel = NULL;
+    if (!ml.cancel_delta) ml.error = ml.cb.error ? ml.cb.error : ml.db.error ? ml.db.error : ml.eb.error;
+    if (ml.error != QBERR_OK) result_free(&ml);
+    return ml;
+
+err:
+    index_free(&idx);
+    free(anchors);
+    result_free(&ml);
+    return ml;
+}
+
+LIBQDIFF_PUBLIC_API void qbdiff_options_init(struct qbdiff_options * opts) { memset(opts, 0, sizeof(*opts)); }
+
 LIBQDIFF_PUBLIC_API int qbdiff_compute(const uint8_t * RESTRICT old, const uint8_t * RESTRICT new, size_t old_size,
                                        size_t new_size, FILE * diff_file) {
-    int err_code = 0;
+    return qbdiff_compute_ex(old, new, old_size, new_size, diff_file, NULL);
+}
+
+// Picks the BCJ filter for the machine of an ELF or PE executable.
+static int detect_filter(const uint8_t * data, size_t size) {
+    unsigned machine = 0;
+    if (size >= 20 && !memcmp(data, "\x7f" "ELF", 4)) {
+        machine = data[5] == 2 ? data[18] << 8 | data[19] : data[19] << 8 | data[18];
+        if (machine == 3 || machine == 62) return QBDIFF_FILTER_X86;  // EM_386, EM_X86_64.
+        if (machine == 183) return QBDIFF_FILTER_ARM64;              // EM_AARCH64.
+    } else if (size >= 64 && !memcmp(data, "MZ", 2)) {
+        size_t pe = data[60] | data[61] << 8 | data[62] << 16 | (size_t)data[63] << 24;
+        if (pe > size - 6 || memcmp(data + pe, "PE\0\0", 4)) return QBDIFF_FILTER_NONE;
+        machine = data[pe + 4] | data[pe + 5] << 8;
+        if (machine == 0x14c || machine == 0x8664) return QBDIFF_FILTER_X86;
+        if (machine == 0xaa64) return QBDIFF_FILTER_ARM64;
+    }
+    return QBDIFF_FILTER_NONE;
+}
+
+// The codec of a stream given the options and the new file.
+static int stream_codec(const struct qbdiff_options * opts, const uint8_t * new, size_t new_size, int stream) {
+    int filter = opts ? opts->filter : QBDIFF_FILTER_AUTO;
+    int streams = opts && opts->filter_streams ? opts->filter_streams : QBDIFF_STREAM_FULL;
+    if (!(streams & stream)) return QBDIFF_CODEC_LZMA2;
+    if (filter == QBDIFF_FILTER_AUTO) {
+        filter = detect_filter(new, new_size);
+#ifndef LZMA_FILTER_ARM64
+        if (filter == QBDIFF_FILTER_ARM64) filter = QBDIFF_FILTER_NONE;
+#endif
+    }
+    switch (filter) {
+        case QBDIFF_FILTER_X86:
+            return QBDIFF_CODEC_LZMA2 | QBDIFF_CODEC_X86;
+        case QBDIFF_FILTER_ARM64:
+            return QBDIFF_CODEC_LZMA2 | QBDIFF_CODEC_ARM64;
+        default:
+            return QBDIFF_CODEC_LZMA2;
+    }
+}
+
+// The codec of a full copy of the new file.
+static int full_codec(const struct qbdiff_options * opts, const uint8_t * new, size_t new_size) {
+    uint64_t hist[256] = { 0 };
+    histogram(hist, new, new_size);
+    return incompressible(hist) ? QBDIFF_CODEC_STORE : stream_codec(opts, new, new_size, QBDIFF_STREAM_FULL);
+}
+
+// Writes a patch holding a copy of the new file, compressed with the codec.
+static int write_packed(const uint8_t * packed, size_t packed_len, size_t new_size, const uint8_t cksum[64],
+                        int codec, FILE * diff_file, struct qbdiff_stats * stats) {
+    double t = now();
+    int err = QBERR_OK;
+    uint8_t header[QBDIFF_HEADER_FULL];
+    memcpy(header, QBDIFF_MAGIC_FULL, 5);
+    memcpy(header + 5, cksum, 64);
+    header[69] = codec;
+    wi64(new_size, header + 70);
+    if (fwrite(header, 1, QBDIFF_HEADER_FULL, diff_file) != QBDIFF_HEADER_FULL ||
+        fwrite(packed, 1, packed_len, diff_file) != packed_len)
+        err = QBERR_IOERR;
+    stats->write_time += now() - t;
+    return err;
+}
+
+// Finds the regions of the new file that match the old one with a quick diff on the hash
+// engine, and normalizes a copy of the new file against them. Leaves *new_norm NULL when no
+// branch could be normalized.
+static int normalize_new(const uint8_t * old, const uint8_t * new, size_t old_size, size_t new_size,
+                         const struct qbdiff_options * opts, int arch, uint8_t ** new_norm, struct norm_info * norm) {
+    struct qbdiff_options probe_opts = { 0 };
+    struct qbdiff_stats probe_stats;
+    if (opts) probe_opts = *opts;
+    probe_opts.engine = QBDIFF_ENGINE_HASH;
+    struct match_result probe = diff(old, new, old_size, new_size, &probe_opts, 0, 0, NULL, 0, true, NULL,
+                                     &probe_stats);
+    if (probe.error != QBERR_OK) return probe.error;
+
+    *new_norm = malloc(new_size);
+    if (!*new_norm) {
+        result_free(&probe);
+        return QBERR_NOMEM;
+    }
+    memcpy(*new_norm, new, new_size);
+    int err = normalize(arch, *new_norm, new_size, probe.regions, probe.nregions, norm);
+    probe.regions = NULL;
+    result_free(&probe);
+
+    bool changed = false;
+    for (int64_t i = 0; err == QBERR_OK && !changed && i < (norm->nflags + 7) / 8; i++) changed = norm->flags[i];
+    if (err != QBERR_OK || !changed) {
+        norm_free(norm);
+        free(*new_norm);
+        *new_norm = NULL;
+    }
+    return err;
+}
+
+// Diffs a copy of the new file with its branches normalized against the old one, and swaps its
+// streams into ml, with the normalization map in *nb, when that makes the patch smaller or when
+// a full copy racing ml won and left it unfinished; the full copy still competes afterwards.
+// Whether it pays off depends on how much code moved and how, and a normalized diff can come out
+// much larger, e.g. when a region moved with its branches left as they were.
+static int normalized_diff(const uint8_t * old, const uint8_t * new, size_t old_size, size_t new_size,
+                           const struct qbdiff_options * opts, int arch, struct match_result * ml, uint8_t ** nb,
+                           size_t * nblen, size_t * nbraw, int * nb_codec, struct qbdiff_stats * stats) {
+    struct norm_info norm = { 0 };
+    struct qbdiff_stats norm_stats = { 0 };
+    uint8_t *new_norm = NULL, *map;
+    double t = now();
+    int err = normalize_new(old, new, old_size, new_size, opts, arch, &new_norm, &norm);
+    if (err != QBERR_OK || !new_norm) {
+        stats->index_time += now() - t;
+        return err;
+    }
+    if ((err = norm_encode(&norm, &map, nbraw)) == QBERR_OK) {
+        uint64_t hist[256] = { 0 };
+        histogram(hist, map, *nbraw);
+        *nb_codec = incompressible(hist) ? QBDIFF_CODEC_STORE : QBDIFF_CODEC_LZMA2;
+        err = compress(map, *nbraw, *nb_codec, nb, nblen);
+        free(map);
+    }
+    norm_free(&norm);
+    stats->index_time += now() - t;
+
+    struct match_result mn = { 0 };
+    if (err == QBERR_OK) {
+        mn = diff(old, new_norm, old_size, new_size, opts, stream_codec(opts, new, new_size, QBDIFF_STREAM_DIFF),
+                  stream_codec(opts, new, new_size, QBDIFF_STREAM_EXTRA), NULL, 0, false, NULL, &norm_stats);
+        err = mn.error;
+    }
+    free(new_norm);
+    stats->index_time += norm_stats.index_time;
+    stats->match_time += norm_stats.match_time;
+    stats->compress_time += norm_stats.compress_time;
+
+    size_t plain_len = ml->cancel_delta ? SIZE_MAX : QBDIFF_HEADER + ml->cb.outlen + ml->db.outlen + ml->eb.outlen;
+    if (err == QBERR_OK && QBDIFF_HEADER_NORM + mn.cb.outlen + mn.db.outlen + mn.eb.outlen + *nblen < plain_len) {
+        struct stream cb = ml->cb, db = ml->db, eb = ml->eb;
+        ml->cb = mn.cb;
+        ml->db = mn.db;
+        ml->eb = mn.eb;
+        mn.cb = cb;
+        mn.db = db;
+        mn.eb = eb;
+        ml->cancel_delta = 0;
+    } else {
+        free(*nb);
+        *nb = NULL;
+        *nblen = *nbraw = 0;
+    }
+    if (err == QBERR_OK) result_free(&mn);
+    return err;
+}
+
+// Seekable patches. The diff is made over the whole file as usual, with its streams kept raw,
+// and its control entries are then cut at the block boundaries of the new file: an entry
+// that crosses one is split, and the old position at the start of each block goes into the
+// index. The blocks are compressed on their own, in parallel. Normalization, the dictionary
+// of the extra stream and full copies do not apply.
+struct seek_block {
+    int64_t old_pos;
+    struct column cols[3];  // Control columns.
+    const uint8_t *d, *e;   // Diff and extra bytes.
+    size_t dlen, elen;
+    uint8_t * out[3];
+    size_t outlen[3], raw[3];
+    uint8_t codec[3];
     uint8_t cksum[64];
-    blake2b_cksum(new, new_size, cksum);
+};
 
-    if (old_size < 256 || new_size < 256) {
-        // Handle the case where the old file is empty,
-        // or both files are very small.
-        if (fwrite(QBDIFF_MAGIC_FULL, 1, 5, diff_file) != 5) return QBERR_IOERR;
-        if (fwrite(cksum, 1, 64, diff_file) != 64) return QBERR_IOERR;
+struct seek_cut {
+    struct seek_block * b;
+    int64_t block, k, new_pos, old_pos;
+    int64_t ctrl[3];  // Entry being merged.
+    const uint8_t *d, *e;
+};
 
-        uint8_t * compressed;
-        size_t compressed_len;
-        int result = compress(new, new_size, &compressed, &compressed_len);
-        if (result != QBERR_OK) return result;
+static int cut_flush(struct seek_cut * c) {
+    struct seek_block * b = &c->b[c->k];
+    int err = column_put(&b->cols[0], c->ctrl[0]) || column_put(&b->cols[1], c->ctrl[1]) ||
+              column_put(&b->cols[2], zigzag(c->ctrl[2]));
+    c->ctrl[0] = c->ctrl[1] = c->ctrl[2] = 0;
+    return err ? QBERR_NOMEM : QBERR_OK;
+}
 
-        uint8_t buf[8];
-        wi64(new_size, buf);
-        if (fwrite(buf, 1, 8, diff_file) != 8) {
-            free(compressed);
-            return QBERR_IOERR;
+// Adds len diff (extra = 0) or extra bytes to the blocks, moving on to the next block when the
+// current one is full. The seek of an entry cut at the end of a block is dropped, as the index
+// holds where the next block starts in the old file.
+static int cut_bytes(struct seek_cut * c, int extra, int64_t len) {
+    while (len) {
+        if (c->new_pos == (c->k + 1) * c->block) {
+            c->ctrl[2] = 0;
+            if (cut_flush(c)) return QBERR_NOMEM;
+            c->k++;
+            c->b[c->k].old_pos = c->old_pos;
+            c->b[c->k].d = c->d;
+            c->b[c->k].e = c->e;
         }
-
-        if (fwrite(compressed, 1, compressed_len, diff_file) != compressed_len) {
-            free(compressed);
-            return QBERR_IOERR;
+        int64_t n = min(len, (c->k + 1) * c->block - c->new_pos);
+        struct seek_block * b = &c->b[c->k];
+        if ((c->ctrl[2] || (!extra && c->ctrl[1])) && cut_flush(c)) return QBERR_NOMEM;
+        c->ctrl[extra] += n;
+        if (extra) {
+            b->elen += n;
+            c->e += n;
+        } else {
+            b->dlen += n;
+            c->d += n;
+            c->old_pos += n;
         }
+        c->new_pos += n;
+        len -= n;
+    }
+    return QBERR_OK;
+}
+
+static int cut_blocks(const struct column sample[3], struct seek_block * b, int64_t block) {
+    struct seek_cut c = { b, block, 0, 0, 0, { 0 }, sample[1].buf, sample[2].buf };
+    const uint8_t *p = sample[0].buf, *end = p + sample[0].len;
+    b[0].d = c.d;
+    b[0].e = c.e;
+    uint64_t v[3];
+    while (p < end) {
+        for (int i = 0; i < 3; i++) p += get_varint(p, &v[i]);
+        int err = cut_bytes(&c, 0, v[0]);
+        if (err == QBERR_OK) err = cut_bytes(&c, 1, v[1]);
+        if (err != QBERR_OK) return err;
+        c.ctrl[2] += unzigzag(v[2]);
+        c.old_pos += unzigzag(v[2]);
+    }
+    c.ctrl[2] = 0;
+    return cut_flush(&c);
+}
+
+struct seek_args {
+    struct seek_block * b;
+    const uint8_t * new;
+    int64_t new_size, block;
+    int db_codec, eb_codec;
+    int err;
+};
+
+// Compresses the streams of a block.
+static void seek_compress(void * arg, int64_t k) {
+    struct seek_args * a = arg;
+    struct seek_block * b = &a->b[k];
+    int64_t len = min(a->block, a->new_size - k * a->block);
+    blake2b_cksum(a->new + k * a->block, len, b->cksum);
+
+    uint8_t lens[18];
+    size_t n = put_varint(b->cols[0].len, lens);
+    n += put_varint(b->cols[1].len, lens + n);
+    struct column ctrl = { 0 };
+    uint8_t * p = column_reserve(&ctrl, n + b->cols[0].len + b->cols[1].len + b->cols[2].len);
+    if (!p) {
+        pool_store(&a->err, QBERR_NOMEM);
+        return;
+    }
+    memcpy(p, lens, n);
+    for (int i = 0; i < 3; i++) {
+        memcpy(p + n, b->cols[i].buf, b->cols[i].len);
+        n += b->cols[i].len;
+        free(b->cols[i].buf);
+        b->cols[i].buf = NULL;
+    }
+
+    const uint8_t * data[3] = { ctrl.buf, b->d, b->e };
+    size_t raw[3] = { ctrl.len, b->dlen, b->elen };
+    int codecs[3] = { QBDIFF_CODEC_LZMA2, a->db_codec, a->eb_codec };
+    for (int i = 0; i < 3; i++) {
+        uint64_t hist[256] = { 0 };
+        histogram(hist, data[i], raw[i]);
+        b->codec[i] = incompressible(hist) ? QBDIFF_CODEC_STORE : codecs[i];
+        b->raw[i] = raw[i];
+        int err = compress(data[i], raw[i], b->codec[i], &b->out[i], &b->outlen[i]);
+        if (err != QBERR_OK) pool_store(&a->err, err);
+    }
+    free(ctrl.buf);
+}
 
-        free(compressed);
+// Spans of the old file that the blocks of an in-place patch read.
+struct read_span {
+    int64_t k, lo, hi;
+};
+
+struct read_spans {
+    struct read_span * s;
+    int64_t n, cap;
+};
+
+static int spans_add(struct read_spans * rs, int64_t k, int64_t lo, int64_t hi) {
+    struct read_span * last = rs->n ? &rs->s[rs->n - 1] : NULL;
+    if (last && last->k == k && last->hi == lo) {
+        last->hi = hi;
         return QBERR_OK;
     }
+    if (rs->n == rs->cap) {
+        int64_t cap = rs->cap * 2 + 256;
+        struct read_span * s = realloc(rs->s, cap * sizeof(struct read_span));
+        if (!s) return QBERR_NOMEM;
+        rs->s = s;
+        rs->cap = cap;
+    }
+    rs->s[rs->n++] = (struct read_span){ k, lo, hi };
+    return QBERR_OK;
+}
+
+// Adds the spans that block k, of len bytes, reads from the old file, given its control columns
+// and the old position at its start. Spans are cut to the old file, as add_old reads nothing
+// outside of it; the checks are those of seek_rebuild.
+static int block_spans(struct read_spans * rs, int64_t k, const uint8_t * col[3], const uint8_t * const col_end[3],
+                       int64_t old_pos, int64_t old_size, int64_t len) {
+    int64_t new_pos = 0;
+    while (new_pos < len) {
+        uint64_t v[3];
+        if (!read_varint(&col[0], col_end[0], &v[0]) || !read_varint(&col[1], col_end[1], &v[1]) ||
+            !read_varint(&col[2], col_end[2], &v[2]) || v[0] > (uint64_t)(len - new_pos))
+            return QBERR_BADPATCH;
+        int64_t lo = max(old_pos, 0), hi = min(old_pos + (int64_t)v[0], old_size);
+        if (lo < hi && spans_add(rs, k, lo, hi) != QBERR_OK) return QBERR_NOMEM;
+        new_pos += v[0];
+        old_pos += v[0];
+
+        int64_t seek = unzigzag(v[2]);
+        if (v[1] > (uint64_t)(len - new_pos) || old_pos + seek > old_size || old_pos + seek < 0)
+            return QBERR_BADPATCH;
+        new_pos += v[1];
+        old_pos += seek;
+    }
+    return QBERR_OK;
+}
 
-    struct match_result ml = diff(old, new, old_size, new_size);
+// In-place patches are applied over the old file itself, each block written to its place as
+// soon as it is rebuilt, so a block has to come after every other block that reads the old
+// data there. The plan is a topological order of these constraints. Blocks that wait on each
+// other in a cycle are broken out of it by rebuilding one of them before anything is written,
+// holding it in the spill buffer and writing it last or, once the buffer is full, by storing
+// it as a literal that reads nothing.
+#define PLAN_PLACED 1
+#define PLAN_SPILLED 2
+#define PLAN_LITERAL 4
+
+struct plan_graph {
+    int64_t *out_start, *out;  // Blocks that each block has to be rebuilt before.
+    int64_t *in_start, *in;    // And the other way round.
+    int64_t *indeg, *queue, *seen;
+    int64_t head, tail;
+    uint8_t * state;
+};
 
-    if (ml.error != QBERR_OK) return ml.error;
+// Drops the constraints that block j puts on others, queueing those left with none.
+static void plan_release(struct plan_graph * g, int64_t j) {
+    for (int64_t e = g->out_start[j]; e < g->out_start[j + 1]; e++) {
+        int64_t w = g->out[e];
+        if (!(g->state[w] & (PLAN_PLACED | PLAN_SPILLED)) && !--g->indeg[w]) g->queue[g->tail++] = w;
+    }
+}
+
+static int seek_literal(struct seek_block * b, const uint8_t * data, int64_t len) {
+    for (int i = 0; i < 3; i++) b->cols[i].len = 0;
+    b->d = b->e = data;
+    b->dlen = 0;
+    b->elen = len;
+    int err = column_put(&b->cols[0], 0) || column_put(&b->cols[1], len) || column_put(&b->cols[2], 0);
+    return err ? QBERR_NOMEM : QBERR_OK;
+}
+
+static int plan_in_place(struct seek_block * b, int64_t nblocks, int64_t block, int64_t old_size,
+                         const uint8_t * new, int64_t new_size, int64_t spill, int64_t * plan) {
+    struct read_spans rs = { 0 };
+    struct plan_graph g = { 0 };
+    int err = QBERR_OK;
+    for (int64_t k = 0; k < nblocks && err == QBERR_OK; k++) {
+        const uint8_t *col[3], *col_end[3];
+        for (int i = 0; i < 3; i++) {
+            col[i] = b[k].cols[i].buf;
+            col_end[i] = col[i] + b[k].cols[i].len;
+        }
+        err = block_spans(&rs, k, col, col_end, b[k].old_pos, old_size, min(block, new_size - k * block));
+    }
+
+    g.out_start = calloc(nblocks + 1, sizeof(int64_t));
+    g.in_start = calloc(nblocks + 1, sizeof(int64_t));
+    g.indeg = calloc(nblocks, sizeof(int64_t));
+    g.queue = malloc(nblocks * sizeof(int64_t));
+    g.seen = calloc(nblocks, sizeof(int64_t));
+    g.state = calloc(nblocks, 1);
+    if (err == QBERR_OK && (!g.out_start || !g.in_start || !g.indeg || !g.queue || !g.seen || !g.state))
+        err = QBERR_NOMEM;
+    if (err != QBERR_OK) goto err;
+
+    // Block j is rebuilt before block w if a span that j reads overlaps the place of w. Spans
+    // come by block, so the constraints of each block are filled in in order.
+    for (int64_t i = 0; i < rs.n; i++) {
+        const struct read_span * s = &rs.s[i];
+        for (int64_t w = s->lo / block; s->lo < new_size && w <= (min(s->hi, new_size) - 1) / block; w++) {
+            if (w == s->k) continue;
+            g.out_start[s->k + 1]++;
+            g.in_start[w + 1]++;
+        }
+    }
+    for (int64_t k = 0; k < nblocks; k++) {
+        g.out_start[k + 1] += g.out_start[k];
+        g.in_start[k + 1] += g.in_start[k];
+    }
+    g.out = malloc((g.out_start[nblocks] + 1) * sizeof(int64_t));
+    g.in = malloc((g.in_start[nblocks] + 1) * sizeof(int64_t));
+    if (!g.out || !g.in) {
+        err = QBERR_NOMEM;
+        goto err;
+    }
+    for (int64_t i = 0, e = 0; i < rs.n; i++) {
+        const struct read_span * s = &rs.s[i];
+        for (int64_t w = s->lo / block; s->lo < new_size && w <= (min(s->hi, new_size) - 1) / block; w++) {
+            if (w == s->k) continue;
+            g.out[e++] = w;
+            g.in[g.in_start[w] + g.indeg[w]++] = s->k;
+        }
+    }
 
-    uint8_t *newcb = NULL, *newdb = NULL, *neweb = NULL;
+    int64_t done = 0, nspill = 0, used = 0, scan = 0, epoch = 0;
+    for (int64_t k = 0; k < nblocks; k++)
+        if (!g.indeg[k]) g.queue[g.tail++] = k;
+    while (done < nblocks) {
+        if (g.head < g.tail) {
+            int64_t j = g.queue[g.head++];
+            if (!(g.state[j] & PLAN_LITERAL)) plan_release(&g, j);
+            g.state[j] |= PLAN_PLACED;
+            done++;
+            continue;
+        }
 
-    size_t orig_cb_len, orig_db_len, orig_eb_len;
-    orig_cb_len = ml.cblen;
-    orig_db_len = ml.dblen;
-    orig_eb_len = ml.eblen;
+        // Every block left waits on another, so walking back along what they wait on runs into
+        // a cycle.
+        while (g.state[scan]) scan++;
+        int64_t j = scan;
+        epoch++;
+        while (g.seen[j] != epoch) {
+            g.seen[j] = epoch;
+            int64_t e = g.in_start[j];
+            while (g.state[g.in[e]]) e++;
+            j = g.in[e];
+        }
+        int64_t len = min(block, new_size - j * block);
+        plan_release(&g, j);
+        if (used + len <= spill) {
+            g.state[j] = PLAN_SPILLED;
+            plan[nspill++] = j | QBDIFF_PLAN_SPILL;
+            used += len;
+            done++;
+        } else {
+            g.state[j] = PLAN_LITERAL;
+            if ((err = seek_literal(&b[j], new + j * block, len)) != QBERR_OK) goto err;
+        }
+    }
+    // The queue holds the other blocks in the order they were placed in.
+    memcpy(plan + nspill, g.queue, g.tail * sizeof(int64_t));
 
-#if defined(_OPENMP)
-    {
-        uint8_t * b[3] = { ml.cb, ml.db, ml.eb };
-        size_t l[3] = { ml.cblen, ml.dblen, ml.eblen };
-        uint8_t * n[3] = { NULL, NULL, NULL };
-        size_t nl[3] = { 0, 0, 0 };
+err:
+    free(rs.s);
+    free(g.out_start);
+    free(g.out);
+    free(g.in_start);
+    free(g.in);
+    free(g.indeg);
+    free(g.queue);
+    free(g.seen);
+    free(g.state);
+    return err;
+}
 
-        int i;
-    #pragma omp parallel for
-        for (i = 0; i < 3; i++) {
-            compress(b[i], l[i], &n[i], &nl[i]);
+static int write_seekable(const uint8_t * old, const uint8_t * new, size_t old_size, size_t new_size,
+                          const uint8_t cksum[64], const struct qbdiff_options * opts, FILE * diff_file,
+                          struct qbdiff_stats * stats) {
+    bool in_place = opts->in_place > 0;
+    int64_t block = in_place && !opts->seekable ? QBDIFF_INPLACE_BLOCK : max(opts->seekable, QBDIFF_SEEK_MIN);
+    int64_t nblocks = (new_size + block - 1) / block;
+    struct column sample[3] = { { 0 } };
+    struct seek_block * b = calloc(nblocks + 1, sizeof(struct seek_block));
+    int64_t * plan = in_place ? malloc((nblocks + 1) * sizeof(int64_t)) : NULL;
+    int err = b && (plan || !in_place) ? QBERR_OK : QBERR_NOMEM;
+    if (err == QBERR_OK && (old_size < 256 || new_size < 256)) {
+        // Too small to diff, as in qbdiff_compute_ex.
+        struct match_result r = { 0 };
+        r.sample = sample;
+        err = emit(&r, old, new, 0, 0, 0, new_size, 0);
+    } else if (err == QBERR_OK) {
+        struct match_result r = diff(old, new, old_size, new_size, opts, 0, 0, NULL, 0, false, sample, stats);
+        err = r.error;
+        result_free(&r);
+    }
+    double t1 = now();
+    if (err == QBERR_OK && nblocks) err = cut_blocks(sample, b, block);
+    free(sample[0].buf);
+    if (err == QBERR_OK && in_place)
+        err = plan_in_place(b, nblocks, block, old_size, new, new_size, opts->in_place, plan);
+
+    if (err == QBERR_OK) {
+        struct seek_args args = { b,
+                                  new,
+                                  new_size,
+                                  block,
+                                  stream_codec(opts, new, new_size, QBDIFF_STREAM_DIFF),
+                                  stream_codec(opts, new, new_size, QBDIFF_STREAM_EXTRA),
+                                  QBERR_OK };
+        pool_for(&opts->executor, opts->threads, nblocks, seek_compress, &args);
+        err = args.err;
+    }
+    free(sample[1].buf);
+    free(sample[2].buf);
+    double t2 = now();
+    stats->compress_time = t2 - t1;
+
+    size_t index_len = QBDIFF_HEADER_SEEK + nblocks * (QBDIFF_SEEK_ENTRY + (in_place ? 8 : 0));
+    uint8_t * index = err == QBERR_OK ? malloc(index_len) : NULL;
+    if (err == QBERR_OK && !index) err = QBERR_NOMEM;
+    if (err == QBERR_OK) {
+        memcpy(index, in_place ? QBDIFF_MAGIC_INPLACE : QBDIFF_MAGIC_SEEK, 5);
+        memcpy(index + 5, cksum, 64);
+        wi64(old_size, index + 69);
+        wi64(new_size, index + 77);
+        wi64(block, index + 85);
+        int64_t off = index_len;
+        for (int64_t k = 0; k < nblocks; k++) {
+            uint8_t * entry = index + QBDIFF_HEADER_SEEK + k * QBDIFF_SEEK_ENTRY;
+            wi64(off, entry);
+            wi64(b[k].old_pos, entry + 8);
+            for (int i = 0; i < 3; i++) {
+                entry[16 + 17 * i] = b[k].codec[i];
+                wi64(b[k].outlen[i], entry + 17 + 17 * i);
+                wi64(b[k].raw[i], entry + 25 + 17 * i);
+                off += b[k].outlen[i];
+            }
+            memcpy(entry + 67, b[k].cksum, 64);
+            if (in_place) wi64(plan[k], index + QBDIFF_HEADER_SEEK + nblocks * QBDIFF_SEEK_ENTRY + 8 * k);
+        }
+        if (fwrite(index, 1, index_len, diff_file) != index_len) err = QBERR_IOERR;
+        for (int64_t k = 0; k < nblocks && err == QBERR_OK; k++)
+            for (int i = 0; i < 3; i++)
+                if (fwrite(b[k].out[i], 1, b[k].outlen[i], diff_file) != b[k].outlen[i]) err = QBERR_IOERR;
+    }
+    stats->write_time = now() - t2;
+
+    free(index);
+    free(plan);
+    for (int64_t k = 0; b && k < nblocks; k++) {
+        for (int i = 0; i < 3; i++) {
+            free(b[k].cols[i].buf);
+            free(b[k].out[i]);
         }
+    }
+    free(b);
+    return err;
+}
+
+LIBQDIFF_PUBLIC_API int qbdiff_compute_ex(const uint8_t * RESTRICT old, const uint8_t * RESTRICT new,
+                                          size_t old_size, size_t new_size, FILE * diff_file,
+                                          const struct qbdiff_options * opts) {
+    int err_code = 0;
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now(), t1;
 
-        newcb = n[0];
-        newdb = n[1];
-        neweb = n[2];
-        ml.cblen = nl[0];
-        ml.dblen = nl[1];
-        ml.eblen = nl[2];
+    uint8_t cksum[64];
+    blake2b_cksum(new, new_size, cksum);
+    err_code = write_fingerprint(old, old_size, opts, diff_file);
+    stats->checksum_time = now() - t0;
+    if (err_code != QBERR_OK) return err_code;
+
+    if (opts && (opts->seekable || opts->in_place > 0)) {
+        err_code = write_seekable(old, new, old_size, new_size, cksum, opts, diff_file, stats);
+        stats->total_time = now() - t0;
+        return err_code;
     }
-#else
-    err_code = compress(ml.cb, ml.cblen, &newcb, &ml.cblen);
-    if (err_code != QBERR_OK) goto err;
 
-    err_code = compress(ml.db, ml.dblen, &newdb, &ml.dblen);
-    if (err_code != QBERR_OK) goto err;
+    uint8_t * packed = NULL;
+    size_t packed_len;
+    int codec = full_codec(opts, new, new_size);
+    if (old_size < 256 || new_size < 256) {
+        // Handle the case where the old file is empty,
+        // or both files are very small.
+        t1 = now();
+        err_code = compress(new, new_size, codec, &packed, &packed_len);
+        stats->compress_time = now() - t1;
+        if (err_code == QBERR_OK) err_code = write_packed(packed, packed_len, new_size, cksum, codec, diff_file, stats);
+        free(packed);
+        stats->total_time = now() - t0;
+        return err_code;
+    }
 
-    err_code = compress(ml.eb, ml.eblen, &neweb, &ml.eblen);
-    if (err_code != QBERR_OK) goto err;
-#endif
+    struct match_result ml = diff(old, new, old_size, new_size, opts,
+                                  stream_codec(opts, new, new_size, QBDIFF_STREAM_DIFF),
+                                  stream_codec(opts, new, new_size, QBDIFF_STREAM_EXTRA),
+                                  codec == QBDIFF_CODEC_STORE ? NULL : new, codec, false, NULL, stats);
+    if (ml.error != QBERR_OK) return ml.error;
+
+    // Executables are diffed again with their branches normalized, when asked to.
+    uint8_t * nb = NULL;
+    size_t nblen = 0, nbraw = 0;
+    int nb_codec = QBDIFF_CODEC_LZMA2;
+    int arch = opts && opts->normalize > 0 ? norm_arch(old, old_size, new, new_size) : NORM_NONE;
+    if (arch != NORM_NONE &&
+        (err_code = normalized_diff(old, new, old_size, new_size, opts, arch, &ml, &nb, &nblen, &nbraw, &nb_codec,
+                                    stats)) != QBERR_OK) {
+        result_free(&ml);
+        return err_code;
+    }
+    t1 = now();
 
 #define sfwrite(ptr, size, nmemb, stream)            \
     if (fwrite(ptr, size, nmemb, stream) != nmemb) { \
@@ -687,190 +2262,1420 @@ LIBQDIFF_PUBLIC_API int qbdiff_compute(const uint8_t * RESTRICT old, const uint8
         goto err;                                    \
     }
 
-    // TODO: Account for compression.
-    if (ml.cblen + ml.dblen + ml.eblen > 0.9 * new_size) {
-        err_code = QBERR_IOERR;
-        if (fwrite(QBDIFF_MAGIC_FULL, 1, 5, diff_file) != 5) goto err;
-        if (fwrite(cksum, 1, 64, diff_file) != 64) goto err;
+    // The smaller of the diff and a full copy wins. The copy has either raced the diff, or it
+    // is compressed now when the diff came out large enough for it to have a chance.
+    size_t delta_len = (nb ? QBDIFF_HEADER_NORM : QBDIFF_HEADER) + ml.cb.outlen + ml.db.outlen + ml.eb.outlen + nblen;
+    if (ml.full.finished && !ml.full.error && !ml.cancel_full) {
+        packed = ml.full.out;
+        packed_len = ml.full.outlen;
+    } else if (codec == QBDIFF_CODEC_STORE) {
+        packed = (uint8_t *)new;
+        packed_len = new_size;
+    } else if (!ml.racing && delta_len > new_size / 4) {
+        double t = now();
+        if ((err_code = compress(new, new_size, codec, &packed, &packed_len)) != QBERR_OK) goto err;
+        stats->compress_time += now() - t;
+    }
+    if (ml.cancel_delta || (packed && QBDIFF_HEADER_FULL + packed_len < delta_len)) {
+        err_code = write_packed(packed, packed_len, new_size, cksum, codec, diff_file, stats);
+    } else {
+        uint8_t header[QBDIFF_HEADER_NORM];
+        size_t header_len = nb ? QBDIFF_HEADER_NORM : QBDIFF_HEADER;
+        memcpy(header, nb ? QBDIFF_MAGIC_NORM : QBDIFF_MAGIC_BIG, 5);
+        memcpy(header + 5, cksum, 64);
+        wi64(old_size, header + 69);
+        wi64(new_size, header + 77);
+        const struct stream * streams[3] = { &ml.cb, &ml.db, &ml.eb };
+        for (int i = 0; i < 3; i++) {
+            header[85 + 17 * i] = streams[i]->codec;
+            wi64(streams[i]->outlen, header + 86 + 17 * i);
+            wi64(streams[i]->raw, header + 94 + 17 * i);
+        }
+        header[136] = nb_codec;
+        wi64(nblen, header + 137);
+        wi64(nbraw, header + 145);
+        sfwrite(header, 1, header_len, diff_file);
+        sfwrite(ml.cb.out, 1, ml.cb.outlen, diff_file);
+        sfwrite(ml.db.out, 1, ml.db.outlen, diff_file);
+        sfwrite(ml.eb.out, 1, ml.eb.outlen, diff_file);
+        sfwrite(nb, 1, nblen, diff_file);
+        stats->write_time = now() - t1;
+    }
+
+err:
+    if (packed != ml.full.out && packed != new) free(packed);
+    result_free(&ml);
+    free(nb);
+    stats->total_time = now() - t0;
+    return err_code;
+}
+
+// Patch size estimation. The middle of the new file is cut into strata, and a window at a
+// random offset in each is matched on its own, with the old position at its start guessed
+// from the relative position of the window. Each stream of a window is priced by lz_cost()
+// rather than compressed, and the windows are scaled up to the whole file with a ratio
+// estimator, whose standard error gives the confidence interval. Small enough inputs are
+// matched in full, window by window. Matching always uses the hash engine, as building the
+// suffix array alone takes about half of a diff; the two engines produce patches of about
+// the same size.
+#define QBDIFF_ESTIMATE_WINDOW (64 << 10)
+#define QBDIFF_ESTIMATE_MIN_WINDOWS 32
+#define QBDIFF_ESTIMATE_RATE 32  // Past the minimum, one window in 32 is matched.
+#define QBDIFF_XZ_OVERHEAD 64    // Headers, index and footer of an .xz stream.
+
+// Order-0 entropy of the bytes, in bytes, with the Miller-Madow correction for the bias of
+// short samples.
+static double entropy(const uint64_t hist[256]) {
+    uint64_t total = 0;
+    double bits = 0;
+    int used = 0;
+    for (int i = 0; i < 256; i++) total += hist[i];
+    for (int i = 0; i < 256; i++) {
+        if (!hist[i]) continue;
+        bits += hist[i] * log2((double)total / hist[i]);
+        used++;
+    }
+    return used ? (bits + (used - 1) / (2 * log(2))) / 8 : 0;
+}
+
+static inline uint32_t lz_hash(const uint8_t * p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> 18;
+}
+
+// Compressed size of the data as estimated from a greedy LZ77 parse, in bytes. Literals cost
+// their entropy in the contexts of the top three bits of the previous byte, as in LZMA with
+// its default lc=3, matches a rough price of their distance and length, and repeats of the
+// last distance less.
+static double lz_cost(const uint8_t * data, size_t len) {
+    uint32_t table[1 << 14] = { 0 };
+    uint64_t hist[8][256] = { { 0 } };
+    double bits = 0;
+    size_t rep = 0;
+    for (size_t i = 0; i < len;) {
+        size_t l = 0, r = 0, cand = 0;
+        if (i + 4 <= len) {
+            cand = table[lz_hash(data + i)];
+            while (cand && i + l < len && data[cand - 1 + l] == data[i + l]) l++;
+            while (rep && i + r < len && data[i - rep + r] == data[i + r]) r++;
+        }
+        if (r >= 2 && r + 2 >= l) {
+            bits += 4 + log2(r);
+            l = r;
+        } else if (l >= 4) {
+            rep = i + 1 - cand;
+            bits += 6 + log2(rep) + log2(l);
+        } else {
+            hist[i ? data[i - 1] >> 5 : 0][data[i]]++;
+            l = 1;
+        }
+        for (size_t end = i + l; i < end; i++)
+            if (i + 4 <= len) table[lz_hash(data + i)] = i + 1;
+    }
+    for (int c = 0; c < 8; c++) bits += 8 * entropy(hist[c]);
+    return bits / 8;
+}
+
+struct estimate_window {
+    int64_t start, len;
+    double bytes[5];  // Price of the control, diff and extra streams, of all three, and of the new bytes.
+};
+
+// Scales the sum of a statistic of the windows up to `total' bytes, with its standard error.
+static double estimate_total(const struct estimate_window * w, int64_t n, int stat, int64_t total, double * se) {
+    double x = 0, y = 0, ss = 0;
+    for (int64_t i = 0; i < n; i++) {
+        x += w[i].len;
+        y += w[i].bytes[stat];
+    }
+    double ratio = y / x, scale = total / x;
+    for (int64_t i = 0; i < n; i++) {
+        double d = w[i].bytes[stat] - ratio * w[i].len;
+        ss += d * d;
+    }
+    if (se) *se = n > 1 && x < total ? scale * sqrt((1 - x / total) * n / (n - 1) * ss) : 0;
+    return y * scale;
+}
+
+struct estimate_args {
+    struct estimate_window * w;
+    const struct match_index * idx;
+    const uint8_t *old, *new;
+    int64_t prefix, span, old_end;
+    int err;
+};
+
+// Matches a window and prices its streams.
+static void estimate_one(void * arg, int64_t i) {
+    struct estimate_args * a = arg;
+    struct estimate_window * w = &a->w[i];
+    struct column sample[3] = { { 0 } };
+    struct match_result r = { 0 };
+    r.sample = sample;
+    int64_t prefix = a->prefix, span = a->span, old_end = a->old_end;
+    int64_t start = w->start, end = start + w->len;
+    int64_t old_start = prefix + (int64_t)((double)(start - prefix) / span * (old_end - prefix));
+    int64_t old_stop = prefix + (int64_t)((double)(end - prefix) / span * (old_end - prefix));
+    int ret = a->idx->size ? match(a->idx, a->new, start, end, old_start, old_stop, &r)
+                           : emit(&r, a->old, a->new, old_start, start, 0, end - start, old_stop - old_start);
+    if (ret != QBERR_OK) pool_store(&a->err, ret);
+    for (int j = 0; j < 3; j++) {
+        w->bytes[3] += w->bytes[j] = lz_cost(sample[j].buf, sample[j].len);
+        free(sample[j].buf);
+    }
+    w->bytes[4] = lz_cost(a->new + start, end - start);
+}
 
-        uint8_t * compressed;
-        size_t compressed_len;
-        err_code = compress(new, new_size, &compressed, &compressed_len);
-        if (err_code != QBERR_OK) goto err;
+LIBQDIFF_PUBLIC_API int qbdiff_estimate(const uint8_t * RESTRICT old, const uint8_t * RESTRICT new, size_t old_size,
+                                        size_t new_size, struct qbdiff_estimate * est,
+                                        const struct qbdiff_options * opts) {
+    int threads = opts ? opts->threads : 0, err = QBERR_OK;
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now();
+    memset(est, 0, sizeof(*est));
+
+    // The same trimming as in diff().
+    int64_t prefix = matchlen(old, old_size, new, new_size);
+    int64_t suffix = matchlen_back(old + old_size, new + new_size, min(old_size, new_size) - prefix);
+    int64_t old_end = old_size - suffix, new_end = new_size - suffix, span = new_end - prefix;
+
+    int64_t n = (span + QBDIFF_ESTIMATE_WINDOW - 1) / QBDIFF_ESTIMATE_WINDOW, stride = QBDIFF_ESTIMATE_WINDOW;
+    if (n > QBDIFF_ESTIMATE_MIN_WINDOWS) {
+        n = max(QBDIFF_ESTIMATE_MIN_WINDOWS, span / (QBDIFF_ESTIMATE_WINDOW * QBDIFF_ESTIMATE_RATE));
+        stride = span / n;
+    }
+    struct estimate_window * w = calloc(n + 1, sizeof(struct estimate_window));
+    if (!w) return QBERR_NOMEM;
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (int64_t i = 0; i < n; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        z ^= z >> 31;
+        w[i].start = prefix + i * stride;
+        w[i].len = min(QBDIFF_ESTIMATE_WINDOW, new_end - w[i].start);
+        if (stride > QBDIFF_ESTIMATE_WINDOW) w[i].start += z % (stride - QBDIFF_ESTIMATE_WINDOW + 1);
+        est->sampled += (double)w[i].len / span;
+    }
 
-        err_code = QBERR_IOERR;
-        uint8_t buf[8];
-        wi64(new_size, buf);
-        if (fwrite(buf, 1, 8, diff_file) != 8) goto err;
-        if (fwrite(compressed, 1, compressed_len, diff_file) != compressed_len) goto err;
-        free(compressed);
+    struct match_index idx = { 0 };
+    idx.old = idx.data = old;
+    idx.old_size = idx.size = old_size;
+    if (!n || old_end == prefix)
+        idx.size = 0;
+    else
+        err = hash_build(&idx, HASH_INTERVAL);
+    est->sampled = min(est->sampled, 1);
+    if (err != QBERR_OK) goto err;
+    double t1 = now();
+    stats->index_time = t1 - t0;
+
+    struct estimate_args args = { w, &idx, old, new, prefix, span, old_end, QBERR_OK };
+    pool_for(opts ? &opts->executor : NULL, threads, n, estimate_one, &args);
+    if ((err = args.err) != QBERR_OK) goto err;
+    stats->match_time = now() - t1;
+
+    double delta_se = 0, full_se = 0, full;
+    if (n) {
+        est->cb = estimate_total(w, n, 0, span, NULL);
+        est->db = estimate_total(w, n, 1, span, NULL);
+        est->eb = estimate_total(w, n, 2, span, NULL);
+        estimate_total(w, n, 3, span, &delta_se);
+        full = estimate_total(w, n, 4, new_size, &full_se);
     } else {
-        sfwrite(QBDIFF_MAGIC_BIG, 1, 5, diff_file);
-        sfwrite(cksum, 1, 64, diff_file);
-        uint8_t buf[8];
-        wi64(old_size, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(new_size, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(ml.cblen, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(ml.dblen, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(ml.eblen, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(orig_cb_len, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(orig_db_len, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        wi64(orig_eb_len, buf);
-        sfwrite(buf, 1, 8, diff_file);
-        sfwrite(newcb, 1, ml.cblen, diff_file);
-        sfwrite(newdb, 1, ml.dblen, diff_file);
-        sfwrite(neweb, 1, ml.eblen, diff_file);
-    }
-
-    free(newcb);
-    free(newdb);
-    free(neweb);
-    free(ml.cb);
-    free(ml.db);
-    free(ml.eb);
-    return QBERR_OK;
+        // Identical files, or the new file is a prefix of the old one.
+        uint64_t hist[256] = { 0 };
+        histogram(hist, new, new_size);
+        full = entropy(hist);
+    }
+    est->cb += QBDIFF_XZ_OVERHEAD;
+    est->db += QBDIFF_XZ_OVERHEAD;
+    est->eb += QBDIFF_XZ_OVERHEAD;
+    est->full = fingerprint_len(opts) + QBDIFF_HEADER_FULL + QBDIFF_XZ_OVERHEAD + (int64_t)full;
+
+    // As in qbdiff_compute_ex, the smaller of the two is written, and small files are always
+    // written in full.
+    int64_t delta = fingerprint_len(opts) + QBDIFF_HEADER + est->cb + est->db + est->eb;
+    if (old_size < 256 || new_size < 256) delta = INT64_MAX;
+    double margin = 1.96 * (delta < est->full ? delta_se : full_se);
+    est->size = min(delta, est->full);
+    est->low = max(0, est->size - (int64_t)margin);
+    est->high = est->size + (int64_t)margin;
 
 err:
-    free(newcb);
-    free(newdb);
-    free(neweb);
-    free(ml.cb);
-    free(ml.db);
-    free(ml.eb);
-    return err_code;
+    index_free(&idx);
+    free(w);
+    stats->total_time = now() - t0;
+    return err;
+}
+
+// Adds old[old_pos, old_pos + len) to dst, treating bytes outside of the old file as zero.
+static void add_old(uint8_t * RESTRICT dst, const uint8_t * RESTRICT old, int64_t old_pos, int64_t old_size,
+                    int64_t len) {
+    int64_t lo = max(0, -old_pos), hi = min(len, old_size - old_pos);
+    for (int64_t i = lo; i < hi; i++) dst[i] += old[old_pos + i];
+}
+
+// A seekable patch, of which the header and the index are at hand, and the bytes from data_off
+// to data_end, at data. The plan of an in-place patch follows the index.
+struct seek_patch {
+    const uint8_t *old, *index, *data;
+    int64_t old_size, new_size, block, nblocks, data_off, data_end;
+    bool in_place;
+};
+
+static bool seekable_magic(const uint8_t * header) {
+    return !memcmp(header, QBDIFF_MAGIC_SEEK, 5) || !memcmp(header, QBDIFF_MAGIC_INPLACE, 5);
+}
+
+// Length of an index entry, with the plan.
+static int64_t seek_entry(const struct seek_patch * sp) { return QBDIFF_SEEK_ENTRY + (sp->in_place ? 8 : 0); }
+
+// Reads the header of a seekable patch.
+static int seek_header(struct seek_patch * sp, const uint8_t * old, size_t old_len, const uint8_t * header) {
+    if (!seekable_magic(header)) return QBERR_BADPATCH;
+    sp->in_place = !memcmp(header, QBDIFF_MAGIC_INPLACE, 5);
+    sp->old = old;
+    sp->old_size = ri64(header + 69);
+    sp->new_size = ri64(header + 77);
+    sp->block = ri64(header + 85);
+    if (sp->old_size != old_len || sp->new_size < 0 || sp->block < QBDIFF_SEEK_MIN) return QBERR_BADPATCH;
+    sp->nblocks = sp->new_size / sp->block + (sp->new_size % sp->block != 0);
+    return QBERR_OK;
+}
+
+// Offset of the end of the streams of blocks [0, k).
+static int64_t seek_end(const struct seek_patch * sp, int64_t k) {
+    if (!k) return QBDIFF_HEADER_SEEK + sp->nblocks * seek_entry(sp);
+    const uint8_t * entry = sp->index + (k - 1) * QBDIFF_SEEK_ENTRY;
+    int64_t end = ri64(entry);
+    for (int i = 0; i < 3; i++) end += ri64(entry + 17 + 17 * i);
+    return end;
+}
+
+static int seek_open(struct seek_patch * sp, const uint8_t * old, const uint8_t * patch, size_t old_len,
+                     size_t patch_len) {
+    if (patch_len < QBDIFF_HEADER_SEEK) return QBERR_TRUNCPATCH;
+    int err = seek_header(sp, old, old_len, patch);
+    if (err != QBERR_OK) return err;
+    if (sp->nblocks > (int64_t)(patch_len - QBDIFF_HEADER_SEEK) / seek_entry(sp)) return QBERR_TRUNCPATCH;
+    sp->index = patch + QBDIFF_HEADER_SEEK;
+    sp->data_off = seek_end(sp, 0);
+    sp->data = patch + sp->data_off;
+    sp->data_end = patch_len;
+    // The streams of the last block end the patch.
+    return seek_end(sp, sp->nblocks) == sp->data_end ? QBERR_OK : QBERR_TRUNCPATCH;
+}
+
+// Splits the control stream of a block into its columns.
+static bool ctrl_columns(const uint8_t * ctrl, int64_t raw, const uint8_t * col[3], const uint8_t * col_end[3]) {
+    const uint8_t *p = ctrl, *end = ctrl + raw;
+    uint64_t add_len, extra_len;
+    if (!read_varint(&p, end, &add_len) || !read_varint(&p, end, &extra_len) || add_len > end - p ||
+        extra_len > end - p - add_len)
+        return false;
+    col[0] = p;
+    col[1] = col_end[0] = p + add_len;
+    col[2] = col_end[1] = p + add_len + extra_len;
+    col_end[2] = end;
+    return true;
+}
+
+// Rebuilds len bytes of a block from its streams, starting at old_pos in the old file.
+static int seek_rebuild(uint8_t * const s[3], const int64_t raw[3], const uint8_t * old, int64_t old_size,
+                        int64_t old_pos, uint8_t * out, int64_t len) {
+    const uint8_t *col[3], *col_end[3];
+    if (!ctrl_columns(s[0], raw[0], col, col_end)) return QBERR_BADPATCH;
+
+    int64_t new_pos = 0, d = 0, e = 0;
+    while (new_pos < len) {
+        uint64_t v[3];
+        if (!read_varint(&col[0], col_end[0], &v[0]) || !read_varint(&col[1], col_end[1], &v[1]) ||
+            !read_varint(&col[2], col_end[2], &v[2]) || v[0] > (uint64_t)(len - new_pos) ||
+            v[0] > (uint64_t)(raw[1] - d))
+            return QBERR_BADPATCH;
+        memcpy(out + new_pos, s[1] + d, v[0]);
+        add_old(out + new_pos, old, old_pos, old_size, v[0]);
+        new_pos += v[0];
+        old_pos += v[0];
+        d += v[0];
+
+        int64_t seek = unzigzag(v[2]);
+        if (v[1] > (uint64_t)(len - new_pos) || v[1] > (uint64_t)(raw[2] - e) || old_pos + seek > old_size ||
+            old_pos + seek < 0)
+            return QBERR_BADPATCH;
+        memcpy(out + new_pos, s[2] + e, v[1]);
+        new_pos += v[1];
+        e += v[1];
+        old_pos += seek;
+    }
+    return QBERR_OK;
+}
+
+// Checks block k of the new file against its BLAKE2b.
+static int seek_check(const struct seek_patch * sp, int64_t k, const uint8_t * out) {
+    uint8_t cksum[64];
+    blake2b_cksum(out, min(sp->block, sp->new_size - k * sp->block), cksum);
+    return memcmp(sp->index + k * QBDIFF_SEEK_ENTRY + 67, cksum, 64) ? QBERR_BADCKSUM : QBERR_OK;
+}
+
+// Rebuilds block k of a seekable patch into out, and checks it against its BLAKE2b.
+static int seek_apply(const struct seek_patch * sp, int64_t k, uint8_t * out) {
+    const uint8_t * entry = sp->index + k * QBDIFF_SEEK_ENTRY;
+    int64_t len = min(sp->block, sp->new_size - k * sp->block);
+    int64_t off = ri64(entry), old_pos = ri64(entry + 8), raw[3];
+    uint8_t * s[3] = { NULL, NULL, NULL };
+    int err = QBERR_OK;
+    if (old_pos < 0 || old_pos > sp->old_size) return QBERR_BADPATCH;
+    if (off < sp->data_off || off > sp->data_end) return QBERR_TRUNCPATCH;
+    for (int i = 0; i < 3 && err == QBERR_OK; i++) {
+        const uint8_t * d = entry + 16 + 17 * i;
+        int64_t packed = ri64(d + 1);
+        raw[i] = ri64(d + 9);
+        if (!codec_valid(d[0]) || (d[0] & 15) == QBDIFF_CODEC_LZMA2_DICT || raw[i] < 0)
+            err = QBERR_BADPATCH;
+        else if (packed < 0 || packed > sp->data_end - off)
+            err = QBERR_TRUNCPATCH;
+        else
+            err = decompress_codec(sp->data + (off - sp->data_off), packed, d[0], NULL, 0, &s[i], raw[i]);
+        off += packed;
+    }
+    if (err == QBERR_OK) err = seek_rebuild(s, raw, sp->old, sp->old_size, old_pos, out, len);
+    if (err == QBERR_OK) err = seek_check(sp, k, out);
+    for (int i = 0; i < 3; i++) free(s[i]);
+    return err;
+}
+
+struct apply_args {
+    const struct seek_patch * sp;
+    int64_t first;  // Block that starts at out.
+    uint8_t * out;
+    int err;
+};
+
+static void apply_task(void * arg, int64_t i) {
+    struct apply_args * a = arg;
+    int err = seek_apply(a->sp, a->first + i, a->out + i * a->sp->block);
+    if (err != QBERR_OK) pool_store(&a->err, err);
+}
+
+// Blocks are independent, so they are decoded and rebuilt in parallel, each straight into its
+// place in the new file.
+static int apply_blocks(const struct seek_patch * sp, int64_t first, int64_t count, uint8_t * out,
+                        const struct qbdiff_options * opts) {
+    struct apply_args args = { sp, first, out, QBERR_OK };
+    pool_for(opts ? &opts->executor : NULL, opts ? opts->threads : 0, count, apply_task, &args);
+    return args.err;
+}
+
+static int patch_seekable(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len,
+                          FILE * new_file, const struct qbdiff_options * opts, struct qbdiff_stats * stats) {
+    struct seek_patch sp;
+    double t0 = now(), t1;
+    int err = seek_open(&sp, old, patch, old_len, patch_len);
+    if (err != QBERR_OK) return err;
+    uint8_t * new_data = malloc(sp.new_size + 1);
+    if (!new_data) return QBERR_NOMEM;
+    err = apply_blocks(&sp, 0, sp.nblocks, new_data, opts);
+    t1 = now();
+    stats->reconstruct_time = t1 - t0;
+
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_cksum(new_data, sp.new_size, cksum);
+        if (memcmp(patch + 5, cksum, 64)) err = QBERR_BADCKSUM;
+        stats->checksum_time = now() - t1;
+    }
+    t1 = now();
+    if (err == QBERR_OK && fwrite(new_data, 1, sp.new_size, new_file) != sp.new_size) err = QBERR_IOERR;
+    stats->write_time = now() - t1;
+    stats->total_time = now() - t0;
+    free(new_data);
+    return err;
+}
+
+LIBQDIFF_PUBLIC_API int qbdiff_patch_range(const uint8_t * RESTRICT old, const uint8_t * RESTRICT patch,
+                                           size_t old_len, size_t patch_len, int64_t offset, int64_t len,
+                                           uint8_t * out, const struct qbdiff_options * opts) {
+    struct seek_patch sp;
+    size_t skip;
+    int err = check_old(old, old_len, patch, patch_len, &skip);
+    if (err == QBERR_OK) err = seek_open(&sp, old, patch + skip, old_len, patch_len - skip);
+    if (err != QBERR_OK) return err;
+    if (offset < 0 || len < 0 || offset > sp.new_size - len) return QBERR_BADPATCH;
+    if (!len) return QBERR_OK;
+
+    // Blocks that the range covers in full are rebuilt in place, and the ones at its ends on
+    // the side.
+    int64_t end = offset + len, first = (offset + sp.block - 1) / sp.block;
+    int64_t last = end == sp.new_size ? sp.nblocks : end / sp.block;
+    if (first < last) err = apply_blocks(&sp, first, last - first, out + (first * sp.block - offset), opts);
+    int64_t edges[2] = { offset / sp.block, (end - 1) / sp.block };
+    uint8_t * tmp = NULL;
+    for (int i = 0; i < 2 && err == QBERR_OK; i++) {
+        int64_t k = edges[i], start = max(offset, k * sp.block), stop = min(end, (k + 1) * sp.block);
+        if ((k >= first && k < last) || (i && k == edges[0])) continue;
+        if (!tmp && !(tmp = malloc(sp.block))) return QBERR_NOMEM;
+        if ((err = seek_apply(&sp, k, tmp)) == QBERR_OK)
+            memcpy(out + (start - offset), tmp + (start - k * sp.block), stop - start);
+    }
+    free(tmp);
+    return err;
 }
 
 LIBQDIFF_PUBLIC_API int qbdiff_patch(const uint8_t * RESTRICT old, const uint8_t * RESTRICT patch, size_t old_len,
                                      size_t patch_len, FILE * new_file) {
-    // Check magic
+    return qbdiff_patch_ex(old, patch, old_len, patch_len, new_file, NULL);
+}
+
+// The streams of a QBDF, QBDB or QBDN patch: a copy of the new file, or the control, diff,
+// extra and, if normalized, map streams.
+struct patch_streams {
+    bool v1, full, normalized;
+    int n;
+    int64_t old_size, new_size;
+    int codec[4];
+    int64_t off[4], len[4], raw[4];
+};
+
+static int patch_streams(const uint8_t * patch, size_t old_len, size_t patch_len, struct patch_streams * ps) {
+    memset(ps, 0, sizeof(*ps));
+    ps->full = !memcmp(patch, QBDIFF_MAGIC_FULL, 5) || !memcmp(patch, QBDIFF_MAGIC_FULL_V1, 5);
+    ps->v1 = !memcmp(patch, QBDIFF_MAGIC_FULL_V1, 5) || !memcmp(patch, QBDIFF_MAGIC_BIG_V1, 5);
+    ps->normalized = !memcmp(patch, QBDIFF_MAGIC_NORM, 5);
+    if (ps->full) {
+        int64_t header = ps->v1 ? QBDIFF_HEADER_FULL_V1 : QBDIFF_HEADER_FULL;
+        if (patch_len < header) return QBERR_TRUNCPATCH;
+        ps->n = 1;
+        ps->codec[0] = ps->v1 ? QBDIFF_CODEC_LZMA2 : patch[69];
+        ps->off[0] = header;
+        ps->len[0] = patch_len - header;
+        ps->new_size = ps->raw[0] = ri64(patch + header - 8);
+        if (!codec_valid(ps->codec[0]) || (ps->codec[0] & 15) == QBDIFF_CODEC_LZMA2_DICT || ps->raw[0] < 0)
+            return QBERR_BADPATCH;
+        return QBERR_OK;
+    }
+    if (!ps->v1 && !ps->normalized && memcmp(patch, QBDIFF_MAGIC_BIG, 5)) return QBERR_BADPATCH;
+
+    // QBDB1 patches have no codec bytes, and plain LZMA2 streams.
+    int64_t off;
+    ps->n = ps->normalized ? 4 : 3;
+    if (ps->v1) {
+        if (patch_len < QBDIFF_HEADER_V1) return QBERR_TRUNCPATCH;
+        for (int i = 0; i < 3; i++) {
+            ps->len[i] = ri64(patch + 69 + 8 * (2 + i));
+            ps->raw[i] = ri64(patch + 69 + 8 * (5 + i));
+        }
+        off = QBDIFF_HEADER_V1;
+    } else {
+        off = ps->normalized ? QBDIFF_HEADER_NORM : QBDIFF_HEADER;
+        if (patch_len < off) return QBERR_TRUNCPATCH;
+        for (int i = 0; i < ps->n; i++) {
+            ps->codec[i] = patch[85 + 17 * i];
+            if (!codec_valid(ps->codec[i])) return QBERR_BADPATCH;
+            ps->len[i] = ri64(patch + 86 + 17 * i);
+            ps->raw[i] = ri64(patch + 94 + 17 * i);
+        }
+    }
+    ps->old_size = ri64(patch + 69);
+    ps->new_size = ri64(patch + 69 + 8 * 1);
+    if (ps->old_size != old_len) return QBERR_BADPATCH;
+    if (ps->new_size < 0 || ps->old_size < 0) return QBERR_TRUNCPATCH;
+    for (int i = 0; i < ps->n; i++) {
+        if (ps->len[i] < 0 || ps->raw[i] < 0) return QBERR_TRUNCPATCH;
+        ps->off[i] = off;
+        off += ps->len[i];
+    }
+    return off == patch_len ? QBERR_OK : QBERR_TRUNCPATCH;
+}
+
+LIBQDIFF_PUBLIC_API int qbdiff_patch_ex(const uint8_t * RESTRICT old, const uint8_t * RESTRICT patch, size_t old_len,
+                                        size_t patch_len, FILE * new_file, const struct qbdiff_options * opts) {
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now(), t1;
+
+    // Check the old file, then the magic
+    size_t skip;
+    int errn = check_old(old, old_len, patch, patch_len, &skip);
+    if (errn != QBERR_OK) return errn;
+    patch += skip;
+    patch_len -= skip;
     if (patch_len < 70) return QBERR_TRUNCPATCH;
-    if (!memcmp(patch, QBDIFF_MAGIC_FULL, 5)) {
+    if (seekable_magic(patch))
+        return patch_seekable(old, patch, old_len, patch_len, new_file, opts, stats);
+    struct patch_streams ps;
+    if ((errn = patch_streams(patch, old_len, patch_len, &ps)) != QBERR_OK) return errn;
+    if (ps.full) {
         // We can essentially relay diff_file to new_file.
         uint8_t new_cksum[64];
-        int64_t uncompressed_size = ri64(patch + 69);
+        int64_t uncompressed_size = ps.raw[0];
         uint8_t * uncompressed;
-        int result = decompress(patch + 77, patch_len - 77, &uncompressed, uncompressed_size);
+        int result = decompress_codec(patch + ps.off[0], ps.len[0], ps.codec[0], old, old_len, &uncompressed,
+                                      uncompressed_size);
         if (result != QBERR_OK) return result;
+        t1 = now();
+        stats->decompress_time = t1 - t0;
         blake2b_cksum(uncompressed, uncompressed_size, new_cksum);
-        if (memcmp(patch + 5, new_cksum, 64)) return QBERR_BADCKSUM;
+        stats->checksum_time = now() - t1;
+        if (memcmp(patch + 5, new_cksum, 64)) {
+            free(uncompressed);
+            return QBERR_BADCKSUM;
+        }
+        t1 = now();
         if (fwrite(uncompressed, 1, uncompressed_size, new_file) != uncompressed_size) {
             free(uncompressed);
             return QBERR_IOERR;
         }
         free(uncompressed);
+        stats->write_time = now() - t1;
+        stats->total_time = now() - t0;
         return QBERR_OK;
-    } else if (!memcmp(patch, QBDIFF_MAGIC_BIG, 5)) {
-        if (patch_len < 133) return QBERR_TRUNCPATCH;
-        int64_t cblen, dblen, eblen, orig_cblen, orig_dblen, orig_eblen, new_size, old_size, i, ctrl[3],
-            errn = QBERR_OK;
-        old_size = ri64(patch + 69);
-        new_size = ri64(patch + 69 + 8 * 1);
-        cblen = ri64(patch + 69 + 8 * 2);
-        dblen = ri64(patch + 69 + 8 * 3);
-        eblen = ri64(patch + 69 + 8 * 4);
-        orig_cblen = ri64(patch + 69 + 8 * 5);
-        orig_dblen = ri64(patch + 69 + 8 * 6);
-        orig_eblen = ri64(patch + 69 + 8 * 7);
-        if (old_size != old_len) return QBERR_BADPATCH;
-        int64_t cb_off = 69 + 8 * 8;
-        int64_t db_off = cb_off + cblen;
-        int64_t eb_off = db_off + dblen;
-        if (new_size < 0 || old_size < 0 || cblen < 0 || dblen < 0 || eblen < 0 || orig_cblen < 0 || orig_dblen < 0 ||
-            orig_eblen < 0)
-            return QBERR_TRUNCPATCH;
-        if (eb_off + eblen != patch_len) return QBERR_TRUNCPATCH;
-        int64_t old_pos = 0, new_pos = 0;
-        uint8_t * new_data = malloc(new_size);
-        if (new_data == NULL) return QBERR_NOMEM;
-
-        uint8_t *cb = NULL, *db = NULL, *eb = NULL;
-
-        errn = decompress(patch + cb_off, cblen, &cb, orig_cblen);
-        if (errn != QBERR_OK) goto err;
-        errn = decompress(patch + db_off, dblen, &db, orig_dblen);
-        if (errn != QBERR_OK) goto err;
-        errn = decompress(patch + eb_off, eblen, &eb, orig_eblen);
+    }
+
+    int64_t old_size = ps.old_size, new_size = ps.new_size, i, ctrl[3];
+    int64_t old_pos = 0, new_pos = 0, db_off = 0, eb_off = 0;
+    struct norm_info norm = { 0 };
+    uint8_t * s[4] = { NULL, NULL, NULL, NULL };
+    uint8_t * new_data = malloc(new_size);
+    if (new_data == NULL) return QBERR_NOMEM;
+
+    for (i = 0; i < ps.n; i++) {
+        errn = decompress_codec(patch + ps.off[i], ps.len[i], ps.codec[i], old, old_size, &s[i], ps.raw[i]);
         if (errn != QBERR_OK) goto err;
+    }
+    if (ps.normalized && (errn = norm_decode(s[3], ps.raw[3], &norm)) != QBERR_OK) goto err;
+    t1 = now();
+    stats->decompress_time = t1 - t0;
+
+    // Cursors into the add, extra and seek columns of the control stream.
+    const uint8_t *cb = s[0], *db = s[1], *eb = s[2], *col[3] = { 0 }, *col_end[3] = { 0 };
+    if (ps.v1) {
+        col[0] = cb;
+        col_end[0] = cb + ps.raw[0];
+    } else {
+        uint64_t add_len, extra_len;
+        const uint8_t * p = cb;
+        if (!read_varint(&p, cb + ps.raw[0], &add_len) || !read_varint(&p, cb + ps.raw[0], &extra_len) ||
+            add_len > ps.raw[0] - (p - cb) || extra_len > ps.raw[0] - (p - cb) - add_len) {
+            errn = QBERR_BADPATCH;
+            goto err;
+        }
+        col[0] = p;
+        col[1] = col_end[0] = p + add_len;
+        col[2] = col_end[1] = p + add_len + extra_len;
+        col_end[2] = cb + ps.raw[0];
+    }
 
-        memset(new_data, 0, new_size);
-        cb_off = 0;
-        db_off = 0;
-        eb_off = 0;
-        while (new_pos < new_size) {
-            for (i = 0; i <= 2; i++) {
-                ctrl[i] = ri64(cb + cb_off);
-                cb_off += 8;
+    memset(new_data, 0, new_size);
+    while (new_pos < new_size) {
+        if (ps.v1) {
+            if (col_end[0] - col[0] < 24) {
+                errn = QBERR_BADPATCH;
+                goto err;
             }
-
-            if (ctrl[0] < 0 || ctrl[1] < 0 || new_pos + ctrl[0] > new_size || ctrl[0] < 0 || new_pos + ctrl[0] < 0) {
+            for (i = 0; i <= 2; i++) ctrl[i] = ri64(col[0] + 8 * i);
+            col[0] += 24;
+        } else {
+            uint64_t v[3];
+            if (!read_varint(&col[0], col_end[0], &v[0]) || !read_varint(&col[1], col_end[1], &v[1]) ||
+                !read_varint(&col[2], col_end[2], &v[2])) {
                 errn = QBERR_BADPATCH;
                 goto err;
             }
+            ctrl[0] = v[0];
+            ctrl[1] = v[1];
+            ctrl[2] = unzigzag(v[2]);
+        }
+
+        if (ctrl[0] < 0 || ctrl[1] < 0 || new_pos + ctrl[0] > new_size || ctrl[0] < 0 || new_pos + ctrl[0] < 0 ||
+            ctrl[0] > ps.raw[1] - db_off || ctrl[1] > ps.raw[2] - eb_off) {
+            errn = QBERR_BADPATCH;
+            goto err;
+        }
+
+        memcpy(new_data + new_pos, db + db_off, ctrl[0]);
+        db_off += ctrl[0];
+
+        /* Add old data to diff string */
+        add_old(new_data + new_pos, old, old_pos, old_size, ctrl[0]);
+
+        /* Adjust pointers */
+        new_pos += ctrl[0];
+        old_pos += ctrl[0];
+
+        /* Sanity-check */
+        if (new_pos + ctrl[1] > new_size || ctrl[1] < 0 || new_pos + ctrl[1] < 0 || old_pos + ctrl[2] > old_size ||
+            old_pos + ctrl[2] < 0) {
+            errn = QBERR_BADPATCH;
+            goto err;
+        }
+
+        /* Read extra string */
+        memcpy(new_data + new_pos, eb + eb_off, ctrl[1]);
+        eb_off += ctrl[1];
+
+        /* Adjust pointers */
+        new_pos += ctrl[1];
+        old_pos += ctrl[2];
+    }
+    if (ps.normalized && (errn = denormalize(&norm, new_data, new_size)) != QBERR_OK) goto err;
+
+    stats->reconstruct_time = now() - t1;
+    t1 = now();
+
+    uint8_t new_cksum[64];
+    blake2b_cksum(new_data, new_size, new_cksum);
+    stats->checksum_time = now() - t1;
+    if (memcmp(patch + 5, new_cksum, 64)) {
+        errn = QBERR_BADCKSUM;
+        goto err;
+    }
+
+    t1 = now();
+    if (fwrite(new_data, 1, new_size, new_file) != new_size) {
+        errn = QBERR_IOERR;
+        goto err;
+    }
+    stats->write_time = now() - t1;
+    stats->total_time = now() - t0;
+
+err:
+    for (i = 0; i < 4; i++) free(s[i]);
+    norm_free(&norm);
+    free(new_data);
+    return errn;
+}
 
-            memcpy(new_data + new_pos, db + db_off, ctrl[0]);
-            db_off += ctrl[0];
+// Reads len bytes of a patch; running out of them means that the patch is truncated.
+static int read_patch(FILE * f, uint8_t * buf, size_t len) {
+    if (fread(buf, 1, len, f) == len) return QBERR_OK;
+    return ferror(f) ? QBERR_IOERR : QBERR_TRUNCPATCH;
+}
 
-            /* Add old data to diff string */
-            for (i = 0; i < ctrl[0]; i++) {
-                if ((old_pos + i >= 0) && (old_pos + i < old_size)) {
-                    new_data[new_pos + i] += old[old_pos + i];
+LIBQDIFF_PUBLIC_API int qbdiff_patch_stream(const uint8_t * RESTRICT old, FILE * patch_file, size_t old_len,
+                                            FILE * new_file, const struct qbdiff_options * opts) {
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now();
+    uint8_t header[QBDIFF_HEADER_OLD + 64];
+    size_t got = fread(header, 1, QBDIFF_HEADER_SEEK, patch_file), skip;
+    if (ferror(patch_file)) return QBERR_IOERR;
+    if (got >= 6 && !memcmp(header, QBDIFF_MAGIC_OLD, 5)) {
+        // The fingerprint of the old file is checked before the rest is read.
+        size_t len = QBDIFF_HEADER_OLD + (header[5] & QBDIFF_OLD_FULL ? 64 : 0);
+        if (got < len) got += fread(header + got, 1, len - got, patch_file);
+        int err = check_old(old, old_len, header, got, &skip);
+        if (err != QBERR_OK) return err;
+        memmove(header, header + skip, got - skip);
+        got -= skip;
+        got += fread(header + got, 1, QBDIFF_HEADER_SEEK - got, patch_file);
+        if (ferror(patch_file)) return QBERR_IOERR;
+    }
+    if (got < QBDIFF_HEADER_SEEK || !seekable_magic(header)) {
+        // Other patches are read in full first.
+        size_t len = got, cap = 1 << 20;
+        uint8_t * patch = malloc(cap);
+        if (!patch) return QBERR_NOMEM;
+        memcpy(patch, header, got);
+        while (!feof(patch_file) && !ferror(patch_file)) {
+            if (len == cap) {
+                uint8_t * grown = realloc(patch, cap *= 2);
+                if (!grown) {
+                    free(patch);
+                    return QBERR_NOMEM;
                 }
+                patch = grown;
             }
+            len += fread(patch + len, 1, cap - len, patch_file);
+        }
+        int err = ferror(patch_file) ? QBERR_IOERR : qbdiff_patch_ex(old, patch, old_len, len, new_file, opts);
+        free(patch);
+        return err;
+    }
 
-            /* Adjust pointers */
-            new_pos += ctrl[0];
-            old_pos += ctrl[0];
-
-            /* Sanity-check */
-            if (new_pos + ctrl[1] > new_size || ctrl[1] < 0 || new_pos + ctrl[1] < 0 || old_pos + ctrl[2] > old_size ||
-                old_pos + ctrl[2] < 0) {
-                errn = QBERR_BADPATCH;
-                goto err;
+    struct seek_patch sp;
+    int err = seek_header(&sp, old, old_len, header);
+    if (err != QBERR_OK) return err;
+    uint8_t * index = malloc(sp.nblocks * seek_entry(&sp) + 1);
+    if (!index) return QBERR_NOMEM;
+    err = read_patch(patch_file, index, sp.nblocks * seek_entry(&sp));
+    sp.index = index;
+
+    // Blocks are rebuilt a batch at a time, in parallel, and written out as soon as they are.
+    int64_t batch = opts && opts->threads > 0 ? opts->threads : pool_threads();
+    uint8_t *data = NULL, *out = err == QBERR_OK ? malloc(batch * sp.block) : NULL;
+    int64_t cap = 0, pos = seek_end(&sp, 0);
+    if (err == QBERR_OK && !out) err = QBERR_NOMEM;
+    blake2b_state state;
+    blake2b_init(&state, 64);
+    for (int64_t k = 0; err == QBERR_OK && k < sp.nblocks; k += batch) {
+        int64_t n = min(batch, sp.nblocks - k), end = seek_end(&sp, k + n);
+        int64_t len = min(n * sp.block, sp.new_size - k * sp.block);
+        if (end < pos) {
+            err = QBERR_BADPATCH;
+            break;
+        }
+        if (end - pos > cap) {
+            uint8_t * grown = realloc(data, end - pos);
+            if (!grown) {
+                err = QBERR_NOMEM;
+                break;
             }
+            data = grown;
+            cap = end - pos;
+        }
+        if ((err = read_patch(patch_file, data, end - pos)) != QBERR_OK) break;
+        sp.data = data;
+        sp.data_off = pos;
+        sp.data_end = pos = end;
+        if ((err = apply_blocks(&sp, k, n, out, opts)) != QBERR_OK) break;
+        blake2b_update(&state, out, len);
+        if (fwrite(out, 1, len, new_file) != len) err = QBERR_IOERR;
+    }
+    if (err == QBERR_OK && fgetc(patch_file) != EOF) err = QBERR_TRUNCPATCH;
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_final(&state, cksum, 64);
+        if (memcmp(header + 5, cksum, 64)) err = QBERR_BADCKSUM;
+    }
+    free(index);
+    free(data);
+    free(out);
+    stats->total_time = now() - t0;
+    return err;
+}
 
-            /* Read extra string */
-            memcpy(new_data + new_pos, eb + eb_off, ctrl[1]);
-            eb_off += ctrl[1];
+// qbdiff_verify rebuilds the new file a window at a time, from streams decoded a buffer at a
+// time, and hashes it as it goes. Overridable so that the test suite can use small windows.
+#ifndef QBDIFF_VERIFY_WINDOW
+    #define QBDIFF_VERIFY_WINDOW (1 << 20)
+#endif
+#define QBDIFF_READER_BUF (QBDIFF_VERIFY_WINDOW / 16)
 
-            /* Adjust pointers */
-            new_pos += ctrl[1];
-            old_pos += ctrl[2];
+// A stream of a patch, decoded a buffer at a time. `limit' is how much more of it may be read.
+struct reader {
+    lzma_stream strm;
+    lzma_options_lzma opt;
+    bool lzma;
+    int64_t left, limit;      // Bytes not decoded yet, and not read yet.
+    const uint8_t *p, *end;  // Decoded bytes at hand.
+    uint8_t buf[QBDIFF_READER_BUF];
+};
+
+static int reader_open(struct reader * r, const uint8_t * src, int64_t src_size, int codec, const uint8_t * old,
+                       int64_t old_size, int64_t raw_size) {
+    r->limit = raw_size;
+    if (codec == QBDIFF_CODEC_STORE) {
+        if (src_size != raw_size) return QBERR_BADPATCH;
+        r->p = src;
+        r->end = src + src_size;
+        return QBERR_OK;
+    }
+
+    const uint8_t * p = src;
+    r->left = raw_size;
+    r->p = r->end = r->buf;
+    if ((codec & 15) == QBDIFF_CODEC_LZMA2) {
+        if (lzma_stream_decoder(&r->strm, UINT64_MAX, 0) != LZMA_OK) return QBERR_LZMAERR;
+    } else {
+        lzma_filter filters[3];
+        uint64_t off, len;
+        if (codec_filters(codec, &r->opt, filters) != QBERR_OK || !read_varint(&p, src + src_size, &off) ||
+            !read_varint(&p, src + src_size, &len) || off > old_size || len > old_size - off || len > r->opt.dict_size)
+            return QBERR_BADPATCH;
+        r->opt.preset_dict = old + off;
+        r->opt.preset_dict_size = len;
+        if (lzma_raw_decoder(&r->strm, filters) != LZMA_OK) return QBERR_LZMAERR;
+    }
+    r->lzma = true;
+    r->strm.next_in = p;
+    r->strm.avail_in = src + src_size - p;
+    return QBERR_OK;
+}
+
+static int reader_fill(struct reader * r) {
+    if (!r->left) return QBERR_BADPATCH;
+    size_t want = min(QBDIFF_READER_BUF, r->left);
+    lzma_ret ret = LZMA_OK;
+    r->strm.next_out = r->buf;
+    r->strm.avail_out = want;
+    while (r->strm.avail_out == want && ret == LZMA_OK) ret = lzma_code(&r->strm, LZMA_FINISH);
+    size_t n = want - r->strm.avail_out;
+    if (!n || (ret != LZMA_OK && ret != LZMA_STREAM_END)) return QBERR_LZMAERR;
+    r->left -= n;
+    r->p = r->buf;
+    r->end = r->buf + n;
+    return QBERR_OK;
+}
+
+// Reads n bytes of the stream to dst, or skips them if it is NULL.
+static int reader_read(struct reader * r, uint8_t * dst, int64_t n) {
+    if (n > r->limit) return QBERR_BADPATCH;
+    r->limit -= n;
+    while (n) {
+        int err;
+        if (r->p == r->end && (err = reader_fill(r)) != QBERR_OK) return err;
+        int64_t len = min(n, r->end - r->p);
+        if (dst) memcpy(dst, r->p, len), dst += len;
+        r->p += len;
+        n -= len;
+    }
+    return QBERR_OK;
+}
+
+static int reader_varint(struct reader * r, uint64_t * v) {
+    uint8_t buf[9] = { 0 };
+    int err;
+    if (!r->limit) return QBERR_BADPATCH;
+    if (r->p == r->end && (err = reader_fill(r)) != QBERR_OK) return err;
+    if ((err = reader_read(r, buf, *r->p ? __builtin_ctz(*r->p) + 1 : 9)) != QBERR_OK) return err;
+    get_varint(buf, v);
+    return QBERR_OK;
+}
+
+// Decodes the rest of the stream, which has to end where the patch says, as it does for
+// qbdiff_patch_ex.
+static int reader_finish(struct reader * r) {
+    int err;
+    if (!r->lzma) return QBERR_OK;
+    while (r->left)
+        if ((err = reader_fill(r)) != QBERR_OK) return err;
+    uint8_t extra;
+    lzma_ret ret = LZMA_OK;
+    while (ret == LZMA_OK) {
+        r->strm.next_out = &extra;
+        r->strm.avail_out = 1;
+        ret = lzma_code(&r->strm, LZMA_FINISH);
+        if (!r->strm.avail_out) return QBERR_LZMAERR;
+    }
+    return ret == LZMA_STREAM_END && !r->strm.avail_in ? QBERR_OK : QBERR_LZMAERR;
+}
+
+static void reader_close(struct reader * r) {
+    if (r->lzma) lzma_end(&r->strm);
+}
+
+// Reads the next control entry, and checks it against the sizes of the files.
+static int verify_control(struct reader * r, const struct patch_streams * ps, int64_t new_pos, int64_t old_pos,
+                          int64_t ctrl[3]) {
+    int err = QBERR_OK;
+    if (ps->v1) {
+        uint8_t entry[24];
+        if ((err = reader_read(&r[0], entry, 24)) != QBERR_OK) return err;
+        for (int i = 0; i < 3; i++) ctrl[i] = ri64(entry + 8 * i);
+    } else {
+        uint64_t v[3];
+        for (int i = 0; i < 3 && err == QBERR_OK; i++) err = reader_varint(&r[i], &v[i]);
+        if (err != QBERR_OK) return err;
+        ctrl[0] = v[0];
+        ctrl[1] = v[1];
+        ctrl[2] = unzigzag(v[2]);
+    }
+    if (ctrl[0] < 0 || ctrl[1] < 0 || ctrl[0] > ps->new_size - new_pos || ctrl[1] > ps->new_size - new_pos - ctrl[0] ||
+        old_pos + ctrl[0] + ctrl[2] > ps->old_size || old_pos + ctrl[0] + ctrl[2] < 0)
+        return QBERR_BADPATCH;
+    return QBERR_OK;
+}
+
+// qbdiff_verify of QBDF, QBDB and QBDN patches. Readers 0-2 decode the add, extra and seek
+// columns of the control stream, which lie one after another in it (or, for QBDB1, reader 0
+// the fixed-width entries, and for QBDF, the new file), and readers 3 and 4 the diff and extra
+// streams.
+static int verify_streams(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len) {
+    struct patch_streams ps;
+    int err = patch_streams(patch, old_len, patch_len, &ps);
+    if (err != QBERR_OK) return err;
+    struct reader * r = calloc(5, sizeof(struct reader));
+    uint8_t *window = malloc(QBDIFF_VERIFY_WINDOW), *nb = NULL;
+    struct norm_info norm = { 0 };
+    struct denorm * dn = NULL;
+    blake2b_state state;
+    blake2b_init(&state, 64);
+    if (!r || !window) {
+        err = QBERR_NOMEM;
+        goto err;
+    }
+
+    int64_t new_pos = 0, old_pos = 0, base = 0, fill = 0, ctrl[3] = { 0, 0, 0 };
+    if (ps.full) {
+        err = reader_open(&r[0], patch + ps.off[0], ps.len[0], ps.codec[0], old, old_len, ps.raw[0]);
+        while (err == QBERR_OK && r[0].limit) {
+            int64_t n = min(r[0].limit, QBDIFF_VERIFY_WINDOW);
+            if ((err = reader_read(&r[0], window, n)) == QBERR_OK) blake2b_update(&state, window, n);
         }
+        if (err == QBERR_OK) err = reader_finish(&r[0]);
+        goto err;
+    }
 
-        uint8_t new_cksum[64];
-        blake2b_cksum(new_data, new_size, new_cksum);
-        if (memcmp(patch + 5, new_cksum, 64)) {
-            errn = QBERR_BADCKSUM;
+    for (int i = 0; i < (ps.v1 ? 1 : 3) && err == QBERR_OK; i++)
+        err = reader_open(&r[i], patch + ps.off[0], ps.len[0], ps.codec[0], old, old_len, ps.raw[0]);
+    for (int i = 1; i < 3 && err == QBERR_OK; i++)
+        err = reader_open(&r[2 + i], patch + ps.off[i], ps.len[i], ps.codec[i], old, old_len, ps.raw[i]);
+    if (err == QBERR_OK && !ps.v1) {
+        uint64_t add_len, extra_len;
+        if ((err = reader_varint(&r[0], &add_len)) != QBERR_OK || (err = reader_varint(&r[0], &extra_len)) != QBERR_OK)
+            goto err;
+        int64_t header = ps.raw[0] - r[0].limit;
+        if (add_len > r[0].limit || extra_len > r[0].limit - add_len) {
+            err = QBERR_BADPATCH;
             goto err;
         }
-
-        if (fwrite(new_data, 1, new_size, new_file) != new_size) {
-            errn = QBERR_IOERR;
+        if ((err = reader_read(&r[1], NULL, header + add_len)) != QBERR_OK ||
+            (err = reader_read(&r[2], NULL, header + add_len + extra_len)) != QBERR_OK)
             goto err;
+        r[0].limit = add_len;
+        r[1].limit = extra_len;
+    }
+    if (err == QBERR_OK && ps.normalized) {
+        err = decompress_codec(patch + ps.off[3], ps.len[3], ps.codec[3], old, old_len, &nb, ps.raw[3]);
+        if (err == QBERR_OK) err = norm_decode(nb, ps.raw[3], &norm);
+        if (err == QBERR_OK) err = denorm_begin(&norm, ps.new_size, &dn);
+    }
+
+    // ctrl holds what is left of the current entry.
+    bool entry = false;
+    while (err == QBERR_OK && new_pos < ps.new_size) {
+        if (!entry && (err = verify_control(r, &ps, new_pos, old_pos, ctrl)) != QBERR_OK) break;
+        entry = true;
+        int64_t n = min(QBDIFF_VERIFY_WINDOW - fill, ctrl[0] ? ctrl[0] : ctrl[1]);
+        if (ctrl[0]) {
+            if ((err = reader_read(&r[3], window + fill, n)) != QBERR_OK) break;
+            add_old(window + fill, old, old_pos, ps.old_size, n);
+            old_pos += n;
+            ctrl[0] -= n;
+        } else if ((err = reader_read(&r[4], window + fill, n)) != QBERR_OK) {
+            break;
+        } else {
+            ctrl[1] -= n;
+        }
+        fill += n;
+        new_pos += n;
+        if (!ctrl[0] && !ctrl[1]) {
+            old_pos += ctrl[2];
+            entry = false;
         }
 
-        free(cb);
-        free(db);
-        free(eb);
-        free(new_data);
-        return QBERR_OK;
+        // A normalized file is final only up to the branches scanned so far.
+        if (fill == QBDIFF_VERIFY_WINDOW || new_pos == ps.new_size) {
+            int64_t done = base + fill;
+            if (dn && (err = denorm_window(dn, window, base, base + fill, &done)) != QBERR_OK) break;
+            blake2b_update(&state, window, done - base);
+            memmove(window, window + (done - base), base + fill - done);
+            fill = base + fill - done;
+            base = done;
+        }
+    }
+    if (err == QBERR_OK) err = reader_finish(&r[ps.v1 ? 0 : 2]);
+    for (int i = 3; i < 5 && err == QBERR_OK; i++) err = reader_finish(&r[i]);
 
-    err:
-        free(cb);
-        free(db);
-        free(eb);
-        free(new_data);
-        return errn;
-    } else {
-        return QBERR_BADPATCH;
+err:
+    if (dn) {
+        int end = denorm_end(dn);
+        if (err == QBERR_OK) err = end;
+    }
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_final(&state, cksum, 64);
+        if (memcmp(patch + 5, cksum, 64)) err = QBERR_BADCKSUM;
+    }
+    for (int i = 0; r && i < 5; i++) reader_close(&r[i]);
+    free(r);
+    free(window);
+    free(nb);
+    norm_free(&norm);
+    return err;
+}
+
+// The blocks of a seekable patch are rebuilt a batch at a time, in parallel.
+static int verify_seekable(const uint8_t * old, const uint8_t * patch, size_t old_len, size_t patch_len,
+                           const struct qbdiff_options * opts) {
+    struct seek_patch sp;
+    int err = seek_open(&sp, old, patch, old_len, patch_len);
+    if (err != QBERR_OK) return err;
+    int64_t batch = opts && opts->threads > 0 ? opts->threads : pool_threads();
+    uint8_t * out = malloc(batch * sp.block);
+    if (!out) return QBERR_NOMEM;
+    blake2b_state state;
+    blake2b_init(&state, 64);
+    for (int64_t k = 0; err == QBERR_OK && k < sp.nblocks; k += batch) {
+        int64_t n = min(batch, sp.nblocks - k);
+        if ((err = apply_blocks(&sp, k, n, out, opts)) == QBERR_OK)
+            blake2b_update(&state, out, min(n * sp.block, sp.new_size - k * sp.block));
+    }
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_final(&state, cksum, 64);
+        if (memcmp(patch + 5, cksum, 64)) err = QBERR_BADCKSUM;
+    }
+    free(out);
+    return err;
+}
+
+LIBQDIFF_PUBLIC_API int qbdiff_verify(const uint8_t * RESTRICT old, const uint8_t * RESTRICT patch, size_t old_len,
+                                      size_t patch_len, const struct qbdiff_options * opts) {
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now();
+    size_t skip;
+    int err = check_old(old, old_len, patch, patch_len, &skip);
+    if (err == QBERR_OK && patch_len - skip < 70)
+        err = QBERR_TRUNCPATCH;
+    else if (err == QBERR_OK && seekable_magic(patch + skip))
+        err = verify_seekable(old, patch + skip, old_len, patch_len - skip, opts);
+    else if (err == QBERR_OK)
+        err = verify_streams(old, patch + skip, old_len, patch_len - skip);
+    stats->total_time = now() - t0;
+    return err;
+}
+
+#ifndef _WIN32
+// The plan of an in-place patch is checked against the spans of the old file that its blocks
+// read, found from their control streams: no block may overwrite old data that a block rebuilt
+// after it reads. Spilled blocks are rebuilt at the first steps and written last, the others
+// rebuilt and written at their step. Sets plan to the blocks in order, and self for the blocks
+// that read their own place, which could not be rebuilt after a crash while being written.
+static int plan_check(const struct seek_patch * sp, int64_t * plan, int64_t * nspill, bool * self) {
+    const uint8_t * steps = sp->index + sp->nblocks * QBDIFF_SEEK_ENTRY;
+    int64_t * at = malloc((sp->nblocks + 1) * sizeof(int64_t));  // Step at which each block is written.
+    struct read_spans rs = { 0 };
+    int err = at ? QBERR_OK : QBERR_NOMEM;
+    *nspill = 0;
+    for (int64_t k = 0; at && k < sp->nblocks; k++) at[k] = -1;
+    for (int64_t s = 0; s < sp->nblocks && err == QBERR_OK; s++) {
+        int64_t v = ri64(steps + 8 * s), k = v & ~QBDIFF_PLAN_SPILL;
+        bool spill = v & QBDIFF_PLAN_SPILL;
+        if (v < 0 || k >= sp->nblocks || at[k] >= 0 || (spill && s != *nspill)) {
+            err = QBERR_BADPATCH;
+            break;
+        }
+        plan[s] = k;
+        at[k] = spill ? sp->nblocks : s;
+        *nspill += spill;
+    }
+
+    for (int64_t s = 0; s < sp->nblocks && err == QBERR_OK; s++) {
+        int64_t j = plan[s];
+        const uint8_t *entry = sp->index + j * QBDIFF_SEEK_ENTRY, *col[3], *col_end[3];
+        int64_t off = ri64(entry), old_pos = ri64(entry + 8), packed = ri64(entry + 17), raw = ri64(entry + 25);
+        uint8_t * ctrl = NULL;
+        if (old_pos < 0 || old_pos > sp->old_size || !codec_valid(entry[16]) ||
+            (entry[16] & 15) == QBDIFF_CODEC_LZMA2_DICT || raw < 0)
+            err = QBERR_BADPATCH;
+        else if (off < sp->data_off || off > sp->data_end || packed < 0 || packed > sp->data_end - off)
+            err = QBERR_TRUNCPATCH;
+        else
+            err = decompress_codec(sp->data + (off - sp->data_off), packed, entry[16], NULL, 0, &ctrl, raw);
+        rs.n = 0;
+        if (err == QBERR_OK && !ctrl_columns(ctrl, raw, col, col_end)) err = QBERR_BADPATCH;
+        int64_t len = min(sp->block, sp->new_size - j * sp->block);
+        if (err == QBERR_OK) err = block_spans(&rs, j, col, col_end, old_pos, sp->old_size, len);
+        free(ctrl);
+        for (int64_t i = 0; i < rs.n && err == QBERR_OK; i++) {
+            const struct read_span * r = &rs.s[i];
+            for (int64_t w = r->lo / sp->block; r->lo < sp->new_size && w <= (min(r->hi, sp->new_size) - 1) / sp->block;
+                 w++) {
+                if (w == j)
+                    self[j] = true;
+                else if (at[w] <= s)
+                    err = QBERR_BADPATCH;
+            }
+        }
+    }
+    free(rs.s);
+    free(at);
+    return err;
+}
+
+// The journal of qbdiff_patch_in_place holds the magic and the BLAKE2b of the new file, which
+// ties it to the patch, two slots for the progress record, a staging slot for a block and the
+// spilled blocks. A record holds a sequence number, the step of the plan reached, the block
+// staged for it or -1, and the BLAKE2b of those. Records go to the slots in turn, so that a
+// torn write leaves the one before it.
+    #define QBDIFF_MAGIC_JOURNAL "QBDJ1"
+    #define QBDIFF_JOURNAL_RECORD 88
+    #define QBDIFF_JOURNAL_HEADER (69 + 2 * QBDIFF_JOURNAL_RECORD)
+
+// Resumable patching records a checkpoint once this much more of the new file is written.
+    #ifndef QBDIFF_CHECKPOINT
+        #define QBDIFF_CHECKPOINT (64 << 20)
+    #endif
+
+struct journal {
+    int fd;
+    int64_t seq, step, staged;
+};
+
+static int pwrite_full(int fd, const uint8_t * buf, int64_t len, int64_t off) {
+    while (len > 0) {
+        ssize_t n = pwrite(fd, buf, len, off);
+        if (n <= 0) return QBERR_IOERR;
+        buf += n;
+        len -= n;
+        off += n;
+    }
+    return QBERR_OK;
+}
+
+static int pread_full(int fd, uint8_t * buf, int64_t len, int64_t off) {
+    while (len > 0) {
+        ssize_t n = pread(fd, buf, len, off);
+        if (n <= 0) return QBERR_IOERR;
+        buf += n;
+        len -= n;
+        off += n;
+    }
+    return QBERR_OK;
+}
+
+// Makes a record durable, after whatever was written to the journal before it.
+static int journal_record(struct journal * j, int64_t step, int64_t staged) {
+    uint8_t rec[QBDIFF_JOURNAL_RECORD];
+    wi64(j->seq + 1, rec);
+    wi64(step, rec + 8);
+    wi64(staged, rec + 16);
+    blake2b_cksum(rec, 24, rec + 24);
+    if (fsync(j->fd) || pwrite_full(j->fd, rec, sizeof(rec), 69 + (j->seq + 1) % 2 * QBDIFF_JOURNAL_RECORD) ||
+        fsync(j->fd))
+        return QBERR_IOERR;
+    j->seq++;
+    j->step = step;
+    j->staged = staged;
+    return QBERR_OK;
+}
+
+// Loads the last record written in full, if any.
+static void journal_load(struct journal * j) {
+    for (int i = 0; i < 2; i++) {
+        uint8_t rec[QBDIFF_JOURNAL_RECORD], cksum[64];
+        if (pread_full(j->fd, rec, sizeof(rec), 69 + i * QBDIFF_JOURNAL_RECORD) != QBERR_OK) continue;
+        blake2b_cksum(rec, 24, cksum);
+        if (memcmp(rec + 24, cksum, 64) || ri64(rec) <= j->seq) continue;
+        j->seq = ri64(rec);
+        j->step = ri64(rec + 8);
+        j->staged = ri64(rec + 16);
+    }
+}
+
+// Opens the journal at path and, if it belongs to the patch whose new file has the given
+// BLAKE2b, loads its last record. Sets owned when it had to be created, and fails on an existing
+// file that is not a journal.
+static int journal_open(struct journal * j, const char * path, const uint8_t cksum[64], bool * owned) {
+    uint8_t head[69];
+    *owned = false;
+    if ((j->fd = open(path, O_RDWR)) < 0) {
+        *owned = true;
+        if ((j->fd = open(path, O_RDWR | O_CREAT | O_EXCL, 0600)) < 0) return QBERR_IOERR;
+    }
+
+    // Any other file, short of a journal cut short as it was created, is not ours to overwrite.
+    ssize_t n = pread(j->fd, head, 69, 0);
+    if (n < 0 || memcmp(head, QBDIFF_MAGIC_JOURNAL, min(n, 5))) {
+        close(j->fd);
+        j->fd = -1;
+        return QBERR_IOERR;
+    }
+    if (n == 69 && !memcmp(head + 5, cksum, 64)) journal_load(j);
+    return QBERR_OK;
+}
+
+// Empties the journal and ties it to the patch.
+static int journal_start(struct journal * j, const uint8_t cksum[64]) {
+    uint8_t head[69];
+    memcpy(head, QBDIFF_MAGIC_JOURNAL, 5);
+    memcpy(head + 5, cksum, 64);
+    return ftruncate(j->fd, 0) || pwrite_full(j->fd, head, 69, 0) ? QBERR_IOERR : QBERR_OK;
+}
+
+// Writes a block to the file through its mapping, and waits for it to reach the disk.
+static int map_write(uint8_t * map, int64_t off, const uint8_t * data, int64_t len) {
+    int64_t page = sysconf(_SC_PAGESIZE), start = off / page * page;
+    memcpy(map + off, data, len);
+    return msync(map + start, off + len - start, MS_SYNC) ? QBERR_IOERR : QBERR_OK;
+}
+#endif
+
+// The file is mapped at the larger of the old and the new size. The spilled blocks are rebuilt
+// into the journal before anything is written, then each block is rebuilt and written in the
+// order of the plan, with a record of the step reached after each, and the spilled blocks go
+// last. A block that reads its own place goes to the journal first, so that it can be written
+// again if the power goes out meanwhile.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_in_place(const char * path, const uint8_t * RESTRICT patch, size_t patch_len,
+                                              const char * journal, const struct qbdiff_options * opts) {
+#ifdef _WIN32
+    return QBERR_IOERR;
+#else
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now();
+    // The fingerprint of the old file is checked below, unless resuming.
+    size_t skip = patch_len >= 6 && !memcmp(patch, QBDIFF_MAGIC_OLD, 5)
+                      ? QBDIFF_HEADER_OLD + (patch[5] & QBDIFF_OLD_FULL ? 64 : 0)
+                      : 0;
+    if (patch_len < skip + QBDIFF_HEADER_SEEK) return QBERR_TRUNCPATCH;
+    const uint8_t * p = patch + skip;
+    int64_t old_size = ri64(p + 69), new_size = ri64(p + 77);
+    if (memcmp(p, QBDIFF_MAGIC_INPLACE, 5) || old_size < 0 || new_size < 0) return QBERR_BADPATCH;
+
+    struct journal j = { -1, 0, 0, -1 };
+    struct seek_patch sp;
+    struct stat st;
+    uint8_t *map = MAP_FAILED, *buf = NULL;
+    int64_t *plan = NULL, nspill = 0, map_len = 1, staging = QBDIFF_JOURNAL_HEADER, spills;
+    bool *self = NULL, owned = false;
+    int err = QBERR_IOERR, fd = open(path, O_RDWR);
+    if (fd < 0 || fstat(fd, &st) || journal_open(&j, journal, p + 5, &owned) != QBERR_OK) goto err;
+
+    // A journal of this patch with a record in it means that the file is on its way already.
+    bool resume = j.seq > 0;
+    map_len = max(max((int64_t)st.st_size, old_size), max(new_size, 1));
+    if ((map = mmap(NULL, map_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED) goto err;
+    if (!resume && (err = check_old(map, st.st_size, patch, patch_len, &skip)) == QBERR_OK)
+        err = verify_seekable(map, p, st.st_size, patch_len - skip, opts);
+    if (resume || err == QBERR_OK) err = seek_open(&sp, map, p, old_size, patch_len - skip);
+    if (err != QBERR_OK) goto err;
+
+    plan = malloc((sp.nblocks + 1) * sizeof(int64_t));
+    self = calloc(sp.nblocks + 1, sizeof(bool));
+    buf = malloc(sp.block);
+    if (!plan || !self || !buf) {
+        err = QBERR_NOMEM;
+        goto err;
+    }
+    if ((err = plan_check(&sp, plan, &nspill, self)) != QBERR_OK) goto err;
+    spills = staging + sp.block;
+
+    if (!resume) {
+        owned = true;
+        err = journal_start(&j, p + 5);
+        for (int64_t i = 0; i < nspill && err == QBERR_OK; i++) {
+            int64_t len = min(sp.block, sp.new_size - plan[i] * sp.block);
+            if ((err = seek_apply(&sp, plan[i], buf)) == QBERR_OK)
+                err = pwrite_full(j.fd, buf, len, spills + i * sp.block);
+        }
+        if (err == QBERR_OK) err = journal_record(&j, nspill, -1);
+        if (err != QBERR_OK) goto err;
+    }
+    if (fstat(fd, &st) || (st.st_size < sp.new_size && ftruncate(fd, sp.new_size))) {
+        err = QBERR_IOERR;
+        goto err;
+    }
+
+    for (int64_t s = j.step; s < sp.nblocks; s++) {
+        int64_t k = plan[s], len = min(sp.block, sp.new_size - k * sp.block);
+        if (j.staged == k) {
+            if ((err = pread_full(j.fd, buf, len, staging)) == QBERR_OK) err = seek_check(&sp, k, buf);
+        } else if ((err = seek_apply(&sp, k, buf)) == QBERR_OK && self[k]) {
+            if ((err = pwrite_full(j.fd, buf, len, staging)) == QBERR_OK) err = journal_record(&j, s, k);
+        }
+        if (err == QBERR_OK) err = map_write(map, k * sp.block, buf, len);
+        if (err == QBERR_OK) err = journal_record(&j, s + 1, -1);
+        if (err != QBERR_OK) goto err;
+    }
+
+    for (int64_t i = 0; i < nspill && err == QBERR_OK; i++) {
+        int64_t len = min(sp.block, sp.new_size - plan[i] * sp.block);
+        if ((err = pread_full(j.fd, buf, len, spills + i * sp.block)) == QBERR_OK) err = seek_check(&sp, plan[i], buf);
+        if (err == QBERR_OK) err = map_write(map, plan[i] * sp.block, buf, len);
+    }
+    if (err == QBERR_OK && (ftruncate(fd, sp.new_size) || fsync(fd))) err = QBERR_IOERR;
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_cksum(map, sp.new_size, cksum);
+        if (memcmp(p + 5, cksum, 64)) err = QBERR_BADCKSUM;
+    }
+    if (err == QBERR_OK && unlink(journal)) err = QBERR_IOERR;
+
+err:
+    // A journal with no record in it is of no use.
+    if (owned && j.fd >= 0 && !j.seq) unlink(journal);
+    if (map != MAP_FAILED) munmap(map, map_len);
+    if (fd >= 0) close(fd);
+    if (j.fd >= 0) close(j.fd);
+    free(plan);
+    free(self);
+    free(buf);
+    stats->total_time = now() - t0;
+    return err;
+#endif
+}
+
+// Seekable patches are applied a batch of blocks at a time, as in qbdiff_patch_stream, and
+// each time QBDIFF_CHECKPOINT more bytes are written, the new file is synced and the number of
+// blocks done recorded in the checkpoint, a journal with records only. A resumed call reads the
+// blocks done back and checks each against its BLAKE2b, which also feeds the hash of the whole
+// file, and rebuilds the rest from the first one that fails. The LZMA decoders of the single
+// streams of other patches have no state that could be saved, so those start over.
+LIBQDIFF_PUBLIC_API int qbdiff_patch_resume(const uint8_t * RESTRICT old, const uint8_t * RESTRICT patch,
+                                            size_t old_len, size_t patch_len, const char * path,
+                                            const char * checkpoint, const struct qbdiff_options * opts) {
+#ifdef _WIN32
+    return QBERR_IOERR;
+#else
+    struct qbdiff_stats scratch, *stats = init_stats(opts, &scratch);
+    double t0 = now();
+    size_t skip;
+    int err = check_old(old, old_len, patch, patch_len, &skip);
+    if (err != QBERR_OK) return err;
+    const uint8_t * p = patch + skip;
+    if (patch_len - skip < 70) return QBERR_TRUNCPATCH;
+    if (!seekable_magic(p)) {
+        FILE * f = fopen(path, "wb");
+        if (!f) return QBERR_IOERR;
+        err = qbdiff_patch_ex(old, patch, old_len, patch_len, f, opts);
+        if (fflush(f) || fsync(fileno(f))) err = err == QBERR_OK ? QBERR_IOERR : err;
+        fclose(f);
+        return err;
+    }
+
+    struct seek_patch sp;
+    struct journal j = { -1, 0, 0, -1 };
+    bool owned = false;
+    if ((err = seek_open(&sp, old, p, old_len, patch_len - skip)) != QBERR_OK) return err;
+    int64_t batch = opts && opts->threads > 0 ? opts->threads : pool_threads(), k = 0, since = 0;
+    uint8_t * out = malloc(batch * sp.block);
+    int fd = open(path, O_RDWR | O_CREAT, 0666);
+    if (!out) err = QBERR_NOMEM;
+    if (err == QBERR_OK && (fd < 0 || journal_open(&j, checkpoint, p + 5, &owned)))
+        err = QBERR_IOERR;
+    if (err == QBERR_OK && !j.seq) {
+        owned = true;
+        err = journal_start(&j, p + 5);
     }
+
+    blake2b_state state;
+    blake2b_init(&state, 64);
+    for (int64_t done = min(max(j.step, 0), sp.nblocks); err == QBERR_OK && k < done;) {
+        int64_t n = min(batch, done - k), i = 0;
+        if (pread_full(fd, out, min(n * sp.block, sp.new_size - k * sp.block), k * sp.block) != QBERR_OK) break;
+        while (i < n && seek_check(&sp, k + i, out + i * sp.block) == QBERR_OK) i++;
+        blake2b_update(&state, out, min(i * sp.block, sp.new_size - k * sp.block));
+        k += i;
+        if (i < n) break;
+    }
+    for (int64_t n; err == QBERR_OK && k < sp.nblocks; k += n) {
+        n = min(batch, sp.nblocks - k);
+        int64_t len = min(n * sp.block, sp.new_size - k * sp.block);
+        if ((err = apply_blocks(&sp, k, n, out, opts)) != QBERR_OK) break;
+        blake2b_update(&state, out, len);
+        err = pwrite_full(fd, out, len, k * sp.block);
+        if (err == QBERR_OK && (since += len) >= QBDIFF_CHECKPOINT && k + n < sp.nblocks) {
+            since = 0;
+            err = fsync(fd) ? QBERR_IOERR : journal_record(&j, k + n, -1);
+        }
+    }
+    if (err == QBERR_OK) {
+        uint8_t cksum[64];
+        blake2b_final(&state, cksum, 64);
+        if (memcmp(p + 5, cksum, 64)) err = QBERR_BADCKSUM;
+    }
+    if (err == QBERR_OK && (ftruncate(fd, sp.new_size) || fsync(fd) || unlink(checkpoint))) err = QBERR_IOERR;
+
+    // A checkpoint with no record in it is of no use.
+    if (err != QBERR_OK && owned && j.fd >= 0 && !j.seq) unlink(checkpoint);
+    if (fd >= 0) close(fd);
+    if (j.fd >= 0) close(j.fd);
+    free(out);
+    stats->total_time = now() - t0;
+    return err;
+#endif
 }
 
 LIBQDIFF_PUBLIC_API const char * qbdiff_version(void) { return VERSION; }
@@ -893,6 +3698,8 @@ LIBQDIFF_PUBLIC_API const char * qbdiff_error(int code) {
             return "LZMA error";
         case QBERR_SAIS:
             return "SAIS error";
+        case QBERR_BADOLD:
+            return "Patch is for another old file";
         default:
             return "Unknown error";
     }
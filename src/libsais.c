@@ -22,6 +22,7 @@ Please see the file 3rdparty/libsais-LICENSE for full copyright information.
 --*/
 
 #include "libsais.h"
+#include "pool.h"
 
 #include <limits.h>
 #include <stddef.h>
@@ -29,12 +30,6 @@ Please see the file 3rdparty/libsais-LICENSE for full copyright information.
 #include <stdlib.h>
 #include <string.h>
 
-#if defined(_OPENMP)
-    #include <omp.h>
-#else
-    #define UNUSED(_x) (void)(_x)
-#endif
-
 typedef int32_t sa_sint_t;
 typedef uint32_t sa_uint_t;
 typedef ptrdiff_t fast_sint_t;
@@ -244,8 +239,6 @@ static void libsais_free_ctx_main(LIBSAIS_CONTEXT * ctx) {
     }
 }
 
-#if defined(_OPENMP)
-
 static sa_sint_t libsais_count_negative_marked_suffixes(sa_sint_t * RESTRICT SA, fast_sint_t omp_block_start,
                                                         fast_sint_t omp_block_size) {
     sa_sint_t count = 0;
@@ -456,8 +449,6 @@ static void libsais_accumulate_counts_s32(sa_sint_t * RESTRICT buckets, fast_sin
     }
 }
 
-#endif
-
 static void libsais_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                            fast_sint_t m, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
     if (omp_block_size > 0) {
@@ -504,48 +495,51 @@ static void libsais_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint_t
     }
 }
 
-static void libsais_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                               sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1, omp_block_start, omp_block_size);
+struct libsais_gather_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_gather_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais_gather_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t t, m = 0;
+        for (t = omp_num_threads - 1; t > omp_thread_num; --t) {
+            m += thread_state[t].state.m;
         }
-#if defined(_OPENMP)
-        else {
-            fast_sint_t t, m = 0;
-            for (t = omp_num_threads - 1; t > omp_thread_num; --t) {
-                m += thread_state[t].state.m;
-            }
 
-            libsais_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1 - m, omp_block_start, omp_block_size);
+        libsais_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1 - m, omp_block_start, omp_block_size);
 
-    #pragma omp barrier
+        pool_barrier();
 
-            if (thread_state[omp_thread_num].state.m > 0) {
-                SA[(fast_sint_t)n - 1 - m] = (sa_sint_t)thread_state[omp_thread_num].state.last_lms_suffix;
-            }
+        if (thread_state[omp_thread_num].state.m > 0) {
+            SA[(fast_sint_t)n - 1 - m] = (sa_sint_t)thread_state[omp_thread_num].state.last_lms_suffix;
         }
-#endif
     }
 }
 
+static void libsais_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                               sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_gather_lms_suffixes_8u_omp_args a = { T, SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais_gather_lms_suffixes_8u_omp_region, &a);
+}
+
 static sa_sint_t libsais_gather_lms_suffixes_32s(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n) {
     const fast_sint_t prefetch_distance = 32;
 
@@ -629,8 +623,6 @@ static sa_sint_t libsais_gather_compacted_lms_suffixes_32s(const sa_sint_t * RES
     return n - 1 - m;
 }
 
-#if defined(_OPENMP)
-
 static void libsais_count_lms_suffixes_32s_4k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                               sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -677,8 +669,6 @@ static void libsais_count_lms_suffixes_32s_4k(const sa_sint_t * RESTRICT T, sa_s
     buckets[BUCKETS_INDEX4((fast_uint_t)c0, (s << 1) & 3)]++;
 }
 
-#endif
-
 static void libsais_count_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                               sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -725,8 +715,6 @@ static void libsais_count_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa_s
     buckets[BUCKETS_INDEX2((fast_uint_t)c0, 0)]++;
 }
 
-#if defined(_OPENMP)
-
 static void libsais_count_compacted_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                                         sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -779,8 +767,6 @@ static void libsais_count_compacted_lms_suffixes_32s_2k(const sa_sint_t * RESTRI
     buckets[BUCKETS_INDEX2((fast_uint_t)c0, 0)]++;
 }
 
-#endif
-
 static sa_sint_t libsais_count_and_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                           sa_sint_t n, sa_sint_t * RESTRICT buckets,
                                                           fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -846,75 +832,81 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_8u(const uint8_t * RESTRI
     return (sa_sint_t)(omp_block_start + omp_block_size - 1 - m);
 }
 
-static sa_sint_t libsais_count_and_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
-                                                              sa_sint_t n, sa_sint_t * RESTRICT buckets,
-                                                              sa_sint_t threads,
-                                                              LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t m = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais_count_and_gather_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais_count_and_gather_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_lms_suffixes_8u(T, SA, n, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.m = libsais_count_and_gather_lms_suffixes_8u(
+                T, SA, n, thread_state[omp_thread_num].state.buckets, omp_block_start, omp_block_size);
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_lms_suffixes_8u(T, SA, n, buckets, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.m = libsais_count_and_gather_lms_suffixes_8u(
-                    T, SA, n, thread_state[omp_thread_num].state.buckets, omp_block_start, omp_block_size);
-
-                if (thread_state[omp_thread_num].state.m > 0) {
-                    thread_state[omp_thread_num].state.last_lms_suffix =
-                        SA[thread_state[omp_thread_num].state.position - 1];
-                }
+            if (thread_state[omp_thread_num].state.m > 0) {
+                thread_state[omp_thread_num].state.last_lms_suffix =
+                    SA[thread_state[omp_thread_num].state.position - 1];
             }
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                memset(buckets, 0, 4 * ALPHABET_SIZE * sizeof(sa_sint_t));
+        if (omp_thread_num == 0) {
+            memset(buckets, 0, 4 * ALPHABET_SIZE * sizeof(sa_sint_t));
 
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.m;
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.m;
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.m > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.m],
-                               (size_t)thread_state[t].state.m * sizeof(sa_sint_t));
-                    }
+                if (t != omp_num_threads - 1 && thread_state[t].state.m > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.m],
+                           (size_t)thread_state[t].state.m * sizeof(sa_sint_t));
+                }
 
-                    {
-                        sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                        fast_sint_t s;
-                        for (s = 0; s < 4 * ALPHABET_SIZE; s += 1) {
-                            sa_sint_t A = buckets[s], B = temp_bucket[s];
-                            buckets[s] = A + B;
-                            temp_bucket[s] = A;
-                        }
+                {
+                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                    fast_sint_t s;
+                    for (s = 0; s < 4 * ALPHABET_SIZE; s += 1) {
+                        sa_sint_t A = buckets[s], B = temp_bucket[s];
+                        buckets[s] = A + B;
+                        temp_bucket[s] = A;
                     }
                 }
             }
         }
-#endif
     }
+}
+
+static sa_sint_t libsais_count_and_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+                                                              sa_sint_t n, sa_sint_t * RESTRICT buckets,
+                                                              sa_sint_t threads,
+                                                              LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t m = 0;
+
+    struct libsais_count_and_gather_lms_suffixes_8u_omp_args a = { T, SA, n, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais_count_and_gather_lms_suffixes_8u_omp_region, &a);
+    m = a.m;
 
     return m;
 }
@@ -1137,8 +1129,6 @@ static sa_sint_t libsais_count_and_gather_compacted_lms_suffixes_32s_2k(const sa
     return (sa_sint_t)(omp_block_start + omp_block_size - 1 - m);
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais_get_bucket_stride(fast_sint_t free_space, fast_sint_t bucket_size, fast_sint_t num_buckets) {
     fast_sint_t bucket_size_1024 = (bucket_size + 1023) & (-1024);
     if (free_space / (num_buckets - 1) >= bucket_size_1024) {
@@ -1152,207 +1142,256 @@ static fast_sint_t libsais_get_bucket_stride(fast_sint_t free_space, fast_sint_t
     return bucket_size;
 }
 
-static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp(const sa_sint_t * RESTRICT T,
-                                                                     sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
-                                                                     sa_sint_t * RESTRICT buckets, sa_sint_t threads,
-                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t m = 0;
-
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp_region(void * arg) {
+    struct libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 4 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 4 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
-
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais_count_and_gather_lms_suffixes_32s_4k(
-                    T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais_count_and_gather_lms_suffixes_32s_4k(
+                T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            if (omp_thread_num == omp_num_threads - 1) {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
+        if (omp_thread_num == omp_num_threads - 1) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.count;
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.count],
-                               (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.count],
+                           (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
-            } else {
-                omp_num_threads = omp_num_threads - 1;
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
-
-                libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                              omp_num_threads + 1);
             }
+        } else {
+            omp_num_threads = omp_num_threads - 1;
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+
+            libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                          omp_num_threads + 1);
         }
-    #endif
     }
-
-    return m;
 }
 
-static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp(const sa_sint_t * RESTRICT T,
+static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp(const sa_sint_t * RESTRICT T,
                                                                      sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
                                                                      sa_sint_t * RESTRICT buckets, sa_sint_t threads,
                                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m = 0;
 
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp_args a = { T, SA, n, k, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp_region,
+                  &a);
+    m = a.m;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 2 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
-
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais_count_and_gather_lms_suffixes_32s_2k(
-                    T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
+    return m;
+}
+
+struct libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp_region(void * arg) {
+    struct libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 2 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
 
-        #pragma omp barrier
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais_count_and_gather_lms_suffixes_32s_2k(
+                T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
+        }
 
-            if (omp_thread_num == omp_num_threads - 1) {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
+        pool_barrier();
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.count],
-                               (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+        if (omp_thread_num == omp_num_threads - 1) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.count;
+
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.count],
+                           (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
-            } else {
-                omp_num_threads = omp_num_threads - 1;
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
-
-                libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                              omp_num_threads + 1);
             }
+        } else {
+            omp_num_threads = omp_num_threads - 1;
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+
+            libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                          omp_num_threads + 1);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp(const sa_sint_t * RESTRICT T,
+                                                                     sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
+                                                                     sa_sint_t * RESTRICT buckets, sa_sint_t threads,
+                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t m = 0;
+
+    struct libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp_args a = { T, SA, n, k, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp_region,
+                  &a);
+    m = a.m;
 
     return m;
 }
 
-static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k, sa_sint_t * RESTRICT buckets,
-    sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_region(void * arg) {
+    struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start,
+                                                               omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 2 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n + n], bucket_size, omp_num_threads);
 
-        if (omp_num_threads == 1) {
-            libsais_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start,
-                                                                   omp_block_size);
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais_count_and_gather_compacted_lms_suffixes_32s_2k(
+                T, SA + n, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 2 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais_get_bucket_stride(buckets - &SA[n + n], bucket_size, omp_num_threads);
 
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais_count_and_gather_compacted_lms_suffixes_32s_2k(
-                    T, SA + n, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                fast_sint_t t, m = 0;
-                for (t = omp_num_threads - 1; t >= omp_thread_num; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
-                }
+        {
+            fast_sint_t t, m = 0;
+            for (t = omp_num_threads - 1; t >= omp_thread_num; --t) {
+                m += (sa_sint_t)thread_state[t].state.count;
+            }
 
-                if (thread_state[omp_thread_num].state.count > 0) {
-                    memcpy(
-                        &SA[n - m],
-                        &SA[n + thread_state[omp_thread_num].state.position - thread_state[omp_thread_num].state.count],
-                        (size_t)thread_state[omp_thread_num].state.count * sizeof(sa_sint_t));
-                }
+            if (thread_state[omp_thread_num].state.count > 0) {
+                memcpy(
+                    &SA[n - m],
+                    &SA[n + thread_state[omp_thread_num].state.position - thread_state[omp_thread_num].state.count],
+                    (size_t)thread_state[omp_thread_num].state.count * sizeof(sa_sint_t));
             }
+        }
 
-            {
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+        {
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
 
-                libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                              omp_num_threads);
-            }
+            libsais_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                          omp_num_threads);
         }
-    #endif
     }
 }
 
-#endif
+static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k, sa_sint_t * RESTRICT buckets,
+    sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args a = { T, SA, n, k, buckets,
+                                                                                    thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_region, &a);
+}
+
+struct libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp_region(void * arg) {
+    struct libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais_count_lms_suffixes_32s_4k(T, n, k, buckets);
+    } else {
+        a->m = libsais_gather_lms_suffixes_32s(T, SA, n);
+    }
+}
 
 static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                        sa_sint_t * RESTRICT SA, sa_sint_t n,
@@ -1360,66 +1399,82 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp(const sa_
                                                                        sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais_count_lms_suffixes_32s_4k(T, n, k, buckets);
-        } else {
-            m = libsais_gather_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1, libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp_region, &a);
+    m = a.m;
 
     return m;
 }
 
+struct libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp_region(void * arg) {
+    struct libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais_count_lms_suffixes_32s_2k(T, n, k, buckets);
+    } else {
+        a->m = libsais_gather_lms_suffixes_32s(T, SA, n);
+    }
+}
+
 static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                        sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                        sa_sint_t k, sa_sint_t * RESTRICT buckets,
                                                                        sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais_count_lms_suffixes_32s_2k(T, n, k, buckets);
-        } else {
-            m = libsais_gather_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1, libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp_region, &a);
+    m = a.m;
 
     return m;
 }
 
+struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_region(void * arg) {
+    struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais_count_compacted_lms_suffixes_32s_2k(T, n, k, buckets);
+    } else {
+        a->m = libsais_gather_compacted_lms_suffixes_32s(T, SA, n);
+    }
+}
+
 static sa_sint_t libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                                  sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                                  sa_sint_t k,
@@ -1427,29 +1482,10 @@ static sa_sint_t libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp
                                                                                  sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais_count_compacted_lms_suffixes_32s_2k(T, n, k, buckets);
-        } else {
-            m = libsais_gather_compacted_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1,
+                  libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_region, &a);
+    m = a.m;
 
     return m;
 }
@@ -1460,7 +1496,6 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_omp(const sa_sint_
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m;
 
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n]) / ((4 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1472,9 +1507,6 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_4k_omp(const sa_sint_
         m = libsais_count_and_gather_lms_suffixes_32s_4k_fs_omp(T, SA, n, k, buckets, max_threads > 2 ? max_threads : 2,
                                                                 thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         m = libsais_count_and_gather_lms_suffixes_32s_4k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1488,7 +1520,6 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_2k_omp(const sa_sint_
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m;
 
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n]) / ((2 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1500,9 +1531,6 @@ static sa_sint_t libsais_count_and_gather_lms_suffixes_32s_2k_omp(const sa_sint_
         m = libsais_count_and_gather_lms_suffixes_32s_2k_fs_omp(T, SA, n, k, buckets, max_threads > 2 ? max_threads : 2,
                                                                 thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         m = libsais_count_and_gather_lms_suffixes_32s_2k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1515,7 +1543,6 @@ static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_omp(const sa_
                                                                        sa_sint_t k, sa_sint_t * RESTRICT buckets,
                                                                        sa_sint_t threads,
                                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n + n]) / ((2 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1527,9 +1554,6 @@ static void libsais_count_and_gather_compacted_lms_suffixes_32s_2k_omp(const sa_
         libsais_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(T, SA, n, k, buckets,
                                                                       max_threads > 2 ? max_threads : 2, thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         libsais_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1793,56 +1817,64 @@ static void libsais_radix_sort_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_si
     }
 }
 
-static void libsais_radix_sort_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                   sa_sint_t m, sa_sint_t * RESTRICT buckets, sa_sint_t threads,
-                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && m >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            libsais_radix_sort_lms_suffixes_8u(T, SA, &buckets[4 * ALPHABET_SIZE], (fast_sint_t)n - (fast_sint_t)m + 1,
-                                               (fast_sint_t)m - 1);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                sa_sint_t * RESTRICT src_bucket = &buckets[4 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT dst_bucket = thread_state[omp_thread_num].state.buckets;
+struct libsais_radix_sort_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_radix_sort_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais_radix_sort_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        libsais_radix_sort_lms_suffixes_8u(T, SA, &buckets[4 * ALPHABET_SIZE], (fast_sint_t)n - (fast_sint_t)m + 1,
+                                           (fast_sint_t)m - 1);
+    } else {
+        {
+            sa_sint_t * RESTRICT src_bucket = &buckets[4 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT dst_bucket = thread_state[omp_thread_num].state.buckets;
 
-                fast_sint_t i, j;
-                for (i = BUCKETS_INDEX2(0, 0), j = BUCKETS_INDEX4(0, 1); i <= BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0);
-                     i += BUCKETS_INDEX2(1, 0), j += BUCKETS_INDEX4(1, 0)) {
-                    dst_bucket[i] = src_bucket[i] - dst_bucket[j];
-                }
+            fast_sint_t i, j;
+            for (i = BUCKETS_INDEX2(0, 0), j = BUCKETS_INDEX4(0, 1); i <= BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0);
+                 i += BUCKETS_INDEX2(1, 0), j += BUCKETS_INDEX4(1, 0)) {
+                dst_bucket[i] = src_bucket[i] - dst_bucket[j];
             }
+        }
 
-            {
-                fast_sint_t t, omp_block_start = 0, omp_block_size = thread_state[omp_thread_num].state.m;
-                for (t = omp_num_threads - 1; t >= omp_thread_num; --t) omp_block_start += thread_state[t].state.m;
-
-                if (omp_block_start == (fast_sint_t)m && omp_block_size > 0) {
-                    omp_block_start -= 1;
-                    omp_block_size -= 1;
-                }
+        {
+            fast_sint_t t, omp_block_start = 0, omp_block_size = thread_state[omp_thread_num].state.m;
+            for (t = omp_num_threads - 1; t >= omp_thread_num; --t) omp_block_start += thread_state[t].state.m;
 
-                libsais_radix_sort_lms_suffixes_8u(T, SA, thread_state[omp_thread_num].state.buckets,
-                                                   (fast_sint_t)n - omp_block_start, omp_block_size);
+            if (omp_block_start == (fast_sint_t)m && omp_block_size > 0) {
+                omp_block_start -= 1;
+                omp_block_size -= 1;
             }
+
+            libsais_radix_sort_lms_suffixes_8u(T, SA, thread_state[omp_thread_num].state.buckets,
+                                               (fast_sint_t)n - omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
+static void libsais_radix_sort_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                   sa_sint_t m, sa_sint_t * RESTRICT buckets, sa_sint_t threads,
+                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_radix_sort_lms_suffixes_8u_omp_args a = { T, SA, n, m, buckets, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 && m >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais_radix_sort_lms_suffixes_8u_omp_region, &a);
+}
+
 static void libsais_radix_sort_lms_suffixes_32s_6k(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                    sa_sint_t * RESTRICT induction_bucket, fast_sint_t omp_block_start,
                                                    fast_sint_t omp_block_size) {
@@ -1913,8 +1945,6 @@ static void libsais_radix_sort_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T,
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais_radix_sort_lms_suffixes_32s_block_gather(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                              LIBSAIS_THREAD_CACHE * RESTRICT cache,
                                                              fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -1992,111 +2022,121 @@ static void libsais_radix_sort_lms_suffixes_32s_2k_block_sort(sa_sint_t * RESTRI
     }
 }
 
-static void libsais_radix_sort_lms_suffixes_32s_6k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
-                                                             sa_sint_t * RESTRICT induction_bucket,
-                                                             LIBSAIS_THREAD_CACHE * RESTRICT cache,
-                                                             fast_sint_t block_start, fast_sint_t block_size,
-                                                             sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
+struct libsais_radix_sort_lms_suffixes_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+static void libsais_radix_sort_lms_suffixes_32s_6k_block_omp_region(void * arg) {
+    struct libsais_radix_sort_lms_suffixes_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
 
-        omp_block_start += block_start;
+    omp_block_start += block_start;
 
-        if (omp_num_threads == 1) {
-            libsais_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    if (omp_num_threads == 1) {
+        libsais_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                             omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                 omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais_radix_sort_lms_suffixes_32s_6k_block_sort(induction_bucket, cache - block_start, block_start,
-                                                                  block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais_radix_sort_lms_suffixes_32s_6k_block_sort(induction_bucket, cache - block_start, block_start,
+                                                              block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-static void libsais_radix_sort_lms_suffixes_32s_2k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+static void libsais_radix_sort_lms_suffixes_32s_6k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                              sa_sint_t * RESTRICT induction_bucket,
                                                              LIBSAIS_THREAD_CACHE * RESTRICT cache,
                                                              fast_sint_t block_start, fast_sint_t block_size,
                                                              sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    struct libsais_radix_sort_lms_suffixes_32s_6k_block_omp_args a = { T, SA, induction_bucket, cache, block_start,
+                                                                       block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_radix_sort_lms_suffixes_32s_6k_block_omp_region, &a);
+}
+
+struct libsais_radix_sort_lms_suffixes_32s_2k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_radix_sort_lms_suffixes_32s_2k_block_omp_region(void * arg) {
+    struct libsais_radix_sort_lms_suffixes_32s_2k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                             omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                 omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais_radix_sort_lms_suffixes_32s_2k_block_sort(induction_bucket, cache - block_start, block_start,
-                                                                  block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais_radix_sort_lms_suffixes_32s_2k_block_sort(induction_bucket, cache - block_start, block_start,
+                                                              block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais_radix_sort_lms_suffixes_32s_2k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+                                                             sa_sint_t * RESTRICT induction_bucket,
+                                                             LIBSAIS_THREAD_CACHE * RESTRICT cache,
+                                                             fast_sint_t block_start, fast_sint_t block_size,
+                                                             sa_sint_t threads) {
+    struct libsais_radix_sort_lms_suffixes_32s_2k_block_omp_args a = { T, SA, induction_bucket, cache, block_start,
+                                                                       block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_radix_sort_lms_suffixes_32s_2k_block_omp_region, &a);
+}
 
 static void libsais_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                        sa_sint_t n, sa_sint_t m, sa_sint_t * RESTRICT induction_bucket,
@@ -2106,7 +2146,6 @@ static void libsais_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTRIC
         libsais_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, (fast_sint_t)n - (fast_sint_t)m + 1,
                                                (fast_sint_t)m - 1);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < (fast_sint_t)m - 1; block_start = block_end) {
@@ -2120,9 +2159,6 @@ static void libsais_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTRIC
                                                              threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -2133,7 +2169,6 @@ static void libsais_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTRIC
         libsais_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, (fast_sint_t)n - (fast_sint_t)m + 1,
                                                (fast_sint_t)m - 1);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < (fast_sint_t)m - 1; block_start = block_end) {
@@ -2147,9 +2182,6 @@ static void libsais_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTRIC
                                                              threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais_radix_sort_lms_suffixes_32s_1k(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -2265,52 +2297,60 @@ static void libsais_radix_sort_set_markers_32s_4k(sa_sint_t * RESTRICT SA, sa_si
     }
 }
 
+struct libsais_radix_sort_set_markers_32s_6k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * induction_bucket;
+};
+
+static void libsais_radix_sort_set_markers_32s_6k_omp_region(void * arg) {
+    struct libsais_radix_sort_set_markers_32s_6k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
+
+    libsais_radix_sort_set_markers_32s_6k(SA, induction_bucket, omp_block_start, omp_block_size);
+}
+
 static void libsais_radix_sort_set_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
                                                       sa_sint_t * RESTRICT induction_bucket, sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && k >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
-#else
-        UNUSED(threads);
+    struct libsais_radix_sort_set_markers_32s_6k_omp_args a = { SA, k, induction_bucket };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais_radix_sort_set_markers_32s_6k_omp_region, &a);
+}
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)k - 1;
-#endif
+struct libsais_radix_sort_set_markers_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * induction_bucket;
+};
 
-        libsais_radix_sort_set_markers_32s_6k(SA, induction_bucket, omp_block_start, omp_block_size);
-    }
+static void libsais_radix_sort_set_markers_32s_4k_omp_region(void * arg) {
+    struct libsais_radix_sort_set_markers_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
+
+    libsais_radix_sort_set_markers_32s_4k(SA, induction_bucket, omp_block_start, omp_block_size);
 }
 
 static void libsais_radix_sort_set_markers_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
                                                       sa_sint_t * RESTRICT induction_bucket, sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && k >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)k - 1;
-#endif
-
-        libsais_radix_sort_set_markers_32s_4k(SA, induction_bucket, omp_block_start, omp_block_size);
-    }
+    struct libsais_radix_sort_set_markers_32s_4k_omp_args a = { SA, k, induction_bucket };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais_radix_sort_set_markers_32s_4k_omp_region, &a);
 }
 
 static void libsais_initialize_buckets_for_partial_sorting_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT buckets,
@@ -2428,8 +2468,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u(const uint8_t * R
     return d;
 }
 
-#if defined(_OPENMP)
-
 static void libsais_partial_sorting_scan_left_to_right_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size,
@@ -2513,87 +2551,92 @@ static void libsais_partial_sorting_scan_left_to_right_8u_block_place(sa_sint_t
     }
 }
 
-static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u_block_omp(
-    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_left_to_right_8u(T, SA, buckets, d, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
-            }
+struct libsais_partial_sorting_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_partial_sorting_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_left_to_right_8u(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                sa_sint_t * RESTRICT induction_bucket = &buckets[4 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
+        if (omp_thread_num == 0) {
+            sa_sint_t * RESTRICT induction_bucket = &buckets[4 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
 
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
-                    sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
+                sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
 
-                    fast_sint_t c;
-                    for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_induction_bucket[c] = A;
-                    }
+                fast_sint_t c;
+                for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_induction_bucket[c] = A;
+                }
 
-                    for (d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + d;
-                        distinct_names[c] = B > 0 ? D : A;
-                        temp_distinct_names[c] = A;
-                    }
-                    d += 1 + (sa_sint_t)thread_state[t].state.position;
-                    thread_state[t].state.position = (fast_sint_t)d - thread_state[t].state.position;
+                for (a->d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + a->d;
+                    distinct_names[c] = B > 0 ? D : A;
+                    temp_distinct_names[c] = A;
                 }
+                a->d += 1 + (sa_sint_t)thread_state[t].state.position;
+                thread_state[t].state.position = (fast_sint_t)a->d - thread_state[t].state.position;
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_partial_sorting_scan_left_to_right_8u_block_place(
-                    SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
-            }
+        {
+            libsais_partial_sorting_scan_left_to_right_8u_block_place(
+                SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u_block_omp(
+    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_partial_sorting_scan_left_to_right_8u_block_omp_args a = { T, SA, buckets, d, block_start,
+                                                                              block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_partial_sorting_scan_left_to_right_8u_block_omp_region, &a);
+    d = a.d;
 
     return d;
 }
 
-#endif
-
 static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                    sa_sint_t n, sa_sint_t * RESTRICT buckets,
                                                                    sa_sint_t left_suffixes_count, sa_sint_t d,
@@ -2608,7 +2651,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u_omp(const uint8_t
     if (threads == 1 || left_suffixes_count < 65536) {
         d = libsais_partial_sorting_scan_left_to_right_8u(T, SA, buckets, d, 0, left_suffixes_count);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < left_suffixes_count;) {
@@ -2643,9 +2685,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_8u_omp(const uint8_t
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -2829,8 +2868,6 @@ static void libsais_partial_sorting_scan_left_to_right_32s_1k(const sa_sint_t *
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais_partial_sorting_scan_left_to_right_32s_6k_block_gather(const sa_sint_t * RESTRICT T,
                                                                            sa_sint_t * RESTRICT SA,
                                                                            LIBSAIS_THREAD_CACHE * RESTRICT cache,
@@ -3192,162 +3229,185 @@ static void libsais_partial_sorting_scan_left_to_right_32s_1k_block_sort(const s
     }
 }
 
-static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, d, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_left_to_right_32s_6k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_left_to_right_32s_6k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                d = libsais_partial_sorting_scan_left_to_right_32s_6k_block_sort(T, buckets, d, cache - block_start,
-                                                                                 block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            a->d = libsais_partial_sorting_scan_left_to_right_32s_6k_block_sort(T, buckets, a->d, cache - block_start,
+                                                                                block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
-
-    return d;
 }
 
-static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
+    struct libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp_args a = { T, SA, buckets, d, cache, block_start,
+                                                                                  block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_left_to_right_32s_6k_block_omp_region, &a);
+    d = a.d;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, d, omp_block_start,
-                                                                  omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_left_to_right_32s_4k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
+    return d;
+}
 
-        #pragma omp master
-            {
-                d = libsais_partial_sorting_scan_left_to_right_32s_4k_block_sort(T, k, buckets, d, cache - block_start,
-                                                                                 block_start, block_size);
-            }
+struct libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, a->d, omp_block_start,
+                                                                 omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_left_to_right_32s_4k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+        if (omp_thread_num == 0) {
+            a->d = libsais_partial_sorting_scan_left_to_right_32s_4k_block_sort(T, k, buckets, a->d,
+                                                                                cache - block_start, block_start,
+                                                                                block_size);
         }
-    #endif
-    }
 
-    return d;
+        pool_barrier();
+
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+    }
 }
 
-static void libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+    struct libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp_args a = { T, SA, k, buckets, d, cache,
+                                                                                  block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_left_to_right_32s_4k_block_omp_region, &a);
+    d = a.d;
 
-        omp_block_start += block_start;
+    return d;
+}
 
-        if (omp_num_threads == 1) {
-            libsais_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_left_to_right_32s_1k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_left_to_right_32s_1k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais_partial_sorting_scan_left_to_right_32s_1k_block_sort(T, buckets, cache - block_start,
-                                                                             block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais_partial_sorting_scan_left_to_right_32s_1k_block_sort(T, buckets, cache - block_start,
+                                                                         block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
+    struct libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                                  block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_left_to_right_32s_1k_block_omp_region, &a);
+}
 
 static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_6k_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t * RESTRICT buckets,
@@ -3358,7 +3418,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_6k_omp(
     if (threads == 1 || left_suffixes_count < 65536) {
         d = libsais_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, d, 0, left_suffixes_count);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < left_suffixes_count; block_start = block_end) {
@@ -3371,9 +3430,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_6k_omp(
                 T, SA, buckets, d, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -3393,7 +3449,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_4k_omp(const sa_
     if (threads == 1 || n < 65536) {
         d = libsais_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, d, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -3406,9 +3461,6 @@ static sa_sint_t libsais_partial_sorting_scan_left_to_right_32s_4k_omp(const sa_
                 T, SA, k, buckets, d, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -3422,7 +3474,6 @@ static void libsais_partial_sorting_scan_left_to_right_32s_1k_omp(const sa_sint_
     if (threads == 1 || n < 65536) {
         libsais_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -3435,26 +3486,29 @@ static void libsais_partial_sorting_scan_left_to_right_32s_1k_omp(const sa_sint_
                                                                         block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
-static void libsais_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                         const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+struct libsais_partial_sorting_shift_markers_8u_omp_args {
+    sa_sint_t * SA;
+    const sa_sint_t * buckets;
+};
+
+static void libsais_partial_sorting_shift_markers_8u_omp_region(void * arg) {
+    struct libsais_partial_sorting_shift_markers_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    const sa_sint_t * RESTRICT buckets = a->buckets;
+
     const fast_sint_t prefetch_distance = 32;
 
     const sa_sint_t * RESTRICT temp_bucket = &buckets[4 * ALPHABET_SIZE];
 
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && n >= 65536)
-#else
-    UNUSED(threads);
-    UNUSED(n);
-#endif
-    for (c = BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0); c >= BUCKETS_INDEX2(1, 0); c -= BUCKETS_INDEX2(1, 0)) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0) - omp_thread_num * BUCKETS_INDEX2(1, 0); c >= BUCKETS_INDEX2(1, 0);
+         c -= omp_num_threads * BUCKETS_INDEX2(1, 0)) {
         fast_sint_t i, j;
         sa_sint_t s = SAINT_MIN;
         for (i = (fast_sint_t)temp_bucket[c] - 1, j = (fast_sint_t)buckets[c - BUCKETS_INDEX2(1, 0)] + 3; i >= j;
@@ -3483,20 +3537,34 @@ static void libsais_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT SA
     }
 }
 
-static void libsais_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
-                                                             const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+static void libsais_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                         const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+    struct libsais_partial_sorting_shift_markers_8u_omp_args a = { SA, buckets };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_partial_sorting_shift_markers_8u_omp_region, &a);
+}
+
+struct libsais_partial_sorting_shift_markers_32s_6k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    const sa_sint_t * buckets;
+};
+
+static void libsais_partial_sorting_shift_markers_32s_6k_omp_region(void * arg) {
+    struct libsais_partial_sorting_shift_markers_32s_6k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    const sa_sint_t * RESTRICT buckets = a->buckets;
+
     const fast_sint_t prefetch_distance = 32;
 
     const sa_sint_t * RESTRICT temp_bucket = &buckets[4 * k];
 
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && k >= 65536)
-#else
-    UNUSED(threads);
-#endif
-    for (c = (fast_sint_t)k - 1; c >= 1; c -= 1) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = (fast_sint_t)k - 1 - omp_thread_num * 1; c >= 1; c -= omp_num_threads * 1) {
         fast_sint_t i, j;
         sa_sint_t s = SAINT_MIN;
         for (i = (fast_sint_t)buckets[BUCKETS_INDEX4(c, 0)] - 1,
@@ -3526,6 +3594,12 @@ static void libsais_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTRIC
     }
 }
 
+static void libsais_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
+                                                             const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+    struct libsais_partial_sorting_shift_markers_32s_6k_omp_args a = { SA, k, buckets };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais_partial_sorting_shift_markers_32s_6k_omp_region, &a);
+}
+
 static void libsais_partial_sorting_shift_markers_32s_4k(sa_sint_t * RESTRICT SA, sa_sint_t n) {
     const fast_sint_t prefetch_distance = 32;
 
@@ -3614,8 +3688,6 @@ static sa_sint_t libsais_partial_sorting_scan_right_to_left_8u(const uint8_t * R
     return d;
 }
 
-#if defined(_OPENMP)
-
 static void libsais_partial_sorting_scan_right_to_left_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size,
@@ -3699,87 +3771,92 @@ static void libsais_partial_sorting_scan_right_to_left_8u_block_place(sa_sint_t
     }
 }
 
-static sa_sint_t libsais_partial_sorting_scan_right_to_left_8u_block_omp(
-    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_right_to_left_8u(T, SA, buckets, d, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
-            }
+struct libsais_partial_sorting_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_partial_sorting_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_right_to_left_8u(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
+        if (omp_thread_num == 0) {
+            sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
 
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
-                    sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
+                sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
 
-                    fast_sint_t c;
-                    for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_induction_bucket[c] = A;
-                    }
+                fast_sint_t c;
+                for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_induction_bucket[c] = A;
+                }
 
-                    for (d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + d;
-                        distinct_names[c] = B > 0 ? D : A;
-                        temp_distinct_names[c] = A;
-                    }
-                    d += 1 + (sa_sint_t)thread_state[t].state.position;
-                    thread_state[t].state.position = (fast_sint_t)d - thread_state[t].state.position;
+                for (a->d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + a->d;
+                    distinct_names[c] = B > 0 ? D : A;
+                    temp_distinct_names[c] = A;
                 }
+                a->d += 1 + (sa_sint_t)thread_state[t].state.position;
+                thread_state[t].state.position = (fast_sint_t)a->d - thread_state[t].state.position;
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_partial_sorting_scan_right_to_left_8u_block_place(
-                    SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
-            }
+        {
+            libsais_partial_sorting_scan_right_to_left_8u_block_place(
+                SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais_partial_sorting_scan_right_to_left_8u_block_omp(
+    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_partial_sorting_scan_right_to_left_8u_block_omp_args a = { T, SA, buckets, d, block_start,
+                                                                              block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_partial_sorting_scan_right_to_left_8u_block_omp_region, &a);
+    d = a.d;
 
     return d;
 }
 
-#endif
-
 static void libsais_partial_sorting_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                               sa_sint_t n, sa_sint_t * RESTRICT buckets,
                                                               sa_sint_t first_lms_suffix, sa_sint_t left_suffixes_count,
@@ -3791,7 +3868,6 @@ static void libsais_partial_sorting_scan_right_to_left_8u_omp(const uint8_t * RE
     if (threads == 1 || (scan_end - scan_start) < 65536) {
         libsais_partial_sorting_scan_right_to_left_8u(T, SA, buckets, d, scan_start, scan_end - scan_start);
     }
-#if defined(_OPENMP)
     else {
         sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
         sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
@@ -3829,9 +3905,6 @@ static void libsais_partial_sorting_scan_right_to_left_8u_omp(const uint8_t * RE
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k(const sa_sint_t * RESTRICT T,
@@ -4007,8 +4080,6 @@ static void libsais_partial_sorting_scan_right_to_left_32s_1k(const sa_sint_t *
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais_partial_sorting_scan_right_to_left_32s_6k_block_gather(const sa_sint_t * RESTRICT T,
                                                                            sa_sint_t * RESTRICT SA,
                                                                            LIBSAIS_THREAD_CACHE * RESTRICT cache,
@@ -4358,162 +4429,185 @@ static void libsais_partial_sorting_scan_right_to_left_32s_1k_block_sort(const s
     }
 }
 
-static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, d, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_right_to_left_32s_6k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_right_to_left_32s_6k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                d = libsais_partial_sorting_scan_right_to_left_32s_6k_block_sort(T, buckets, d, cache - block_start,
-                                                                                 block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            a->d = libsais_partial_sorting_scan_right_to_left_32s_6k_block_sort(T, buckets, a->d, cache - block_start,
+                                                                                block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
-
-    return d;
 }
 
-static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, d, omp_block_start,
-                                                                  omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_right_to_left_32s_4k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
+    struct libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp_args a = { T, SA, buckets, d, cache, block_start,
+                                                                                  block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_right_to_left_32s_6k_block_omp_region, &a);
+    d = a.d;
 
-        #pragma omp barrier
+    return d;
+}
 
-        #pragma omp master
-            {
-                d = libsais_partial_sorting_scan_right_to_left_32s_4k_block_sort(T, k, buckets, d, cache - block_start,
-                                                                                 block_start, block_size);
-            }
+struct libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, a->d, omp_block_start,
+                                                                 omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_right_to_left_32s_4k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+        if (omp_thread_num == 0) {
+            a->d = libsais_partial_sorting_scan_right_to_left_32s_4k_block_sort(T, k, buckets, a->d,
+                                                                                cache - block_start, block_start,
+                                                                                block_size);
         }
-    #endif
-    }
 
-    return d;
+        pool_barrier();
+
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+    }
 }
 
-static void libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
+    struct libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp_args a = { T, SA, k, buckets, d, cache,
+                                                                                  block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_right_to_left_32s_4k_block_omp_region, &a);
+    d = a.d;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
+    return d;
+}
 
-        if (omp_num_threads == 1) {
-            libsais_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp_region(void * arg) {
+    struct libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_partial_sorting_scan_right_to_left_32s_1k_block_gather(T, SA, cache - block_start,
+                                                                           omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_partial_sorting_scan_right_to_left_32s_1k_block_gather(T, SA, cache - block_start,
-                                                                               omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais_partial_sorting_scan_right_to_left_32s_1k_block_sort(T, buckets, cache - block_start,
-                                                                             block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais_partial_sorting_scan_right_to_left_32s_1k_block_sort(T, buckets, cache - block_start,
+                                                                         block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
+    struct libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                                  block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_partial_sorting_scan_right_to_left_32s_1k_block_omp_region, &a);
+}
 
 static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t * RESTRICT buckets,
@@ -4525,7 +4619,6 @@ static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k_omp(
     if (threads == 1 || (scan_end - scan_start) < 65536) {
         d = libsais_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, d, scan_start, scan_end - scan_start);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = scan_end - 1; block_start >= scan_start; block_start = block_end) {
@@ -4538,9 +4631,6 @@ static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_6k_omp(
                 T, SA, buckets, d, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -4553,7 +4643,6 @@ static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_4k_omp(const sa_
     if (threads == 1 || n < 65536) {
         d = libsais_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, d, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -4566,9 +4655,6 @@ static sa_sint_t libsais_partial_sorting_scan_right_to_left_32s_4k_omp(const sa_
                 T, SA, k, buckets, d, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -4580,7 +4666,6 @@ static void libsais_partial_sorting_scan_right_to_left_32s_1k_omp(const sa_sint_
     if (threads == 1 || n < 65536) {
         libsais_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -4593,9 +4678,6 @@ static void libsais_partial_sorting_scan_right_to_left_32s_1k_omp(const sa_sint_
                 T, SA, buckets, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static fast_sint_t libsais_partial_sorting_gather_lms_suffixes_32s_4k(sa_sint_t * RESTRICT SA,
@@ -4662,110 +4744,110 @@ static fast_sint_t libsais_partial_sorting_gather_lms_suffixes_32s_1k(sa_sint_t
     return l;
 }
 
-static void libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                                   sa_sint_t threads,
-                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp_region(void * arg) {
+    struct libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start;
+            thread_state[omp_thread_num].state.count =
+                libsais_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size) -
+                omp_block_start;
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start;
-                thread_state[omp_thread_num].state.count =
-                    libsais_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size) -
-                    omp_block_start;
-            }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                fast_sint_t t, position = 0;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    if (t > 0 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
-
-                    position += thread_state[t].state.count;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = 0;
+            for (t = 0; t < omp_num_threads; ++t) {
+                if (t > 0 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
+
+                position += thread_state[t].state.count;
             }
         }
-#endif
     }
 }
 
-static void libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+static void libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                    sa_sint_t threads,
                                                                    LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+    struct libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp_args a = { SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais_partial_sorting_gather_lms_suffixes_32s_4k_omp_region, &a);
+}
 
-        if (omp_num_threads == 1) {
-            libsais_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size);
+struct libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp_region(void * arg) {
+    struct libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start;
+            thread_state[omp_thread_num].state.count =
+                libsais_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size) -
+                omp_block_start;
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start;
-                thread_state[omp_thread_num].state.count =
-                    libsais_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size) -
-                    omp_block_start;
-            }
-
-    #pragma omp barrier
 
-    #pragma omp master
-            {
-                fast_sint_t t, position = 0;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    if (t > 0 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+        pool_barrier();
 
-                    position += thread_state[t].state.count;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = 0;
+            for (t = 0; t < omp_num_threads; ++t) {
+                if (t > 0 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
+
+                position += thread_state[t].state.count;
             }
         }
-#endif
     }
 }
 
+static void libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                                   sa_sint_t threads,
+                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp_args a = { SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais_partial_sorting_gather_lms_suffixes_32s_1k_omp_region, &a);
+}
+
 static void libsais_induce_partial_order_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                 sa_sint_t * RESTRICT buckets, sa_sint_t first_lms_suffix,
                                                 sa_sint_t left_suffixes_count, sa_sint_t threads,
@@ -4898,118 +4980,123 @@ static fast_sint_t libsais_gather_marked_suffixes_8u(sa_sint_t * RESTRICT SA, sa
     return l;
 }
 
-static sa_sint_t libsais_renumber_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
-                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t name = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            name = libsais_renumber_lms_suffixes_8u(SA, m, 0, omp_block_start, omp_block_size);
+struct libsais_renumber_lms_suffixes_8u_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t name;
+};
+
+static void libsais_renumber_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais_renumber_lms_suffixes_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->name = libsais_renumber_lms_suffixes_8u(SA, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
-            }
 
-    #pragma omp barrier
-
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                if (omp_thread_num == omp_num_threads - 1) {
-                    name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
-                }
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
 
-                libsais_renumber_lms_suffixes_8u(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
             }
+
+            libsais_renumber_lms_suffixes_8u(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
         }
-#endif
     }
+}
+
+static sa_sint_t libsais_renumber_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
+                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t name = 0;
+
+    struct libsais_renumber_lms_suffixes_8u_omp_args a = { SA, m, thread_state, name };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais_renumber_lms_suffixes_8u_omp_region, &a);
+    name = a.name;
 
     return name;
 }
 
-static void libsais_gather_marked_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t fs,
-                                                      sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_gather_marked_suffixes_8u(SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                if (omp_thread_num < omp_num_threads - 1) {
-                    thread_state[omp_thread_num].state.position = libsais_gather_marked_suffixes_8u(
-                        SA, m, (fast_sint_t)m + omp_block_start + omp_block_size, omp_block_start, omp_block_size);
-                    thread_state[omp_thread_num].state.count =
-                        (fast_sint_t)m + omp_block_start + omp_block_size - thread_state[omp_thread_num].state.position;
-                } else {
-                    thread_state[omp_thread_num].state.position = libsais_gather_marked_suffixes_8u(
-                        SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
-                    thread_state[omp_thread_num].state.count =
-                        (fast_sint_t)n + (fast_sint_t)fs - thread_state[omp_thread_num].state.position;
-                }
+struct libsais_gather_marked_lms_suffixes_8u_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t fs;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_gather_marked_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais_gather_marked_lms_suffixes_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t fs = a->fs;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_gather_marked_suffixes_8u(SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
+    } else {
+        {
+            if (omp_thread_num < omp_num_threads - 1) {
+                thread_state[omp_thread_num].state.position = libsais_gather_marked_suffixes_8u(
+                    SA, m, (fast_sint_t)m + omp_block_start + omp_block_size, omp_block_start, omp_block_size);
+                thread_state[omp_thread_num].state.count =
+                    (fast_sint_t)m + omp_block_start + omp_block_size - thread_state[omp_thread_num].state.position;
+            } else {
+                thread_state[omp_thread_num].state.position = libsais_gather_marked_suffixes_8u(
+                    SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
+                thread_state[omp_thread_num].state.count =
+                    (fast_sint_t)n + (fast_sint_t)fs - thread_state[omp_thread_num].state.position;
             }
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                fast_sint_t t, position = (fast_sint_t)n + (fast_sint_t)fs;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = (fast_sint_t)n + (fast_sint_t)fs;
 
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    position -= thread_state[t].state.count;
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                position -= thread_state[t].state.count;
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
             }
         }
-#endif
     }
 }
 
+static void libsais_gather_marked_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t fs,
+                                                      sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_gather_marked_lms_suffixes_8u_omp_args a = { SA, n, m, fs, thread_state };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais_gather_marked_lms_suffixes_8u_omp_region, &a);
+}
+
 static sa_sint_t libsais_renumber_and_gather_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
                                                                  sa_sint_t fs, sa_sint_t threads,
                                                                  LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
@@ -5122,104 +5209,115 @@ static void libsais_clamp_lms_suffixes_length_32s(sa_sint_t * RESTRICT SA, sa_si
     }
 }
 
-static sa_sint_t libsais_renumber_distinct_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t m,
-                                                                   sa_sint_t threads,
-                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t name = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            name = libsais_renumber_distinct_lms_suffixes_32s_4k(SA, m, 1, omp_block_start, omp_block_size);
+struct libsais_renumber_distinct_lms_suffixes_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t name;
+};
+
+static void libsais_renumber_distinct_lms_suffixes_32s_4k_omp_region(void * arg) {
+    struct libsais_renumber_distinct_lms_suffixes_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->name = libsais_renumber_distinct_lms_suffixes_32s_4k(SA, m, 1, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
-            }
-
-    #pragma omp barrier
 
-            {
-                fast_sint_t t, count = 1;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                if (omp_thread_num == omp_num_threads - 1) {
-                    name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
-                }
+        {
+            fast_sint_t t, count = 1;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
 
-                libsais_renumber_distinct_lms_suffixes_32s_4k(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
             }
+
+            libsais_renumber_distinct_lms_suffixes_32s_4k(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
         }
-#endif
     }
+}
+
+static sa_sint_t libsais_renumber_distinct_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t m,
+                                                                   sa_sint_t threads,
+                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t name = 0;
+
+    struct libsais_renumber_distinct_lms_suffixes_32s_4k_omp_args a = { SA, m, thread_state, name };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais_renumber_distinct_lms_suffixes_32s_4k_omp_region,
+                  &a);
+    name = a.name;
 
     return name - 1;
 }
 
+struct libsais_mark_distinct_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
+
+static void libsais_mark_distinct_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais_mark_distinct_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+    libsais_mark_distinct_lms_suffixes_32s(SA, m, omp_block_start, omp_block_size);
+}
+
 static void libsais_mark_distinct_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
                                                        sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-#else
-        UNUSED(threads);
+    struct libsais_mark_distinct_lms_suffixes_32s_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais_mark_distinct_lms_suffixes_32s_omp_region, &a);
+}
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n >> 1;
-#endif
-        libsais_mark_distinct_lms_suffixes_32s(SA, m, omp_block_start, omp_block_size);
-    }
+struct libsais_clamp_lms_suffixes_length_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
+
+static void libsais_clamp_lms_suffixes_length_32s_omp_region(void * arg) {
+    struct libsais_clamp_lms_suffixes_length_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+    libsais_clamp_lms_suffixes_length_32s(SA, m, omp_block_start, omp_block_size);
 }
 
 static void libsais_clamp_lms_suffixes_length_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
                                                       sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n >> 1;
-#endif
-        libsais_clamp_lms_suffixes_length_32s(SA, m, omp_block_start, omp_block_size);
-    }
+    struct libsais_clamp_lms_suffixes_length_32s_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais_clamp_lms_suffixes_length_32s_omp_region, &a);
 }
 
 static sa_sint_t libsais_renumber_and_mark_distinct_lms_suffixes_32s_4k_omp(
@@ -5371,26 +5469,30 @@ static void libsais_reconstruct_lms_suffixes(sa_sint_t * RESTRICT SA, sa_sint_t
     }
 }
 
-static void libsais_reconstruct_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-#else
-        UNUSED(threads);
+struct libsais_reconstruct_lms_suffixes_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = m;
-#endif
+static void libsais_reconstruct_lms_suffixes_omp_region(void * arg) {
+    struct libsais_reconstruct_lms_suffixes_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
 
-        libsais_reconstruct_lms_suffixes(SA, n, m, omp_block_start, omp_block_size);
-    }
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    libsais_reconstruct_lms_suffixes(SA, n, m, omp_block_start, omp_block_size);
+}
+
+static void libsais_reconstruct_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t threads) {
+    struct libsais_reconstruct_lms_suffixes_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais_reconstruct_lms_suffixes_omp_region, &a);
 }
 
 static void libsais_place_lms_suffixes_interval_8u(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
@@ -5775,8 +5877,6 @@ static void libsais_final_sorting_scan_left_to_right_32s(const sa_sint_t * RESTR
     }
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais_final_bwt_scan_left_to_right_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -6057,69 +6157,139 @@ static void libsais_final_sorting_scan_left_to_right_32s_block_sort(const sa_sin
     }
 }
 
+struct libsais_final_bwt_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_bwt_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais_final_bwt_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
+                }
+            }
+        }
+
+        pool_barrier();
+
+        {
+            libsais_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                  thread_state[omp_thread_num].state.cache,
+                                                                  thread_state[omp_thread_num].state.count);
+        }
+    }
+}
+
 static void libsais_final_bwt_scan_left_to_right_8u_block_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                               sa_sint_t * RESTRICT induction_bucket,
                                                               fast_sint_t block_start, fast_sint_t block_size,
                                                               sa_sint_t threads,
                                                               LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais_final_bwt_scan_left_to_right_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                        block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_bwt_scan_left_to_right_8u_block_omp_region, &a);
+}
+
+struct libsais_final_bwt_aux_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t rm;
+    sa_sint_t * I;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_bwt_aux_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais_final_bwt_aux_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t rm = a->rm;
+    sa_sint_t * RESTRICT I = a->I;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, omp_block_start,
+                                                    omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                      thread_state[omp_thread_num].state.cache,
-                                                                      thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais_final_bwt_aux_scan_left_to_right_8u_block_place(
+                SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -6129,65 +6299,69 @@ static void libsais_final_bwt_aux_scan_left_to_right_8u_block_omp(const uint8_t
                                                                   fast_sint_t block_start, fast_sint_t block_size,
                                                                   sa_sint_t threads,
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, omp_block_start,
-                                                        omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais_final_bwt_aux_scan_left_to_right_8u_block_omp_args a = { T, SA, rm, I, induction_bucket, block_start,
+                                                                            block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_bwt_aux_scan_left_to_right_8u_block_omp_region, &a);
+}
+
+struct libsais_final_sorting_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_sorting_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais_final_sorting_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_sorting_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_bwt_aux_scan_left_to_right_8u_block_place(
-                    SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                  thread_state[omp_thread_num].state.cache,
+                                                                  thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -6196,119 +6370,68 @@ static void libsais_final_sorting_scan_left_to_right_8u_block_omp(const uint8_t
                                                                   fast_sint_t block_start, fast_sint_t block_size,
                                                                   sa_sint_t threads,
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais_final_sorting_scan_left_to_right_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                            block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_sorting_scan_left_to_right_8u_block_omp_region, &a);
+}
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_sorting_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
+struct libsais_final_sorting_scan_left_to_right_32s_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_final_sorting_scan_left_to_right_32s_block_omp_region(void * arg) {
+    struct libsais_final_sorting_scan_left_to_right_32s_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_sorting_scan_left_to_right_32s(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_final_sorting_scan_left_to_right_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                                      omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
-                }
-            }
+        if (omp_thread_num == 0) {
+            libsais_final_sorting_scan_left_to_right_32s_block_sort(T, buckets, cache - block_start, block_start,
+                                                                    block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                      thread_state[omp_thread_num].state.cache,
-                                                                      thread_state[omp_thread_num].state.count);
-            }
-        }
-    #endif
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
 static void libsais_final_sorting_scan_left_to_right_32s_block_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_sorting_scan_left_to_right_32s(T, SA, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_final_sorting_scan_left_to_right_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                          omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                libsais_final_sorting_scan_left_to_right_32s_block_sort(T, buckets, cache - block_start, block_start,
-                                                                        block_size);
-            }
-
-        #pragma omp barrier
-
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
-    }
+    struct libsais_final_sorting_scan_left_to_right_32s_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                             block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_final_sorting_scan_left_to_right_32s_block_omp_region, &a);
 }
 
-#endif
-
 static void libsais_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                         fast_sint_t n, sa_sint_t * RESTRICT induction_bucket,
                                                         sa_sint_t threads,
@@ -6319,7 +6442,6 @@ static void libsais_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRICT
     if (threads == 1 || n < 65536) {
         libsais_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6355,9 +6477,6 @@ static void libsais_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRICT
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6374,7 +6493,6 @@ static void libsais_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * REST
     if (threads == 1 || n < 65536) {
         libsais_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6413,9 +6531,6 @@ static void libsais_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * REST
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_final_sorting_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6428,7 +6543,6 @@ static void libsais_final_sorting_scan_left_to_right_8u_omp(const uint8_t * REST
     if (threads == 1 || n < 65536) {
         libsais_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6463,9 +6577,6 @@ static void libsais_final_sorting_scan_left_to_right_8u_omp(const uint8_t * REST
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6477,7 +6588,6 @@ static void libsais_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t * R
     if (threads == 1 || n < 65536) {
         libsais_final_sorting_scan_left_to_right_32s(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -6490,9 +6600,6 @@ static void libsais_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t * R
                                                                    block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais_final_bwt_scan_right_to_left_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6713,8 +6820,6 @@ static void libsais_final_sorting_scan_right_to_left_32s(const sa_sint_t * RESTR
     }
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais_final_bwt_scan_right_to_left_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -7067,69 +7172,139 @@ static void libsais_final_sorting_scan_right_to_left_32s_block_sort(const sa_sin
     }
 }
 
+struct libsais_final_bwt_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_bwt_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais_final_bwt_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
+                }
+            }
+        }
+
+        pool_barrier();
+
+        {
+            libsais_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                  thread_state[omp_thread_num].state.cache,
+                                                                  thread_state[omp_thread_num].state.count);
+        }
+    }
+}
+
 static void libsais_final_bwt_scan_right_to_left_8u_block_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                               sa_sint_t * RESTRICT induction_bucket,
                                                               fast_sint_t block_start, fast_sint_t block_size,
                                                               sa_sint_t threads,
                                                               LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_bwt_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais_final_bwt_scan_right_to_left_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                        block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_bwt_scan_right_to_left_8u_block_omp_region, &a);
+}
+
+struct libsais_final_bwt_aux_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t rm;
+    sa_sint_t * I;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_bwt_aux_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais_final_bwt_aux_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t rm = a->rm;
+    sa_sint_t * RESTRICT I = a->I;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, omp_block_start,
+                                                    omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_bwt_aux_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                      thread_state[omp_thread_num].state.cache,
-                                                                      thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais_final_bwt_aux_scan_right_to_left_8u_block_place(
+                SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -7139,65 +7314,69 @@ static void libsais_final_bwt_aux_scan_right_to_left_8u_block_omp(const uint8_t
                                                                   fast_sint_t block_start, fast_sint_t block_size,
                                                                   sa_sint_t threads,
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, omp_block_start,
-                                                        omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_bwt_aux_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais_final_bwt_aux_scan_right_to_left_8u_block_omp_args a = { T, SA, rm, I, induction_bucket, block_start,
+                                                                            block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_bwt_aux_scan_right_to_left_8u_block_omp_region, &a);
+}
+
+struct libsais_final_sorting_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_final_sorting_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais_final_sorting_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais_final_sorting_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_bwt_aux_scan_right_to_left_8u_block_place(
-                    SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                  thread_state[omp_thread_num].state.cache,
+                                                                  thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -7206,119 +7385,68 @@ static void libsais_final_sorting_scan_right_to_left_8u_block_omp(const uint8_t
                                                                   fast_sint_t block_start, fast_sint_t block_size,
                                                                   sa_sint_t threads,
                                                                   LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais_final_sorting_scan_right_to_left_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                            block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais_final_sorting_scan_right_to_left_8u_block_omp_region, &a);
+}
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais_final_sorting_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
+struct libsais_final_sorting_scan_right_to_left_32s_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais_final_sorting_scan_right_to_left_32s_block_omp_region(void * arg) {
+    struct libsais_final_sorting_scan_right_to_left_32s_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_final_sorting_scan_right_to_left_32s(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais_final_sorting_scan_right_to_left_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                                      omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
-                }
-            }
+        if (omp_thread_num == 0) {
+            libsais_final_sorting_scan_right_to_left_32s_block_sort(T, buckets, cache - block_start, block_start,
+                                                                    block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                      thread_state[omp_thread_num].state.cache,
-                                                                      thread_state[omp_thread_num].state.count);
-            }
-        }
-    #endif
+        { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
 static void libsais_final_sorting_scan_right_to_left_32s_block_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_final_sorting_scan_right_to_left_32s(T, SA, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais_final_sorting_scan_right_to_left_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                          omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                libsais_final_sorting_scan_right_to_left_32s_block_sort(T, buckets, cache - block_start, block_start,
-                                                                        block_size);
-            }
-
-        #pragma omp barrier
-
-            { libsais_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
-    }
+    struct libsais_final_sorting_scan_right_to_left_32s_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                             block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais_final_sorting_scan_right_to_left_32s_block_omp_region, &a);
 }
 
-#endif
-
 static sa_sint_t libsais_final_bwt_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                              sa_sint_t n, sa_sint_t * RESTRICT induction_bucket,
                                                              sa_sint_t threads,
@@ -7328,7 +7456,6 @@ static sa_sint_t libsais_final_bwt_scan_right_to_left_8u_omp(const uint8_t * RES
     if (threads == 1 || n < 65536) {
         index = libsais_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7366,9 +7493,6 @@ static sa_sint_t libsais_final_bwt_scan_right_to_left_8u_omp(const uint8_t * RES
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return index;
 }
@@ -7380,7 +7504,6 @@ static void libsais_final_bwt_aux_scan_right_to_left_8u_omp(const uint8_t * REST
     if (threads == 1 || n < 65536) {
         libsais_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7422,9 +7545,6 @@ static void libsais_final_bwt_aux_scan_right_to_left_8u_omp(const uint8_t * REST
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_final_sorting_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -7434,7 +7554,6 @@ static void libsais_final_sorting_scan_right_to_left_8u_omp(const uint8_t * REST
     if (threads == 1 || n < 65536) {
         libsais_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7469,9 +7588,6 @@ static void libsais_final_sorting_scan_right_to_left_8u_omp(const uint8_t * REST
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -7481,7 +7597,6 @@ static void libsais_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t * R
     if (threads == 1 || n < 65536) {
         libsais_final_sorting_scan_right_to_left_32s(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -7494,29 +7609,41 @@ static void libsais_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t * R
                                                                    block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
-static void libsais_clear_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
-                                           sa_sint_t * RESTRICT bucket_start, sa_sint_t * RESTRICT bucket_end,
-                                           sa_sint_t threads) {
+struct libsais_clear_lms_suffixes_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * bucket_start;
+    sa_sint_t * bucket_end;
+};
+
+static void libsais_clear_lms_suffixes_omp_region(void * arg) {
+    struct libsais_clear_lms_suffixes_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT bucket_start = a->bucket_start;
+    sa_sint_t * RESTRICT bucket_end = a->bucket_end;
+
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && n >= 65536)
-#else
-    UNUSED(threads);
-    UNUSED(n);
-#endif
-    for (c = 0; c < k; ++c) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = 0 + omp_thread_num; c < k; c += omp_num_threads) {
         if (bucket_end[c] > bucket_start[c]) {
             memset(&SA[bucket_start[c]], 0, ((size_t)bucket_end[c] - (size_t)bucket_start[c]) * sizeof(sa_sint_t));
         }
     }
 }
 
+static void libsais_clear_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
+                                           sa_sint_t * RESTRICT bucket_start, sa_sint_t * RESTRICT bucket_end,
+                                           sa_sint_t threads) {
+    struct libsais_clear_lms_suffixes_omp_args a = { SA, k, bucket_start, bucket_end };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_clear_lms_suffixes_omp_region, &a);
+}
+
 static sa_sint_t libsais_induce_final_order_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                    sa_sint_t bwt, sa_sint_t r, sa_sint_t * RESTRICT I,
                                                    sa_sint_t * RESTRICT buckets, sa_sint_t threads,
@@ -7711,8 +7838,6 @@ static void libsais_compact_unique_and_nonunique_lms_suffixes_32s(sa_sint_t * RE
     *pr = r + 1;
 }
 
-#if defined(_OPENMP)
-
 static sa_sint_t libsais_count_unique_suffixes(sa_sint_t * RESTRICT SA, sa_sint_t m, fast_sint_t omp_block_start,
                                                fast_sint_t omp_block_size) {
     const fast_sint_t prefetch_distance = 32;
@@ -7742,133 +7867,140 @@ static sa_sint_t libsais_count_unique_suffixes(sa_sint_t * RESTRICT SA, sa_sint_
     return f0 + f1 + f2 + f3;
 }
 
-#endif
-
-static sa_sint_t libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp(
-    sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
-    LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t f = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            f = libsais_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, 0, omp_block_start, omp_block_size);
+struct libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t f;
+};
+
+static void libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->f = libsais_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais_count_unique_suffixes(SA, m, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais_count_unique_suffixes(SA, m, omp_block_start, omp_block_size);
-            }
-
-    #pragma omp barrier
 
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                if (omp_thread_num == omp_num_threads - 1) {
-                    f = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
-                }
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
 
-                libsais_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, (sa_sint_t)count, omp_block_start,
-                                                                       omp_block_size);
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->f = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
             }
+
+            libsais_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, (sa_sint_t)count, omp_block_start,
+                                                                   omp_block_size);
         }
-#endif
     }
+}
+
+static sa_sint_t libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp(
+    sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t f = 0;
+
+    struct libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args a = { T, SA, m, thread_state, f };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1,
+                  libsais_renumber_unique_and_nonunique_lms_suffixes_32s_omp_region, &a);
+    f = a.f;
 
     return f;
 }
 
-static void libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
-                                                                      sa_sint_t fs, sa_sint_t f, sa_sint_t threads,
-                                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072 && m < fs)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t fs;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t fs = a->fs;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        fast_sint_t l = m, r = (fast_sint_t)n + (fast_sint_t)fs;
+        libsais_compact_unique_and_nonunique_lms_suffixes_32s(SA, m, &l, &r, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position =
+                (fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = (fast_sint_t)m + omp_block_start + omp_block_size;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            fast_sint_t l = m, r = (fast_sint_t)n + (fast_sint_t)fs;
-            libsais_compact_unique_and_nonunique_lms_suffixes_32s(SA, m, &l, &r, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position =
-                    (fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = (fast_sint_t)m + omp_block_start + omp_block_size;
-
-                libsais_compact_unique_and_nonunique_lms_suffixes_32s(
-                    SA, m, &thread_state[omp_thread_num].state.position, &thread_state[omp_thread_num].state.count,
-                    omp_block_start, omp_block_size);
-            }
+            libsais_compact_unique_and_nonunique_lms_suffixes_32s(
+                SA, m, &thread_state[omp_thread_num].state.position, &thread_state[omp_thread_num].state.count,
+                omp_block_start, omp_block_size);
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                fast_sint_t t, position;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position;
 
-                for (position = m, t = omp_num_threads - 1; t >= 0; --t) {
-                    fast_sint_t omp_block_end =
-                        t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
-                    fast_sint_t count =
-                        ((fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_end - thread_state[t].state.position);
+            for (position = m, t = omp_num_threads - 1; t >= 0; --t) {
+                fast_sint_t omp_block_end =
+                    t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
+                fast_sint_t count =
+                    ((fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_end - thread_state[t].state.position);
 
-                    if (count > 0) {
-                        position -= count;
-                        memcpy(&SA[position], &SA[thread_state[t].state.position], (size_t)count * sizeof(sa_sint_t));
-                    }
+                if (count > 0) {
+                    position -= count;
+                    memcpy(&SA[position], &SA[thread_state[t].state.position], (size_t)count * sizeof(sa_sint_t));
                 }
+            }
 
-                for (position = (fast_sint_t)n + (fast_sint_t)fs, t = omp_num_threads - 1; t >= 0; --t) {
-                    fast_sint_t omp_block_end =
-                        t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
-                    fast_sint_t count = ((fast_sint_t)m + omp_block_end - thread_state[t].state.count);
+            for (position = (fast_sint_t)n + (fast_sint_t)fs, t = omp_num_threads - 1; t >= 0; --t) {
+                fast_sint_t omp_block_end =
+                    t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
+                fast_sint_t count = ((fast_sint_t)m + omp_block_end - thread_state[t].state.count);
 
-                    if (count > 0) {
-                        position -= count;
-                        memcpy(&SA[position], &SA[thread_state[t].state.count], (size_t)count * sizeof(sa_sint_t));
-                    }
+                if (count > 0) {
+                    position -= count;
+                    memcpy(&SA[position], &SA[thread_state[t].state.count], (size_t)count * sizeof(sa_sint_t));
                 }
             }
         }
-#endif
     }
+}
+
+static void libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
+                                                                      sa_sint_t fs, sa_sint_t f, sa_sint_t threads,
+                                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp_args a = { SA, n, m, fs, thread_state };
+    pool_parallel(threads > 1 && n >= 131072 && m < fs ? threads : 1,
+                  libsais_compact_unique_and_nonunique_lms_suffixes_32s_omp_region, &a);
 
     memcpy(&SA[(fast_sint_t)n + (fast_sint_t)fs - (fast_sint_t)m], &SA[(fast_sint_t)m - (fast_sint_t)f],
            (size_t)f * sizeof(sa_sint_t));
@@ -7974,98 +8106,106 @@ static void libsais_merge_nonunique_lms_suffixes_32s(sa_sint_t * RESTRICT SA, sa
     }
 }
 
-static void libsais_merge_unique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                      sa_sint_t m, sa_sint_t threads,
-                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais_merge_unique_lms_suffixes_32s(T, SA, n, m, 0, omp_block_start, omp_block_size);
+struct libsais_merge_unique_lms_suffixes_32s_omp_args {
+    sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_merge_unique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais_merge_unique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_merge_unique_lms_suffixes_32s(T, SA, n, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais_count_negative_marked_suffixes(T, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais_count_negative_marked_suffixes(T, omp_block_start, omp_block_size);
-            }
-
-    #pragma omp barrier
 
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                libsais_merge_unique_lms_suffixes_32s(T, SA, n, m, count, omp_block_start, omp_block_size);
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
             }
+
+            libsais_merge_unique_lms_suffixes_32s(T, SA, n, m, count, omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
-static void libsais_merge_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t f,
-                                                         sa_sint_t threads,
-                                                         LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+static void libsais_merge_unique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                      sa_sint_t m, sa_sint_t threads,
+                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_merge_unique_lms_suffixes_32s_omp_args a = { T, SA, n, m, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_merge_unique_lms_suffixes_32s_omp_region, &a);
+}
 
-        if (omp_num_threads == 1) {
-            libsais_merge_nonunique_lms_suffixes_32s(SA, n, m, f, omp_block_start, omp_block_size);
+struct libsais_merge_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t f;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais_merge_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais_merge_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t f = a->f;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais_merge_nonunique_lms_suffixes_32s(SA, n, m, f, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais_count_zero_marked_suffixes(SA, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais_count_zero_marked_suffixes(SA, omp_block_start, omp_block_size);
-            }
 
-    #pragma omp barrier
+        pool_barrier();
 
-            {
-                fast_sint_t t, count = f;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
-
-                libsais_merge_nonunique_lms_suffixes_32s(SA, n, m, count, omp_block_start, omp_block_size);
+        {
+            fast_sint_t t, count = f;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
             }
+
+            libsais_merge_nonunique_lms_suffixes_32s(SA, n, m, count, omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
+static void libsais_merge_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t f,
+                                                         sa_sint_t threads,
+                                                         LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais_merge_nonunique_lms_suffixes_32s_omp_args a = { SA, n, m, f, thread_state };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais_merge_nonunique_lms_suffixes_32s_omp_region, &a);
+}
+
 static void libsais_merge_compacted_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                          sa_sint_t m, sa_sint_t f, sa_sint_t threads,
                                                          LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
@@ -8416,32 +8556,32 @@ static void libsais_bwt_copy_8u(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A, sa
     }
 }
 
-#if defined(_OPENMP)
+struct libsais_bwt_copy_8u_omp_args {
+    uint8_t * U;
+    sa_sint_t * A;
+    sa_sint_t n;
+};
 
-static void libsais_bwt_copy_8u_omp(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A, sa_sint_t n, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = ((fast_sint_t)n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)n - omp_block_start;
-    #else
-        UNUSED(threads);
+static void libsais_bwt_copy_8u_omp_region(void * arg) {
+    struct libsais_bwt_copy_8u_omp_args * a = arg;
+    uint8_t * RESTRICT U = a->U;
+    sa_sint_t * RESTRICT A = a->A;
+    sa_sint_t n = a->n;
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n;
-    #endif
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = ((fast_sint_t)n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)n - omp_block_start;
 
-        libsais_bwt_copy_8u(U + omp_block_start, A + omp_block_start, (sa_sint_t)omp_block_size);
-    }
+    libsais_bwt_copy_8u(U + omp_block_start, A + omp_block_start, (sa_sint_t)omp_block_size);
 }
 
-#endif
+static void libsais_bwt_copy_8u_omp(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A, sa_sint_t n, sa_sint_t threads) {
+    struct libsais_bwt_copy_8u_omp_args a = { U, A, n };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais_bwt_copy_8u_omp_region, &a);
+}
 
 void * libsais_create_ctx(void) { return (void *)libsais_create_ctx_main(1); }
 
@@ -8498,14 +8638,12 @@ int32_t libsais_ctx(const void * ctx, const uint8_t * T, int32_t * SA, int32_t n
     return libsais_main_ctx((const LIBSAIS_CONTEXT *)ctx, T, SA, n, 0, 0, NULL, fs, freq);
 }
 
-#if defined(_OPENMP)
-
 void * libsais_create_ctx_omp(int32_t threads) {
     if (threads < 0) {
         return NULL;
     }
 
-    threads = threads > 0 ? threads : omp_get_max_threads();
+    threads = threads > 0 ? threads : pool_threads();
     return (void *)libsais_create_ctx_main(threads);
 }
 
@@ -8525,7 +8663,7 @@ int32_t libsais_omp(const uint8_t * T, int32_t * SA, int32_t n, int32_t fs, int3
         return 0;
     }
 
-    threads = threads > 0 ? threads : omp_get_max_threads();
+    threads = threads > 0 ? threads : pool_threads();
 
     return libsais_main(T, SA, n, 0, 0, NULL, fs, freq, threads);
 }
@@ -8540,9 +8678,8 @@ int32_t libsais_int_omp(int32_t * T, int32_t * SA, int32_t n, int32_t k, int32_t
         return 0;
     }
 
-    threads = threads > 0 ? threads : omp_get_max_threads();
+    threads = threads > 0 ? threads : pool_threads();
 
     return libsais_main_int(T, SA, n, k, fs, threads);
 }
 
-#endif
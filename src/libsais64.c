@@ -22,6 +22,7 @@ Please see the file 3rdparty/libsais-LICENSE for full copyright information.
 --*/
 
 #include "libsais64.h"
+#include "pool.h"
 
 #include <limits.h>
 #include <stddef.h>
@@ -31,12 +32,6 @@ Please see the file 3rdparty/libsais-LICENSE for full copyright information.
 
 #include "libsais.h"
 
-#if defined(_OPENMP)
-    #include <omp.h>
-#else
-    #define UNUSED(_x) (void)(_x)
-#endif
-
 typedef int64_t sa_sint_t;
 typedef uint64_t sa_uint_t;
 typedef int64_t fast_sint_t;
@@ -220,8 +215,6 @@ static void libsais64_free_thread_state(LIBSAIS_THREAD_STATE * thread_state) {
     }
 }
 
-#if defined(_OPENMP)
-
 static sa_sint_t libsais64_count_negative_marked_suffixes(sa_sint_t * RESTRICT SA, fast_sint_t omp_block_start,
                                                           fast_sint_t omp_block_size) {
     sa_sint_t count = 0;
@@ -432,8 +425,6 @@ static void libsais64_accumulate_counts_s32(sa_sint_t * RESTRICT buckets, fast_s
     }
 }
 
-#endif
-
 static void libsais64_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                              fast_sint_t m, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
     if (omp_block_size > 0) {
@@ -480,48 +471,51 @@ static void libsais64_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint
     }
 }
 
-static void libsais64_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                 sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1, omp_block_start, omp_block_size);
+struct libsais64_gather_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_gather_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais64_gather_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t t, m = 0;
+        for (t = omp_num_threads - 1; t > omp_thread_num; --t) {
+            m += thread_state[t].state.m;
         }
-#if defined(_OPENMP)
-        else {
-            fast_sint_t t, m = 0;
-            for (t = omp_num_threads - 1; t > omp_thread_num; --t) {
-                m += thread_state[t].state.m;
-            }
 
-            libsais64_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1 - m, omp_block_start, omp_block_size);
+        libsais64_gather_lms_suffixes_8u(T, SA, n, (fast_sint_t)n - 1 - m, omp_block_start, omp_block_size);
 
-    #pragma omp barrier
+        pool_barrier();
 
-            if (thread_state[omp_thread_num].state.m > 0) {
-                SA[(fast_sint_t)n - 1 - m] = (sa_sint_t)thread_state[omp_thread_num].state.last_lms_suffix;
-            }
+        if (thread_state[omp_thread_num].state.m > 0) {
+            SA[(fast_sint_t)n - 1 - m] = (sa_sint_t)thread_state[omp_thread_num].state.last_lms_suffix;
         }
-#endif
     }
 }
 
+static void libsais64_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                 sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_gather_lms_suffixes_8u_omp_args a = { T, SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_gather_lms_suffixes_8u_omp_region, &a);
+}
+
 static sa_sint_t libsais64_gather_lms_suffixes_32s(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n) {
     const fast_sint_t prefetch_distance = 32;
 
@@ -605,8 +599,6 @@ static sa_sint_t libsais64_gather_compacted_lms_suffixes_32s(const sa_sint_t * R
     return n - 1 - m;
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_count_lms_suffixes_32s_4k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                                 sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -653,8 +645,6 @@ static void libsais64_count_lms_suffixes_32s_4k(const sa_sint_t * RESTRICT T, sa
     buckets[BUCKETS_INDEX4((fast_uint_t)c0, (s << 1) & 3)]++;
 }
 
-#endif
-
 static void libsais64_count_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                                 sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -701,8 +691,6 @@ static void libsais64_count_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa
     buckets[BUCKETS_INDEX2((fast_uint_t)c0, 0)]++;
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_count_compacted_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT T, sa_sint_t n, sa_sint_t k,
                                                           sa_sint_t * RESTRICT buckets) {
     const fast_sint_t prefetch_distance = 32;
@@ -755,8 +743,6 @@ static void libsais64_count_compacted_lms_suffixes_32s_2k(const sa_sint_t * REST
     buckets[BUCKETS_INDEX2((fast_uint_t)c0, 0)]++;
 }
 
-#endif
-
 static sa_sint_t libsais64_count_and_gather_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                             sa_sint_t n, sa_sint_t * RESTRICT buckets,
                                                             fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -822,75 +808,81 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_8u(const uint8_t * REST
     return (sa_sint_t)(omp_block_start + omp_block_size - 1 - m);
 }
 
-static sa_sint_t libsais64_count_and_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
-                                                                sa_sint_t n, sa_sint_t * RESTRICT buckets,
-                                                                sa_sint_t threads,
-                                                                LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t m = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais64_count_and_gather_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais64_count_and_gather_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_lms_suffixes_8u(T, SA, n, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.m = libsais64_count_and_gather_lms_suffixes_8u(
+                T, SA, n, thread_state[omp_thread_num].state.buckets, omp_block_start, omp_block_size);
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_lms_suffixes_8u(T, SA, n, buckets, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.m = libsais64_count_and_gather_lms_suffixes_8u(
-                    T, SA, n, thread_state[omp_thread_num].state.buckets, omp_block_start, omp_block_size);
-
-                if (thread_state[omp_thread_num].state.m > 0) {
-                    thread_state[omp_thread_num].state.last_lms_suffix =
-                        SA[thread_state[omp_thread_num].state.position - 1];
-                }
+            if (thread_state[omp_thread_num].state.m > 0) {
+                thread_state[omp_thread_num].state.last_lms_suffix =
+                    SA[thread_state[omp_thread_num].state.position - 1];
             }
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                memset(buckets, 0, 4 * ALPHABET_SIZE * sizeof(sa_sint_t));
+        if (omp_thread_num == 0) {
+            memset(buckets, 0, 4 * ALPHABET_SIZE * sizeof(sa_sint_t));
 
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.m;
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.m;
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.m > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.m],
-                               (size_t)thread_state[t].state.m * sizeof(sa_sint_t));
-                    }
+                if (t != omp_num_threads - 1 && thread_state[t].state.m > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.m],
+                           (size_t)thread_state[t].state.m * sizeof(sa_sint_t));
+                }
 
-                    {
-                        sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                        fast_sint_t s;
-                        for (s = 0; s < 4 * ALPHABET_SIZE; s += 1) {
-                            sa_sint_t A = buckets[s], B = temp_bucket[s];
-                            buckets[s] = A + B;
-                            temp_bucket[s] = A;
-                        }
+                {
+                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                    fast_sint_t s;
+                    for (s = 0; s < 4 * ALPHABET_SIZE; s += 1) {
+                        sa_sint_t A = buckets[s], B = temp_bucket[s];
+                        buckets[s] = A + B;
+                        temp_bucket[s] = A;
                     }
                 }
             }
         }
-#endif
     }
+}
+
+static sa_sint_t libsais64_count_and_gather_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+                                                                sa_sint_t n, sa_sint_t * RESTRICT buckets,
+                                                                sa_sint_t threads,
+                                                                LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t m = 0;
+
+    struct libsais64_count_and_gather_lms_suffixes_8u_omp_args a = { T, SA, n, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_count_and_gather_lms_suffixes_8u_omp_region, &a);
+    m = a.m;
 
     return m;
 }
@@ -1115,8 +1107,6 @@ static sa_sint_t libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(const
     return (sa_sint_t)(omp_block_start + omp_block_size - 1 - m);
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais64_get_bucket_stride(fast_sint_t free_space, fast_sint_t bucket_size,
                                                fast_sint_t num_buckets) {
     fast_sint_t bucket_size_1024 = (bucket_size + 1023) & (-1024);
@@ -1131,209 +1121,258 @@ static fast_sint_t libsais64_get_bucket_stride(fast_sint_t free_space, fast_sint
     return bucket_size;
 }
 
-static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp(const sa_sint_t * RESTRICT T,
-                                                                       sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                                       sa_sint_t k, sa_sint_t * RESTRICT buckets,
-                                                                       sa_sint_t threads,
-                                                                       LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t m = 0;
-
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 4 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 4 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
-
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais64_count_and_gather_lms_suffixes_32s_4k(
-                    T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais64_count_and_gather_lms_suffixes_32s_4k(
+                T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            if (omp_thread_num == omp_num_threads - 1) {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
+        if (omp_thread_num == omp_num_threads - 1) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.count;
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.count],
-                               (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.count],
+                           (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
-            } else {
-                omp_num_threads = omp_num_threads - 1;
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
-
-                libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                                omp_num_threads + 1);
             }
+        } else {
+            omp_num_threads = omp_num_threads - 1;
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+
+            libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                            omp_num_threads + 1);
         }
-    #endif
     }
-
-    return m;
 }
 
-static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp(const sa_sint_t * RESTRICT T,
+static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp(const sa_sint_t * RESTRICT T,
                                                                        sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                        sa_sint_t k, sa_sint_t * RESTRICT buckets,
                                                                        sa_sint_t threads,
                                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m = 0;
 
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp_args a = { T, SA, n, k, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp_region,
+                  &a);
+    m = a.m;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 2 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
-
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais64_count_and_gather_lms_suffixes_32s_2k(
-                    T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
+    return m;
+}
 
-        #pragma omp barrier
+struct libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start, omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 2 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n], bucket_size, omp_num_threads);
 
-            if (omp_thread_num == omp_num_threads - 1) {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais64_count_and_gather_lms_suffixes_32s_2k(
+                T, SA, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
+        }
 
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memcpy(&SA[n - m], &SA[thread_state[t].state.position - thread_state[t].state.count],
-                               (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+        pool_barrier();
+
+        if (omp_thread_num == omp_num_threads - 1) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                a->m += (sa_sint_t)thread_state[t].state.count;
+
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memcpy(&SA[n - a->m], &SA[thread_state[t].state.position - thread_state[t].state.count],
+                           (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
-            } else {
-                omp_num_threads = omp_num_threads - 1;
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
-
-                libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                                omp_num_threads + 1);
             }
+        } else {
+            omp_num_threads = omp_num_threads - 1;
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+
+            libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                            omp_num_threads + 1);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp(const sa_sint_t * RESTRICT T,
+                                                                       sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                                       sa_sint_t k, sa_sint_t * RESTRICT buckets,
+                                                                       sa_sint_t threads,
+                                                                       LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t m = 0;
+
+    struct libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp_args a = { T, SA, n, k, buckets, thread_state, m };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp_region,
+                  &a);
+    m = a.m;
 
     return m;
 }
 
-static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k, sa_sint_t * RESTRICT buckets,
-    sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start,
+                                                                 omp_block_size);
+    } else {
+        fast_sint_t bucket_size = 2 * (fast_sint_t)k;
+        fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n + n], bucket_size, omp_num_threads);
 
-        if (omp_num_threads == 1) {
-            libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, omp_block_start,
-                                                                     omp_block_size);
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(
+                T, SA + n, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            fast_sint_t bucket_size = 2 * (fast_sint_t)k;
-            fast_sint_t bucket_stride = libsais64_get_bucket_stride(buckets - &SA[n + n], bucket_size, omp_num_threads);
-
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(
-                    T, SA + n, n, k, buckets - (omp_thread_num * bucket_stride), omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                fast_sint_t t, m = 0;
-                for (t = omp_num_threads - 1; t >= omp_thread_num; --t) {
-                    m += (sa_sint_t)thread_state[t].state.count;
-                }
+        {
+            fast_sint_t t, m = 0;
+            for (t = omp_num_threads - 1; t >= omp_thread_num; --t) {
+                m += (sa_sint_t)thread_state[t].state.count;
+            }
 
-                if (thread_state[omp_thread_num].state.count > 0) {
-                    memcpy(
-                        &SA[n - m],
-                        &SA[n + thread_state[omp_thread_num].state.position - thread_state[omp_thread_num].state.count],
-                        (size_t)thread_state[omp_thread_num].state.count * sizeof(sa_sint_t));
-                }
+            if (thread_state[omp_thread_num].state.count > 0) {
+                memcpy(
+                    &SA[n - m],
+                    &SA[n + thread_state[omp_thread_num].state.position - thread_state[omp_thread_num].state.count],
+                    (size_t)thread_state[omp_thread_num].state.count * sizeof(sa_sint_t));
             }
+        }
 
-            {
-                omp_block_stride = (bucket_size / omp_num_threads) & (-16);
-                omp_block_start = omp_thread_num * omp_block_stride;
-                omp_block_size =
-                    omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
+        {
+            omp_block_stride = (bucket_size / omp_num_threads) & (-16);
+            omp_block_start = omp_thread_num * omp_block_stride;
+            omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : bucket_size - omp_block_start;
 
-                libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
-                                                omp_num_threads);
-            }
+            libsais64_accumulate_counts_s32(buckets + omp_block_start, omp_block_size, bucket_stride,
+                                            omp_num_threads);
         }
-    #endif
     }
 }
 
-#endif
+static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k, sa_sint_t * RESTRICT buckets,
+    sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_args a = { T, SA, n, k, buckets,
+                                                                                      thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp_region, &a);
+}
+
+struct libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais64_count_lms_suffixes_32s_4k(T, n, k, buckets);
+    } else {
+        a->m = libsais64_gather_lms_suffixes_32s(T, SA, n);
+    }
+}
 
 static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                          sa_sint_t * RESTRICT SA, sa_sint_t n,
@@ -1341,66 +1380,84 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp(const s
                                                                          sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_lms_suffixes_32s_4k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais64_count_lms_suffixes_32s_4k(T, n, k, buckets);
-        } else {
-            m = libsais64_gather_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1, libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp_region,
+                  &a);
+    m = a.m;
 
     return m;
 }
 
+struct libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais64_count_lms_suffixes_32s_2k(T, n, k, buckets);
+    } else {
+        a->m = libsais64_gather_lms_suffixes_32s(T, SA, n);
+    }
+}
+
 static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                          sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                          sa_sint_t k, sa_sint_t * RESTRICT buckets,
                                                                          sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais64_count_lms_suffixes_32s_2k(T, n, k, buckets);
-        } else {
-            m = libsais64_gather_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1, libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp_region,
+                  &a);
+    m = a.m;
 
     return m;
 }
 
+struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t m;
+};
+
+static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_region(void * arg) {
+    struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        a->m = libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
+    } else if (omp_thread_num == 0) {
+        libsais64_count_compacted_lms_suffixes_32s_2k(T, n, k, buckets);
+    } else {
+        a->m = libsais64_gather_compacted_lms_suffixes_32s(T, SA, n);
+    }
+}
+
 static sa_sint_t libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp(const sa_sint_t * RESTRICT T,
                                                                                    sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                                    sa_sint_t k,
@@ -1408,29 +1465,10 @@ static sa_sint_t libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_o
                                                                                    sa_sint_t threads) {
     sa_sint_t m = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(2) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            m = libsais64_count_and_gather_compacted_lms_suffixes_32s_2k(T, SA, n, k, buckets, 0, n);
-        }
-#if defined(_OPENMP)
-        else if (omp_thread_num == 0) {
-            libsais64_count_compacted_lms_suffixes_32s_2k(T, n, k, buckets);
-        } else {
-            m = libsais64_gather_compacted_lms_suffixes_32s(T, SA, n);
-        }
-#endif
-    }
+    struct libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_args a = { T, SA, n, k, buckets, m };
+    pool_parallel(threads > 1 && n >= 65536 ? 2 : 1,
+                  libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp_region, &a);
+    m = a.m;
 
     return m;
 }
@@ -1441,7 +1479,6 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_omp(const sa_sin
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m;
 
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n]) / ((4 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1453,9 +1490,6 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_4k_omp(const sa_sin
         m = libsais64_count_and_gather_lms_suffixes_32s_4k_fs_omp(T, SA, n, k, buckets,
                                                                   max_threads > 2 ? max_threads : 2, thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         m = libsais64_count_and_gather_lms_suffixes_32s_4k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1469,7 +1503,6 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_2k_omp(const sa_sin
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t m;
 
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n]) / ((2 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1481,9 +1514,6 @@ static sa_sint_t libsais64_count_and_gather_lms_suffixes_32s_2k_omp(const sa_sin
         m = libsais64_count_and_gather_lms_suffixes_32s_2k_fs_omp(T, SA, n, k, buckets,
                                                                   max_threads > 2 ? max_threads : 2, thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         m = libsais64_count_and_gather_lms_suffixes_32s_2k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1496,7 +1526,6 @@ static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_omp(const s
                                                                          sa_sint_t k, sa_sint_t * RESTRICT buckets,
                                                                          sa_sint_t threads,
                                                                          LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
     sa_sint_t max_threads = (sa_sint_t)((buckets - &SA[n + n]) / ((2 * (fast_sint_t)k + 15) & (-16)));
     if (max_threads > threads) {
         max_threads = threads;
@@ -1508,9 +1537,6 @@ static void libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_omp(const s
         libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_fs_omp(
             T, SA, n, k, buckets, max_threads > 2 ? max_threads : 2, thread_state);
     } else
-#else
-    UNUSED(thread_state);
-#endif
     {
         libsais64_count_and_gather_compacted_lms_suffixes_32s_2k_nofs_omp(T, SA, n, k, buckets, threads);
     }
@@ -1774,56 +1800,64 @@ static void libsais64_radix_sort_lms_suffixes_8u(const uint8_t * RESTRICT T, sa_
     }
 }
 
-static void libsais64_radix_sort_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                     sa_sint_t m, sa_sint_t * RESTRICT buckets, sa_sint_t threads,
-                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536 && m >= 65536 && omp_get_dynamic() == 0)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais64_radix_sort_lms_suffixes_8u_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_radix_sort_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais64_radix_sort_lms_suffixes_8u_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    if (omp_num_threads == 1) {
+        libsais64_radix_sort_lms_suffixes_8u(T, SA, &buckets[4 * ALPHABET_SIZE],
+                                             (fast_sint_t)n - (fast_sint_t)m + 1, (fast_sint_t)m - 1);
+    } else {
+        {
+            sa_sint_t * RESTRICT src_bucket = &buckets[4 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT dst_bucket = thread_state[omp_thread_num].state.buckets;
 
-        fast_sint_t omp_num_threads = 1;
-#endif
-        if (omp_num_threads == 1) {
-            libsais64_radix_sort_lms_suffixes_8u(T, SA, &buckets[4 * ALPHABET_SIZE],
-                                                 (fast_sint_t)n - (fast_sint_t)m + 1, (fast_sint_t)m - 1);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                sa_sint_t * RESTRICT src_bucket = &buckets[4 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT dst_bucket = thread_state[omp_thread_num].state.buckets;
-
-                fast_sint_t i, j;
-                for (i = BUCKETS_INDEX2(0, 0), j = BUCKETS_INDEX4(0, 1); i <= BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0);
-                     i += BUCKETS_INDEX2(1, 0), j += BUCKETS_INDEX4(1, 0)) {
-                    dst_bucket[i] = src_bucket[i] - dst_bucket[j];
-                }
+            fast_sint_t i, j;
+            for (i = BUCKETS_INDEX2(0, 0), j = BUCKETS_INDEX4(0, 1); i <= BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0);
+                 i += BUCKETS_INDEX2(1, 0), j += BUCKETS_INDEX4(1, 0)) {
+                dst_bucket[i] = src_bucket[i] - dst_bucket[j];
             }
+        }
 
-            {
-                fast_sint_t t, omp_block_start = 0, omp_block_size = thread_state[omp_thread_num].state.m;
-                for (t = omp_num_threads - 1; t >= omp_thread_num; --t) omp_block_start += thread_state[t].state.m;
-
-                if (omp_block_start == (fast_sint_t)m && omp_block_size > 0) {
-                    omp_block_start -= 1;
-                    omp_block_size -= 1;
-                }
+        {
+            fast_sint_t t, omp_block_start = 0, omp_block_size = thread_state[omp_thread_num].state.m;
+            for (t = omp_num_threads - 1; t >= omp_thread_num; --t) omp_block_start += thread_state[t].state.m;
 
-                libsais64_radix_sort_lms_suffixes_8u(T, SA, thread_state[omp_thread_num].state.buckets,
-                                                     (fast_sint_t)n - omp_block_start, omp_block_size);
+            if (omp_block_start == (fast_sint_t)m && omp_block_size > 0) {
+                omp_block_start -= 1;
+                omp_block_size -= 1;
             }
+
+            libsais64_radix_sort_lms_suffixes_8u(T, SA, thread_state[omp_thread_num].state.buckets,
+                                                 (fast_sint_t)n - omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
+static void libsais64_radix_sort_lms_suffixes_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                     sa_sint_t m, sa_sint_t * RESTRICT buckets, sa_sint_t threads,
+                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_radix_sort_lms_suffixes_8u_omp_args a = { T, SA, n, m, buckets, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 && m >= 65536 && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_radix_sort_lms_suffixes_8u_omp_region, &a);
+}
+
 static void libsais64_radix_sort_lms_suffixes_32s_6k(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                      sa_sint_t * RESTRICT induction_bucket, fast_sint_t omp_block_start,
                                                      fast_sint_t omp_block_size) {
@@ -1894,8 +1928,6 @@ static void libsais64_radix_sort_lms_suffixes_32s_2k(const sa_sint_t * RESTRICT
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_radix_sort_lms_suffixes_32s_block_gather(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                LIBSAIS_THREAD_CACHE * RESTRICT cache,
                                                                fast_sint_t omp_block_start,
@@ -1976,111 +2008,121 @@ static void libsais64_radix_sort_lms_suffixes_32s_2k_block_sort(sa_sint_t * REST
     }
 }
 
-static void libsais64_radix_sort_lms_suffixes_32s_6k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
-                                                               sa_sint_t * RESTRICT induction_bucket,
-                                                               LIBSAIS_THREAD_CACHE * RESTRICT cache,
-                                                               fast_sint_t block_start, fast_sint_t block_size,
-                                                               sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
+struct libsais64_radix_sort_lms_suffixes_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+static void libsais64_radix_sort_lms_suffixes_32s_6k_block_omp_region(void * arg) {
+    struct libsais64_radix_sort_lms_suffixes_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
 
-        omp_block_start += block_start;
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
 
-        if (omp_num_threads == 1) {
-            libsais64_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                               omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                   omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais64_radix_sort_lms_suffixes_32s_6k_block_sort(induction_bucket, cache - block_start, block_start,
-                                                                    block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais64_radix_sort_lms_suffixes_32s_6k_block_sort(induction_bucket, cache - block_start, block_start,
+                                                                block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-static void libsais64_radix_sort_lms_suffixes_32s_2k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+static void libsais64_radix_sort_lms_suffixes_32s_6k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                sa_sint_t * RESTRICT induction_bucket,
                                                                LIBSAIS_THREAD_CACHE * RESTRICT cache,
                                                                fast_sint_t block_start, fast_sint_t block_size,
                                                                sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
+    struct libsais64_radix_sort_lms_suffixes_32s_6k_block_omp_args a = { T, SA, induction_bucket, cache, block_start,
+                                                                         block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_radix_sort_lms_suffixes_32s_6k_block_omp_region, &a);
+}
+
+struct libsais64_radix_sort_lms_suffixes_32s_2k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_radix_sort_lms_suffixes_32s_2k_block_omp_region(void * arg) {
+    struct libsais64_radix_sort_lms_suffixes_32s_2k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                               omp_block_size);
+        }
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+        pool_barrier();
 
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, omp_block_start, omp_block_size);
+        if (omp_thread_num == 0) {
+            libsais64_radix_sort_lms_suffixes_32s_2k_block_sort(induction_bucket, cache - block_start, block_start,
+                                                                block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_radix_sort_lms_suffixes_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                   omp_block_size);
-            }
-
-        #pragma omp barrier
 
-        #pragma omp master
-            {
-                libsais64_radix_sort_lms_suffixes_32s_2k_block_sort(induction_bucket, cache - block_start, block_start,
-                                                                    block_size);
-            }
-
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais64_radix_sort_lms_suffixes_32s_2k_block_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
+                                                               sa_sint_t * RESTRICT induction_bucket,
+                                                               LIBSAIS_THREAD_CACHE * RESTRICT cache,
+                                                               fast_sint_t block_start, fast_sint_t block_size,
+                                                               sa_sint_t threads) {
+    struct libsais64_radix_sort_lms_suffixes_32s_2k_block_omp_args a = { T, SA, induction_bucket, cache, block_start,
+                                                                         block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_radix_sort_lms_suffixes_32s_2k_block_omp_region, &a);
+}
 
 static void libsais64_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                          sa_sint_t n, sa_sint_t m,
@@ -2090,7 +2132,6 @@ static void libsais64_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTR
         libsais64_radix_sort_lms_suffixes_32s_6k(T, SA, induction_bucket, (fast_sint_t)n - (fast_sint_t)m + 1,
                                                  (fast_sint_t)m - 1);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < (fast_sint_t)m - 1; block_start = block_end) {
@@ -2104,9 +2145,6 @@ static void libsais64_radix_sort_lms_suffixes_32s_6k_omp(const sa_sint_t * RESTR
                                                                threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -2117,7 +2155,6 @@ static void libsais64_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTR
         libsais64_radix_sort_lms_suffixes_32s_2k(T, SA, induction_bucket, (fast_sint_t)n - (fast_sint_t)m + 1,
                                                  (fast_sint_t)m - 1);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < (fast_sint_t)m - 1; block_start = block_end) {
@@ -2131,9 +2168,6 @@ static void libsais64_radix_sort_lms_suffixes_32s_2k_omp(const sa_sint_t * RESTR
                                                                threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais64_radix_sort_lms_suffixes_32s_1k(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -2249,52 +2283,60 @@ static void libsais64_radix_sort_set_markers_32s_4k(sa_sint_t * RESTRICT SA, sa_
     }
 }
 
+struct libsais64_radix_sort_set_markers_32s_6k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * induction_bucket;
+};
+
+static void libsais64_radix_sort_set_markers_32s_6k_omp_region(void * arg) {
+    struct libsais64_radix_sort_set_markers_32s_6k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
+
+    libsais64_radix_sort_set_markers_32s_6k(SA, induction_bucket, omp_block_start, omp_block_size);
+}
+
 static void libsais64_radix_sort_set_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
                                                         sa_sint_t * RESTRICT induction_bucket, sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && k >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
-#else
-        UNUSED(threads);
+    struct libsais64_radix_sort_set_markers_32s_6k_omp_args a = { SA, k, induction_bucket };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais64_radix_sort_set_markers_32s_6k_omp_region, &a);
+}
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)k - 1;
-#endif
+struct libsais64_radix_sort_set_markers_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * induction_bucket;
+};
 
-        libsais64_radix_sort_set_markers_32s_6k(SA, induction_bucket, omp_block_start, omp_block_size);
-    }
+static void libsais64_radix_sort_set_markers_32s_4k_omp_region(void * arg) {
+    struct libsais64_radix_sort_set_markers_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
+
+    libsais64_radix_sort_set_markers_32s_4k(SA, induction_bucket, omp_block_start, omp_block_size);
 }
 
 static void libsais64_radix_sort_set_markers_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
                                                         sa_sint_t * RESTRICT induction_bucket, sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && k >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)k - 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)k - 1 - omp_block_start;
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)k - 1;
-#endif
-
-        libsais64_radix_sort_set_markers_32s_4k(SA, induction_bucket, omp_block_start, omp_block_size);
-    }
+    struct libsais64_radix_sort_set_markers_32s_4k_omp_args a = { SA, k, induction_bucket };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais64_radix_sort_set_markers_32s_4k_omp_region, &a);
 }
 
 static void libsais64_initialize_buckets_for_partial_sorting_8u(const uint8_t * RESTRICT T,
@@ -2413,8 +2455,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u(const uint8_t *
     return d;
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_partial_sorting_scan_left_to_right_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size,
@@ -2498,87 +2538,92 @@ static void libsais64_partial_sorting_scan_left_to_right_8u_block_place(sa_sint_
     }
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u_block_omp(
-    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_left_to_right_8u(T, SA, buckets, d, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
-            }
+struct libsais64_partial_sorting_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_partial_sorting_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_left_to_right_8u(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                sa_sint_t * RESTRICT induction_bucket = &buckets[4 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
+        if (omp_thread_num == 0) {
+            sa_sint_t * RESTRICT induction_bucket = &buckets[4 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
 
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
-                    sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
+                sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
 
-                    fast_sint_t c;
-                    for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_induction_bucket[c] = A;
-                    }
+                fast_sint_t c;
+                for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_induction_bucket[c] = A;
+                }
 
-                    for (d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + d;
-                        distinct_names[c] = B > 0 ? D : A;
-                        temp_distinct_names[c] = A;
-                    }
-                    d += 1 + (sa_sint_t)thread_state[t].state.position;
-                    thread_state[t].state.position = (fast_sint_t)d - thread_state[t].state.position;
+                for (a->d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + a->d;
+                    distinct_names[c] = B > 0 ? D : A;
+                    temp_distinct_names[c] = A;
                 }
+                a->d += 1 + (sa_sint_t)thread_state[t].state.position;
+                thread_state[t].state.position = (fast_sint_t)a->d - thread_state[t].state.position;
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_partial_sorting_scan_left_to_right_8u_block_place(
-                    SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
-            }
+        {
+            libsais64_partial_sorting_scan_left_to_right_8u_block_place(
+                SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u_block_omp(
+    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_partial_sorting_scan_left_to_right_8u_block_omp_args a = { T, SA, buckets, d, block_start,
+                                                                                block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_partial_sorting_scan_left_to_right_8u_block_omp_region, &a);
+    d = a.d;
 
     return d;
 }
 
-#endif
-
 static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u_omp(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t * RESTRICT buckets,
     sa_sint_t left_suffixes_count, sa_sint_t d, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
@@ -2591,7 +2636,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u_omp(
     if (threads == 1 || left_suffixes_count < 65536) {
         d = libsais64_partial_sorting_scan_left_to_right_8u(T, SA, buckets, d, 0, left_suffixes_count);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < left_suffixes_count;) {
@@ -2626,9 +2670,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_8u_omp(
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -2813,8 +2854,6 @@ static void libsais64_partial_sorting_scan_left_to_right_32s_1k(const sa_sint_t
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_partial_sorting_scan_left_to_right_32s_6k_block_gather(const sa_sint_t * RESTRICT T,
                                                                              sa_sint_t * RESTRICT SA,
                                                                              LIBSAIS_THREAD_CACHE * RESTRICT cache,
@@ -3172,162 +3211,186 @@ static void libsais64_partial_sorting_scan_left_to_right_32s_1k_block_sort(const
     }
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, d, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, a->d, omp_block_start,
+                                                                   omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_left_to_right_32s_6k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_left_to_right_32s_6k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                d = libsais64_partial_sorting_scan_left_to_right_32s_6k_block_sort(T, buckets, d, cache - block_start,
-                                                                                   block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            a->d = libsais64_partial_sorting_scan_left_to_right_32s_6k_block_sort(T, buckets, a->d, cache - block_start,
+                                                                                  block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
-
-    return d;
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, d, omp_block_start,
-                                                                    omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_left_to_right_32s_4k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
+    struct libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp_args a = { T, SA, buckets, d, cache,
+                                                                                    block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_left_to_right_32s_6k_block_omp_region, &a);
+    d = a.d;
 
-        #pragma omp barrier
+    return d;
+}
 
-        #pragma omp master
-            {
-                d = libsais64_partial_sorting_scan_left_to_right_32s_4k_block_sort(
-                    T, k, buckets, d, cache - block_start, block_start, block_size);
-            }
+struct libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, a->d, omp_block_start,
+                                                                   omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_left_to_right_32s_4k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+        if (omp_thread_num == 0) {
+            a->d = libsais64_partial_sorting_scan_left_to_right_32s_4k_block_sort(T, k, buckets, a->d,
+                                                                                  cache - block_start, block_start,
+                                                                                  block_size);
         }
-    #endif
-    }
 
-    return d;
+        pool_barrier();
+
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+    }
 }
 
-static void libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+    struct libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp_args a = { T, SA, k, buckets, d, cache,
+                                                                                    block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_left_to_right_32s_4k_block_omp_region, &a);
+    d = a.d;
 
-        omp_block_start += block_start;
+    return d;
+}
 
-        if (omp_num_threads == 1) {
-            libsais64_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_left_to_right_32s_1k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_left_to_right_32s_1k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais64_partial_sorting_scan_left_to_right_32s_1k_block_sort(T, buckets, cache - block_start,
-                                                                               block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais64_partial_sorting_scan_left_to_right_32s_1k_block_sort(T, buckets, cache - block_start,
+                                                                           block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
+    struct libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                                    block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_left_to_right_32s_1k_block_omp_region, &a);
+}
 
 static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_6k_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t * RESTRICT buckets,
@@ -3338,7 +3401,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_6k_omp(
     if (threads == 1 || left_suffixes_count < 65536) {
         d = libsais64_partial_sorting_scan_left_to_right_32s_6k(T, SA, buckets, d, 0, left_suffixes_count);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < left_suffixes_count; block_start = block_end) {
@@ -3351,9 +3413,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_6k_omp(
                 T, SA, buckets, d, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -3373,7 +3432,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_4k_omp(const s
     if (threads == 1 || n < 65536) {
         d = libsais64_partial_sorting_scan_left_to_right_32s_4k(T, SA, k, buckets, d, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -3386,9 +3444,6 @@ static sa_sint_t libsais64_partial_sorting_scan_left_to_right_32s_4k_omp(const s
                 T, SA, k, buckets, d, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -3402,7 +3457,6 @@ static void libsais64_partial_sorting_scan_left_to_right_32s_1k_omp(const sa_sin
     if (threads == 1 || n < 65536) {
         libsais64_partial_sorting_scan_left_to_right_32s_1k(T, SA, buckets, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -3415,26 +3469,29 @@ static void libsais64_partial_sorting_scan_left_to_right_32s_1k_omp(const sa_sin
                 T, SA, buckets, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
-static void libsais64_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                           const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+struct libsais64_partial_sorting_shift_markers_8u_omp_args {
+    sa_sint_t * SA;
+    const sa_sint_t * buckets;
+};
+
+static void libsais64_partial_sorting_shift_markers_8u_omp_region(void * arg) {
+    struct libsais64_partial_sorting_shift_markers_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    const sa_sint_t * RESTRICT buckets = a->buckets;
+
     const fast_sint_t prefetch_distance = 32;
 
     const sa_sint_t * RESTRICT temp_bucket = &buckets[4 * ALPHABET_SIZE];
 
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && n >= 65536)
-#else
-    UNUSED(threads);
-    UNUSED(n);
-#endif
-    for (c = BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0); c >= BUCKETS_INDEX2(1, 0); c -= BUCKETS_INDEX2(1, 0)) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = BUCKETS_INDEX2(ALPHABET_SIZE - 1, 0) - omp_thread_num * BUCKETS_INDEX2(1, 0); c >= BUCKETS_INDEX2(1, 0);
+         c -= omp_num_threads * BUCKETS_INDEX2(1, 0)) {
         fast_sint_t i, j;
         sa_sint_t s = SAINT_MIN;
         for (i = (fast_sint_t)temp_bucket[c] - 1, j = (fast_sint_t)buckets[c - BUCKETS_INDEX2(1, 0)] + 3; i >= j;
@@ -3463,20 +3520,34 @@ static void libsais64_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT
     }
 }
 
-static void libsais64_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
-                                                               const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+static void libsais64_partial_sorting_shift_markers_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                           const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+    struct libsais64_partial_sorting_shift_markers_8u_omp_args a = { SA, buckets };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_partial_sorting_shift_markers_8u_omp_region, &a);
+}
+
+struct libsais64_partial_sorting_shift_markers_32s_6k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    const sa_sint_t * buckets;
+};
+
+static void libsais64_partial_sorting_shift_markers_32s_6k_omp_region(void * arg) {
+    struct libsais64_partial_sorting_shift_markers_32s_6k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    const sa_sint_t * RESTRICT buckets = a->buckets;
+
     const fast_sint_t prefetch_distance = 32;
 
     const sa_sint_t * RESTRICT temp_bucket = &buckets[4 * k];
 
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && k >= 65536)
-#else
-    UNUSED(threads);
-#endif
-    for (c = (fast_sint_t)k - 1; c >= 1; c -= 1) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = (fast_sint_t)k - 1 - omp_thread_num * 1; c >= 1; c -= omp_num_threads * 1) {
         fast_sint_t i, j;
         sa_sint_t s = SAINT_MIN;
         for (i = (fast_sint_t)buckets[BUCKETS_INDEX4(c, 0)] - 1,
@@ -3506,6 +3577,13 @@ static void libsais64_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTR
     }
 }
 
+static void libsais64_partial_sorting_shift_markers_32s_6k_omp(sa_sint_t * RESTRICT SA, sa_sint_t k,
+                                                               const sa_sint_t * RESTRICT buckets, sa_sint_t threads) {
+    struct libsais64_partial_sorting_shift_markers_32s_6k_omp_args a = { SA, k, buckets };
+    pool_parallel(threads > 1 && k >= 65536 ? threads : 1, libsais64_partial_sorting_shift_markers_32s_6k_omp_region,
+                  &a);
+}
+
 static void libsais64_partial_sorting_shift_markers_32s_4k(sa_sint_t * RESTRICT SA, sa_sint_t n) {
     const fast_sint_t prefetch_distance = 32;
 
@@ -3594,8 +3672,6 @@ static sa_sint_t libsais64_partial_sorting_scan_right_to_left_8u(const uint8_t *
     return d;
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_partial_sorting_scan_right_to_left_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size,
@@ -3679,87 +3755,92 @@ static void libsais64_partial_sorting_scan_right_to_left_8u_block_place(sa_sint_
     }
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_right_to_left_8u_block_omp(
-    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_right_to_left_8u(T, SA, buckets, d, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
-            }
+struct libsais64_partial_sorting_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_partial_sorting_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_right_to_left_8u(T, SA, buckets, a->d, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size, &thread_state[omp_thread_num]);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
-                sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
+        if (omp_thread_num == 0) {
+            sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
+            sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
 
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
-                    sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_induction_bucket = &thread_state[t].state.buckets[0 * ALPHABET_SIZE];
+                sa_sint_t * RESTRICT temp_distinct_names = &thread_state[t].state.buckets[2 * ALPHABET_SIZE];
 
-                    fast_sint_t c;
-                    for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_induction_bucket[c] = A;
-                    }
+                fast_sint_t c;
+                for (c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_induction_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_induction_bucket[c] = A;
+                }
 
-                    for (d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + d;
-                        distinct_names[c] = B > 0 ? D : A;
-                        temp_distinct_names[c] = A;
-                    }
-                    d += 1 + (sa_sint_t)thread_state[t].state.position;
-                    thread_state[t].state.position = (fast_sint_t)d - thread_state[t].state.position;
+                for (a->d -= 1, c = 0; c < 2 * ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = distinct_names[c], B = temp_distinct_names[c], D = B + a->d;
+                    distinct_names[c] = B > 0 ? D : A;
+                    temp_distinct_names[c] = A;
                 }
+                a->d += 1 + (sa_sint_t)thread_state[t].state.position;
+                thread_state[t].state.position = (fast_sint_t)a->d - thread_state[t].state.position;
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_partial_sorting_scan_right_to_left_8u_block_place(
-                    SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
-            }
+        {
+            libsais64_partial_sorting_scan_right_to_left_8u_block_place(
+                SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count, (sa_sint_t)thread_state[omp_thread_num].state.position);
         }
-    #endif
     }
+}
+
+static sa_sint_t libsais64_partial_sorting_scan_right_to_left_8u_block_omp(
+    const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+    fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads, LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_partial_sorting_scan_right_to_left_8u_block_omp_args a = { T, SA, buckets, d, block_start,
+                                                                                block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_partial_sorting_scan_right_to_left_8u_block_omp_region, &a);
+    d = a.d;
 
     return d;
 }
 
-#endif
-
 static void libsais64_partial_sorting_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                 sa_sint_t n, sa_sint_t * RESTRICT buckets,
                                                                 sa_sint_t first_lms_suffix,
@@ -3772,7 +3853,6 @@ static void libsais64_partial_sorting_scan_right_to_left_8u_omp(const uint8_t *
     if (threads == 1 || (scan_end - scan_start) < 65536) {
         libsais64_partial_sorting_scan_right_to_left_8u(T, SA, buckets, d, scan_start, scan_end - scan_start);
     }
-#if defined(_OPENMP)
     else {
         sa_sint_t * RESTRICT induction_bucket = &buckets[0 * ALPHABET_SIZE];
         sa_sint_t * RESTRICT distinct_names = &buckets[2 * ALPHABET_SIZE];
@@ -3810,9 +3890,6 @@ static void libsais64_partial_sorting_scan_right_to_left_8u_omp(const uint8_t *
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k(const sa_sint_t * RESTRICT T,
@@ -3989,8 +4066,6 @@ static void libsais64_partial_sorting_scan_right_to_left_32s_1k(const sa_sint_t
     }
 }
 
-#if defined(_OPENMP)
-
 static void libsais64_partial_sorting_scan_right_to_left_32s_6k_block_gather(const sa_sint_t * RESTRICT T,
                                                                              sa_sint_t * RESTRICT SA,
                                                                              LIBSAIS_THREAD_CACHE * RESTRICT cache,
@@ -4336,162 +4411,186 @@ static void libsais64_partial_sorting_scan_right_to_left_32s_1k_block_sort(const
     }
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
-    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, d, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, a->d, omp_block_start,
+                                                                   omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_right_to_left_32s_6k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_right_to_left_32s_6k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                d = libsais64_partial_sorting_scan_right_to_left_32s_6k_block_sort(T, buckets, d, cache - block_start,
-                                                                                   block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            a->d = libsais64_partial_sorting_scan_right_to_left_32s_6k_block_sort(T, buckets, a->d, cache - block_start,
+                                                                                  block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
-
-    return d;
 }
 
-static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
+static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            d = libsais64_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, d, omp_block_start,
-                                                                    omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_right_to_left_32s_4k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
+    struct libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp_args a = { T, SA, buckets, d, cache,
+                                                                                    block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_right_to_left_32s_6k_block_omp_region, &a);
+    d = a.d;
 
-        #pragma omp barrier
+    return d;
+}
 
-        #pragma omp master
-            {
-                d = libsais64_partial_sorting_scan_right_to_left_32s_4k_block_sort(
-                    T, k, buckets, d, cache - block_start, block_start, block_size);
-            }
+struct libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * buckets;
+    sa_sint_t d;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        a->d = libsais64_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, a->d, omp_block_start,
+                                                                   omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_right_to_left_32s_4k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+        if (omp_thread_num == 0) {
+            a->d = libsais64_partial_sorting_scan_right_to_left_32s_4k_block_sort(T, k, buckets, a->d,
+                                                                                  cache - block_start, block_start,
+                                                                                  block_size);
         }
-    #endif
-    }
 
-    return d;
+        pool_barrier();
+
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
+    }
 }
 
-static void libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t k, sa_sint_t * RESTRICT buckets, sa_sint_t d,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+    struct libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp_args a = { T, SA, k, buckets, d, cache,
+                                                                                    block_start, block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_right_to_left_32s_4k_block_omp_region, &a);
+    d = a.d;
 
-        omp_block_start += block_start;
+    return d;
+}
 
-        if (omp_num_threads == 1) {
-            libsais64_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp_region(void * arg) {
+    struct libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_partial_sorting_scan_right_to_left_32s_1k_block_gather(T, SA, cache - block_start,
+                                                                             omp_block_start, omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_partial_sorting_scan_right_to_left_32s_1k_block_gather(T, SA, cache - block_start,
-                                                                                 omp_block_start, omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais64_partial_sorting_scan_right_to_left_32s_1k_block_sort(T, buckets, cache - block_start,
-                                                                               block_start, block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais64_partial_sorting_scan_right_to_left_32s_1k_block_sort(T, buckets, cache - block_start,
+                                                                           block_start, block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
+    struct libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                                    block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_partial_sorting_scan_right_to_left_32s_1k_block_omp_region, &a);
+}
 
 static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t * RESTRICT buckets,
@@ -4503,7 +4602,6 @@ static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k_omp(
     if (threads == 1 || (scan_end - scan_start) < 65536) {
         d = libsais64_partial_sorting_scan_right_to_left_32s_6k(T, SA, buckets, d, scan_start, scan_end - scan_start);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = scan_end - 1; block_start >= scan_start; block_start = block_end) {
@@ -4516,9 +4614,6 @@ static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_6k_omp(
                 T, SA, buckets, d, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -4531,7 +4626,6 @@ static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_4k_omp(const s
     if (threads == 1 || n < 65536) {
         d = libsais64_partial_sorting_scan_right_to_left_32s_4k(T, SA, k, buckets, d, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -4544,9 +4638,6 @@ static sa_sint_t libsais64_partial_sorting_scan_right_to_left_32s_4k_omp(const s
                 T, SA, k, buckets, d, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return d;
 }
@@ -4558,7 +4649,6 @@ static void libsais64_partial_sorting_scan_right_to_left_32s_1k_omp(const sa_sin
     if (threads == 1 || n < 65536) {
         libsais64_partial_sorting_scan_right_to_left_32s_1k(T, SA, buckets, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -4571,9 +4661,6 @@ static void libsais64_partial_sorting_scan_right_to_left_32s_1k_omp(const sa_sin
                 T, SA, buckets, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static fast_sint_t libsais64_partial_sorting_gather_lms_suffixes_32s_4k(sa_sint_t * RESTRICT SA,
@@ -4640,110 +4727,110 @@ static fast_sint_t libsais64_partial_sorting_gather_lms_suffixes_32s_1k(sa_sint_
     return l;
 }
 
-static void libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                                     sa_sint_t threads,
-                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp_region(void * arg) {
+    struct libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start;
+            thread_state[omp_thread_num].state.count =
+                libsais64_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size) -
+                omp_block_start;
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start;
-                thread_state[omp_thread_num].state.count =
-                    libsais64_partial_sorting_gather_lms_suffixes_32s_4k(SA, omp_block_start, omp_block_size) -
-                    omp_block_start;
-            }
-
-    #pragma omp barrier
 
-    #pragma omp master
-            {
-                fast_sint_t t, position = 0;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    if (t > 0 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
+        pool_barrier();
 
-                    position += thread_state[t].state.count;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = 0;
+            for (t = 0; t < omp_num_threads; ++t) {
+                if (t > 0 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
+
+                position += thread_state[t].state.count;
             }
         }
-#endif
     }
 }
 
-static void libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+static void libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                                      sa_sint_t threads,
                                                                      LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+    struct libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp_args a = { SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais64_partial_sorting_gather_lms_suffixes_32s_4k_omp_region, &a);
+}
 
-        if (omp_num_threads == 1) {
-            libsais64_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size);
+struct libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp_region(void * arg) {
+    struct libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position = omp_block_start;
+            thread_state[omp_thread_num].state.count =
+                libsais64_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size) -
+                omp_block_start;
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position = omp_block_start;
-                thread_state[omp_thread_num].state.count =
-                    libsais64_partial_sorting_gather_lms_suffixes_32s_1k(SA, omp_block_start, omp_block_size) -
-                    omp_block_start;
-            }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                fast_sint_t t, position = 0;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    if (t > 0 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
-
-                    position += thread_state[t].state.count;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = 0;
+            for (t = 0; t < omp_num_threads; ++t) {
+                if (t > 0 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
+
+                position += thread_state[t].state.count;
             }
         }
-#endif
     }
 }
 
+static void libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                                     sa_sint_t threads,
+                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp_args a = { SA, n, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1,
+                  libsais64_partial_sorting_gather_lms_suffixes_32s_1k_omp_region, &a);
+}
+
 static void libsais64_induce_partial_order_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                   sa_sint_t * RESTRICT buckets, sa_sint_t first_lms_suffix,
                                                   sa_sint_t left_suffixes_count, sa_sint_t threads,
@@ -4877,118 +4964,123 @@ static fast_sint_t libsais64_gather_marked_suffixes_8u(sa_sint_t * RESTRICT SA,
     return l;
 }
 
+struct libsais64_renumber_lms_suffixes_8u_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t name;
+};
+
+static void libsais64_renumber_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais64_renumber_lms_suffixes_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->name = libsais64_renumber_lms_suffixes_8u(SA, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais64_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
+
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
+            }
+
+            libsais64_renumber_lms_suffixes_8u(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
+        }
+    }
+}
+
 static sa_sint_t libsais64_renumber_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
                                                         LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
     sa_sint_t name = 0;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais64_renumber_lms_suffixes_8u_omp_args a = { SA, m, thread_state, name };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais64_renumber_lms_suffixes_8u_omp_region, &a);
+    name = a.name;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+    return name;
+}
 
-        if (omp_num_threads == 1) {
-            name = libsais64_renumber_lms_suffixes_8u(SA, m, 0, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
+struct libsais64_gather_marked_lms_suffixes_8u_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t fs;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_gather_marked_lms_suffixes_8u_omp_region(void * arg) {
+    struct libsais64_gather_marked_lms_suffixes_8u_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t fs = a->fs;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_gather_marked_suffixes_8u(SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start,
+                                            omp_block_size);
+    } else {
+        {
+            if (omp_thread_num < omp_num_threads - 1) {
+                thread_state[omp_thread_num].state.position = libsais64_gather_marked_suffixes_8u(
+                    SA, m, (fast_sint_t)m + omp_block_start + omp_block_size, omp_block_start, omp_block_size);
+                thread_state[omp_thread_num].state.count =
+                    (fast_sint_t)m + omp_block_start + omp_block_size - thread_state[omp_thread_num].state.position;
+            } else {
+                thread_state[omp_thread_num].state.position = libsais64_gather_marked_suffixes_8u(
+                    SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
                 thread_state[omp_thread_num].state.count =
-                    libsais64_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
+                    (fast_sint_t)n + (fast_sint_t)fs - thread_state[omp_thread_num].state.position;
             }
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position = (fast_sint_t)n + (fast_sint_t)fs;
 
-                if (omp_thread_num == omp_num_threads - 1) {
-                    name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                position -= thread_state[t].state.count;
+                if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
+                    memmove(&SA[position], &SA[thread_state[t].state.position],
+                            (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
                 }
-
-                libsais64_renumber_lms_suffixes_8u(SA, m, (sa_sint_t)count, omp_block_start, omp_block_size);
             }
         }
-#endif
     }
-
-    return name;
 }
 
 static void libsais64_gather_marked_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m, sa_sint_t fs,
                                                         sa_sint_t threads,
                                                         LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_gather_marked_suffixes_8u(SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start,
-                                                omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                if (omp_thread_num < omp_num_threads - 1) {
-                    thread_state[omp_thread_num].state.position = libsais64_gather_marked_suffixes_8u(
-                        SA, m, (fast_sint_t)m + omp_block_start + omp_block_size, omp_block_start, omp_block_size);
-                    thread_state[omp_thread_num].state.count =
-                        (fast_sint_t)m + omp_block_start + omp_block_size - thread_state[omp_thread_num].state.position;
-                } else {
-                    thread_state[omp_thread_num].state.position = libsais64_gather_marked_suffixes_8u(
-                        SA, m, (fast_sint_t)n + (fast_sint_t)fs, omp_block_start, omp_block_size);
-                    thread_state[omp_thread_num].state.count =
-                        (fast_sint_t)n + (fast_sint_t)fs - thread_state[omp_thread_num].state.position;
-                }
-            }
-
-    #pragma omp barrier
-
-    #pragma omp master
-            {
-                fast_sint_t t, position = (fast_sint_t)n + (fast_sint_t)fs;
-
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    position -= thread_state[t].state.count;
-                    if (t != omp_num_threads - 1 && thread_state[t].state.count > 0) {
-                        memmove(&SA[position], &SA[thread_state[t].state.position],
-                                (size_t)thread_state[t].state.count * sizeof(sa_sint_t));
-                    }
-                }
-            }
-        }
-#endif
-    }
+    struct libsais64_gather_marked_lms_suffixes_8u_omp_args a = { SA, n, m, fs, thread_state };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais64_gather_marked_lms_suffixes_8u_omp_region, &a);
 }
 
 static sa_sint_t libsais64_renumber_and_gather_lms_suffixes_8u_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
@@ -5103,105 +5195,116 @@ static void libsais64_clamp_lms_suffixes_length_32s(sa_sint_t * RESTRICT SA, sa_
     }
 }
 
-static sa_sint_t libsais64_renumber_distinct_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t m,
-                                                                     sa_sint_t threads,
-                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t name = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            name = libsais64_renumber_distinct_lms_suffixes_32s_4k(SA, m, 1, omp_block_start, omp_block_size);
+struct libsais64_renumber_distinct_lms_suffixes_32s_4k_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t name;
+};
+
+static void libsais64_renumber_distinct_lms_suffixes_32s_4k_omp_region(void * arg) {
+    struct libsais64_renumber_distinct_lms_suffixes_32s_4k_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->name = libsais64_renumber_distinct_lms_suffixes_32s_4k(SA, m, 1, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais64_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais64_count_negative_marked_suffixes(SA, omp_block_start, omp_block_size);
-            }
 
-    #pragma omp barrier
+        pool_barrier();
 
-            {
-                fast_sint_t t, count = 1;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
-
-                if (omp_thread_num == omp_num_threads - 1) {
-                    name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
-                }
+        {
+            fast_sint_t t, count = 1;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
 
-                libsais64_renumber_distinct_lms_suffixes_32s_4k(SA, m, (sa_sint_t)count, omp_block_start,
-                                                                omp_block_size);
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->name = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
             }
+
+            libsais64_renumber_distinct_lms_suffixes_32s_4k(SA, m, (sa_sint_t)count, omp_block_start,
+                                                            omp_block_size);
         }
-#endif
     }
+}
+
+static sa_sint_t libsais64_renumber_distinct_lms_suffixes_32s_4k_omp(sa_sint_t * RESTRICT SA, sa_sint_t m,
+                                                                     sa_sint_t threads,
+                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t name = 0;
+
+    struct libsais64_renumber_distinct_lms_suffixes_32s_4k_omp_args a = { SA, m, thread_state, name };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais64_renumber_distinct_lms_suffixes_32s_4k_omp_region,
+                  &a);
+    name = a.name;
 
     return name - 1;
 }
 
+struct libsais64_mark_distinct_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
+
+static void libsais64_mark_distinct_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais64_mark_distinct_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+    libsais64_mark_distinct_lms_suffixes_32s(SA, m, omp_block_start, omp_block_size);
+}
+
 static void libsais64_mark_distinct_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
                                                          sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-#else
-        UNUSED(threads);
+    struct libsais64_mark_distinct_lms_suffixes_32s_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais64_mark_distinct_lms_suffixes_32s_omp_region, &a);
+}
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n >> 1;
-#endif
-        libsais64_mark_distinct_lms_suffixes_32s(SA, m, omp_block_start, omp_block_size);
-    }
+struct libsais64_clamp_lms_suffixes_length_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
+
+static void libsais64_clamp_lms_suffixes_length_32s_omp_region(void * arg) {
+    struct libsais64_clamp_lms_suffixes_length_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+    libsais64_clamp_lms_suffixes_length_32s(SA, m, omp_block_start, omp_block_size);
 }
 
 static void libsais64_clamp_lms_suffixes_length_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
                                                         sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-#else
-        UNUSED(threads);
-
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n >> 1;
-#endif
-        libsais64_clamp_lms_suffixes_length_32s(SA, m, omp_block_start, omp_block_size);
-    }
+    struct libsais64_clamp_lms_suffixes_length_32s_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && n >= 131072 ? threads : 1, libsais64_clamp_lms_suffixes_length_32s_omp_region, &a);
 }
 
 static sa_sint_t libsais64_renumber_and_mark_distinct_lms_suffixes_32s_4k_omp(
@@ -5353,27 +5456,31 @@ static void libsais64_reconstruct_lms_suffixes(sa_sint_t * RESTRICT SA, sa_sint_
     }
 }
 
-static void libsais64_reconstruct_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
-                                                   sa_sint_t threads) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-#else
-        UNUSED(threads);
+struct libsais64_reconstruct_lms_suffixes_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+};
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = m;
-#endif
+static void libsais64_reconstruct_lms_suffixes_omp_region(void * arg) {
+    struct libsais64_reconstruct_lms_suffixes_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
 
-        libsais64_reconstruct_lms_suffixes(SA, n, m, omp_block_start, omp_block_size);
-    }
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    libsais64_reconstruct_lms_suffixes(SA, n, m, omp_block_start, omp_block_size);
+}
+
+static void libsais64_reconstruct_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
+                                                   sa_sint_t threads) {
+    struct libsais64_reconstruct_lms_suffixes_omp_args a = { SA, n, m };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais64_reconstruct_lms_suffixes_omp_region, &a);
 }
 
 static void libsais64_place_lms_suffixes_interval_8u(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
@@ -5758,8 +5865,6 @@ static void libsais64_final_sorting_scan_left_to_right_32s(const sa_sint_t * RES
     }
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais64_final_bwt_scan_left_to_right_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -6041,69 +6146,139 @@ static void libsais64_final_sorting_scan_left_to_right_32s_block_sort(const sa_s
     }
 }
 
+struct libsais64_final_bwt_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_bwt_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais64_final_bwt_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
+                }
+            }
+        }
+
+        pool_barrier();
+
+        {
+            libsais64_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                    thread_state[omp_thread_num].state.cache,
+                                                                    thread_state[omp_thread_num].state.count);
+        }
+    }
+}
+
 static void libsais64_final_bwt_scan_left_to_right_8u_block_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                 sa_sint_t * RESTRICT induction_bucket,
                                                                 fast_sint_t block_start, fast_sint_t block_size,
                                                                 sa_sint_t threads,
                                                                 LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais64_final_bwt_scan_left_to_right_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                          block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_bwt_scan_left_to_right_8u_block_omp_region, &a);
+}
+
+struct libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t rm;
+    sa_sint_t * I;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t rm = a->rm;
+    sa_sint_t * RESTRICT I = a->I;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, omp_block_start,
+                                                      omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                        thread_state[omp_thread_num].state.cache,
-                                                                        thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais64_final_bwt_aux_scan_left_to_right_8u_block_place(
+                SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -6113,65 +6288,69 @@ static void libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp(const uint8_
                                                                     fast_sint_t block_start, fast_sint_t block_size,
                                                                     sa_sint_t threads,
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, omp_block_start,
-                                                          omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp_args a = { T, SA, rm, I, induction_bucket,
+                                                                              block_start, block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_bwt_aux_scan_left_to_right_8u_block_omp_region, &a);
+}
+
+struct libsais64_final_sorting_scan_left_to_right_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_sorting_scan_left_to_right_8u_block_omp_region(void * arg) {
+    struct libsais64_final_sorting_scan_left_to_right_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_sorting_scan_left_to_right_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = 0; t < omp_num_threads; ++t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A + B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_final_bwt_aux_scan_left_to_right_8u_block_place(
-                    SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais64_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                    thread_state[omp_thread_num].state.cache,
+                                                                    thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -6180,118 +6359,67 @@ static void libsais64_final_sorting_scan_left_to_right_8u_block_omp(const uint8_
                                                                     fast_sint_t block_start, fast_sint_t block_size,
                                                                     sa_sint_t threads,
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_sorting_scan_left_to_right_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = 0; t < omp_num_threads; ++t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A + B;
-                        temp_bucket[c] = A;
-                    }
-                }
-            }
-
-        #pragma omp barrier
-
-            {
-                libsais64_final_order_scan_left_to_right_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                        thread_state[omp_thread_num].state.cache,
-                                                                        thread_state[omp_thread_num].state.count);
-            }
-        }
-    #endif
-    }
+    struct libsais64_final_sorting_scan_left_to_right_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                              block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_sorting_scan_left_to_right_8u_block_omp_region, &a);
 }
 
-static void libsais64_final_sorting_scan_left_to_right_32s_block_omp(
-    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
-    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_sorting_scan_left_to_right_32s(T, SA, buckets, omp_block_start, omp_block_size);
+struct libsais64_final_sorting_scan_left_to_right_32s_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_final_sorting_scan_left_to_right_32s_block_omp_region(void * arg) {
+    struct libsais64_final_sorting_scan_left_to_right_32s_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_sorting_scan_left_to_right_32s(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_final_sorting_scan_left_to_right_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                                        omp_block_size);
         }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_final_sorting_scan_left_to_right_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                            omp_block_size);
-            }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                libsais64_final_sorting_scan_left_to_right_32s_block_sort(T, buckets, cache - block_start, block_start,
-                                                                          block_size);
-            }
+        if (omp_thread_num == 0) {
+            libsais64_final_sorting_scan_left_to_right_32s_block_sort(T, buckets, cache - block_start, block_start,
+                                                                      block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
-#endif
+static void libsais64_final_sorting_scan_left_to_right_32s_block_omp(
+    const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
+    LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
+    struct libsais64_final_sorting_scan_left_to_right_32s_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                               block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_final_sorting_scan_left_to_right_32s_block_omp_region, &a);
+}
 
 static void libsais64_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                           fast_sint_t n, sa_sint_t * RESTRICT induction_bucket,
@@ -6303,7 +6431,6 @@ static void libsais64_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRI
     if (threads == 1 || n < 65536) {
         libsais64_final_bwt_scan_left_to_right_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6339,9 +6466,6 @@ static void libsais64_final_bwt_scan_left_to_right_8u_omp(const uint8_t * RESTRI
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6358,7 +6482,6 @@ static void libsais64_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * RE
     if (threads == 1 || n < 65536) {
         libsais64_final_bwt_aux_scan_left_to_right_8u(T, SA, rm, I, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6397,9 +6520,6 @@ static void libsais64_final_bwt_aux_scan_left_to_right_8u_omp(const uint8_t * RE
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_final_sorting_scan_left_to_right_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6412,7 +6532,6 @@ static void libsais64_final_sorting_scan_left_to_right_8u_omp(const uint8_t * RE
     if (threads == 1 || n < 65536) {
         libsais64_final_sorting_scan_left_to_right_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = 0; block_start < n;) {
@@ -6447,9 +6566,6 @@ static void libsais64_final_sorting_scan_left_to_right_8u_omp(const uint8_t * RE
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6461,7 +6577,6 @@ static void libsais64_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t *
     if (threads == 1 || n < 65536) {
         libsais64_final_sorting_scan_left_to_right_32s(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = 0; block_start < n; block_start = block_end) {
@@ -6474,9 +6589,6 @@ static void libsais64_final_sorting_scan_left_to_right_32s_omp(const sa_sint_t *
                 T, SA, induction_bucket, thread_state[0].state.cache, block_start, block_end - block_start, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static sa_sint_t libsais64_final_bwt_scan_right_to_left_8u(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -6697,8 +6809,6 @@ static void libsais64_final_sorting_scan_right_to_left_32s(const sa_sint_t * RES
     }
 }
 
-#if defined(_OPENMP)
-
 static fast_sint_t libsais64_final_bwt_scan_right_to_left_8u_block_prepare(
     const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t omp_block_start, fast_sint_t omp_block_size) {
@@ -7052,69 +7162,139 @@ static void libsais64_final_sorting_scan_right_to_left_32s_block_sort(const sa_s
     }
 }
 
+struct libsais64_final_bwt_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_bwt_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais64_final_bwt_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
+                }
+            }
+        }
+
+        pool_barrier();
+
+        {
+            libsais64_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                    thread_state[omp_thread_num].state.cache,
+                                                                    thread_state[omp_thread_num].state.count);
+        }
+    }
+}
+
 static void libsais64_final_bwt_scan_right_to_left_8u_block_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                 sa_sint_t * RESTRICT induction_bucket,
                                                                 fast_sint_t block_start, fast_sint_t block_size,
                                                                 sa_sint_t threads,
                                                                 LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_bwt_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais64_final_bwt_scan_right_to_left_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                          block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_bwt_scan_right_to_left_8u_block_omp_region, &a);
+}
+
+struct libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t rm;
+    sa_sint_t * I;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t rm = a->rm;
+    sa_sint_t * RESTRICT I = a->I;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, omp_block_start,
+                                                      omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_bwt_aux_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                        thread_state[omp_thread_num].state.cache,
-                                                                        thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais64_final_bwt_aux_scan_right_to_left_8u_block_place(
+                SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -7124,65 +7304,69 @@ static void libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp(const uint8_
                                                                     fast_sint_t block_start, fast_sint_t block_size,
                                                                     sa_sint_t threads,
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, omp_block_start,
-                                                          omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_bwt_aux_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
+    struct libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp_args a = { T, SA, rm, I, induction_bucket,
+                                                                              block_start, block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_bwt_aux_scan_right_to_left_8u_block_omp_region, &a);
+}
+
+struct libsais64_final_sorting_scan_right_to_left_8u_block_omp_args {
+    const uint8_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * induction_bucket;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_final_sorting_scan_right_to_left_8u_block_omp_region(void * arg) {
+    struct libsais64_final_sorting_scan_right_to_left_8u_block_omp_args * a = arg;
+    const uint8_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT induction_bucket = a->induction_bucket;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count = libsais64_final_sorting_scan_right_to_left_8u_block_prepare(
+                T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
+                omp_block_start, omp_block_size);
+        }
+
+        pool_barrier();
+
+        if (omp_thread_num == 0) {
+            fast_sint_t t;
+            for (t = omp_num_threads - 1; t >= 0; --t) {
+                sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
+                fast_sint_t c;
+                for (c = 0; c < ALPHABET_SIZE; c += 1) {
+                    sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
+                    induction_bucket[c] = A - B;
+                    temp_bucket[c] = A;
                 }
             }
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_final_bwt_aux_scan_right_to_left_8u_block_place(
-                    SA, rm, I, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    thread_state[omp_thread_num].state.count);
-            }
+        {
+            libsais64_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
+                                                                    thread_state[omp_thread_num].state.cache,
+                                                                    thread_state[omp_thread_num].state.count);
         }
-    #endif
     }
 }
 
@@ -7191,119 +7375,68 @@ static void libsais64_final_sorting_scan_right_to_left_8u_block_omp(const uint8_
                                                                     fast_sint_t block_start, fast_sint_t block_size,
                                                                     sa_sint_t threads,
                                                                     LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 64 * ALPHABET_SIZE && \
-                                                      omp_get_dynamic() == 0)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(thread_state);
+    struct libsais64_final_sorting_scan_right_to_left_8u_block_omp_args a = { T, SA, induction_bucket, block_start,
+                                                                              block_size, thread_state };
+    pool_parallel(threads > 1 && block_size >= 64 * ALPHABET_SIZE && pool_dynamic() == 0 ? threads : 1,
+                  libsais64_final_sorting_scan_right_to_left_8u_block_omp_region, &a);
+}
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count = libsais64_final_sorting_scan_right_to_left_8u_block_prepare(
-                    T, SA, thread_state[omp_thread_num].state.buckets, thread_state[omp_thread_num].state.cache,
-                    omp_block_start, omp_block_size);
-            }
+struct libsais64_final_sorting_scan_right_to_left_32s_block_omp_args {
+    const sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t * buckets;
+    LIBSAIS_THREAD_CACHE * cache;
+    fast_sint_t block_start;
+    fast_sint_t block_size;
+};
+
+static void libsais64_final_sorting_scan_right_to_left_32s_block_omp_region(void * arg) {
+    struct libsais64_final_sorting_scan_right_to_left_32s_block_omp_args * a = arg;
+    const sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t * RESTRICT buckets = a->buckets;
+    LIBSAIS_THREAD_CACHE * RESTRICT cache = a->cache;
+    fast_sint_t block_start = a->block_start;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    omp_block_start += block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_final_sorting_scan_right_to_left_32s(T, SA, buckets, omp_block_start, omp_block_size);
+    } else {
+        {
+            libsais64_final_sorting_scan_right_to_left_32s_block_gather(T, SA, cache - block_start, omp_block_start,
+                                                                        omp_block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-        #pragma omp master
-            {
-                fast_sint_t t;
-                for (t = omp_num_threads - 1; t >= 0; --t) {
-                    sa_sint_t * RESTRICT temp_bucket = thread_state[t].state.buckets;
-                    fast_sint_t c;
-                    for (c = 0; c < ALPHABET_SIZE; c += 1) {
-                        sa_sint_t A = induction_bucket[c], B = temp_bucket[c];
-                        induction_bucket[c] = A - B;
-                        temp_bucket[c] = A;
-                    }
-                }
-            }
+        if (omp_thread_num == 0) {
+            libsais64_final_sorting_scan_right_to_left_32s_block_sort(T, buckets, cache - block_start, block_start,
+                                                                      block_size);
+        }
 
-        #pragma omp barrier
+        pool_barrier();
 
-            {
-                libsais64_final_order_scan_right_to_left_8u_block_place(SA, thread_state[omp_thread_num].state.buckets,
-                                                                        thread_state[omp_thread_num].state.cache,
-                                                                        thread_state[omp_thread_num].state.count);
-            }
-        }
-    #endif
+        { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
     }
 }
 
 static void libsais64_final_sorting_scan_right_to_left_32s_block_omp(
     const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t * RESTRICT buckets,
     LIBSAIS_THREAD_CACHE * RESTRICT cache, fast_sint_t block_start, fast_sint_t block_size, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && block_size >= 16384)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-    #else
-        UNUSED(threads);
-        UNUSED(cache);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-    #endif
-        fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-        omp_block_start += block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_final_sorting_scan_right_to_left_32s(T, SA, buckets, omp_block_start, omp_block_size);
-        }
-    #if defined(_OPENMP)
-        else {
-            {
-                libsais64_final_sorting_scan_right_to_left_32s_block_gather(T, SA, cache - block_start, omp_block_start,
-                                                                            omp_block_size);
-            }
-
-        #pragma omp barrier
-
-        #pragma omp master
-            {
-                libsais64_final_sorting_scan_right_to_left_32s_block_sort(T, buckets, cache - block_start, block_start,
-                                                                          block_size);
-            }
-
-        #pragma omp barrier
-
-            { libsais64_compact_and_place_cached_suffixes(SA, cache - block_start, omp_block_start, omp_block_size); }
-        }
-    #endif
-    }
+    struct libsais64_final_sorting_scan_right_to_left_32s_block_omp_args a = { T, SA, buckets, cache, block_start,
+                                                                               block_size };
+    pool_parallel(threads > 1 && block_size >= 16384 ? threads : 1,
+                  libsais64_final_sorting_scan_right_to_left_32s_block_omp_region, &a);
 }
 
-#endif
-
 static sa_sint_t libsais64_final_bwt_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
                                                                sa_sint_t n, sa_sint_t * RESTRICT induction_bucket,
                                                                sa_sint_t threads,
@@ -7313,7 +7446,6 @@ static sa_sint_t libsais64_final_bwt_scan_right_to_left_8u_omp(const uint8_t * R
     if (threads == 1 || n < 65536) {
         index = libsais64_final_bwt_scan_right_to_left_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7351,9 +7483,6 @@ static sa_sint_t libsais64_final_bwt_scan_right_to_left_8u_omp(const uint8_t * R
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 
     return index;
 }
@@ -7365,7 +7494,6 @@ static void libsais64_final_bwt_aux_scan_right_to_left_8u_omp(const uint8_t * RE
     if (threads == 1 || n < 65536) {
         libsais64_final_bwt_aux_scan_right_to_left_8u(T, SA, rm, I, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7407,9 +7535,6 @@ static void libsais64_final_bwt_aux_scan_right_to_left_8u_omp(const uint8_t * RE
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_final_sorting_scan_right_to_left_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -7419,7 +7544,6 @@ static void libsais64_final_sorting_scan_right_to_left_8u_omp(const uint8_t * RE
     if (threads == 1 || n < 65536) {
         libsais64_final_sorting_scan_right_to_left_8u(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0;) {
@@ -7454,9 +7578,6 @@ static void libsais64_final_sorting_scan_right_to_left_8u_omp(const uint8_t * RE
             }
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
 static void libsais64_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA,
@@ -7466,7 +7587,6 @@ static void libsais64_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t *
     if (threads == 1 || n < 65536) {
         libsais64_final_sorting_scan_right_to_left_32s(T, SA, induction_bucket, 0, n);
     }
-#if defined(_OPENMP)
     else {
         fast_sint_t block_start, block_end;
         for (block_start = (fast_sint_t)n - 1; block_start >= 0; block_start = block_end) {
@@ -7479,29 +7599,41 @@ static void libsais64_final_sorting_scan_right_to_left_32s_omp(const sa_sint_t *
                 T, SA, induction_bucket, thread_state[0].state.cache, block_end + 1, block_start - block_end, threads);
         }
     }
-#else
-    UNUSED(thread_state);
-#endif
 }
 
-static void libsais64_clear_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
-                                             sa_sint_t * RESTRICT bucket_start, sa_sint_t * RESTRICT bucket_end,
-                                             sa_sint_t threads) {
+struct libsais64_clear_lms_suffixes_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t k;
+    sa_sint_t * bucket_start;
+    sa_sint_t * bucket_end;
+};
+
+static void libsais64_clear_lms_suffixes_omp_region(void * arg) {
+    struct libsais64_clear_lms_suffixes_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t k = a->k;
+    sa_sint_t * RESTRICT bucket_start = a->bucket_start;
+    sa_sint_t * RESTRICT bucket_end = a->bucket_end;
+
     fast_sint_t c;
 
-#if defined(_OPENMP)
-    #pragma omp parallel for schedule(static, 1) num_threads(threads) if (threads > 1 && n >= 65536)
-#else
-    UNUSED(threads);
-    UNUSED(n);
-#endif
-    for (c = 0; c < k; ++c) {
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+
+    for (c = 0 + omp_thread_num; c < k; c += omp_num_threads) {
         if (bucket_end[c] > bucket_start[c]) {
             memset(&SA[bucket_start[c]], 0, ((size_t)bucket_end[c] - (size_t)bucket_start[c]) * sizeof(sa_sint_t));
         }
     }
 }
 
+static void libsais64_clear_lms_suffixes_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t k,
+                                             sa_sint_t * RESTRICT bucket_start, sa_sint_t * RESTRICT bucket_end,
+                                             sa_sint_t threads) {
+    struct libsais64_clear_lms_suffixes_omp_args a = { SA, k, bucket_start, bucket_end };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_clear_lms_suffixes_omp_region, &a);
+}
+
 static sa_sint_t libsais64_induce_final_order_8u_omp(const uint8_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                      sa_sint_t bwt, sa_sint_t r, sa_sint_t * RESTRICT I,
                                                      sa_sint_t * RESTRICT buckets, sa_sint_t threads,
@@ -7696,8 +7828,6 @@ static void libsais64_compact_unique_and_nonunique_lms_suffixes_32s(sa_sint_t *
     *pr = r + 1;
 }
 
-#if defined(_OPENMP)
-
 static sa_sint_t libsais64_count_unique_suffixes(sa_sint_t * RESTRICT SA, sa_sint_t m, fast_sint_t omp_block_start,
                                                  fast_sint_t omp_block_size) {
     const fast_sint_t prefetch_distance = 32;
@@ -7727,134 +7857,141 @@ static sa_sint_t libsais64_count_unique_suffixes(sa_sint_t * RESTRICT SA, sa_sin
     return f0 + f1 + f2 + f3;
 }
 
-#endif
-
-static sa_sint_t libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp(
-    sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
-    LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-    sa_sint_t f = 0;
-
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            f = libsais64_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, 0, omp_block_start, omp_block_size);
+struct libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+    sa_sint_t f;
+};
+
+static void libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        a->f = libsais64_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais64_count_unique_suffixes(SA, m, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais64_count_unique_suffixes(SA, m, omp_block_start, omp_block_size);
-            }
-
-    #pragma omp barrier
 
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                if (omp_thread_num == omp_num_threads - 1) {
-                    f = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
-                }
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
+            }
 
-                libsais64_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, (sa_sint_t)count, omp_block_start,
-                                                                         omp_block_size);
+            if (omp_thread_num == omp_num_threads - 1) {
+                a->f = (sa_sint_t)(count + thread_state[omp_thread_num].state.count);
             }
+
+            libsais64_renumber_unique_and_nonunique_lms_suffixes_32s(T, SA, m, (sa_sint_t)count, omp_block_start,
+                                                                     omp_block_size);
         }
-#endif
     }
+}
+
+static sa_sint_t libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp(
+    sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t m, sa_sint_t threads,
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    sa_sint_t f = 0;
+
+    struct libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp_args a = { T, SA, m, thread_state, f };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1,
+                  libsais64_renumber_unique_and_nonunique_lms_suffixes_32s_omp_region, &a);
+    f = a.f;
 
     return f;
 }
 
-static void libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                                        sa_sint_t m, sa_sint_t fs, sa_sint_t f,
-                                                                        sa_sint_t threads,
-                                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 131072 && m < fs)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
+struct libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t fs;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t fs = a->fs;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        fast_sint_t l = m, r = (fast_sint_t)n + (fast_sint_t)fs;
+        libsais64_compact_unique_and_nonunique_lms_suffixes_32s(SA, m, &l, &r, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.position =
+                (fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_start + omp_block_size;
+            thread_state[omp_thread_num].state.count = (fast_sint_t)m + omp_block_start + omp_block_size;
 
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (((fast_sint_t)n >> 1) / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : ((fast_sint_t)n >> 1) - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            fast_sint_t l = m, r = (fast_sint_t)n + (fast_sint_t)fs;
-            libsais64_compact_unique_and_nonunique_lms_suffixes_32s(SA, m, &l, &r, omp_block_start, omp_block_size);
-        }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.position =
-                    (fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_start + omp_block_size;
-                thread_state[omp_thread_num].state.count = (fast_sint_t)m + omp_block_start + omp_block_size;
-
-                libsais64_compact_unique_and_nonunique_lms_suffixes_32s(
-                    SA, m, &thread_state[omp_thread_num].state.position, &thread_state[omp_thread_num].state.count,
-                    omp_block_start, omp_block_size);
-            }
+            libsais64_compact_unique_and_nonunique_lms_suffixes_32s(
+                SA, m, &thread_state[omp_thread_num].state.position, &thread_state[omp_thread_num].state.count,
+                omp_block_start, omp_block_size);
+        }
 
-    #pragma omp barrier
+        pool_barrier();
 
-    #pragma omp master
-            {
-                fast_sint_t t, position;
+        if (omp_thread_num == 0) {
+            fast_sint_t t, position;
 
-                for (position = m, t = omp_num_threads - 1; t >= 0; --t) {
-                    fast_sint_t omp_block_end =
-                        t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
-                    fast_sint_t count =
-                        ((fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_end - thread_state[t].state.position);
+            for (position = m, t = omp_num_threads - 1; t >= 0; --t) {
+                fast_sint_t omp_block_end =
+                    t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
+                fast_sint_t count =
+                    ((fast_sint_t)m + ((fast_sint_t)n >> 1) + omp_block_end - thread_state[t].state.position);
 
-                    if (count > 0) {
-                        position -= count;
-                        memcpy(&SA[position], &SA[thread_state[t].state.position], (size_t)count * sizeof(sa_sint_t));
-                    }
+                if (count > 0) {
+                    position -= count;
+                    memcpy(&SA[position], &SA[thread_state[t].state.position], (size_t)count * sizeof(sa_sint_t));
                 }
+            }
 
-                for (position = (fast_sint_t)n + (fast_sint_t)fs, t = omp_num_threads - 1; t >= 0; --t) {
-                    fast_sint_t omp_block_end =
-                        t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
-                    fast_sint_t count = ((fast_sint_t)m + omp_block_end - thread_state[t].state.count);
+            for (position = (fast_sint_t)n + (fast_sint_t)fs, t = omp_num_threads - 1; t >= 0; --t) {
+                fast_sint_t omp_block_end =
+                    t < omp_num_threads - 1 ? omp_block_stride * (t + 1) : ((fast_sint_t)n >> 1);
+                fast_sint_t count = ((fast_sint_t)m + omp_block_end - thread_state[t].state.count);
 
-                    if (count > 0) {
-                        position -= count;
-                        memcpy(&SA[position], &SA[thread_state[t].state.count], (size_t)count * sizeof(sa_sint_t));
-                    }
+                if (count > 0) {
+                    position -= count;
+                    memcpy(&SA[position], &SA[thread_state[t].state.count], (size_t)count * sizeof(sa_sint_t));
                 }
             }
         }
-#endif
     }
+}
+
+static void libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                                        sa_sint_t m, sa_sint_t fs, sa_sint_t f,
+                                                                        sa_sint_t threads,
+                                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp_args a = { SA, n, m, fs, thread_state };
+    pool_parallel(threads > 1 && n >= 131072 && m < fs ? threads : 1,
+                  libsais64_compact_unique_and_nonunique_lms_suffixes_32s_omp_region, &a);
 
     memcpy(&SA[(fast_sint_t)n + (fast_sint_t)fs - (fast_sint_t)m], &SA[(fast_sint_t)m - (fast_sint_t)f],
            (size_t)f * sizeof(sa_sint_t));
@@ -7960,98 +8097,106 @@ static void libsais64_merge_nonunique_lms_suffixes_32s(sa_sint_t * RESTRICT SA,
     }
 }
 
-static void libsais64_merge_unique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
-                                                        sa_sint_t m, sa_sint_t threads,
-                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
-
-        if (omp_num_threads == 1) {
-            libsais64_merge_unique_lms_suffixes_32s(T, SA, n, m, 0, omp_block_start, omp_block_size);
+struct libsais64_merge_unique_lms_suffixes_32s_omp_args {
+    sa_sint_t * T;
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_merge_unique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais64_merge_unique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT T = a->T;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : n - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_merge_unique_lms_suffixes_32s(T, SA, n, m, 0, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais64_count_negative_marked_suffixes(T, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais64_count_negative_marked_suffixes(T, omp_block_start, omp_block_size);
-            }
 
-    #pragma omp barrier
-
-            {
-                fast_sint_t t, count = 0;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                libsais64_merge_unique_lms_suffixes_32s(T, SA, n, m, count, omp_block_start, omp_block_size);
+        {
+            fast_sint_t t, count = 0;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
             }
+
+            libsais64_merge_unique_lms_suffixes_32s(T, SA, n, m, count, omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
-static void libsais64_merge_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
-                                                           sa_sint_t f, sa_sint_t threads,
-                                                           LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1 && m >= 65536)
-#endif
-    {
-#if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-        UNUSED(threads);
-        UNUSED(thread_state);
-
-        fast_sint_t omp_thread_num = 0;
-        fast_sint_t omp_num_threads = 1;
-#endif
-        fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+static void libsais64_merge_unique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
+                                                        sa_sint_t m, sa_sint_t threads,
+                                                        LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_merge_unique_lms_suffixes_32s_omp_args a = { T, SA, n, m, thread_state };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_merge_unique_lms_suffixes_32s_omp_region, &a);
+}
 
-        if (omp_num_threads == 1) {
-            libsais64_merge_nonunique_lms_suffixes_32s(SA, n, m, f, omp_block_start, omp_block_size);
+struct libsais64_merge_nonunique_lms_suffixes_32s_omp_args {
+    sa_sint_t * SA;
+    sa_sint_t n;
+    sa_sint_t m;
+    sa_sint_t f;
+    LIBSAIS_THREAD_STATE * thread_state;
+};
+
+static void libsais64_merge_nonunique_lms_suffixes_32s_omp_region(void * arg) {
+    struct libsais64_merge_nonunique_lms_suffixes_32s_omp_args * a = arg;
+    sa_sint_t * RESTRICT SA = a->SA;
+    sa_sint_t n = a->n;
+    sa_sint_t m = a->m;
+    sa_sint_t f = a->f;
+    LIBSAIS_THREAD_STATE * RESTRICT thread_state = a->thread_state;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (m / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : m - omp_block_start;
+
+    if (omp_num_threads == 1) {
+        libsais64_merge_nonunique_lms_suffixes_32s(SA, n, m, f, omp_block_start, omp_block_size);
+    } else {
+        {
+            thread_state[omp_thread_num].state.count =
+                libsais64_count_zero_marked_suffixes(SA, omp_block_start, omp_block_size);
         }
-#if defined(_OPENMP)
-        else {
-            {
-                thread_state[omp_thread_num].state.count =
-                    libsais64_count_zero_marked_suffixes(SA, omp_block_start, omp_block_size);
-            }
-
-    #pragma omp barrier
 
-            {
-                fast_sint_t t, count = f;
-                for (t = 0; t < omp_thread_num; ++t) {
-                    count += thread_state[t].state.count;
-                }
+        pool_barrier();
 
-                libsais64_merge_nonunique_lms_suffixes_32s(SA, n, m, count, omp_block_start, omp_block_size);
+        {
+            fast_sint_t t, count = f;
+            for (t = 0; t < omp_thread_num; ++t) {
+                count += thread_state[t].state.count;
             }
+
+            libsais64_merge_nonunique_lms_suffixes_32s(SA, n, m, count, omp_block_start, omp_block_size);
         }
-#endif
     }
 }
 
+static void libsais64_merge_nonunique_lms_suffixes_32s_omp(sa_sint_t * RESTRICT SA, sa_sint_t n, sa_sint_t m,
+                                                           sa_sint_t f, sa_sint_t threads,
+                                                           LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
+    struct libsais64_merge_nonunique_lms_suffixes_32s_omp_args a = { SA, n, m, f, thread_state };
+    pool_parallel(threads > 1 && m >= 65536 ? threads : 1, libsais64_merge_nonunique_lms_suffixes_32s_omp_region, &a);
+}
+
 static void libsais64_merge_compacted_lms_suffixes_32s_omp(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT SA, sa_sint_t n,
                                                            sa_sint_t m, sa_sint_t f, sa_sint_t threads,
                                                            LIBSAIS_THREAD_STATE * RESTRICT thread_state) {
@@ -8124,31 +8269,36 @@ static void libsais64_convert_inplace_64u_to_32u(uint64_t * S, uint32_t * D, fas
     }
 }
 
+struct libsais64_convert_inplace_32u_to_64u_omp_args {
+    uint32_t * S;
+    uint64_t * D;
+    sa_sint_t n;
+    fast_sint_t block_size;
+};
+
+static void libsais64_convert_inplace_32u_to_64u_omp_region(void * arg) {
+    struct libsais64_convert_inplace_32u_to_64u_omp_args * a = arg;
+    uint32_t * S = a->S;
+    uint64_t * D = a->D;
+    sa_sint_t n = a->n;
+    fast_sint_t block_size = a->block_size;
+
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size = omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
+
+    libsais64_convert_left_to_right_32u_to_64u(S, D, n + omp_block_start, omp_block_size);
+}
+
 static void libsais64_convert_inplace_32u_to_64u_omp(uint32_t * S, uint64_t * D, sa_sint_t n, sa_sint_t threads) {
     while (n >= 65536) {
         fast_sint_t block_size = n >> 1;
         n -= block_size;
 
-#if defined(_OPENMP)
-    #pragma omp parallel num_threads(threads) if (threads > 1)
-#endif
-        {
-#if defined(_OPENMP)
-            fast_sint_t omp_thread_num = omp_get_thread_num();
-            fast_sint_t omp_num_threads = omp_get_num_threads();
-#else
-            UNUSED(threads);
-
-            fast_sint_t omp_thread_num = 0;
-            fast_sint_t omp_num_threads = 1;
-#endif
-            fast_sint_t omp_block_stride = (block_size / omp_num_threads) & (-16);
-            fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-            fast_sint_t omp_block_size =
-                omp_thread_num < omp_num_threads - 1 ? omp_block_stride : block_size - omp_block_start;
-
-            libsais64_convert_left_to_right_32u_to_64u(S, D, n + omp_block_start, omp_block_size);
-        }
+        struct libsais64_convert_inplace_32u_to_64u_omp_args a = { S, D, n, block_size };
+        pool_parallel(threads, libsais64_convert_inplace_32u_to_64u_omp_region, &a);
     }
 
     libsais64_convert_right_to_left_32u_to_64u(S, D, 0, n);
@@ -8163,12 +8313,8 @@ static sa_sint_t libsais64_main_32s(sa_sint_t * RESTRICT T, sa_sint_t * RESTRICT
         if (new_fs / k >= 4 || (new_fs >= fs)) {
             libsais64_convert_inplace_64u_to_32u((uint64_t *)T, (uint32_t *)T, 0, n);
 
-#if defined(_OPENMP)
             sa_sint_t index =
                 libsais_int_omp((int32_t *)T, (int32_t *)SA, (int32_t)n, (int32_t)k, (int32_t)new_fs, (int32_t)threads);
-#else
-            sa_sint_t index = libsais_int((int32_t *)T, (int32_t *)SA, (int32_t)n, (int32_t)k, (int32_t)new_fs);
-#endif
             if (index >= 0) {
                 libsais64_convert_inplace_32u_to_64u_omp((uint32_t *)SA, (uint64_t *)SA, n, threads);
             }
@@ -8456,32 +8602,32 @@ static void libsais64_bwt_copy_8u(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A,
     }
 }
 
-#if defined(_OPENMP)
+struct libsais64_bwt_copy_8u_omp_args {
+    uint8_t * U;
+    sa_sint_t * A;
+    sa_sint_t n;
+};
 
-static void libsais64_bwt_copy_8u_omp(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A, sa_sint_t n, sa_sint_t threads) {
-    #if defined(_OPENMP)
-        #pragma omp parallel num_threads(threads) if (threads > 1 && n >= 65536)
-    #endif
-    {
-    #if defined(_OPENMP)
-        fast_sint_t omp_thread_num = omp_get_thread_num();
-        fast_sint_t omp_num_threads = omp_get_num_threads();
-        fast_sint_t omp_block_stride = ((fast_sint_t)n / omp_num_threads) & (-16);
-        fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
-        fast_sint_t omp_block_size =
-            omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)n - omp_block_start;
-    #else
-        UNUSED(threads);
+static void libsais64_bwt_copy_8u_omp_region(void * arg) {
+    struct libsais64_bwt_copy_8u_omp_args * a = arg;
+    uint8_t * RESTRICT U = a->U;
+    sa_sint_t * RESTRICT A = a->A;
+    sa_sint_t n = a->n;
 
-        fast_sint_t omp_block_start = 0;
-        fast_sint_t omp_block_size = (fast_sint_t)n;
-    #endif
+    fast_sint_t omp_thread_num = pool_thread_num();
+    fast_sint_t omp_num_threads = pool_num_threads();
+    fast_sint_t omp_block_stride = ((fast_sint_t)n / omp_num_threads) & (-16);
+    fast_sint_t omp_block_start = omp_thread_num * omp_block_stride;
+    fast_sint_t omp_block_size =
+        omp_thread_num < omp_num_threads - 1 ? omp_block_stride : (fast_sint_t)n - omp_block_start;
 
-        libsais64_bwt_copy_8u(U + omp_block_start, A + omp_block_start, (sa_sint_t)omp_block_size);
-    }
+    libsais64_bwt_copy_8u(U + omp_block_start, A + omp_block_start, (sa_sint_t)omp_block_size);
 }
 
-#endif
+static void libsais64_bwt_copy_8u_omp(uint8_t * RESTRICT U, sa_sint_t * RESTRICT A, sa_sint_t n, sa_sint_t threads) {
+    struct libsais64_bwt_copy_8u_omp_args a = { U, A, n };
+    pool_parallel(threads > 1 && n >= 65536 ? threads : 1, libsais64_bwt_copy_8u_omp_region, &a);
+}
 
 int64_t libsais64(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, int64_t * freq) {
     if ((T == NULL) || (SA == NULL) || (n < 0) || (fs < 0)) {
@@ -8516,8 +8662,6 @@ int64_t libsais64(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, int64_
     return libsais64_main(T, SA, n, 0, 0, NULL, fs, freq, 1);
 }
 
-#if defined(_OPENMP)
-
 int64_t libsais64_omp(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, int64_t * freq, int64_t threads) {
     if ((T == NULL) || (SA == NULL) || (n < 0) || (fs < 0) || (threads < 0)) {
         return -1;
@@ -8534,7 +8678,7 @@ int64_t libsais64_omp(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, in
         return 0;
     }
 
-    threads = threads > 0 ? threads : omp_get_max_threads();
+    threads = threads > 0 ? threads : pool_threads();
 
     if (n <= INT32_MAX) {
         sa_sint_t new_fs = (fs + fs + n + n) <= INT32_MAX ? (fs + fs + n) : INT32_MAX - n;
@@ -8553,4 +8697,3 @@ int64_t libsais64_omp(const uint8_t * T, int64_t * SA, int64_t n, int64_t fs, in
     return libsais64_main(T, SA, n, 0, 0, NULL, fs, freq, threads);
 }
 
-#endif
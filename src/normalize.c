@@ -0,0 +1,476 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Branch target normalization, after Courgette and Zucchini. When code moves between two
+// builds, every call and jump across the move changes its displacement, and the diff stream
+// fills with scattered nonzero bytes. Given regions of the new file that correspond to the
+// old file, found by a quick first diff, each branch of the new file is rewritten to the
+// displacement it would have if its own position and its target were those of the matching
+// old code. Branches then mostly diff to zero against the old file.
+//
+// Only displacement fields are rewritten, and the scan for branches only looks at opcode
+// bytes, so the same branches are found again in the normalized file. A branch is only
+// considered if its stored target lies in the code, and it is rewritten only if the original
+// displacement can be restored from the new one. Restoring may also apply to a branch that
+// was left alone, so wherever it would change the displacement a bit records whether the
+// branch was rewritten. The code ranges, the regions and the bits are stored in the patch,
+// so that denormalization needs no knowledge of the executable format.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libqbdiff.h"
+#include "libqbdiff_private.h"
+#include "normalize.h"
+
+// Regions shorter than this, or used by fewer rewritten branches, are not worth storing.
+#define NORM_MIN_REGION 32
+#define NORM_MIN_USES 3
+
+static uint32_t rl32(const uint8_t * p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+
+static void wl32(uint32_t x, uint8_t * p) {
+    p[0] = x;
+    p[1] = x >> 8;
+    p[2] = x >> 16;
+    p[3] = x >> 24;
+}
+
+static int elf_machine(const uint8_t * d, size_t size) {
+    // 64-bit little-endian ELF.
+    if (size < 64 || memcmp(d, "\x7f" "ELF", 4) || d[4] != 2 || d[5] != 1) return NORM_NONE;
+    switch (d[18] | d[19] << 8) {
+        case 62:  // EM_X86_64
+            return NORM_X86_64;
+        case 183:  // EM_AARCH64
+            return NORM_ARM64;
+    }
+    return NORM_NONE;
+}
+
+int norm_arch(const uint8_t * old, size_t old_size, const uint8_t * new, size_t new_size) {
+    int arch = elf_machine(new, new_size);
+    return arch == elf_machine(old, old_size) ? arch : NORM_NONE;
+}
+
+// File ranges of the executable segments, sorted and merged.
+static int code_ranges(const uint8_t * d, size_t size, struct norm_info * info) {
+    uint64_t phoff = rl64(d + 32);
+    unsigned phentsize = d[54] | d[55] << 8, phnum = d[56] | d[57] << 8;
+    info->ranges = malloc((2 * phnum + 1) * sizeof(int64_t));
+    if (!info->ranges) return QBERR_NOMEM;
+    info->nranges = 0;
+    for (unsigned i = 0; i < phnum && phentsize >= 56; i++) {
+        uint64_t ph = phoff + (uint64_t)i * phentsize;
+        if (ph > size || size - ph < 56) break;
+        // PT_LOAD with PF_X.
+        if (rl32(d + ph) != 1 || !(rl32(d + ph + 4) & 1)) continue;
+        uint64_t off = rl64(d + ph + 8), len = rl64(d + ph + 32);
+        if (off >= size) continue;
+        int64_t start = off, end = len > size - off ? size : off + len, j = info->nranges++;
+        for (; j > 0 && info->ranges[2 * j - 2] > start; j--) {
+            info->ranges[2 * j] = info->ranges[2 * j - 2];
+            info->ranges[2 * j + 1] = info->ranges[2 * j - 1];
+        }
+        info->ranges[2 * j] = start;
+        info->ranges[2 * j + 1] = end;
+    }
+    int64_t n = 0;
+    for (int64_t i = 0; i < info->nranges; i++) {
+        if (n && info->ranges[2 * i] <= info->ranges[2 * n - 1]) {
+            info->ranges[2 * n - 1] = max(info->ranges[2 * n - 1], info->ranges[2 * i + 1]);
+        } else {
+            info->ranges[2 * n] = info->ranges[2 * i];
+            info->ranges[2 * n + 1] = info->ranges[2 * i + 1];
+            n++;
+        }
+    }
+    info->nranges = n;
+    return QBERR_OK;
+}
+
+static bool in_code(const struct norm_info * info, int64_t pos) {
+    int64_t lo = 0, hi = info->nranges - 1;
+    while (lo < hi) {
+        int64_t mid = (lo + hi + 1) / 2;
+        if (info->ranges[2 * mid] <= pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    return info->nranges && pos >= info->ranges[2 * lo] && pos < info->ranges[2 * lo + 1];
+}
+
+// The region containing a position of the new file, or of the old file through `by_old', a
+// permutation of the regions sorted by old_pos. Of overlapping regions of the old file, only
+// the last one to start is tried, which keeps the lookup the same on both sides.
+static const struct norm_region * find_region(const struct norm_info * info, const int64_t * by_old, int64_t pos) {
+    int64_t lo = 0, hi = info->nregions - 1;
+    if (hi < 0) return NULL;
+    while (lo < hi) {
+        int64_t mid = (lo + hi + 1) / 2;
+        const struct norm_region * r = &info->regions[by_old ? by_old[mid] : mid];
+        if ((by_old ? r->old_pos : r->new_pos) <= pos)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    const struct norm_region * r = &info->regions[by_old ? by_old[lo] : lo];
+    int64_t start = by_old ? r->old_pos : r->new_pos;
+    return pos >= start && pos - start < r->len ? r : NULL;
+}
+
+// The keys are sorted along with the index, as qsort() has no way to pass the regions on.
+struct old_key {
+    int64_t old_pos, new_pos, i;
+};
+
+static int by_old_pos(const void * a, const void * b) {
+    const struct old_key *x = a, *y = b;
+    if (x->old_pos != y->old_pos) return x->old_pos < y->old_pos ? -1 : 1;
+    return x->new_pos < y->new_pos ? -1 : x->new_pos > y->new_pos;
+}
+
+static int64_t * old_order(const struct norm_info * info) {
+    int64_t * by_old = malloc((info->nregions + 1) * sizeof(int64_t));
+    struct old_key * keys = malloc((info->nregions + 1) * sizeof(struct old_key));
+    if (!by_old || !keys) {
+        free(by_old);
+        free(keys);
+        return NULL;
+    }
+    for (int64_t i = 0; i < info->nregions; i++)
+        keys[i] = (struct old_key){ info->regions[i].old_pos, info->regions[i].new_pos, i };
+    qsort(keys, info->nregions, sizeof(struct old_key), by_old_pos);
+    for (int64_t i = 0; i < info->nregions; i++) by_old[i] = keys[i].i;
+    free(keys);
+    return by_old;
+}
+
+// Branch scanner. `at' is the position of the displacement field, and the target of the
+// branch is `base' plus the displacement.
+struct scan {
+    int arch;
+    int64_t range, pos;
+    int64_t at, base, disp;
+};
+
+// Finds the next branch in the bytes of the new file before `limit', which are held at d from
+// `off' on. A branch that may run past the limit is left for the next call.
+static bool next_branch(struct scan * s, const struct norm_info * info, const uint8_t * d, int64_t off,
+                        int64_t limit) {
+    for (; s->range < info->nranges; s->range++) {
+        int64_t end = info->ranges[2 * s->range + 1], stop = end;
+        if (end > limit) stop = limit - (s->arch == NORM_X86_64);
+        if (s->pos < info->ranges[2 * s->range]) s->pos = info->ranges[2 * s->range];
+        if (s->arch == NORM_X86_64) {
+            // call rel32, jmp rel32 and jcc rel32.
+            while (s->pos + 5 <= stop) {
+                const uint8_t * p = d + (s->pos - off);
+                if (p[0] == 0xe8 || p[0] == 0xe9) {
+                    s->at = s->pos + 1;
+                    s->pos += 5;
+                } else if (p[0] == 0x0f && s->pos + 6 <= end && (p[1] & 0xf0) == 0x80) {
+                    s->at = s->pos + 2;
+                    s->pos += 6;
+                } else {
+                    s->pos++;
+                    continue;
+                }
+                s->base = s->at + 4;
+                s->disp = (int32_t)rl32(d + (s->at - off));
+                return true;
+            }
+        } else {
+            // b and bl, with a 26-bit word displacement.
+            s->pos = (s->pos + 3) & ~(int64_t)3;
+            for (; s->pos + 4 <= stop; s->pos += 4) {
+                uint32_t w = rl32(d + (s->pos - off));
+                if ((w & 0x7c000000) != 0x14000000) continue;
+                s->at = s->base = s->pos;
+                s->disp = (int64_t)((int32_t)(w << 6) >> 6) * 4;
+                s->pos += 4;
+                return true;
+            }
+        }
+        if (end > limit) return false;
+    }
+    return false;
+}
+
+static bool disp_fits(int arch, int64_t disp) {
+    if (arch == NORM_X86_64) return disp >= INT32_MIN && disp <= INT32_MAX;
+    return !(disp & 3) && disp >= -(1 << 27) && disp < (1 << 27);
+}
+
+static void write_disp(int arch, uint8_t * d, int64_t at, int64_t disp) {
+    if (arch == NORM_X86_64)
+        wl32(disp, d + at);
+    else
+        wl32((rl32(d + at) & 0xfc000000) | ((disp >> 2) & 0x03ffffff), d + at);
+}
+
+static int push_flag(struct norm_info * info, int64_t * cap, bool flag) {
+    if (info->nflags == *cap * 8) {
+        int64_t n = *cap * 2 + 4096;
+        uint8_t * flags = realloc(info->flags, n);
+        if (!flags) return QBERR_NOMEM;
+        memset(flags + *cap, 0, n - *cap);
+        info->flags = flags;
+        *cap = n;
+    }
+    if (flag) info->flags[info->nflags / 8] |= 1 << (info->nflags % 8);
+    info->nflags++;
+    return QBERR_OK;
+}
+
+// The displacement that a rewritten branch had originally, if it differs from the stored one.
+static bool restore(const struct norm_info * info, const int64_t * by_old, const struct scan * s, int64_t disp,
+                    int64_t * orig) {
+    const struct norm_region * rp = find_region(info, NULL, s->at);
+    if (!rp) return false;
+    int64_t off_p = rp->old_pos - rp->new_pos;
+    const struct norm_region * back = find_region(info, by_old, s->base + disp + off_p);
+    if (!back) return false;
+    *orig = disp + off_p - (back->old_pos - back->new_pos);
+    return *orig != disp;
+}
+
+// The displacement of a branch in the normalized file.
+static int64_t rewrite(const struct norm_info * info, const int64_t * by_old, const struct scan * s,
+                       const struct norm_region ** rp, const struct norm_region ** rt) {
+    *rp = find_region(info, NULL, s->at);
+    *rt = find_region(info, NULL, s->base + s->disp);
+    if (!*rp || !*rt) return s->disp;
+    int64_t disp = s->disp + ((*rt)->old_pos - (*rt)->new_pos) - ((*rp)->old_pos - (*rp)->new_pos), orig;
+    if (!disp_fits(info->arch, disp) || !in_code(info, s->base + disp) || !restore(info, by_old, s, disp, &orig) ||
+        orig != s->disp)
+        return s->disp;
+    return disp;
+}
+
+int normalize(int arch, uint8_t * new, size_t new_size, struct norm_region * regions, int64_t nregions,
+              struct norm_info * info) {
+    memset(info, 0, sizeof(*info));
+    info->arch = arch;
+    info->regions = regions;
+
+    // Drop short regions, and merge neighbours that keep the same offset into the old file.
+    int64_t n = 0;
+    for (int64_t i = 0; i < nregions; i++) {
+        if (regions[i].len < NORM_MIN_REGION) continue;
+        if (n && regions[i].old_pos - regions[i].new_pos == regions[n - 1].old_pos - regions[n - 1].new_pos) {
+            regions[n - 1].len = regions[i].new_pos + regions[i].len - regions[n - 1].new_pos;
+        } else {
+            regions[n++] = regions[i];
+        }
+    }
+    info->nregions = n;
+
+    int err = code_ranges(new, new_size, info);
+    if (err != QBERR_OK) return err;
+    int64_t * by_old = old_order(info);
+    int64_t * uses = calloc(n + 1, sizeof(int64_t));
+    if (!by_old || !uses) {
+        free(by_old);
+        free(uses);
+        return QBERR_NOMEM;
+    }
+
+    // Keep the regions that enough branches would be rewritten with.
+    const struct norm_region *rp, *rt;
+    struct scan s = { .arch = arch };
+    while (next_branch(&s, info, new, 0, new_size)) {
+        if (!in_code(info, s.base + s.disp) || rewrite(info, by_old, &s, &rp, &rt) == s.disp) continue;
+        uses[rp - info->regions]++;
+        uses[rt - info->regions]++;
+    }
+    n = 0;
+    for (int64_t i = 0; i < info->nregions; i++)
+        if (uses[i] >= NORM_MIN_USES) info->regions[n++] = info->regions[i];
+    info->nregions = n;
+    free(uses);
+    free(by_old);
+    if (!(by_old = old_order(info))) return QBERR_NOMEM;
+
+    int64_t cap = 0, orig;
+    s = (struct scan){ .arch = arch };
+    while (next_branch(&s, info, new, 0, new_size)) {
+        if (!in_code(info, s.base + s.disp)) continue;
+        int64_t disp = rewrite(info, by_old, &s, &rp, &rt);
+        if (disp != s.disp) write_disp(arch, new, s.at, disp);
+        if (restore(info, by_old, &s, disp, &orig) && (err = push_flag(info, &cap, disp != s.disp)) != QBERR_OK)
+            break;
+    }
+    free(by_old);
+    return err;
+}
+
+struct denorm {
+    const struct norm_info * info;
+    int64_t * by_old;
+    struct scan s;
+    int64_t flag;
+};
+
+int denorm_begin(const struct norm_info * info, size_t new_size, struct denorm ** dn) {
+    for (int64_t i = 0; i < info->nranges; i++)
+        if (info->ranges[2 * i] > info->ranges[2 * i + 1] || info->ranges[2 * i + 1] > (int64_t)new_size ||
+            (i && info->ranges[2 * i] < info->ranges[2 * i - 1]))
+            return QBERR_BADPATCH;
+
+    if (!(*dn = calloc(1, sizeof(struct denorm)))) return QBERR_NOMEM;
+    (*dn)->info = info;
+    (*dn)->s.arch = info->arch;
+    if (!((*dn)->by_old = old_order(info))) {
+        free(*dn);
+        return QBERR_NOMEM;
+    }
+    return QBERR_OK;
+}
+
+int denorm_window(struct denorm * dn, uint8_t * d, int64_t off, int64_t end, int64_t * done) {
+    const struct norm_info * info = dn->info;
+    struct scan * s = &dn->s;
+    int64_t orig;
+    while (next_branch(s, info, d, off, end)) {
+        if (!in_code(info, s->base + s->disp) || !restore(info, dn->by_old, s, s->disp, &orig)) continue;
+        if (dn->flag >= info->nflags) return QBERR_BADPATCH;
+        if (info->flags[dn->flag / 8] >> (dn->flag % 8) & 1) write_disp(info->arch, d, s->at - off, orig);
+        dn->flag++;
+    }
+    // Bytes before the scan are done with, as branches are only rewritten once scanned past.
+    *done = s->range < info->nranges ? min(end, s->pos) : end;
+    return QBERR_OK;
+}
+
+int denorm_end(struct denorm * dn) {
+    int err = dn->flag == dn->info->nflags ? QBERR_OK : QBERR_BADPATCH;
+    free(dn->by_old);
+    free(dn);
+    return err;
+}
+
+int denormalize(const struct norm_info * info, uint8_t * new, size_t new_size) {
+    struct denorm * dn;
+    int64_t done;
+    int err = denorm_begin(info, new_size, &dn);
+    if (err != QBERR_OK) return err;
+    err = denorm_window(dn, new, 0, new_size, &done);
+    int end = denorm_end(dn);
+    return err != QBERR_OK ? err : end;
+}
+
+// Serialized as varints: the architecture, the code ranges as gaps and lengths, the regions
+// in columns of gaps, changes of offset and lengths, then the number of flags and the flags.
+int norm_encode(const struct norm_info * info, uint8_t ** buf, size_t * len) {
+    *buf = malloc(9 * (3 + 2 * info->nranges + 3 * info->nregions) + (info->nflags + 7) / 8);
+    if (!*buf) return QBERR_NOMEM;
+    uint8_t * p = *buf;
+    p += put_varint(info->arch, p);
+    p += put_varint(info->nranges, p);
+    for (int64_t i = 0, end = 0; i < info->nranges; end = info->ranges[2 * i + 1], i++) {
+        p += put_varint(info->ranges[2 * i] - end, p);
+        p += put_varint(info->ranges[2 * i + 1] - info->ranges[2 * i], p);
+    }
+    p += put_varint(info->nregions, p);
+    for (int64_t i = 0, end = 0; i < info->nregions; end = info->regions[i].new_pos + info->regions[i].len, i++)
+        p += put_varint(info->regions[i].new_pos - end, p);
+    for (int64_t i = 0, off = 0; i < info->nregions; off = info->regions[i].old_pos - info->regions[i].new_pos, i++)
+        p += put_varint(zigzag(info->regions[i].old_pos - info->regions[i].new_pos - off), p);
+    for (int64_t i = 0; i < info->nregions; i++) p += put_varint(info->regions[i].len, p);
+    p += put_varint(info->nflags, p);
+    memcpy(p, info->flags, (info->nflags + 7) / 8);
+    *len = p - *buf + (info->nflags + 7) / 8;
+    return QBERR_OK;
+}
+
+int norm_decode(const uint8_t * buf, size_t len, struct norm_info * info) {
+    const uint8_t *p = buf, *end = buf + len;
+    uint64_t v[3];
+    memset(info, 0, sizeof(*info));
+    // Every value is kept well within range, so that sums of a few of them cannot overflow.
+#define GET(x)                                                                       \
+    do {                                                                             \
+        if (!read_varint(&p, end, &(x)) || (x) > ((uint64_t)1 << 60)) goto bad;     \
+    } while (0)
+
+    GET(v[0]);
+    info->arch = v[0];
+    if (info->arch != NORM_X86_64 && info->arch != NORM_ARM64) goto bad;
+
+    GET(v[0]);
+    if (v[0] > len) goto bad;
+    info->nranges = v[0];
+    info->ranges = malloc((2 * info->nranges + 1) * sizeof(int64_t));
+    if (!info->ranges) return QBERR_NOMEM;
+    for (int64_t i = 0, pos = 0; i < info->nranges; i++) {
+        GET(v[0]);
+        GET(v[1]);
+        info->ranges[2 * i] = pos += v[0];
+        info->ranges[2 * i + 1] = pos += v[1];
+        if (pos > (int64_t)1 << 60) goto bad;
+    }
+
+    GET(v[0]);
+    if (v[0] > len) goto bad;
+    info->nregions = v[0];
+    info->regions = malloc((info->nregions + 1) * sizeof(struct norm_region));
+    if (!info->regions) return QBERR_NOMEM;
+    for (int64_t i = 0, pos = 0; i < info->nregions; i++) {
+        GET(v[0]);
+        info->regions[i].new_pos = pos += v[0];
+        info->regions[i].len = 0;
+        if (pos > (int64_t)1 << 60) goto bad;
+    }
+    for (int64_t i = 0, off = 0; i < info->nregions; i++) {
+        GET(v[0]);
+        off += unzigzag(v[0]);
+        if (off > (int64_t)1 << 60 || off < -((int64_t)1 << 60)) goto bad;
+        info->regions[i].old_pos = info->regions[i].new_pos + off;
+    }
+    for (int64_t i = 0, shift = 0; i < info->nregions; i++) {
+        GET(v[0]);
+        info->regions[i].new_pos += shift;
+        info->regions[i].old_pos += shift;
+        info->regions[i].len = v[0];
+        shift += v[0];
+        if (info->regions[i].new_pos > (int64_t)1 << 60) goto bad;
+    }
+
+    GET(v[0]);
+    info->nflags = v[0];
+    if ((uint64_t)(end - p) != (v[0] + 7) / 8) goto bad;
+    info->flags = malloc((v[0] + 7) / 8 + 1);
+    if (!info->flags) return QBERR_NOMEM;
+    memcpy(info->flags, p, (v[0] + 7) / 8);
+    return QBERR_OK;
+#undef GET
+
+bad:
+    return QBERR_BADPATCH;
+}
+
+void norm_free(struct norm_info * info) {
+    free(info->ranges);
+    free(info->regions);
+    free(info->flags);
+    memset(info, 0, sizeof(*info));
+}
@@ -0,0 +1,527 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Parallel stages. With OpenMP, pool_run() is a parallel region whose master runs the stage
+// and whose other threads pick up its tasks, and queues are task dependences. Without it, or
+// with a host executor, the stage gets a team that holds a list of ready tasks; the tasks of
+// a queue are held back on the queue until the one before them is done. The team runs its
+// tasks on POSIX threads started for each pool_run(), as stages are few and long, or on the
+// host executor, which is handed one host task per ready task. A host task runs whichever
+// task is ready first, if any is left by then.
+
+#include "pool.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_OPENMP)
+    #include <omp.h>
+#else
+    #include <unistd.h>
+#endif
+
+struct pool_args {
+    union {
+        uint64_t align;
+        unsigned char data[POOL_ARG_SIZE];
+    };
+};
+
+struct pool_job {
+    struct pool_job * next;
+    struct pool_queue * q;
+    void (*fn)(void * arg);
+    struct pool_args a;
+};
+
+struct team {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;            // Signalled when a task is ready or the last one is done.
+    struct pool_job *head, *tail;  // Ready to run.
+    int64_t pending;               // Submitted and not done.
+    int stop;
+    bool host;
+    struct qbdiff_executor ex;
+    // The stage and the host tasks not run yet, which may outlive it: the last one frees the
+    // team.
+    int64_t refs;
+};
+
+// The team of the pool_run() that the thread works for, if any.
+static __thread struct team * current;
+
+// Makes a task ready. Returns whether a host task is due for it, which is submitted once the
+// lock is released, as the host may well run it right away.
+static bool ready(struct team * t, struct pool_job * job) {
+    job->next = NULL;
+    if (t->tail)
+        t->tail->next = job;
+    else
+        t->head = job;
+    t->tail = job;
+    pthread_cond_signal(&t->cond);
+    if (!t->host) return false;
+    t->refs++;
+    return true;
+}
+
+static void host_task(void * arg);
+
+// Runs the first ready task. Called and returns with the lock held.
+static void run_one(struct team * t) {
+    struct pool_job * job = t->head;
+    if (!(t->head = job->next)) t->tail = NULL;
+    pthread_mutex_unlock(&t->lock);
+    job->fn(job->a.data);
+    pthread_mutex_lock(&t->lock);
+
+    // Hands the queue over to its next task.
+    struct pool_queue * q = job->q;
+    bool host = false;
+    if (q && q->head) {
+        struct pool_job * next = q->head;
+        if (!(q->head = next->next)) q->tail = NULL;
+        host = ready(t, next);
+    } else if (q) {
+        q->busy = 0;
+    }
+    free(job);
+    if (host) {
+        pthread_mutex_unlock(&t->lock);
+        t->ex.submit(t->ex.host, host_task, t);
+        pthread_mutex_lock(&t->lock);
+    }
+    if (!--t->pending) pthread_cond_broadcast(&t->cond);
+}
+
+static void team_free(struct team * t) {
+    pthread_mutex_destroy(&t->lock);
+    pthread_cond_destroy(&t->cond);
+    free(t);
+}
+
+static void host_task(void * arg) {
+    struct team *t = arg, *outer = current;
+    current = t;
+    pthread_mutex_lock(&t->lock);
+    if (t->head) run_one(t);
+    bool last = !--t->refs;
+    pthread_mutex_unlock(&t->lock);
+    current = outer;
+    if (last) team_free(t);
+}
+
+static void * worker(void * arg) {
+    struct team * t = current = arg;
+    pthread_mutex_lock(&t->lock);
+    for (;;) {
+        if (t->head)
+            run_one(t);
+        else if (t->stop)
+            break;
+        else
+            pthread_cond_wait(&t->cond, &t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+    return NULL;
+}
+
+static void team_run(const struct qbdiff_executor * ex, int threads, void (*fn)(void * arg), void * arg) {
+    struct team * t = calloc(1, sizeof(struct team));
+    pthread_t * workers = t && !ex ? malloc(threads * sizeof(pthread_t)) : NULL;
+    struct team * outer = current;
+    int n = 0;
+    if (t) {
+        pthread_mutex_init(&t->lock, NULL);
+        pthread_cond_init(&t->cond, NULL);
+        t->refs = 1;
+        if (ex) {
+            t->host = true;
+            t->ex = *ex;
+        }
+        while (workers && n < threads - 1 && !pthread_create(&workers[n], NULL, worker, t)) n++;
+    }
+
+    // With no other threads, tasks run as they are submitted.
+    current = t && (ex ? threads > 1 : n > 0) ? t : NULL;
+    fn(arg);
+    pool_wait();
+    current = outer;
+    if (!t) return;
+
+    pthread_mutex_lock(&t->lock);
+    t->stop = 1;
+    pthread_cond_broadcast(&t->cond);
+    bool last = !--t->refs;
+    pthread_mutex_unlock(&t->lock);
+    for (int i = 0; i < n; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    if (last) team_free(t);
+}
+
+void pool_run(const struct qbdiff_executor * ex, int threads, void (*fn)(void * arg), void * arg) {
+    if (threads <= 0) threads = pool_threads();
+    if (ex && !ex->submit) ex = NULL;
+#if defined(_OPENMP)
+    if (!ex) {
+    #pragma omp parallel num_threads(threads)
+    #pragma omp single
+        fn(arg);
+        return;
+    }
+#endif
+    team_run(ex, threads, fn, arg);
+}
+
+void pool_submit(struct pool_queue * q, void (*fn)(void * arg), const void * arg, size_t size) {
+    struct team * t = current;
+#if defined(_OPENMP)
+    if (!t) {
+        struct pool_args a;
+        memcpy(a.data, arg, size);
+        if (q) {
+    #pragma omp task firstprivate(fn, a) depend(inout : q[0])
+            fn(a.data);
+        } else {
+    #pragma omp task firstprivate(fn, a)
+            fn(a.data);
+        }
+        return;
+    }
+#endif
+    struct pool_job * job = t ? malloc(sizeof(struct pool_job)) : NULL;
+    if (!job) {
+        // Run in place, after whatever the queue holds.
+        if (t) pool_wait();
+        struct pool_args a;
+        memcpy(a.data, arg, size);
+        fn(a.data);
+        return;
+    }
+    job->q = q;
+    job->fn = fn;
+    memcpy(job->a.data, arg, size);
+
+    bool host = false;
+    pthread_mutex_lock(&t->lock);
+    t->pending++;
+    if (q && q->busy) {
+        job->next = NULL;
+        if (q->tail)
+            q->tail->next = job;
+        else
+            q->head = job;
+        q->tail = job;
+    } else {
+        if (q) q->busy = 1;
+        host = ready(t, job);
+    }
+    pthread_mutex_unlock(&t->lock);
+    if (host) t->ex.submit(t->ex.host, host_task, t);
+}
+
+// Ready tasks are run here rather than left to the host, so the stage never waits on a host
+// that is busy elsewhere, or on the very thread it runs on.
+void pool_wait(void) {
+    struct team * t = current;
+    if (!t) {
+#if defined(_OPENMP)
+    #pragma omp taskwait
+#endif
+        return;
+    }
+    pthread_mutex_lock(&t->lock);
+    while (t->pending) {
+        if (t->head)
+            run_one(t);
+        else
+            pthread_cond_wait(&t->cond, &t->lock);
+    }
+    pthread_mutex_unlock(&t->lock);
+}
+
+struct pool_range {
+    void (*fn)(void * arg, int64_t i);
+    void * arg;
+    int64_t n, next;
+    int threads;
+};
+
+static void range_worker(void * arg) {
+    struct pool_range * r = *(struct pool_range **)arg;
+    for (int64_t i; (i = __atomic_fetch_add(&r->next, 1, __ATOMIC_RELAXED)) < r->n;) r->fn(r->arg, i);
+}
+
+static void range_run(void * arg) {
+    struct pool_range * r = arg;
+    for (int i = 1; i < r->threads; i++) pool_submit(NULL, range_worker, &r, sizeof(r));
+    range_worker(&r);
+}
+
+void pool_for(const struct qbdiff_executor * ex, int threads, int64_t n, void (*fn)(void * arg, int64_t i),
+              void * arg) {
+    if (threads <= 0) threads = pool_threads();
+#if defined(_OPENMP)
+    if (!ex || !ex->submit) {
+    #pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (int64_t i = 0; i < n; i++) fn(arg, i);
+        return;
+    }
+#endif
+    struct pool_range r = { fn, arg, n, 0, n < threads ? (int)n : threads };
+    if (n > 0) pool_run(ex, r.threads, range_run, &r);
+}
+
+int pool_threads(void) {
+#if defined(_OPENMP)
+    return omp_get_max_threads();
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+// Regions wait for every thread at barriers, so each of their threads must be running, not
+// queued as a task. A gang is a set of threads that stay in it until it is done, each picking
+// up one thread number of a region at a time; a region is given no more threads than the gang
+// has. Its size is fixed before its first region, as a region may pick up where the one before
+// it left off with the same number of threads.
+
+// How long a gang waits for the host to run its tasks, in nanoseconds.
+#define GANG_WAIT 10000000
+
+struct gang {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;  // Signalled when a region starts or is done, and at barriers.
+    int size, joined, closed, stop;
+    // The current region and the thread numbers handed out, and those not done yet.
+    void (*fn)(void * arg);
+    void * arg;
+    int threads, next, running;
+    // Threads at the barrier, and barriers passed.
+    int arrived, passed;
+    // The gang and the host tasks not run yet, which may outlive it: the last one frees the gang.
+    int64_t refs;
+};
+
+// The gang of the thread, and its place in the region it runs, if any. Regions of one thread
+// run on their own, with OpenMP too.
+static __thread struct gang * gang;
+static __thread int gang_num, gang_threads = 1, alone;
+
+// Runs regions until the gang is done. Called and returns with the lock held.
+static void gang_member(struct gang * g) {
+    gang = g;
+    for (;;) {
+        if (g->next < g->threads) {
+            int num = g->next++, threads = g->threads;
+            pthread_mutex_unlock(&g->lock);
+            gang_num = num;
+            gang_threads = threads;
+            g->fn(g->arg);
+            gang_num = 0;
+            gang_threads = 1;
+            pthread_mutex_lock(&g->lock);
+            if (!--g->running) pthread_cond_broadcast(&g->cond);
+        } else if (g->stop) {
+            break;
+        } else {
+            pthread_cond_wait(&g->cond, &g->lock);
+        }
+    }
+    gang = NULL;
+}
+
+static void gang_free(struct gang * g) {
+    pthread_mutex_destroy(&g->lock);
+    pthread_cond_destroy(&g->cond);
+    free(g);
+}
+
+static void gang_task(void * arg) {
+    struct gang *g = arg, *outer = gang;
+    pthread_mutex_lock(&g->lock);
+    if (!g->closed && outer != g) {
+        g->joined++;
+        pthread_cond_broadcast(&g->cond);
+        gang_member(g);
+    }
+    bool last = !--g->refs;
+    pthread_mutex_unlock(&g->lock);
+    gang = outer;
+    if (last) gang_free(g);
+}
+
+static void * gang_worker(void * arg) {
+    struct gang * g = arg;
+    pthread_mutex_lock(&g->lock);
+    gang_member(g);
+    pthread_mutex_unlock(&g->lock);
+    return NULL;
+}
+
+void pool_gang(const struct qbdiff_executor * ex, int threads, void (*fn)(void * arg, int threads), void * arg) {
+    if (threads <= 0) threads = pool_threads();
+    if (ex && !ex->submit) ex = NULL;
+#if defined(_OPENMP)
+    if (!ex) {
+        fn(arg, threads);
+        return;
+    }
+#endif
+    struct gang * g = threads > 1 && !gang ? calloc(1, sizeof(struct gang)) : NULL;
+    pthread_t * workers = g && !ex ? malloc((threads - 1) * sizeof(pthread_t)) : NULL;
+    if (!g || (!ex && !workers)) {
+        free(g);
+        fn(arg, 1);
+        return;
+    }
+    pthread_mutex_init(&g->lock, NULL);
+    pthread_cond_init(&g->cond, NULL);
+    g->refs = 1;
+
+    int n = 0;
+    if (ex) {
+        // Host tasks that the host runs right away, on this thread, find the gang here.
+        gang = g;
+        g->refs += threads - 1;
+        for (int i = 1; i < threads; i++) ex->submit(ex->host, gang_task, g);
+        gang = NULL;
+        struct timespec until;
+        clock_gettime(CLOCK_REALTIME, &until);
+        until.tv_nsec += GANG_WAIT;
+        until.tv_sec += until.tv_nsec / 1000000000;
+        until.tv_nsec %= 1000000000;
+        pthread_mutex_lock(&g->lock);
+        while (g->joined < threads - 1)
+            if (pthread_cond_timedwait(&g->cond, &g->lock, &until)) break;
+        n = g->joined;
+    } else {
+        while (n < threads - 1 && !pthread_create(&workers[n], NULL, gang_worker, g)) n++;
+        pthread_mutex_lock(&g->lock);
+    }
+    g->size = 1 + n;
+    g->closed = 1;
+    pthread_mutex_unlock(&g->lock);
+
+    gang = g;
+    fn(arg, g->size);
+    gang = NULL;
+
+    pthread_mutex_lock(&g->lock);
+    g->stop = 1;
+    pthread_cond_broadcast(&g->cond);
+    bool last = !--g->refs;
+    pthread_mutex_unlock(&g->lock);
+    if (!ex)
+        for (int i = 0; i < n; i++) pthread_join(workers[i], NULL);
+    free(workers);
+    if (last) gang_free(g);
+}
+
+void pool_parallel(int threads, void (*fn)(void * arg), void * arg) {
+    struct gang * g = gang;
+    // Without a gang, only OpenMP has threads to offer.
+#if defined(_OPENMP)
+    bool none = g && g->size == 1;
+#else
+    bool none = !g || g->size == 1;
+#endif
+    if (threads <= 1 || alone || gang_threads > 1 || none) {
+        int num = gang_num, outer = gang_threads;
+        gang_num = 0;
+        gang_threads = 1;
+        alone++;
+        fn(arg);
+        alone--;
+        gang_num = num;
+        gang_threads = outer;
+        return;
+    }
+#if defined(_OPENMP)
+    if (!g) {
+    #pragma omp parallel num_threads(threads)
+        fn(arg);
+        return;
+    }
+#endif
+    threads = threads < g->size ? threads : g->size;
+    pthread_mutex_lock(&g->lock);
+    g->fn = fn;
+    g->arg = arg;
+    g->threads = threads;
+    g->next = 1;
+    g->running = threads - 1;
+    pthread_cond_broadcast(&g->cond);
+    pthread_mutex_unlock(&g->lock);
+
+    gang_threads = threads;
+    fn(arg);
+    gang_threads = 1;
+
+    pthread_mutex_lock(&g->lock);
+    while (g->running) pthread_cond_wait(&g->cond, &g->lock);
+    g->threads = g->next = 0;
+    pthread_mutex_unlock(&g->lock);
+}
+
+int pool_thread_num(void) {
+#if defined(_OPENMP)
+    if (!gang && !alone) return omp_get_thread_num();
+#endif
+    return gang_num;
+}
+
+int pool_num_threads(void) {
+#if defined(_OPENMP)
+    if (!gang && !alone) return omp_get_num_threads();
+#endif
+    return gang_threads;
+}
+
+void pool_barrier(void) {
+    struct gang * g = gang;
+    if (alone) return;
+#if defined(_OPENMP)
+    if (!g) {
+    #pragma omp barrier
+        return;
+    }
+#endif
+    if (!g || gang_threads == 1) return;
+    pthread_mutex_lock(&g->lock);
+    int passed = g->passed;
+    if (++g->arrived == gang_threads) {
+        g->arrived = 0;
+        g->passed++;
+        pthread_cond_broadcast(&g->cond);
+    } else {
+        while (g->passed == passed) pthread_cond_wait(&g->cond, &g->lock);
+    }
+    pthread_mutex_unlock(&g->lock);
+}
+
+int pool_dynamic(void) {
+#if defined(_OPENMP)
+    if (!gang) return omp_get_dynamic();
+#endif
+    return 0;
+}
@@ -22,32 +22,152 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libqbdiff.h"
 #include "libqbdiff_private.h"
 
+// Parses a byte count with an optional K, M or G suffix; returns -1 if malformed.
+static int64_t parse_size(const char * s) {
+    char * end;
+    int64_t v = strtoll(s, &end, 10);
+    switch (*end) {
+        case 'G': v <<= 10;  // Fall through.
+        case 'M': v <<= 10;  // Fall through.
+        case 'K': v <<= 10; end++;
+    }
+    return end == s || *end || v < 0 ? -1 : v;
+}
+
+// Parses a comma-separated list of streams; returns -1 if malformed.
+static int parse_streams(const char * s) {
+    static const struct {
+        const char * name;
+        int mask;
+    } names[] = { { "diff", QBDIFF_STREAM_DIFF }, { "extra", QBDIFF_STREAM_EXTRA }, { "full", QBDIFF_STREAM_FULL } };
+    int mask = 0;
+    while (*s) {
+        size_t len = strcspn(s, ","), i;
+        for (i = 0; i < 3; i++)
+            if (strlen(names[i].name) == len && !strncmp(s, names[i].name, len)) break;
+        if (i == 3) return -1;
+        mask |= names[i].mask;
+        s += len + (s[len] == ',');
+    }
+    return mask ? mask : -1;
+}
+
 int main(int argc, char * argv[]) {
-    if (argc < 4) {
+    struct qbdiff_options opts;
+    qbdiff_options_init(&opts);
+
+    char * files[3];
+    int nfiles = 0, bad = 0, estimate = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--engine=sa"))
+            opts.engine = QBDIFF_ENGINE_SA;
+        else if (!strcmp(argv[i], "--engine=hash"))
+            opts.engine = QBDIFF_ENGINE_HASH;
+        else if (!strcmp(argv[i], "--filter=auto"))
+            opts.filter = QBDIFF_FILTER_AUTO;
+        else if (!strcmp(argv[i], "--filter=none"))
+            opts.filter = QBDIFF_FILTER_NONE;
+        else if (!strcmp(argv[i], "--filter=x86"))
+            opts.filter = QBDIFF_FILTER_X86;
+        else if (!strcmp(argv[i], "--filter=arm64"))
+            opts.filter = QBDIFF_FILTER_ARM64;
+        else if (!strncmp(argv[i], "--filter-streams=", 17))
+            bad |= (opts.filter_streams = parse_streams(argv[i] + 17)) < 0;
+        else if (!strncmp(argv[i], "--scratch-dir=", 14))
+            opts.scratch_dir = argv[i] + 14;
+        else if (!strncmp(argv[i], "--memory-limit=", 15))
+            bad |= (opts.memory_limit = parse_size(argv[i] + 15)) < 0;
+        else if (!strcmp(argv[i], "--normalize"))
+            opts.normalize = 1;
+        else if (!strcmp(argv[i], "--no-normalize"))
+            opts.normalize = 0;
+        else if (!strcmp(argv[i], "--extra-dict"))
+            opts.extra_dict = 1;
+        else if (!strcmp(argv[i], "--seekable"))
+            opts.seekable = 4 << 20;
+        else if (!strncmp(argv[i], "--seekable=", 11))
+            bad |= (opts.seekable = parse_size(argv[i] + 11)) <= 0;
+        else if (!strcmp(argv[i], "--in-place"))
+            opts.in_place = 1 << 20;
+        else if (!strncmp(argv[i], "--in-place=", 11))
+            bad |= (opts.in_place = parse_size(argv[i] + 11)) <= 0;
+        else if (!strcmp(argv[i], "--fingerprint=sampled"))
+            opts.fingerprint = 0;
+        else if (!strcmp(argv[i], "--fingerprint=full"))
+            opts.fingerprint = 1;
+        else if (!strcmp(argv[i], "--fingerprint=none"))
+            opts.fingerprint = -1;
+        else if (!strcmp(argv[i], "--estimate"))
+            estimate = 1;
+        else if (!strncmp(argv[i], "--", 2) || nfiles == 3)
+            bad = 1;
+        else
+            files[nfiles++] = argv[i];
+    }
+
+    if (nfiles != 3 - estimate || bad) {
         fprintf(stderr,
                 "qbdiff %s - Quick Binary Diff\n"
-                "Usage: qbdiff oldfile newfile deltafile\n\n"
-                "Creates a binary patch DELTAFILE from OLDFILE to NEWFILE.\n",
+                "Usage: qbdiff [--engine=sa|hash] [--filter=auto|none|x86|arm64]\n"
+                "              [--filter-streams=diff,extra,full] [--scratch-dir=DIR]\n"
+                "              [--memory-limit=SIZE] [--normalize] [--extra-dict]\n"
+                "              [--seekable[=SIZE]] [--in-place[=SIZE]]\n"
+                "              [--fingerprint=sampled|full|none]\n"
+                "              oldfile newfile deltafile\n"
+                "       qbdiff --estimate oldfile newfile\n\n"
+                "Creates a binary patch DELTAFILE from OLDFILE to NEWFILE, or - for the\n"
+                "standard output.\n"
+                "--estimate predicts the size of the patch from a sample instead.\n"
+                "--engine=hash trades slightly larger patches for much faster diffing.\n"
+                "--filter applies a BCJ filter for executables to the given streams.\n"
+                "--scratch-dir diffs inputs too large for SIZE (default: half of RAM) with\n"
+                "temporary files in DIR.\n"
+                "--normalize also diffs ELF executables with their branches rewritten, and\n"
+                "keeps the smaller patch.\n"
+                "--extra-dict compresses new data with the old file as a dictionary.\n"
+                "--seekable cuts the patch into blocks of SIZE (default: 4M) of NEWFILE that\n"
+                "can be rebuilt on their own.\n"
+                "--in-place makes a seekable patch that qbpatch --in-place can apply over\n"
+                "OLDFILE itself, with a spill buffer of SIZE (default: 1M).\n"
+                "--fingerprint picks how much of OLDFILE the patch records a hash of, which\n"
+                "qbpatch checks before anything else.\n",
                 qbdiff_version());
         return 1;
     }
 
     struct file_mapping old_file, new_file;
-    old_file = map_file(argv[1]);
-    new_file = map_file(argv[2]);
+    old_file = map_file(files[0]);
+    new_file = map_file(files[1]);
+
+    if (estimate) {
+        struct qbdiff_estimate est;
+        int ret = qbdiff_estimate(old_file.data, new_file.data, old_file.length, new_file.length, &est, &opts);
+        if (ret != QBERR_OK) {
+            fprintf(stderr, "Failed to estimate delta (error %d: %s)\n", ret, qbdiff_error(ret));
+            return 1;
+        }
+        printf("%lld bytes, 95%% interval %lld-%lld (control %lld, diff %lld, extra %lld, full copy %lld, "
+               "%.1f%% sampled)\n",
+               (long long)est.size, (long long)est.low, (long long)est.high, (long long)est.cb, (long long)est.db,
+               (long long)est.eb, (long long)est.full, 100 * est.sampled);
+        unmap_file(old_file);
+        unmap_file(new_file);
+        return 0;
+    }
 
-    FILE * delta_file = fopen(argv[3], "wb");
+    FILE * delta_file = strcmp(files[2], "-") ? fopen(files[2], "wb") : stdout;
     if (!delta_file) {
-        fprintf(stderr, "Failed to open delta file %s for writing: %s\n", argv[3], strerror(errno));
+        fprintf(stderr, "Failed to open delta file %s for writing: %s\n", files[2], strerror(errno));
         return 1;
     }
 
-    int ret = qbdiff_compute(old_file.data, new_file.data, old_file.length, new_file.length, delta_file);
+    int ret = qbdiff_compute_ex(old_file.data, new_file.data, old_file.length, new_file.length, delta_file, &opts);
     if (ret != QBERR_OK) {
         fprintf(stderr, "Failed to create delta (error %d: %s)\n", ret, qbdiff_error(ret));
         return 1;
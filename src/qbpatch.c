@@ -22,33 +22,96 @@
 #include <errno.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "libqbdiff.h"
 #include "libqbdiff_private.h"
 
 int main(int argc, char * argv[]) {
-    if (argc < 4) {
+    int verify = argc > 1 && !strcmp(argv[1], "--verify"), in_place = argc > 1 && !strcmp(argv[1], "--in-place");
+    int resume = argc > 1 && !strcmp(argv[1], "--resume");
+    if (resume) {
+        argv++;
+        argc--;
+    }
+    if (argc < 4 || ((verify || in_place) && argc != 4) ||
+        (resume && (argc != 4 || !strcmp(argv[2], "-") || !strcmp(argv[3], "-")))) {
         fprintf(stderr,
                 "qbdiff %s - Quick Binary Diff\n"
-                "Usage: qbpatch oldfile newfile deltafile\n\n"
+                "Usage: qbpatch [--resume] oldfile newfile deltafile\n"
+                "       qbpatch --verify oldfile deltafile\n"
+                "       qbpatch --in-place file deltafile\n\n"
                 "Applies the binary patch DELTAFILE to OLDFILE to create file "
-                "NEWFILE.\n",
+                "NEWFILE.\n"
+                "- for NEWFILE or DELTAFILE stands for the standard output or input.\n"
+                "--verify checks that DELTAFILE applies to OLDFILE without writing anything.\n"
+                "--in-place turns FILE into the new file, journaling its progress in\n"
+                "FILE.journal; run it again to resume after an interruption.\n"
+                "--resume records checkpoints in NEWFILE.checkpoint, and picks up from the\n"
+                "last one if an earlier run was interrupted.\n",
                 qbdiff_version());
         return 1;
     }
 
-    struct file_mapping old_file, delta_file;
+    if (in_place) {
+        struct file_mapping delta_file = map_file(argv[3]);
+        char * journal = malloc(strlen(argv[2]) + 9);
+        if (!journal) return 1;
+        sprintf(journal, "%s.journal", argv[2]);
+        int ret = qbdiff_patch_in_place(argv[2], delta_file.data, delta_file.length, journal, NULL);
+        if (ret != QBERR_OK) {
+            fprintf(stderr, "Failed to patch in place (error %d: %s)\n", ret, qbdiff_error(ret));
+            return 1;
+        }
+        free(journal);
+        unmap_file(delta_file);
+        return 0;
+    }
+
+    if (resume) {
+        struct file_mapping old_file = map_file(argv[1]), delta_file = map_file(argv[3]);
+        char * checkpoint = malloc(strlen(argv[2]) + 12);
+        if (!checkpoint) return 1;
+        sprintf(checkpoint, "%s.checkpoint", argv[2]);
+        int ret = qbdiff_patch_resume(old_file.data, delta_file.data, old_file.length, delta_file.length, argv[2],
+                                      checkpoint, NULL);
+        if (ret != QBERR_OK) {
+            fprintf(stderr, "Failed to patch (error %d: %s)\n", ret, qbdiff_error(ret));
+            return 1;
+        }
+        free(checkpoint);
+        unmap_file(old_file);
+        unmap_file(delta_file);
+        return 0;
+    }
+
+    if (verify) {
+        struct file_mapping old_file = map_file(argv[2]), delta_file = map_file(argv[3]);
+        int ret = qbdiff_verify(old_file.data, delta_file.data, old_file.length, delta_file.length, NULL);
+        if (ret != QBERR_OK) {
+            fprintf(stderr, "Patch does not apply (error %d: %s)\n", ret, qbdiff_error(ret));
+            return 1;
+        }
+        unmap_file(old_file);
+        unmap_file(delta_file);
+        return 0;
+    }
+
+    // A patch on the standard input is applied as it arrives.
+    int piped = !strcmp(argv[3], "-");
+    struct file_mapping old_file, delta_file = { 0 };
     old_file = map_file(argv[1]);
-    delta_file = map_file(argv[3]);
+    if (!piped) delta_file = map_file(argv[3]);
 
-    FILE * new_file = fopen(argv[2], "wb");
+    FILE * new_file = strcmp(argv[2], "-") ? fopen(argv[2], "wb") : stdout;
     if (!new_file) {
         fprintf(stderr, "Failed to open new file %s for writing: %s\n", argv[2], strerror(errno));
         return 1;
     }
 
-    int ret = qbdiff_patch(old_file.data, delta_file.data, old_file.length, delta_file.length, new_file);
+    int ret = piped ? qbdiff_patch_stream(old_file.data, stdin, old_file.length, new_file, NULL)
+                    : qbdiff_patch(old_file.data, delta_file.data, old_file.length, delta_file.length, new_file);
     if (ret != QBERR_OK) {
         fprintf(stderr, "Failed to patch (error %d: %s)\n", ret, qbdiff_error(ret));
         return 1;
@@ -57,7 +120,7 @@ int main(int argc, char * argv[]) {
     close_out_file(new_file);
 
     unmap_file(old_file);
-    unmap_file(delta_file);
+    if (!piped) unmap_file(delta_file);
 
     return 0;
 }
@@ -0,0 +1,52 @@
+#!/bin/sh
+# Performance smoke test: runs qbbench on a small fixed corpus and compares it against
+# tests/perf-baseline.csv. Patch sizes are deterministic and may grow by at most
+# QBDIFF_PERF_SIZE_SLACK percent (default 2); this is all that `make check' runs. With
+# --throughput (`make perf-check'), diff and patch throughput may also drop by at most
+# QBDIFF_PERF_TOLERANCE (default 0.5, i.e. half of the baseline). Throughput depends on the
+# machine and its load, so that check only makes sense against a baseline recorded on the same
+# machine, when it is otherwise idle. Set QBDIFF_PERF_SKIP=1 to skip, and regenerate the
+# baseline with `make perf-baseline' (which passes --update) after an intended change.
+
+: "${srcdir:=$(dirname "$0")/..}"
+: "${QBDIFF_PERF_TOLERANCE:=0.5}"
+: "${QBDIFF_PERF_SIZE_SLACK:=2}"
+
+baseline="$srcdir/tests/perf-baseline.csv"
+qbbench=./benchmark/qbbench
+[ -x "$qbbench" ] || { echo "$qbbench has not been built."; exit 99; }
+
+# Sizes need a single run.
+throughput=0 runs=1
+[ "$1" = --throughput ] || [ "$1" = --update ] && throughput=1 runs=3
+flags="-k mixed,insert,text,reloc -z 256K,1M -t 1 -r $runs -f csv"
+
+if [ "$1" = --update ]; then
+    exec "$qbbench" $flags > "$baseline"
+fi
+
+[ "$QBDIFF_PERF_SKIP" = 1 ] && exit 77
+[ -f "$baseline" ] || { echo "No baseline at $baseline."; exit 77; }
+
+current=$(mktemp) || exit 99
+trap 'rm -f "$current"' EXIT
+"$qbbench" $flags > "$current" || status=$?
+
+# Fields: 1 kind, 2 size, 4 threads, 7 patch_size, 9 diff_mbps, 17 patch_mbps, 29 ok.
+awk -F, -v tol="$QBDIFF_PERF_TOLERANCE" -v slack="$QBDIFF_PERF_SIZE_SLACK" -v throughput=$throughput '
+    FNR == 1 { next }
+    NR == FNR { size[$1","$2","$4] = $7; diff[$1","$2","$4] = $9; patch[$1","$2","$4] = $17; next }
+    {
+        key = $1 "," $2 "," $4
+        if ($29 != 1) { printf "FAIL %s: round trip failed\n", key; bad++; next }
+        if (!(key in size)) { printf "SKIP %s: not in the baseline\n", key; next }
+        printf "%-20s patch %8d (%8d)  diff %8.2f MB/s (%8.2f)  patch %8.2f MB/s (%8.2f)\n", key, $7, size[key],
+               $9, diff[key], $17, patch[key]
+        if ($7 > size[key] * (1 + slack / 100)) { printf "FAIL %s: patch size regressed\n", key; bad++ }
+        if (!throughput) next
+        if ($9 < diff[key] * (1 - tol)) { printf "FAIL %s: diff throughput regressed\n", key; bad++ }
+        if ($17 < patch[key] * (1 - tol)) { printf "FAIL %s: patch throughput regressed\n", key; bad++ }
+    }
+    END { exit bad ? 1 : 0 }
+' "$baseline" "$current" || exit 1
+exit ${status:-0}
@@ -0,0 +1,910 @@
+/*
+ * qbdiff - Quick Binary Diff
+ * Copyright (C) 2023 Kamila Szewczyk
+ *
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of  MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Round-trip tests: diff generated old/new pairs, apply the patch and compare, and check
+// that damaged patches and wrong old files are rejected. Built twice by `make check', once
+// against the library and once with the 64-bit suffix array path and streaming compression
+// of small diffs forced.
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../benchmark/corpus.h"
+#include "libqbdiff.h"
+#include "libqbdiff_private.h"
+
+static int failures = 0;
+
+// Options of the diffs made by roundtrip(), switched to force the block hash pre-pass, the
+// hash engine, BCJ filters, the dictionary of the extra stream and out-of-core diffing.
+static struct qbdiff_options options;
+
+#define CHECK(cond, ...)                    \
+    do {                                    \
+        if (!(cond)) {                      \
+            printf("FAIL: " __VA_ARGS__);   \
+            printf(" (%s)\n", #cond);       \
+            failures++;                     \
+        }                                   \
+    } while (0)
+
+// Reads the whole of a temporary file back into memory.
+static uint8_t * slurp(FILE * f, size_t * len) {
+    fseek(f, 0, SEEK_END);
+    *len = ftell(f);
+    rewind(f);
+    uint8_t * buf = malloc(*len + 1);
+    if (!buf || fread(buf, 1, *len, f) != *len) {
+        fprintf(stderr, "Failed to read back a temporary file.\n");
+        exit(99);
+    }
+    return buf;
+}
+
+static uint8_t * make_patch(const uint8_t * old, size_t old_len, const uint8_t * new, size_t new_len,
+                            size_t * patch_len) {
+    FILE * f = tmpfile();
+    if (!f) exit(99);
+    int ret = qbdiff_compute_ex(old, new, old_len, new_len, f, &options);
+    CHECK(ret == QBERR_OK, "qbdiff_compute returned %d", ret);
+    uint8_t * patch = slurp(f, patch_len);
+    fclose(f);
+    return patch;
+}
+
+// A patch without the fingerprint of the old file in front, for tests of the formats behind it.
+static uint8_t * make_bare_patch(const uint8_t * old, size_t old_len, const uint8_t * new, size_t new_len,
+                                 size_t * patch_len) {
+    uint8_t * patch = make_patch(old, old_len, new, new_len, patch_len);
+    size_t skip = memcmp(patch, "QBDO1", 5) ? 0 : 78 + (patch[5] & 1) * 64;
+    memmove(patch, patch + skip, *patch_len - skip);
+    *patch_len -= skip;
+    return patch;
+}
+
+static int apply(const uint8_t * old, size_t old_len, const uint8_t * patch, size_t patch_len, uint8_t ** out,
+                 size_t * out_len) {
+    FILE * f = tmpfile();
+    if (!f) exit(99);
+    int ret = qbdiff_patch(old, patch, old_len, patch_len, f);
+    *out = slurp(f, out_len);
+    fclose(f);
+    return ret;
+}
+
+// Applies the first patch_len bytes of a patch as qbpatch does when it is piped in.
+static int apply_stream(const uint8_t * old, size_t old_len, const uint8_t * patch, size_t patch_len, uint8_t ** out,
+                        size_t * out_len) {
+    FILE *in = tmpfile(), *f = tmpfile();
+    if (!in || !f || fwrite(patch, 1, patch_len, in) != patch_len) exit(99);
+    rewind(in);
+    int ret = qbdiff_patch_stream(old, in, old_len, f, &options);
+    *out = slurp(f, out_len);
+    fclose(in);
+    fclose(f);
+    return ret;
+}
+
+// Files that the library opens by name live under TMPDIR.
+static void temp_path(char path[256]) {
+    const char * tmpdir = getenv("TMPDIR");
+    snprintf(path, 256, "%s/qbdiff-test-XXXXXX", tmpdir ? tmpdir : "/tmp");
+    int fd = mkstemp(path);
+    if (fd < 0) exit(99);
+    close(fd);
+}
+
+static void write_path(const char * path, const uint8_t * data, size_t len) {
+    FILE * f = fopen(path, "wb");
+    if (!f || fwrite(data, 1, len, f) != len || fclose(f)) exit(99);
+}
+
+static uint8_t * read_path(const char * path, size_t * len) {
+    FILE * f = fopen(path, "rb");
+    if (!f) exit(99);
+    uint8_t * data = slurp(f, len);
+    fclose(f);
+    return data;
+}
+
+static void roundtrip(const char * name, const uint8_t * old, size_t old_len, const uint8_t * new, size_t new_len) {
+    size_t patch_len, out_len;
+    uint8_t *out, *patch = make_patch(old, old_len, new, new_len, &patch_len);
+    int ret = apply(old, old_len, patch, patch_len, &out, &out_len);
+    CHECK(ret == QBERR_OK, "%s: qbdiff_patch returned %d", name, ret);
+    CHECK(out_len == new_len && !memcmp(out, new, new_len), "%s: output differs", name);
+    ret = qbdiff_verify(old, patch, old_len, patch_len, &options);
+    CHECK(ret == QBERR_OK, "%s: qbdiff_verify returned %d", name, ret);
+    printf("%-28s old %9zu new %9zu patch %8zu\n", name, old_len, new_len, patch_len);
+    free(out);
+    free(patch);
+}
+
+static void corpora(const char * suffix) {
+    static const size_t sizes[] = { 1000, 10000, 100000, 300000 };
+    for (int k = 0; k < CORPUS_KINDS; k++) {
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            struct corpus c;
+            char name[64];
+            if (corpus_generate(k, sizes[i], 7, &c)) exit(99);
+            snprintf(name, sizeof(name), "%s/%zu%s", corpus_kind_name(k), sizes[i], suffix);
+            roundtrip(name, c.old, c.old_len, c.new, c.new_len);
+            corpus_free(&c);
+        }
+    }
+}
+
+static void edge_cases(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_MIXED, 100000, 3, &c)) exit(99);
+    size_t n = c.old_len;
+
+    roundtrip("identical", c.old, n, c.old, n);
+    roundtrip("empty old", c.old, 0, c.new, c.new_len);
+    roundtrip("empty new", c.old, n, c.new, 0);
+    roundtrip("both empty", c.old, 0, c.new, 0);
+    roundtrip("tiny", c.old, 100, c.new, 200);
+    roundtrip("prefix of old", c.old, n, c.old, n / 2);
+    roundtrip("suffix of old", c.old, n, c.old + n / 2, n - n / 2);
+    roundtrip("unrelated", c.old, n / 2, c.old + n / 2, n - n / 2);
+
+    // Append-only: the old file followed by new data.
+    uint8_t * appended = malloc(n + c.new_len);
+    if (!appended) exit(99);
+    memcpy(appended, c.old, n);
+    memcpy(appended + n, c.new, c.new_len);
+    roundtrip("append", c.old, n, appended, n + c.new_len);
+
+    // A run of zeroes, which yields extremely repetitive suffixes.
+    uint8_t * zeroes = calloc(n, 1);
+    if (!zeroes) exit(99);
+    memcpy(appended, zeroes, n);
+    appended[n / 3] = 1;
+    roundtrip("zeroes", zeroes, n, appended, n);
+
+    free(zeroes);
+    free(appended);
+    corpus_free(&c);
+}
+
+static void damaged_patches(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_TEXT, 100000, 5, &c)) exit(99);
+
+    size_t patch_len, out_len;
+    uint8_t *out, *patch = make_bare_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+
+    // The wrong old file, and an old file of the wrong size.
+    uint8_t * other = malloc(c.old_len);
+    if (!other) exit(99);
+    memcpy(other, c.old, c.old_len);
+    other[c.old_len / 2] ^= 1;
+    CHECK(apply(other, c.old_len, patch, patch_len, &out, &out_len) == QBERR_BADCKSUM, "wrong old accepted");
+    free(out);
+    CHECK(qbdiff_verify(other, patch, c.old_len, patch_len, &options) == QBERR_BADCKSUM, "wrong old verified");
+    CHECK(apply(c.old, c.old_len - 1, patch, patch_len, &out, &out_len) != QBERR_OK, "short old accepted");
+    free(out);
+
+    // Truncations and single flipped bits anywhere in the patch.
+    for (size_t cut = 0; cut < patch_len; cut += 1 + patch_len / 37) {
+        CHECK(apply(c.old, c.old_len, patch, cut, &out, &out_len) != QBERR_OK, "patch truncated to %zu accepted",
+              cut);
+        CHECK(qbdiff_verify(c.old, patch, c.old_len, cut, &options) != QBERR_OK, "patch truncated to %zu verified",
+              cut);
+        free(out);
+    }
+    for (size_t pos = 0; pos < patch_len; pos += 1 + patch_len / 53) {
+        patch[pos] ^= 0x10;
+        CHECK(apply(c.old, c.old_len, patch, patch_len, &out, &out_len) != QBERR_OK, "bit flip at %zu accepted", pos);
+        CHECK(qbdiff_verify(c.old, patch, c.old_len, patch_len, &options) != QBERR_OK, "bit flip at %zu verified", pos);
+        free(out);
+        patch[pos] ^= 0x10;
+    }
+
+    // Stored streams whose control entries reach past the end of the diff stream.
+    uint8_t crafted[160] = "QBDB2", add[9];
+    size_t add_len = put_varint(c.old_len, add), crafted_len = 136;
+    crafted_len += put_varint(add_len, crafted + crafted_len);
+    crafted_len += put_varint(1, crafted + crafted_len);
+    memcpy(crafted + crafted_len, add, add_len);
+    crafted_len += add_len;
+    crafted_len += put_varint(0, crafted + crafted_len);
+    crafted_len += put_varint(0, crafted + crafted_len);
+    wi64(c.old_len, crafted + 69);
+    wi64(c.old_len, crafted + 77);
+    for (int i = 0; i < 3; i++) {
+        int64_t len = i == 0 ? (int64_t)crafted_len - 136 : i == 1;
+        crafted[85 + 17 * i] = 0x02;
+        wi64(len, crafted + 86 + 17 * i);
+        wi64(len, crafted + 94 + 17 * i);
+    }
+    crafted_len++;
+    CHECK(apply(c.old, c.old_len, crafted, crafted_len, &out, &out_len) == QBERR_BADPATCH, "overlong add accepted");
+    free(out);
+    CHECK(qbdiff_verify(c.old, crafted, c.old_len, crafted_len, &options) == QBERR_BADPATCH, "overlong add verified");
+
+    free(other);
+    free(patch);
+    corpus_free(&c);
+    printf("%-28s done\n", "damaged patches");
+}
+
+// BCJ filter selection from ELF and PE headers, seen in the codec byte of full patches.
+static void filters(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_RELOC, 100000, 9, &c)) exit(99);
+    static const struct {
+        const char * name;
+        const char * header;
+        size_t len;
+        uint8_t codec;
+    } cases[] = {
+        { "elf x86-64", "\x7f" "ELF\x02\x01\x01\0\0\0\0\0\0\0\0\0\x03\0\x3e\0", 20, 0x10 },
+        { "pe i386", "MZ", 2, 0x10 },
+        { "unknown", "\x7f" "ELF\x02\x01\x01\0\0\0\0\0\0\0\0\0\x03\0\x08\0", 20, 0x00 },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        memcpy(c.new, cases[i].header, cases[i].len);
+        if (!strcmp(cases[i].name, "pe i386")) {
+            c.new[60] = 0x80, c.new[61] = c.new[62] = c.new[63] = 0;
+            memcpy(c.new + 0x80, "PE\0\0\x4c\x01", 6);
+        }
+        size_t patch_len;
+        uint8_t * patch = make_bare_patch(c.old, 0, c.new, c.new_len, &patch_len);
+        CHECK(patch_len > 78 && !memcmp(patch, "QBDF2", 5) && patch[69] == cases[i].codec, "%s: codec %d",
+              cases[i].name, patch_len > 78 ? patch[69] : -1);
+        free(patch);
+        roundtrip(cases[i].name, c.old, 0, c.new, c.new_len);
+        roundtrip(cases[i].name, c.old, c.old_len, c.new, c.new_len);
+    }
+    corpus_free(&c);
+}
+
+// Random data, inserted or on its own, is stored rather than compressed.
+static void stored(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_OVERWRITE, 300000, 17, &c)) exit(99);
+    size_t len = 100000, patch_len;
+    const uint8_t *old = c.old, *fresh = c.old + len;
+    uint8_t * new = malloc(2 * len);
+    if (!new) exit(99);
+    memcpy(new, old, len / 2);
+    memcpy(new + len / 2, fresh, len);
+    memcpy(new + len + len / 2, old + len / 2, len / 2);
+
+    uint8_t * patch = make_bare_patch(old, len, new, 2 * len, &patch_len);
+    CHECK(patch_len > 136 && !memcmp(patch, "QBDB2", 5) && patch[119] == 0x02, "random extra data compressed");
+    free(patch);
+    roundtrip("stored extra", old, len, new, 2 * len);
+    patch = make_bare_patch(old, 0, fresh, len, &patch_len);
+    CHECK(patch_len == 78 + len && patch[69] == 0x02, "random file compressed");
+    free(patch);
+    roundtrip("stored full", old, 0, fresh, len);
+    free(new);
+    corpus_free(&c);
+}
+
+// A full copy of the new file racing the diff: it wins on unrelated data, and whichever wins
+// on a new file that shares only its start with the old one must apply.
+static void race(void) {
+    struct corpus text, code;
+    if (corpus_generate(CORPUS_TEXT, 300000, 19, &text) || corpus_generate(CORPUS_RELOC, 300000, 19, &code))
+        exit(99);
+    size_t len = 300000, patch_len;
+    options.threads = 4;
+
+    uint8_t * patch = make_bare_patch(text.old, len, code.old, len, &patch_len);
+    CHECK(patch_len > 78 && !memcmp(patch, "QBDF2", 5), "diff of unrelated files kept");
+    free(patch);
+    roundtrip("race unrelated", text.old, len, code.old, len);
+
+    uint8_t * new = malloc(len);
+    if (!new) exit(99);
+    memcpy(new, text.old, len / 3);
+    memcpy(new + len / 3, code.old, len - len / 3);
+    roundtrip("race mostly new", text.old, len, new, len);
+
+    options.threads = 0;
+    free(new);
+    corpus_free(&text);
+    corpus_free(&code);
+}
+
+// Estimates land near the real patch size, and their interval around them.
+static void estimates(void) {
+    for (int k = 0; k < CORPUS_KINDS; k++) {
+        struct corpus c;
+        struct qbdiff_estimate est;
+        size_t patch_len;
+        if (corpus_generate(k, 1000000, 11, &c)) exit(99);
+        int ret = qbdiff_estimate(c.old, c.new, c.old_len, c.new_len, &est, &options);
+        free(make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len));
+        CHECK(ret == QBERR_OK, "%s: qbdiff_estimate returned %d", corpus_kind_name(k), ret);
+        CHECK(est.low <= est.size && est.size <= est.high && est.sampled > 0 && est.sampled <= 1,
+              "%s: bad interval", corpus_kind_name(k));
+        CHECK(est.size <= 3 * (int64_t)patch_len && patch_len <= 3 * (size_t)est.size, "%s: estimate off",
+              corpus_kind_name(k));
+        printf("%-28s estimate %8lld [%lld, %lld] patch %8zu\n", corpus_kind_name(k), (long long)est.size,
+               (long long)est.low, (long long)est.high, patch_len);
+
+        qbdiff_estimate(c.old, c.old, c.old_len, c.old_len, &est, &options);
+        CHECK(est.size < 1000 && est.low == est.high, "%s: identical files", corpus_kind_name(k));
+        corpus_free(&c);
+    }
+
+    // Large enough to be sampled.
+    struct corpus c;
+    struct qbdiff_estimate est;
+    if (corpus_generate(CORPUS_INSERT, 8 << 20, 11, &c)) exit(99);
+    qbdiff_estimate(c.old, c.new, c.old_len, c.new_len, &est, &options);
+    CHECK(est.sampled < 0.5 && est.low < est.size && est.size < est.high, "sampled estimate");
+    corpus_free(&c);
+
+    if (corpus_generate(CORPUS_OVERWRITE, 300000, 13, &c)) exit(99);
+    qbdiff_estimate(c.old, c.old + 150000, 150000, 150000, &est, &options);
+    CHECK(est.size == est.full && est.full >= 140000 && est.full <= 160000, "unrelated random files");
+    qbdiff_estimate(c.old, c.new, 100, 100, &est, &options);
+    CHECK(est.size == est.full, "small files");
+    corpus_free(&c);
+}
+
+// Ranges of a seekable patch, and the blocks left intact by damage to one of them.
+static void seekable(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_MIXED, 300000, 23, &c)) exit(99);
+    size_t patch_len;
+    uint8_t * patch = make_bare_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    uint8_t * out = malloc(c.new_len);
+    if (!out) exit(99);
+    CHECK(!memcmp(patch, "QBDS1", 5), "seekable patch not written");
+
+    static const int64_t ranges[][2] = { { 0, 1 }, { 0, 4096 }, { 4095, 2 }, { 5000, 20000 }, { 8192, 4096 },
+                                         { 123457, 54321 }, { 0, -1 }, { -1, 1 } };
+    for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++) {
+        int64_t off = ranges[i][0], len = ranges[i][1] < 0 ? (int64_t)c.new_len : ranges[i][1];
+        if (off < 0) off = c.new_len - len;
+        int ret = qbdiff_patch_range(c.old, patch, c.old_len, patch_len, off, len, out, &options);
+        CHECK(ret == QBERR_OK && !memcmp(out, c.new + off, len), "range %lld+%lld", (long long)off, (long long)len);
+    }
+    int ret = qbdiff_patch_range(c.old, patch, c.old_len, patch_len, c.new_len - 10, 11, out, &options);
+    CHECK(ret == QBERR_BADPATCH, "range past the end accepted");
+
+    // Streamed in, a patch is rebuilt up to the first block it lacks.
+    size_t out_len;
+    uint8_t * streamed;
+    ret = apply_stream(c.old, c.old_len, patch, patch_len, &streamed, &out_len);
+    CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(streamed, c.new, c.new_len), "streamed patch differs");
+    free(streamed);
+    ret = apply_stream(c.old, c.old_len, patch, patch_len - 1, &streamed, &out_len);
+    CHECK(ret == QBERR_TRUNCPATCH && out_len < c.new_len && !memcmp(streamed, c.new, out_len),
+          "truncated stream accepted");
+    free(streamed);
+    options.seekable = 0;
+    size_t whole_len;
+    uint8_t * whole = make_patch(c.old, c.old_len, c.new, c.new_len, &whole_len);
+    options.seekable = 4096;
+    ret = apply_stream(c.old, c.old_len, whole, whole_len, &streamed, &out_len);
+    CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(streamed, c.new, c.new_len), "streamed QBDB2 differs");
+    free(streamed);
+    free(whole);
+
+    // Damage to the streams of block 10 spoils it alone.
+    int64_t off = ri64(patch + 93 + 10 * 131);
+    patch[off + ri64(patch + 93 + 10 * 131 + 17) / 2] ^= 0x10;
+    CHECK(qbdiff_patch_range(c.old, patch, c.old_len, patch_len, 10 * 4096, 10, out, &options) != QBERR_OK,
+          "damaged block accepted");
+    CHECK(qbdiff_patch_range(c.old, patch, c.old_len, patch_len, 0, 10 * 4096, out, &options) == QBERR_OK &&
+              !memcmp(out, c.new, 10 * 4096),
+          "blocks before the damage lost");
+    CHECK(qbdiff_patch_range(c.old, patch, c.old_len, patch_len, 11 * 4096, 4096, out, &options) == QBERR_OK &&
+              !memcmp(out, c.new + 11 * 4096, 4096),
+          "blocks after the damage lost");
+
+    free(out);
+    free(patch);
+    corpus_free(&c);
+    printf("%-28s done\n", "seekable ranges");
+}
+
+// The fingerprint of the old file turns another old file down before the patch is decoded,
+// unless it differs only between the samples, which the full hash catches.
+static void fingerprints(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_INSERT, 1 << 20, 29, &c)) exit(99);
+    size_t patch_len, out_len, gap = 4096 + ((c.old_len - 4096) / 63 - 4096) / 2;
+    uint8_t *out, *patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    CHECK(patch_len > 78 && !memcmp(patch, "QBDO1", 5) && !patch[5], "sampled fingerprint not written");
+
+    c.old[0] ^= 1;
+    CHECK(apply(c.old, c.old_len, patch, patch_len, &out, &out_len) == QBERR_BADOLD, "changed old accepted");
+    free(out);
+    CHECK(apply_stream(c.old, c.old_len, patch, patch_len, &out, &out_len) == QBERR_BADOLD && !out_len,
+          "changed old accepted from a stream");
+    free(out);
+    CHECK(qbdiff_verify(c.old, patch, c.old_len, patch_len, &options) == QBERR_BADOLD, "changed old verified");
+    c.old[0] ^= 1;
+    c.old[gap] ^= 1;
+    int ret = apply(c.old, c.old_len, patch, patch_len, &out, &out_len);
+    CHECK(ret != QBERR_OK && ret != QBERR_BADOLD, "change between samples: %d", ret);
+    free(out);
+    free(patch);
+
+    c.old[gap] ^= 1;
+    options.fingerprint = 1;
+    patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    c.old[gap] ^= 1;
+    CHECK(patch[5] == 1 && apply(c.old, c.old_len, patch, patch_len, &out, &out_len) == QBERR_BADOLD,
+          "full fingerprint missed a change");
+    free(out);
+    c.old[gap] ^= 1;
+    free(patch);
+    options.fingerprint = -1;
+    patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    CHECK(memcmp(patch, "QBDO1", 5), "fingerprint written");
+    free(patch);
+    options.fingerprint = 0;
+
+    // Seekable patches check it for ranges too.
+    options.seekable = 4096;
+    patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    out = malloc(4096);
+    if (!out) exit(99);
+    ret = qbdiff_patch_range(c.old, patch, c.old_len, patch_len, 0, 4096, out, &options);
+    CHECK(ret == QBERR_OK && !memcmp(out, c.new, 4096), "range of a fingerprinted patch");
+    c.old[0] ^= 1;
+    ret = qbdiff_patch_range(c.old, patch, c.old_len, patch_len, 0, 4096, out, &options);
+    CHECK(ret == QBERR_BADOLD, "range against a changed old: %d", ret);
+    options.seekable = 0;
+    free(out);
+    free(patch);
+    corpus_free(&c);
+    printf("%-28s done\n", "old file fingerprints");
+}
+
+// A child can be killed at its crash_at-th sync, as if the power went out there. This takes
+// effect only because the library resolves fsync to this definition rather than the one of the
+// C library: at link time in the builds that compile the library in, and through symbol
+// interposition, hence the default visibility, when it is a shared library.
+static int syncs, crash_at;
+
+__attribute__((visibility("default"))) int fsync(int fd) {
+    if (crash_at && ++syncs == crash_at) raise(SIGKILL);
+    return fdatasync(fd);
+}
+
+struct patch_job {
+    const uint8_t *old, *patch;
+    size_t old_len, patch_len;
+    const char *path, *aside;  // The file patched, and its journal or checkpoint.
+};
+
+static int job_in_place(const struct patch_job * job) {
+    return qbdiff_patch_in_place(job->path, job->patch, job->patch_len, job->aside, &options);
+}
+
+static int job_resume(const struct patch_job * job) {
+    return qbdiff_patch_resume(job->old, job->patch, job->old_len, job->patch_len, job->path, job->aside, &options);
+}
+
+// Runs a job in a child that crashes at the given sync. Returns its result, or -1 if it crashed.
+static int crashing(int (*fn)(const struct patch_job * job), const struct patch_job * job, int at) {
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) exit(99);
+    if (!pid) {
+        // A forked child has none of the threads of the OpenMP runtime, which would wait on them.
+        crash_at = at;
+        options.threads = 1;
+        _exit(fn(job));
+    }
+    int status;
+    if (waitpid(pid, &status, 0) != pid) exit(99);
+    return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// In-place patches turn a file into the new one over its own storage. Moved sections make
+// blocks read each other's places, which a spill buffer or, without one, literal blocks take
+// care of. Each call runs in a forked child killed at one of its first few syncs, and is run
+// again until it completes, which checks that the journal resumes from wherever it crashed.
+static void in_place(void) {
+    static const int kinds[] = { CORPUS_INSERT, CORPUS_DELETE, CORPUS_MOVE, CORPUS_MIXED };
+    char path[256], journal[264];
+    temp_path(path);
+    snprintf(journal, sizeof(journal), "%s.journal", path);
+    options.seekable = 4096;
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        struct corpus c;
+        if (corpus_generate(kinds[i], 300000, 31, &c)) exit(99);
+        size_t sizes[2];
+        for (int spill = 0; spill < 2; spill++) {
+            options.in_place = spill ? 64 << 10 : 1;
+            size_t patch_len, out_len;
+            uint8_t *out, *patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+            sizes[spill] = patch_len;
+            CHECK(!memcmp(patch + 78, "QBDI1", 5), "%s: in-place patch not written", corpus_kind_name(kinds[i]));
+            int ret = apply(c.old, c.old_len, patch, patch_len, &out, &out_len);
+            CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(out, c.new, c.new_len), "%s: qbdiff_patch: %d",
+                  corpus_kind_name(kinds[i]), ret);
+            free(out);
+
+            // Crashes at a few syncs into each call, which make a record or two.
+            struct patch_job job = { NULL, patch, 0, patch_len, path, journal };
+            write_path(path, c.old, c.old_len);
+            int calls = 0;
+            while ((ret = crashing(job_in_place, &job, 3 + calls % 4)) < 0 && ++calls < 1000) continue;
+            out = read_path(path, &out_len);
+            CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(out, c.new, c.new_len),
+                  "%s: patched in place: %d", corpus_kind_name(kinds[i]), ret);
+            CHECK(access(journal, F_OK), "%s: journal left behind", corpus_kind_name(kinds[i]));
+            free(out);
+
+            // The new file is not the old one any more.
+            ret = qbdiff_patch_in_place(path, patch, patch_len, journal, &options);
+            CHECK(ret == QBERR_BADOLD && access(journal, F_OK), "%s: patched twice: %d", corpus_kind_name(kinds[i]),
+                  ret);
+            free(patch);
+        }
+        CHECK(sizes[1] <= sizes[0], "%s: spill buffer made the patch larger", corpus_kind_name(kinds[i]));
+        printf("%-28s patch %8zu, %8zu with no spill buffer\n", corpus_kind_name(kinds[i]), sizes[1], sizes[0]);
+        corpus_free(&c);
+    }
+    options.in_place = 0;
+    options.seekable = 0;
+    remove(path);
+    printf("%-28s done\n", "in-place patches");
+}
+
+// Resumable patching leaves a checkpoint behind when it crashes, once test builds that record
+// one every 4K have written some, and then keeps the blocks done, from the first damaged one on.
+static void resumable(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_MIXED, 300000, 37, &c)) exit(99);
+    char path[256], checkpoint[268];
+    temp_path(path);
+    snprintf(checkpoint, sizeof(checkpoint), "%s.checkpoint", path);
+    options.seekable = 4096;
+    size_t patch_len, out_len;
+    uint8_t *out, *patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    struct patch_job job = { c.old, patch, c.old_len, patch_len, path, checkpoint };
+    int ret, calls = 0;
+
+    // A file that is not a checkpoint is left alone.
+    write_path(checkpoint, c.new, 1000);
+    ret = qbdiff_patch_resume(c.old, patch, c.old_len, patch_len, path, checkpoint, &options);
+    out = read_path(checkpoint, &out_len);
+    CHECK(ret == QBERR_IOERR && out_len == 1000 && !memcmp(out, c.new, 1000), "other file overwritten: %d", ret);
+    free(out);
+    remove(checkpoint);
+
+    while ((ret = crashing(job_resume, &job, 3 + calls % 4)) < 0 && ++calls < 1000) {
+        if (calls != 2) continue;
+        out = read_path(path, &out_len);
+        out[100] ^= 1;
+        write_path(path, out, out_len);
+        free(out);
+    }
+    out = read_path(path, &out_len);
+    CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(out, c.new, c.new_len), "resumed patch: %d", ret);
+    CHECK(access(checkpoint, F_OK), "checkpoint left behind");
+    free(out);
+    free(patch);
+
+    // Other patches start over, and a longer file left behind is cut to size.
+    options.seekable = 0;
+    patch = make_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    write_path(path, c.old, c.old_len);
+    ret = qbdiff_patch_resume(c.old, patch, c.old_len, patch_len, path, checkpoint, &options);
+    out = read_path(path, &out_len);
+    CHECK(ret == QBERR_OK && out_len == c.new_len && !memcmp(out, c.new, c.new_len), "resumed QBDB2: %d", ret);
+    free(out);
+    free(patch);
+    remove(path);
+    corpus_free(&c);
+    printf("%-28s done\n", "resumable patching");
+}
+
+// A host thread pool of one thread. A lazy host holds its tasks back until the diff is done.
+struct host {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    struct host_task {
+        void (*fn)(void * arg);
+        void * arg;
+    } * tasks;
+    int head, tail, cap, submitted, lazy, stop;
+};
+
+static void host_submit(void * h, void (*fn)(void * arg), void * arg) {
+    struct host * host = h;
+    pthread_mutex_lock(&host->lock);
+    if (host->tail == host->cap) {
+        host->cap = host->cap * 2 + 64;
+        if (!(host->tasks = realloc(host->tasks, host->cap * sizeof(struct host_task)))) exit(99);
+    }
+    host->tasks[host->tail++] = (struct host_task){ fn, arg };
+    host->submitted++;
+    pthread_cond_signal(&host->cond);
+    pthread_mutex_unlock(&host->lock);
+}
+
+static void * host_thread(void * h) {
+    struct host * host = h;
+    pthread_mutex_lock(&host->lock);
+    while (!host->stop || host->head != host->tail) {
+        if (host->head == host->tail || (host->lazy && !host->stop)) {
+            pthread_cond_wait(&host->cond, &host->lock);
+            continue;
+        }
+        struct host_task t = host->tasks[host->head++];
+        pthread_mutex_unlock(&host->lock);
+        t.fn(t.arg);
+        pthread_mutex_lock(&host->lock);
+    }
+    pthread_mutex_unlock(&host->lock);
+    return NULL;
+}
+
+// Diffs on a host executor, which must see the tasks and need not run them before the diff
+// is done.
+static void executor(void) {
+    for (int lazy = 0; lazy < 2; lazy++) {
+        struct host host = { .lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER, .lazy = lazy };
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, host_thread, &host)) exit(99);
+        options.executor = (struct qbdiff_executor){ host_submit, &host };
+        options.threads = 4;
+        corpora(lazy ? "/lazy-host" : "/host");
+        race();
+
+        struct corpus c;
+        struct qbdiff_estimate est;
+        if (corpus_generate(CORPUS_MIXED, 1000000, 11, &c)) exit(99);
+        CHECK(qbdiff_estimate(c.old, c.new, c.old_len, c.new_len, &est, &options) == QBERR_OK && est.size > 0,
+              "estimate on a host executor");
+        corpus_free(&c);
+
+        pthread_mutex_lock(&host.lock);
+        host.stop = 1;
+        pthread_cond_signal(&host.cond);
+        pthread_mutex_unlock(&host.lock);
+        pthread_join(thread, NULL);
+        CHECK(host.submitted > 0, "host executor unused");
+        free(host.tasks);
+        options.executor = (struct qbdiff_executor){ 0 };
+        options.threads = 0;
+    }
+}
+
+// Turns the start of a file into an ELF64 header with one executable segment over the file.
+static void make_elf(uint8_t * data, size_t len, uint8_t machine) {
+    memset(data, 0, 120);
+    memcpy(data, "\x7f" "ELF\x02\x01\x01", 7);
+    data[16] = 3;
+    data[18] = machine;
+    data[32] = 64;  // e_phoff
+    data[54] = 56;  // e_phentsize
+    data[56] = 1;   // e_phnum
+    data[64] = 1;   // PT_LOAD
+    data[68] = 5;   // PF_R | PF_X
+    for (int i = 0; i < 8; i++) data[96 + i] = (uint64_t)len >> (8 * i);  // p_filesz
+}
+
+// Branch normalization of relocated code, and patches with a damaged normalization map.
+static void normalization(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_RELOC, 300000, 13, &c)) exit(99);
+    make_elf(c.old, c.old_len, 62);
+    make_elf(c.new, c.new_len, 62);
+
+    size_t plain_len, patch_len, out_len;
+    uint8_t *out, *patch;
+    free(make_patch(c.old, c.old_len, c.new, c.new_len, &plain_len));
+    options.normalize = 1;
+    patch = make_bare_patch(c.old, c.old_len, c.new, c.new_len, &patch_len);
+    CHECK(patch_len > 153 && !memcmp(patch, "QBDN2", 5), "x86-64 elf: not normalized");
+    CHECK(patch_len < plain_len, "x86-64 elf: patch of %zu bytes, %zu without normalization", patch_len, plain_len);
+    roundtrip("elf x86-64", c.old, c.old_len, c.new, c.new_len);
+
+    // The normalization map is the last stream of the patch.
+    size_t map_len = patch_len > 153 ? (size_t)ri64(patch + 137) : 0;
+    for (size_t pos = patch_len - map_len; pos < patch_len; pos += 1 + map_len / 17) {
+        patch[pos] ^= 0x04;
+        CHECK(apply(c.old, c.old_len, patch, patch_len, &out, &out_len) != QBERR_OK, "map bit flip at %zu accepted",
+              pos);
+        CHECK(qbdiff_verify(c.old, patch, c.old_len, patch_len, &options) != QBERR_OK, "map bit flip at %zu verified",
+              pos);
+        free(out);
+        patch[pos] ^= 0x04;
+    }
+    CHECK(apply(c.old, c.old_len, patch, patch_len - 1, &out, &out_len) != QBERR_OK, "truncated map accepted");
+    free(out);
+    free(patch);
+
+    make_elf(c.old, c.old_len, 183);
+    make_elf(c.new, c.new_len, 183);
+    roundtrip("elf arm64", c.old, c.old_len, c.new, c.new_len);
+
+    // Code shifted by 64 bytes with its branches left as they were, which normalization would
+    // rewrite all across the shifted region: the plain diff is kept.
+    uint8_t * shifted = malloc(c.old_len);
+    if (!shifted) exit(99);
+    size_t at = c.old_len / 3;
+    make_elf(c.old, c.old_len, 62);
+    memcpy(shifted, c.old, c.old_len);
+    memcpy(shifted + at + 64, c.old + at, c.old_len / 3);
+    memset(shifted + at, 0x90, 64);
+    options.normalize = 0;
+    free(make_patch(c.old, c.old_len, shifted, c.old_len, &plain_len));
+    options.normalize = 1;
+    patch = make_patch(c.old, c.old_len, shifted, c.old_len, &patch_len);
+    CHECK(patch_len <= plain_len, "shifted elf: patch of %zu bytes, %zu without normalization", patch_len,
+          plain_len);
+    free(patch);
+    roundtrip("shifted elf", c.old, c.old_len, shifted, c.old_len);
+    options.normalize = 0;
+    free(shifted);
+    corpus_free(&c);
+}
+
+// Varints of the control stream at the edges of each encoded length.
+static void varints(void) {
+    uint8_t buf[32] = { 0 };
+    for (int bits = 0; bits <= 64; bits++) {
+        for (int d = -1; d <= 1; d++) {
+            uint64_t v = (bits == 64 ? 0 : 1ULL << bits) + d, w;
+            size_t n = put_varint(v, buf);
+            CHECK(get_varint(buf, &w) == n && w == v, "varint %llu", (unsigned long long)v);
+            int64_t sv = (int64_t)v;
+            CHECK(unzigzag(zigzag(sv)) == sv, "zigzag %lld", (long long)sv);
+        }
+    }
+    printf("%-28s done\n", "varints");
+}
+
+// A patch made by qbdiff 1.x, in the QBDB1 format with fixed-width control entries, from the
+// text corpus of 2000 bytes with seed 11.
+static const uint8_t legacy_patch[] = {
+    0x51, 0x42, 0x44, 0x42, 0x31, 0x4e, 0x64, 0xfe, 0xc4, 0xcf, 0xc0, 0x6a,
+    0xae, 0x9f, 0xd1, 0x1b, 0xef, 0x88, 0xe9, 0x79, 0xea, 0x7e, 0x44, 0x51,
+    0x52, 0x5d, 0x61, 0xbd, 0xe5, 0xf3, 0x86, 0x18, 0x9c, 0x72, 0x95, 0xa6,
+    0x19, 0xec, 0x2c, 0x8b, 0x84, 0x3a, 0x8b, 0x3e, 0x70, 0x25, 0xd3, 0xcb,
+    0xf2, 0x41, 0x44, 0x50, 0x7a, 0x9f, 0xee, 0x30, 0xa1, 0xd7, 0xe4, 0xb2,
+    0x83, 0x27, 0x6f, 0xd5, 0xe7, 0x80, 0x1d, 0xcf, 0xea, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x07, 0xd0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x08,
+    0x5f, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x78, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0xa0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0xa0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xc0, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x07, 0xca, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x95, 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4,
+    0x46, 0x02, 0x00, 0x21, 0x01, 0x1a, 0x00, 0x00, 0x00, 0xcc, 0x90, 0x33,
+    0xe9, 0xe0, 0x00, 0xbf, 0x00, 0x38, 0x5d, 0x00, 0x00, 0x69, 0x7e, 0xee,
+    0x31, 0x2a, 0x43, 0x9f, 0x7b, 0x13, 0xfb, 0xf2, 0xa6, 0x5a, 0x31, 0x56,
+    0x6d, 0x92, 0x90, 0xab, 0xa0, 0x33, 0xb1, 0xb4, 0xa3, 0x5e, 0xcd, 0xbc,
+    0x1e, 0x12, 0xfe, 0x8b, 0xd5, 0x3f, 0xd7, 0x23, 0x16, 0xe2, 0x1d, 0x2f,
+    0x6a, 0xd0, 0xbb, 0xc5, 0x53, 0x5f, 0x08, 0x48, 0xd5, 0x18, 0x55, 0xd3,
+    0x85, 0x55, 0x00, 0x00, 0x00, 0xd6, 0xd6, 0x56, 0xd1, 0x44, 0x44, 0xb7,
+    0xb8, 0x00, 0x01, 0x54, 0xc0, 0x01, 0x00, 0x00, 0x00, 0x82, 0x11, 0xe3,
+    0x05, 0xb1, 0xc4, 0x67, 0xfb, 0x02, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59,
+    0x5a, 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00, 0x04, 0xe6, 0xd6, 0xb4,
+    0x46, 0x02, 0x00, 0x21, 0x01, 0x1a, 0x00, 0x00, 0x00, 0xcc, 0x90, 0x33,
+    0xe9, 0xe0, 0x07, 0xc9, 0x00, 0x5e, 0x5d, 0x00, 0x00, 0x6f, 0xfd, 0xff,
+    0xff, 0x85, 0x97, 0x26, 0xd1, 0xd8, 0x84, 0x1f, 0xbb, 0x8b, 0xc5, 0x85,
+    0x23, 0x19, 0x1e, 0xc3, 0xcb, 0x27, 0x9b, 0xb6, 0x3b, 0x78, 0x8c, 0xe0,
+    0x9d, 0x00, 0x21, 0xf1, 0xe8, 0x76, 0x82, 0xcb, 0x74, 0x76, 0x04, 0xf2,
+    0x18, 0xdb, 0x64, 0x8f, 0x1f, 0xb3, 0xda, 0x5a, 0xf1, 0x51, 0x6c, 0xc7,
+    0x51, 0xf9, 0x71, 0x5e, 0x6c, 0xd7, 0x88, 0x02, 0x4b, 0x90, 0x35, 0x1d,
+    0x4b, 0xcc, 0x0d, 0x62, 0x73, 0xcd, 0x08, 0x40, 0x83, 0x94, 0xb4, 0x0e,
+    0x36, 0x1f, 0x17, 0xc4, 0x33, 0x52, 0x6d, 0x0c, 0xa3, 0x93, 0xf9, 0x94,
+    0x09, 0xc5, 0x69, 0x5f, 0x2f, 0x58, 0x00, 0x00, 0x00, 0xcd, 0x73, 0xe0,
+    0x59, 0xd9, 0x39, 0xe3, 0x27, 0x00, 0x01, 0x7a, 0xca, 0x0f, 0x00, 0x00,
+    0x00, 0x56, 0x1a, 0x2a, 0x92, 0xb1, 0xc4, 0x67, 0xfb, 0x02, 0x00, 0x00,
+    0x00, 0x00, 0x04, 0x59, 0x5a, 0xfd, 0x37, 0x7a, 0x58, 0x5a, 0x00, 0x00,
+    0x04, 0xe6, 0xd6, 0xb4, 0x46, 0x02, 0x00, 0x21, 0x01, 0x1a, 0x00, 0x00,
+    0x00, 0xcc, 0x90, 0x33, 0xe9, 0xe0, 0x00, 0x94, 0x00, 0x5e, 0x5d, 0x00,
+    0x35, 0x98, 0x5e, 0x04, 0x40, 0x6d, 0x35, 0xca, 0x6b, 0x22, 0x4f, 0xea,
+    0xd9, 0xdc, 0x57, 0x81, 0x4b, 0x6a, 0x61, 0x4e, 0xb5, 0x3a, 0xdf, 0xe2,
+    0x48, 0x36, 0x6b, 0xe8, 0xc9, 0x04, 0x61, 0x9d, 0x79, 0xc5, 0x41, 0x2e,
+    0x4a, 0x71, 0x1e, 0x42, 0x14, 0x6f, 0x40, 0xff, 0x2a, 0x03, 0x92, 0xf4,
+    0x10, 0x0d, 0xf7, 0x0a, 0x74, 0xdb, 0x46, 0x5a, 0xa0, 0x4d, 0xf9, 0x4b,
+    0x8c, 0xa6, 0x60, 0x4f, 0x7e, 0x46, 0xd3, 0x45, 0x60, 0xb4, 0x15, 0x35,
+    0x8f, 0x28, 0xfe, 0x1f, 0x3b, 0x2f, 0x3d, 0xbf, 0xda, 0x91, 0x35, 0x51,
+    0xc9, 0x01, 0xdf, 0x57, 0x6c, 0x89, 0x09, 0xff, 0x66, 0x00, 0x00, 0x00,
+    0x00, 0x74, 0xc7, 0x65, 0x44, 0x75, 0xb2, 0xb5, 0xed, 0x00, 0x01, 0x7a,
+    0x95, 0x01, 0x00, 0x00, 0x00, 0x7f, 0x35, 0xb6, 0xc8, 0xb1, 0xc4, 0x67,
+    0xfb, 0x02, 0x00, 0x00, 0x00, 0x00, 0x04, 0x59, 0x5a,
+};
+
+static void legacy(void) {
+    struct corpus c;
+    if (corpus_generate(CORPUS_TEXT, 2000, 11, &c)) exit(99);
+    size_t out_len;
+    uint8_t * out;
+    int ret = apply(c.old, c.old_len, legacy_patch, sizeof(legacy_patch), &out, &out_len);
+    CHECK(ret == QBERR_OK, "QBDB1 patch: qbdiff_patch returned %d", ret);
+    CHECK(out_len == c.new_len && !memcmp(out, c.new, c.new_len), "QBDB1 patch: output differs");
+    free(out);
+    corpus_free(&c);
+    printf("%-28s done\n", "QBDB1 patch");
+}
+
+int main(void) {
+    qbdiff_options_init(&options);
+    corpora("");
+    edge_cases();
+    damaged_patches();
+    fingerprints();
+    varints();
+    legacy();
+    filters();
+    stored();
+    race();
+    normalization();
+    estimates();
+    executor();
+
+    options.block_size = 64;
+    corpora("/blocks");
+    edge_cases();
+
+    options.block_size = 0;
+    options.engine = QBDIFF_ENGINE_HASH;
+    corpora("/hash");
+    edge_cases();
+
+    options.engine = QBDIFF_ENGINE_SA;
+    options.filter = QBDIFF_FILTER_X86;
+    options.filter_streams = QBDIFF_STREAM_DIFF | QBDIFF_STREAM_EXTRA | QBDIFF_STREAM_FULL;
+    corpora("/x86");
+    edge_cases();
+    damaged_patches();
+    normalization();
+    options.filter = QBDIFF_FILTER_AUTO;
+    options.filter_streams = 0;
+
+    options.extra_dict = 1;
+    corpora("/dict");
+    edge_cases();
+    damaged_patches();
+    options.extra_dict = 0;
+
+    options.seekable = 4096;
+    corpora("/seekable");
+    edge_cases();
+    damaged_patches();
+    seekable();
+    options.seekable = 0;
+    in_place();
+    resumable();
+
+    // A limit this small splits the larger old files into several suffix array windows.
+    const char * tmpdir = getenv("TMPDIR");
+    options.block_size = -1;
+    options.scratch_dir = tmpdir ? tmpdir : "/tmp";
+    options.memory_limit = 200000;
+    corpora("/ooc");
+    edge_cases();
+
+    if (failures) printf("%d check(s) failed.\n", failures);
+    return failures ? 1 : 0;
+}